@@ -0,0 +1,71 @@
+# flash and RAM of an executable and of the region code linked in it, run by the <target>_size_report targets of
+# pico_lorawan_size_report:
+#   cmake -DSIZE=<size tool> -DELF=<executable> -DOBJECTS=<object folder of the target> -DREGIONS=<regions, comma separated>
+#         [-DNM=<nm tool>] -P size-report.cmake
+# flash is text + data (the initial values of data are copied from flash), RAM is data + bss. The objects are measured
+# before the linker drops the sections nobody calls, their sizes are an upper bound of what they add to the image.
+# With NM the largest variables in RAM follow, the same report of two builds shows where the RAM went
+
+function(berkeley FILE TEXT DATA BSS)
+  execute_process(COMMAND ${SIZE} ${FILE} OUTPUT_VARIABLE OUT RESULT_VARIABLE RSLT)
+  if (NOT RSLT EQUAL 0 OR NOT OUT MATCHES "\n[ \t]*([0-9]+)[ \t]+([0-9]+)[ \t]+([0-9]+)[ \t]+[0-9]+")
+    message(FATAL_ERROR "${SIZE} ${FILE} failed: ${OUT}")
+  endif()
+  set(${TEXT} ${CMAKE_MATCH_1} PARENT_SCOPE)
+  set(${DATA} ${CMAKE_MATCH_2} PARENT_SCOPE)
+  set(${BSS} ${CMAKE_MATCH_3} PARENT_SCOPE)
+endfunction()
+
+get_filename_component(NAME ${ELF} NAME)
+string(REPLACE "," " " REGIONS "${REGIONS}")
+
+berkeley(${ELF} TEXT DATA BSS)
+math(EXPR FLASH "${TEXT} + ${DATA}")
+math(EXPR RAM "${DATA} + ${BSS}")
+
+file(GLOB_RECURSE REGION_OBJECTS ${OBJECTS}/Region*.o ${OBJECTS}/Region*.obj)
+list(SORT REGION_OBJECTS)
+
+set(ROWS "")
+set(REGION_FLASH 0)
+set(REGION_RAM 0)
+foreach(OBJECT IN LISTS REGION_OBJECTS)
+  berkeley(${OBJECT} TEXT DATA BSS)
+  math(EXPR OBJECT_FLASH "${TEXT} + ${DATA}")
+  math(EXPR OBJECT_RAM "${DATA} + ${BSS}")
+  math(EXPR REGION_FLASH "${REGION_FLASH} + ${OBJECT_FLASH}")
+  math(EXPR REGION_RAM "${REGION_RAM} + ${OBJECT_RAM}")
+  get_filename_component(SOURCE ${OBJECT} NAME_WE)
+  string(APPEND ROWS "| ${SOURCE}.c | ${OBJECT_FLASH} | ${OBJECT_RAM} |\n")
+endforeach()
+
+message("\n${NAME}, regions ${REGIONS}\n"
+        "| | flash (bytes) | RAM (bytes) |\n"
+        "|-|---------------|-------------|\n"
+        "| ${NAME} | ${FLASH} | ${RAM} |\n"
+        "| region code, objects | ${REGION_FLASH} | ${REGION_RAM} |\n"
+        "${ROWS}")
+
+if (NM)
+  execute_process(COMMAND ${NM} -S --size-sort ${ELF} OUTPUT_VARIABLE OUT RESULT_VARIABLE RSLT)
+  if (NOT RSLT EQUAL 0)
+    message(FATAL_ERROR "${NM} ${ELF} failed")
+  endif()
+  # address, size in hex, type and name, the list is sorted by size: the largest data and bss symbols are at the end
+  string(REGEX MATCHALL "[0-9a-fA-F]+ [0-9a-fA-F]+ [bBdD] [^\n]+" SYMBOLS "${OUT}")
+  list(REVERSE SYMBOLS)
+  list(LENGTH SYMBOLS COUNT)
+  if (COUNT GREATER 12)
+    list(SUBLIST SYMBOLS 0 12 SYMBOLS)
+  endif()
+  set(ROWS "")
+  foreach(SYMBOL IN LISTS SYMBOLS)
+    string(REGEX MATCH "^[0-9a-fA-F]+ ([0-9a-fA-F]+) [bBdD] (.+)$" _ "${SYMBOL}")
+    math(EXPR BYTES "0x${CMAKE_MATCH_1}")
+    string(APPEND ROWS "| ${CMAKE_MATCH_2} | ${BYTES} |\n")
+  endforeach()
+  message("largest variables in RAM\n"
+          "| symbol | RAM (bytes) |\n"
+          "|--------|-------------|\n"
+          "${ROWS}")
+endif()
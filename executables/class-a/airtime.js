@@ -0,0 +1,59 @@
+/*
+    airtime of the batch frames for every datarate of EU868, run with node airtime.js
+    the time on air follows the formula of the Semtech SX1262 datasheet (LoRa modem, explicit header, CRC on, CR 4/5)
+    and it is compared with the single 12 bytes struct uplink sent for every reading
+*/
+
+/* MHDR (1) + FHDR without FOpts (7) + FPort (1) + MIC (4) */
+var LORAWAN_OVERHEAD = 13;
+var PREAMBLE_SYMBOLS = 8;
+var CODING_RATE = 1; /* 4/5 */
+/* see lib/batch/batch.h */
+var BATCH_HEADER_LEN = 3;
+var BATCH_AGE_LEN = 2;
+var BATCH_RECORD_LEN = 10;
+var SINGLE_UPLINK_LEN = 12;
+/* duty cycle of the g1 sub-band */
+var DUTY_CYCLE = 0.01;
+
+/* EU868 datarates with the max application payload without FOpts */
+var DATARATES = [
+    { "dr": 0, "sf": 12, "bw": 125000, "max_payload": 51 },
+    { "dr": 1, "sf": 11, "bw": 125000, "max_payload": 51 },
+    { "dr": 2, "sf": 10, "bw": 125000, "max_payload": 51 },
+    { "dr": 3, "sf": 9,  "bw": 125000, "max_payload": 115 },
+    { "dr": 4, "sf": 8,  "bw": 125000, "max_payload": 222 },
+    { "dr": 5, "sf": 7,  "bw": 125000, "max_payload": 222 },
+];
+
+/* time on air in ms of a frame carrying payload_len bytes of application payload */
+function timeOnAir(dr, payload_len){
+    var pl = LORAWAN_OVERHEAD + payload_len;
+    var t_sym = Math.pow(2, dr.sf) / dr.bw * 1000;
+    /* low datarate optimization is mandatory when the symbol lasts 16 ms or more */
+    var de = t_sym >= 16 ? 1 : 0;
+    var n_payload = 8 + Math.max(Math.ceil((8 * pl - 4 * dr.sf + 28 + 16) / (4 * (dr.sf - 2 * de))) * (CODING_RATE + 4), 0);
+    return (PREAMBLE_SYMBOLS + 4.25) * t_sym + n_payload * t_sym;
+}
+
+function pad(value, len){
+    var s = String(value);
+    while(s.length < len)
+        s = " " + s;
+    return s;
+}
+
+DATARATES.forEach(function(dr){
+    var single = timeOnAir(dr, SINGLE_UPLINK_LEN);
+    var max_readings = Math.floor((dr.max_payload - BATCH_HEADER_LEN) / (BATCH_AGE_LEN + BATCH_RECORD_LEN));
+    console.log("DR" + dr.dr + " SF" + dr.sf + " - single uplink " + single.toFixed(1) + " ms per reading");
+    console.log("  readings  bytes  airtime[ms]  per reading[ms]  saved  max readings/h @1%");
+    for(var n = 1; n <= max_readings; n++){
+        var len = BATCH_HEADER_LEN + n * (BATCH_AGE_LEN + BATCH_RECORD_LEN);
+        var toa = timeOnAir(dr, len);
+        var per_reading = toa / n;
+        var per_hour = Math.floor(3600 * 1000 * DUTY_CYCLE / toa) * n;
+        console.log("  " + pad(n, 8) + pad(len, 7) + pad(toa.toFixed(1), 13) + pad(per_reading.toFixed(1), 17)
+            + pad(((1 - per_reading / single) * 100).toFixed(0) + "%", 7) + pad(per_hour, 20));
+    }
+});
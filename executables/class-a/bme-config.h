@@ -1,9 +1,22 @@
 #define PIN_FORMAT_OUTPUT   16
 #define PIN_FORMAT_INPUT    17
+#define MAX_SILENCE         6*12 /*highest number of readings without reporting any, a reading is reported anyway after that (heartbeat)*/
 #define SAVE_INTERVAL       6*24 /*number of readings before saving the state, each reading happens in an interval of 5 minutes*/
+#define BATCH_PORT          4   /*uplink port of the frames holding a batch of readings*/
+#define DELTA_PORT          5   /*uplink port of the frames holding a delta compressed series of readings*/
+#define DOWNLINK_PORT       10  /*downlink port of the command frames, their ack is appended to the next frame sent*/
+#define LINK_DIGEST_PORT    11  /*uplink port of the link telemetry digest, see src/include/pico/link-telemetry.h*/
+#define LINK_DIGEST_EVERY   24  /*frames sent between two digests, 0 to turn the digest off*/
+#define UPLINK_DELTA            /*comment out to send the readings of the batch as they are on BATCH_PORT*/
+#define UPLINK_QUEUE_CAPACITY   48  /*frames kept while the network is unreachable, two days with a frame every hour*/
+#define UPLINK_QUEUE_POLICY     UPLINK_QUEUE_DROP_OLDEST    /*what to drop when the queue is full, the newest readings are worth more*/
+#define UPLINK_QUEUE_DRAIN      3   /*highest number of confirmed uplinks sent after a reading*/
 
 const char* state_file_name = "state_file.config";
+const char* state_file_name_b = "state_file_b.config";
 const char* log_file_name = "file.log";
+const char* uplink_queue_file_name = "uplink_queue.log";
+const char* uplink_queue_tmp_name = "uplink_queue.tmp";
 /**
  * @brief saves the file on littlefs afters some time has passed
  * 
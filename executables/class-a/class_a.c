@@ -34,6 +34,15 @@ pico libraries used to handle the sensor
 
 /*pico libraries used to handle the filesystem*/
 #include "pico_hal.h"
+#include "../lib/state_store/state_store.h"
+#include "../lib/scratch/scratch.h"
+#include "../lib/stats/stats.h"
+#include "../lib/batch/batch.h"
+#include "../lib/tscodec/tscodec.h"
+#include "../lib/payload/payload.h"
+#include "../lib/deadband/deadband.h"
+#include "../lib/uplink_queue/uplink_queue.h"
+#include "../lib/downlink/downlink.h"
 
 // edit with LoRaWAN Node Region and ABP settings 
 #include "lora-config.h"
@@ -71,38 +80,60 @@ const struct lorawan_sx12xx_settings sx12xx_settings = {
     .dio1 = 20
 };
 
-/*
-    ABP settings
-*/ 
-const struct lorawan_abp_settings abp_settings = {
-    .device_address = LORAWAN_DEV_ADDR,
-    .network_session_key = LORAWAN_NETWORK_SESSION_KEY,
-    .app_session_key = LORAWAN_APP_SESSION_KEY,
-    .channel_mask = LORAWAN_CHANNEL_MASK
-};
+#ifdef LORAWAN_SINGLE_CHANNEL_FREQ
+#define SINGLE_CHANNEL_FLAG     PROVISION_SINGLE_CHANNEL
+#else
+#define SINGLE_CHANNEL_FLAG     0
+#define LORAWAN_SINGLE_CHANNEL_FREQ     0
+#define LORAWAN_SINGLE_CHANNEL_DR       0
+#endif
 
-/*
-    variables for receiving lora downlinks (if any)
-*/
-int receive_length = 0;
-uint8_t receive_buffer[242];
-uint8_t receive_port = 0;
+#ifdef LORAWAN_CHANNEL_MASK
+#define CHANNEL_MASK_FLAG       PROVISION_CHANNEL_MASK
+#else
+#define CHANNEL_MASK_FLAG       0
+#endif
 
 /*
-    Structure of the uplink, total of 12 Bytes
-    the values obtained from the uplink need to be converted,
-    sending them as integers requires multipling them by a factor (in the curly brackets)
-    that then has to be used for the opposite conversion process
+    keys of lora-config.h converted to binary by the compiler, used when the provisioning sector of the flash holds no
+    record of tools/provision. With a single channel every uplink goes on the frequency and the datarate the
+    nanogateway listens to, CMD_CHANNEL moves it until the next reset
 */
-struct uplink {
-    uint16_t id; 
-    int16_t temp; //-273.15 - 90.00 -> -27315 - 9000 {100}
-    uint16_t hum; //0.00 - 100.00 -> 0 - 10000 {100}
-    uint16_t press; //840.0 - 1013.25 [hPa] -> 8400 - 10133 {10, ignore last decimal number}
-    uint16_t AQI; //50.0 - 500.0 -> 500 - 5000 {10}
-    uint16_t CO2; //600 - 10000 [ppm] -> 600 - 10000
+const struct provision_record provision = {
+    PROVISION_HEADER,
+    .region = LORAWAN_REGION,
+#ifdef LORAWAN_OTAA
+    .flags = PROVISION_OTAA | CHANNEL_MASK_FLAG | SINGLE_CHANNEL_FLAG,
+    .dev_eui = PROVISION_HEX_8(DEV_EUI),
+    .join_eui = PROVISION_HEX_8(LORAWAN_APP_EUI),
+    .app_key = PROVISION_HEX_16(LORAWAN_APP_KEY),
+#else
+    .flags = PROVISION_DEV_ADDR | CHANNEL_MASK_FLAG | SINGLE_CHANNEL_FLAG,
+    .dev_addr = PROVISION_HEX_U32(LORAWAN_DEV_ADDR),
+    .nwk_s_key = PROVISION_HEX_16(LORAWAN_NETWORK_SESSION_KEY),
+    .app_s_key = PROVISION_HEX_16(LORAWAN_APP_SESSION_KEY),
+#endif
+#ifdef LORAWAN_CHANNEL_MASK
+    .channel_mask = PROVISION_HEX_MASK(LORAWAN_CHANNEL_MASK),
+#endif
+    .frequency = LORAWAN_SINGLE_CHANNEL_FREQ,
+    .datarate = LORAWAN_SINGLE_CHANNEL_DR,
 };
 
+//the conversions above read past a string too short without a warning, the lengths are checked here
+#ifdef LORAWAN_OTAA
+_Static_assert(sizeof(DEV_EUI) == 17, "DEV_EUI must be 16 hex digits");
+_Static_assert(sizeof(LORAWAN_APP_EUI) == 17, "LORAWAN_APP_EUI must be 16 hex digits");
+_Static_assert(sizeof(LORAWAN_APP_KEY) == 33, "LORAWAN_APP_KEY must be 32 hex digits");
+#else
+_Static_assert(sizeof(LORAWAN_DEV_ADDR) == 9, "LORAWAN_DEV_ADDR must be 8 hex digits");
+_Static_assert(sizeof(LORAWAN_NETWORK_SESSION_KEY) == 33, "LORAWAN_NETWORK_SESSION_KEY must be 32 hex digits");
+_Static_assert(sizeof(LORAWAN_APP_SESSION_KEY) == 33, "LORAWAN_APP_SESSION_KEY must be 32 hex digits");
+#endif
+#ifdef LORAWAN_CHANNEL_MASK
+_Static_assert(sizeof(LORAWAN_CHANNEL_MASK) == 25, "LORAWAN_CHANNEL_MASK must be 24 hex digits");
+#endif
+
 //bsec measurement
 bsec_sensor_configuration_t requested_virtual_sensors[REQUESTED_OUTPUT];
 uint8_t n_requested_virtual_sensors = REQUESTED_OUTPUT;
@@ -115,17 +146,116 @@ bsec_sensor_configuration_t required_sensor_settings[BSEC_MAX_PHYSICAL_SENSOR];
 uint8_t n_required_sensor_settings = BSEC_MAX_PHYSICAL_SENSOR;
 //configuration coming from bsec
 bsec_bme_settings_t conf_bsec;
+/*
+    statistics of the outputs between two records of the batch, every reading contributes to the packet
+    instead of only the last one, the scale of each channel is the factor used in the uplink
+*/
+#define STATS_EWMA_SHIFT        3
+struct stats_window window;
+//seconds between two readings in ULP and LP mode
+#define READING_PERIOD_ULP_S    300
+#define READING_PERIOD_LP_S     3
+//a reading with an IAQ above 200.0 (very unhealthy) is sent right away
+#define URGENT_AQI              2000
+struct batch batch;
+/*
+    dead-band of the channels (temp, hum, press, AQI, CO2) in the unit of the uplink fields: 0.2 C, 1 %, 0.5 hPa, 10 IAQ, 50 ppm,
+    a reading goes in the batch only when a channel moved more than that from the last reading queued, or after MAX_SILENCE readings,
+    the decoder holds the last value received in between
+*/
+#define DEADBAND_CHANNELS       5
+const int32_t deadband_threshold[DEADBAND_CHANNELS] = {20, 100, 5, 100, 50};
+struct deadband deadband;
+/*
+    frames waiting for an acknowledgment, kept on littlefs so that they survive a reset or a power cut,
+    they go out oldest first as confirmed uplinks
+*/
+struct uplink_queue uplink_queue;
+uint16_t digest_frames = 0;   //frames sent since the last link digest
+/*
+    settings that can be changed with a downlink, see the command table below
+*/
+struct settings {
+    uint16_t interval;                  //highest number of readings sent together in a frame
+    uint16_t save_interval;             //number of readings before saving the state
+    uint16_t reading_period_s;          //seconds between two readings, follows the sample rate of the bsec library
+    bool save_state;                    //the state is saved at the end of the current reading
+    bool reboot;                        //the node resets once the ack of the command has been queued
+};
+struct settings settings = {
+    .interval = INTERVAL,
+    .save_interval = SAVE_INTERVAL,
+    .reading_period_s = READING_PERIOD_ULP_S,
+    .save_state = false,
+    .reboot = false,
+};
+/*
+    commands accepted on DOWNLINK_PORT, the types and the ranges are the same as Encode in codec.js
+*/
+#define CMD_INTERVAL            0x01    //u16, readings in a frame
+#define CMD_SAVE_INTERVAL       0x02    //u16, readings between two saves of the state
+#define CMD_SAMPLE_RATE         0x03    //u8, 0 ULP, 1 LP
+#define CMD_DATARATE            0x04    //i8, datarate of the uplinks, negative to give it back to ADR
+#define CMD_SAVE_STATE          0x05    //no value, saves the state now
+#define CMD_REBOOT              0x06    //no value, resets the node
+#define CMD_CHANNEL             0x07    //u32, frequency in Hz of the single-channel gateway, 0 for every channel of the region
+#define MAX_INTERVAL            (12 * 24)
+#define MAX_SAVE_INTERVAL       (12 * 24 * 7)
+#define SAMPLE_RATE_ULP         0
+#define SAMPLE_RATE_LP          1
+static uint8_t cmd_interval(const uint8_t* value, uint8_t len, void* ctx);
+static uint8_t cmd_save_interval(const uint8_t* value, uint8_t len, void* ctx);
+static uint8_t cmd_sample_rate(const uint8_t* value, uint8_t len, void* ctx);
+static uint8_t cmd_datarate(const uint8_t* value, uint8_t len, void* ctx);
+static uint8_t cmd_save_state(const uint8_t* value, uint8_t len, void* ctx);
+static uint8_t cmd_reboot(const uint8_t* value, uint8_t len, void* ctx);
+static uint8_t cmd_channel(const uint8_t* value, uint8_t len, void* ctx);
+const struct downlink_command commands[] = {
+    {CMD_INTERVAL, 2, 2, cmd_interval},
+    {CMD_SAVE_INTERVAL, 2, 2, cmd_save_interval},
+    {CMD_SAMPLE_RATE, 1, 1, cmd_sample_rate},
+    {CMD_DATARATE, 1, 1, cmd_datarate},
+    {CMD_SAVE_STATE, 0, 0, cmd_save_state},
+    {CMD_REBOOT, 0, 0, cmd_reboot},
+    {CMD_CHANNEL, 4, 4, cmd_channel},
+};
+#define DOWNLINK_PORTS          1
+const struct downlink_port downlink_ports[DOWNLINK_PORTS] = {
+    {DOWNLINK_PORT, commands, sizeof(commands) / sizeof(commands[0])},
+};
+/*outcome of the last command frame, appended to the next frame queued*/
+struct downlink_ack downlink_ack;
+#ifdef UPLINK_DELTA
+/*
+    quantization of the channels in the delta frame, in the unit of the uplink fields (temp, hum, press, AQI, CO2):
+    0.05 C, 0.1 %, 0.1 hPa, 1 IAQ, 1 ppm, finer than the sensor accuracy
+*/
+#define DELTA_CHANNELS          5
+const uint16_t delta_quantum[DELTA_CHANNELS] = {5, 10, 1, 10, 1};
+#endif
 
 /*
     variables used to hold the state for the bsec library
     state should be saved pretty often, so in case the MCU
     shuts down it can be restored
+    the state and its work buffer are only needed while restoring or saving,
+    they are taken from the scratch arena for the duration of the operation
 */
-uint8_t serialized_state[BSEC_MAX_STATE_BLOB_SIZE];
 uint32_t n_serialized_state_max = BSEC_MAX_STATE_BLOB_SIZE;
 uint32_t n_serialized_state = BSEC_MAX_STATE_BLOB_SIZE;
-uint8_t work_buffer_state[BSEC_MAX_WORKBUFFER_SIZE];
 uint32_t n_work_buffer_size = BSEC_MAX_WORKBUFFER_SIZE;
+#define LOG_SIZE                256
+/*
+    scratch region shared by the bsec state operations and the log read at boot,
+    sized for the largest set of buffers alive at the same time (state and its work buffer),
+    the log buffer is released before the state is restored
+*/
+#define SCRATCH_SIZE            (SCRATCH_ROUND(BSEC_MAX_STATE_BLOB_SIZE) + SCRATCH_ROUND(BSEC_MAX_WORKBUFFER_SIZE))
+static uint8_t scratch_region[SCRATCH_SIZE] __attribute__((aligned(SCRATCH_ALIGN)));
+/*
+    A/B slots holding the state on the filesystem
+*/
+struct state_store state_store;
 
 /*
     for class a no settings are required to load
@@ -206,13 +336,45 @@ static void rtc_sleep(uint8_t secs, uint8_t mins, uint8_t hrs){
 }
 
 /**
- * @brief popolates the uplink structure with the values read from the sensor
+ * @brief popolates the uplink structure with the statistics of the readings since the last record added to the batch
+ * 
+ * @param pkt the reading, see struct payload_reading in payload.json
+ * @param win statistics of the outputs requested from the BSEC library
+ */
+void make_pkt(struct payload_reading* pkt, const struct stats_window* win);
+
+/**
+ * @brief converts the interval of the uplinks in the age of the oldest reading that flushes the batch,
+ *          so that a frame holds at most interval readings
  * 
- * @param pkt the uplink structure
- * @param output array of the values requested from the BSEC library
- * @param len length of the output array
+ * @param interval number of readings between two uplinks
+ * @param period_s seconds between two readings
+ * @return uint32_t age in seconds
  */
-void make_pkt(struct uplink* pkt, bsec_output_t* output, int len);
+uint32_t batch_max_age(uint16_t interval, uint16_t period_s);
+
+#ifdef UPLINK_DELTA
+/**
+ * @brief encodes the oldest readings of the batch as a delta compressed series, the readings are not removed from the batch
+ * 
+ * @param b batch
+ * @param frame buffer of at least max_payload bytes
+ * @param max_payload application payload allowed by the current datarate
+ * @param now_s current time, used for the age of the newest reading sent
+ * @param n_readings filled with the number of readings that fit in the frame
+ * @return int length of the frame, 0 if not even a reading fits
+ */
+int make_delta_frame(const struct batch* b, uint8_t* frame, int max_payload, uint32_t now_s, uint8_t* n_readings);
+#endif
+
+/**
+ * @brief sends the frames of the uplink queue as confirmed uplinks, oldest first, a frame is removed only once acknowledged.
+ *          It stops at the first frame refused by the stack (duty cycle) or not acknowledged, the rest waits for the next reading
+ * 
+ * @param frame buffer of BATCH_MAX_PAYLOAD bytes
+ * @return int number of uplinks sent
+ */
+int drain_uplink_queue(uint8_t* frame);
 
 /**
  * @brief processes and prepares sensor readings for the bsec library 
@@ -241,6 +403,14 @@ void print_results(int id, float signal, int accuracy);
  */
 void check_fs_error(int rslt, char msg[]);
 
+/**
+ * @brief stops on a block the scratch arena could not give, SCRATCH_SIZE is too small for the buffers alive together
+ * 
+ * @param block result of scratch_alloc
+ * @param msg buffer requested
+ */
+void check_scratch(const void* block, char msg[]);
+
 int main( void )
 {   
     /*
@@ -250,16 +420,10 @@ int main( void )
     clock0_orig = clocks_hw->sleep_en0;
     clock1_orig = clocks_hw->sleep_en1;
 
-    //variables holding the time of the sleep in secs, hours and minutes, cannot overflow
-    uint8_t secs = 58;
-    uint8_t mins = 4;
-
     /*
         PKT AND CONSTANT VALUES
     */
-    struct uplink pkt = {
-        .id = DEV_ID,
-    };    
+    struct payload_reading pkt = {0};    
     /*
         BME API VARIABLES
         bme holds the physical info of the sensor
@@ -281,14 +445,16 @@ int main( void )
 
     /*
         del_persiod is the amount of time to wait before reading to heat the plate
-        sent_time is the counter for the number of time that a reading has been made but not sent
-        saved_time is the counter for the number of time that a reading has been made but the state is not saved
+        uptime_s is the time base of the batch, deep sleep stops the timer so it advances by one sampling period for every reading
+        saved_time is the counter for the number of time that a reading has been made but the state is not saved, up to MAX_SAVE_INTERVAL
         before_time e after_time are two variables used to compute the amount of time elapsed between a reading and all the other operations
         this time is then used to scale the sleep time correctly
     */
     uint32_t del_period;
-    uint16_t sent_time = INTERVAL;
-    uint8_t saved_time = SAVE_INTERVAL;
+    uint32_t uptime_s = 0;
+    uint8_t record[PAYLOAD_READING_LEN];
+    uint8_t frame[BATCH_MAX_PAYLOAD];
+    uint16_t saved_time = SAVE_INTERVAL;
     uint64_t before_time = 0;
     uint64_t after_time = 0;
         
@@ -330,25 +496,41 @@ int main( void )
         blink();
     }
     gpio_put(PIN_FORMAT_OUTPUT, 0);
+
+    scratch_init(scratch_region, sizeof(scratch_region));
+    uint32_t scratch_top = scratch_mark();
     
     int log_file = pico_open(log_file_name, LFS_O_CREAT | LFS_O_RDONLY);
     check_fs_error( log_file, "Error opening log file"); 
     
-    char log[256];
-    int rslt_log = pico_read(log_file, log, 256);
+    char* log = scratch_alloc(LOG_SIZE);
+    check_scratch(log, "the log");
+    int rslt_log = pico_read(log_file, log, LOG_SIZE);
     if(rslt_log > 0)
         printf("LOG: %s\n", log);
+    pico_close(log_file);
+    scratch_release(scratch_top);
 
-
-    //read state to get the previous state and avoid restarting everything
-    int state_file = pico_open(state_file_name, LFS_O_CREAT | LFS_O_RDONLY );
-    check_fs_error( state_file, "Error opening state file"); 
-    
-    rslt_fs = pico_read(state_file, serialized_state, BSEC_MAX_STATE_BLOB_SIZE*sizeof(uint8_t));
-    check_fs_error(state_file, "Error while reading state file");  
-
-    pico_rewind(state_file);
-    check_fs_error(state_file, "Error while rewinding state file");
+    /*
+        read state to get the previous state and avoid restarting everything
+        only a state with a valid CRC is returned, a corrupted slot falls back to the other one
+        the buffers stay allocated until the state is given to the bsec library
+    */
+    uint8_t* serialized_state = scratch_alloc(n_serialized_state_max);
+    uint8_t* work_buffer_state = scratch_alloc(n_work_buffer_size);
+    check_scratch(serialized_state, "the state");
+    check_scratch(work_buffer_state, "the state work buffer");
+    state_store_init(&state_store, state_file_name, state_file_name_b);
+    int state_len = state_store_restore(&state_store, serialized_state, n_serialized_state_max);
+    /*
+        frames left from before the reset are sent first, an error here doesn't stop the node,
+        the frames that cannot be queued are simply lost as before
+    */
+    if(uplink_queue_open(&uplink_queue, uplink_queue_file_name, uplink_queue_tmp_name, UPLINK_QUEUE_CAPACITY, UPLINK_QUEUE_POLICY) < 0){
+    #ifdef DEBUG
+        printf("Error opening the uplink queue\n");
+    #endif
+    }
     
     //deinit pins, they are no longer used until the device is restarted
     gpio_deinit(PIN_FORMAT_INPUT);
@@ -373,6 +555,18 @@ int main( void )
     requested_virtual_sensors[5].sensor_id = BSEC_OUTPUT_RAW_GAS; //gas resistance
     requested_virtual_sensors[5].sample_rate = BSEC_SAMPLE_RATE_ULP;
 
+    /*
+        outputs aggregated between two uplinks, the scale is the conversion factor of the uplink field
+        the gas resistance is not sent so it is not followed
+    */
+    stats_init(&window, STATS_EWMA_SHIFT);
+    stats_add_channel(&window, BSEC_OUTPUT_IAQ, 10.0f);
+    stats_add_channel(&window, BSEC_OUTPUT_RAW_TEMPERATURE, 100.0f);
+    stats_add_channel(&window, BSEC_OUTPUT_RAW_PRESSURE, 0.1f);
+    stats_add_channel(&window, BSEC_OUTPUT_RAW_HUMIDITY, 100.0f);
+    stats_add_channel(&window, BSEC_OUTPUT_CO2_EQUIVALENT, 1.0f);
+    batch_init(&batch, DEV_ID, PAYLOAD_READING_LEN, batch_max_age(settings.interval, settings.reading_period_s));
+
     /*
         INITIALIZATION BME CONFIGURATION
     */
@@ -417,16 +611,17 @@ int main( void )
     check_rslt_bsec(rslt_bsec, "BSEC_INIT", NULL);
 
     /*
-        reading from the file returned bytes, so there is a state file saved
+        the store returned a valid state, resume it with the number of bytes actually saved
     */
-    if(rslt_fs > 0){
+    if(state_len > 0){
     #ifdef DEBUG
-        printf("...resuming the state, read %d bytes\n", rslt_fs);
+        printf("...resuming the state, read %d bytes\n", state_len);
     #endif
         //set the state if there is one saved
-        rslt_bsec = bsec_set_state(serialized_state, n_serialized_state, work_buffer_state, n_work_buffer_size);
+        rslt_bsec = bsec_set_state(serialized_state, state_len, work_buffer_state, n_work_buffer_size);
         check_rslt_bsec(rslt_bsec, "BSEC_SET_STATE", NULL);
     }    
+    scratch_release(scratch_top);
     /*
         Set configuration is skipped for class a
     */    
@@ -440,48 +635,62 @@ int main( void )
 #ifdef DEBUG
     lorawan_debug(true);
     printf("Pico LoRaWAN - lora and bme sensor\n\n");
-    printf("Erasing NVM ... ");
-    
-    if (lorawan_erase_nvm() < 0) {
-        printf("failed!!!\n");
-    } else {
+#endif
+    /*
+        the LoRaWAN session stored in the NVM is resumed at boot, it is thrown away
+        only with the format pin, together with the state files, or when the keys change
+    */
+    if (format) {
+    #ifdef DEBUG
+        printf("Erasing NVM ... ");
+    #endif
+        if (lorawan_erase_nvm() < 0) {
+        #ifdef DEBUG
+            printf("failed!!!\n");
+        #endif
+            blink();
+        }
+    #ifdef DEBUG
         printf("success!\n");
+    #endif
     }
-#else 
-    if (lorawan_erase_nvm() < 0) {
-        blink();
-    } 
-#endif
 
     // initialize the LoRaWAN stack
 #ifdef DEBUG
     printf("Initilizating LoRaWAN ... ");
 #endif
-    if (lorawan_init_abp(&sx12xx_settings, LORAWAN_REGION, &abp_settings) < 0) {
+    const struct provision_record* flash_record = lorawan_provision_flash();
+    if (lorawan_init_provisioned(&sx12xx_settings, flash_record != NULL ? flash_record : &provision) < 0) {
     #ifdef DEBUG
         printf("Fail, restarting\n");
     #endif
         software_reset();
 
     }
+#ifdef DEBUG
+    printf("%s session\n", lorawan_session_state() == LORAWAN_SESSION_RESTORED ? "Restored" : "New");
+#endif
       
-    /*initialize state for temp/hum/press with unaccepted values*/
-    double previous_temp = -400;
-    double previous_hum = -400;
-    double previous_press = -400;
+    /*nothing reported yet, the first reading always goes in the batch*/
+    deadband_init(&deadband, DEADBAND_CHANNELS, deadband_threshold, MAX_SILENCE * settings.reading_period_s);
     uint8_t current_op_mode = BME68X_SLEEP_MODE;
-    uint16_t current_interval = INTERVAL;
 
     /*
-        using abp it is a pass through function
-        but it stays in case of switch to otaa when using a proper 
-        gateway
+        using abp or a restored session it is a pass through function,
+        with otaa the failed attempts are retried with a growing wait
     */
     lorawan_join();
 
     while (!lorawan_is_joined()) {
         lorawan_process();
     }
+#ifdef DEBUG
+    printf("Joined after %d attempts in %lu ms\n", lorawan_join_attempts(), (unsigned long)lorawan_join_time_ms());
+#endif
+#ifdef CLOCK_SYNC_ACCURACY_MS
+    //the time slept is told to the library after every sleep, it carries the GPS time with the drift it estimates
+    lorawan_clock_sync_accuracy(CLOCK_SYNC_ACCURACY_MS);
+#endif
     lorawan_process_timeout_ms(1000);
 
     // loop forever
@@ -590,80 +799,136 @@ int main( void )
                             }
                             printf("--------------------------------------------\n");
                         #endif
+                            for(uint8_t i = 0; i < n_output; i++)
+                                stats_update(&window, output[i].sensor_id, output[i].signal);
                             /*
                                 once all the operations from the library are done save the time for the operation required for the LoRaWAN stack
-                                if it's time to send out a packet send it
+                                a reading is added to the batch when it is out of the dead-band of the last one added, when nothing
+                                has been added for MAX_SILENCE readings or when the air quality gets bad,
+                                the frame is sent when it is full or when the oldest reading is too old,
+                                an ack waiting to be sent makes the reading urgent so that it goes out with it
                             */
                             before_time = time_us_64();
-                            secs = 58;
-                            if(sent_time >= current_interval){
-                                make_pkt(&pkt, output, REQUESTED_OUTPUT);
-                            #ifdef DEBUG
-                                printf("\n");
-                                if (lorawan_send_unconfirmed(&pkt, sizeof(struct uplink), 2) < 0) {
-                                    printf("failed!!!\n");
-                                }else{ 
-                                    printf("success!\n");
+                            uptime_s += settings.reading_period_s;
+                            make_pkt(&pkt, &window);
+                            stats_reset(&window);
+                            int32_t values[DEADBAND_CHANNELS] = {pkt.temp, pkt.hum, pkt.press, pkt.AQI, pkt.CO2};
+                            bool urgent = pkt.AQI >= URGENT_AQI || downlink_ack.pending;
+                            uint8_t report = deadband_check(&deadband, values, uptime_s);
+                            if(report != DEADBAND_REPORT_NONE || urgent){
+                                payload_reading_encode(&pkt, record);
+                                if(batch_add(&batch, record, uptime_s, urgent) < 0){
+                                #ifdef DEBUG
+                                    printf("Batch full, reading dropped\n");
+                                #endif
+                                }else{
+                                    deadband_reported(&deadband, values, uptime_s);
                                 }
+                            }
+                        #ifdef DEBUG
+                            else{
+                                printf("Reading inside the dead-band, not reported\n");
+                            }
+                        #endif
+                            //room for the ack of the last command frame, if any, at the end of the frame
+                            uint8_t ack_len = downlink_ack_len(&downlink_ack);
+                            int max_payload = lorawan_max_payload_size() - ack_len;
+                            if(max_payload < 0)
+                                max_payload = 0;
+                            int frame_len = 0;
+                        #ifdef UPLINK_DELTA
+                            /*
+                                the size of a delta frame depends on the readings, the frame is full when the series
+                                doesn't take every reading waiting anymore
+                            */
+                            uint8_t n_readings = 0;
+                            frame_len = make_delta_frame(&batch, frame, max_payload, uptime_s, &n_readings);
+                            uint8_t flush = batch_pending(&batch, uptime_s, BATCH_MAX_PAYLOAD);
+                            if(n_readings < batch.count)
+                                flush |= BATCH_FLUSH_SIZE;
+                            uint8_t port = DELTA_PORT;
+                        #else
+                            uint8_t flush = batch_pending(&batch, uptime_s, max_payload);
+                            uint8_t port = BATCH_PORT;
+                        #endif
+                            if(flush != BATCH_FLUSH_NONE){
+                            #ifdef UPLINK_DELTA
+                                batch_drop(&batch, n_readings);
                             #else
-                                lorawan_send_unconfirmed(&pkt, sizeof(struct uplink), 2);
+                                frame_len = batch_encode(&batch, frame, max_payload, uptime_s);
                             #endif
-                                sent_time = 1;
-                                #ifdef DEBUG
-                                    printf("Resetting sent time: %u\n", sent_time);
-                                #endif
-                                /*
-                                    process LoRaWAN events, give time to the irq do go down before deep sleep, otherwise it bugs and 
-                                    the next time it tries to send the irq results busy, then check for eventual downlinks
-                                */
-                                lorawan_process_timeout_ms(4500);
-                                receive_length = lorawan_receive(receive_buffer, sizeof(receive_buffer), &receive_port);
-                                if(receive_length == 2){
-                                    current_interval = receive_buffer[1] + (receive_buffer[0] << 8);
+                                if(frame_len > 0 && ack_len > 0)
+                                    frame_len += downlink_ack_encode(&downlink_ack, &frame[frame_len], ack_len);
+                            #ifdef DEBUG
+                                printf("\nQueueing batch (reasons %x), %d bytes, %u readings left\n", flush, frame_len, batch.count);
+                            #endif
+                                if(frame_len > 0 && uplink_queue_push(&uplink_queue, port, frame, frame_len) < 0){
                                 #ifdef DEBUG
-                                    printf("Buffer received: least significant %u most significant %u", receive_buffer[1], receive_buffer[0]);
-                                    printf("New interval time: %d", current_interval);
+                                    printf("Frame not queued, %lu frames dropped so far\n", (unsigned long)uplink_queue.dropped);
                                 #endif
+                                }else if(frame_len > 0){
+                                    downlink_ack_clear(&downlink_ack);
                                 }
-                            #ifdef DEBUG
-                                /*
-                                    handle interval time as downlink to change it
-                                */
-                                if(receive_length == 2){
-                                    current_interval = receive_buffer[1] + (receive_buffer[0] << 8);
+                            }
+                            /*
+                                the frames are sent from the queue, a gateway down or a send refused by the stack only delay them,
+                                then check for eventual downlinks
+                            */
+                            int sent = drain_uplink_queue(frame);
+                        #if LINK_DIGEST_EVERY > 0
+                            /*
+                                the link telemetry goes up through the queue like the readings, the LinkCheckReq asked now
+                                rides on the next frame and its answer lands in the following digest
+                            */
+                            digest_frames += sent;
+                            if(digest_frames >= LINK_DIGEST_EVERY){
+                                //sized for the current datarate, one byte left for the LinkCheckReq
+                                int digest_max = lorawan_max_payload_size() - 1;
+                                int digest_len = digest_max > 0 ? lorawan_link_digest(frame, digest_max) : 0;
+                                if(digest_len > 0 && uplink_queue_push(&uplink_queue, LINK_DIGEST_PORT, frame, digest_len) > 0){
+                                    digest_frames = 0;
+                                    lorawan_link_check();
                                 #ifdef DEBUG
-                                    printf("Buffer received: least significant %u most significant %u", receive_buffer[1], receive_buffer[0]);
-                                    printf("New interval time: %d", current_interval);
+                                    printf("Link digest of %d bytes queued\n", digest_len);
                                 #endif
                                 }
-                                /*
-                                    prepare for handling eventual different downlinks
-                                */
-                                else if (receive_length > -1) {
+                            }
+                        #endif
+                            if(sent > 0){
+                                //every downlink of the burst is applied in order, the ack of the last command frame goes up
+                                const struct lorawan_downlink* downlink;
+                                while((downlink = lorawan_downlink_peek()) != NULL){
+                                    int applied = downlink_process(downlink_ports, DOWNLINK_PORTS, downlink->port, downlink->data,
+                                                                    downlink->size, &settings, &downlink_ack);
                                 #ifdef DEBUG
-                                    printf("received a %d byte message on port %d: ", receive_length, receive_port);
+                                    printf("Received a %u byte message on port %u (RSSI %d, SNR %d): ", downlink->size, downlink->port,
+                                            downlink->rssi, downlink->snr);
+                                    for(int i = 0; i < downlink->size; i++)
+                                        printf("%02x", downlink->data[i]);
+                                    if(applied == DOWNLINK_E_PORT)
+                                        printf(", not a command\n");
+                                    else
+                                        printf(", %d commands applied\n", applied);
+                                #else
+                                    (void)applied;
                                 #endif
-                                    for (int i = 0; i < receive_length; i++) {
-                                        printf("%02x", receive_buffer[i]);
-                                    }
-                                    printf("\n");
+                                    lorawan_downlink_consume();
                                 }
-                            #endif
-                                receive_length = 0;
-                            }else{
-                                sent_time += 1;
                             #ifdef DEBUG
-                                printf("Increasing sent time: %u\n", sent_time);
+                                if(lorawan_downlink_overflows() > 0)
+                                    printf("%lu downlinks dropped so far, queue full\n", (unsigned long)lorawan_downlink_overflows());
                             #endif
-
+                                batch.max_age_s = batch_max_age(settings.interval, settings.reading_period_s);
+                                deadband.max_silence_s = MAX_SILENCE * settings.reading_period_s;
                             }
                         }
                     }
                 }
                 //check if the time has come to save the state file
-                if(saved_time >= SAVE_INTERVAL){
+                if(saved_time >= settings.save_interval || settings.save_state){
                     save_state_file();
                     saved_time = 1;
+                    settings.save_state = false;
                     #ifdef DEBUG
                         printf("Resetting saved time %u\n", saved_time);
                         sleep_ms(200);
@@ -675,15 +940,25 @@ int main( void )
                     sleep_ms(200);
                 #endif
                 }
+                /*
+                    the reset asked by a downlink waits for its ack to be queued, the state is saved before
+                */
+                if(settings.reboot && !downlink_ack.pending){
+                    save_state_file();
+                    software_reset();
+                }
                 /*
                     get the time after all the operations are completed, compute the amount of seconds that the MCU will go to sleep,
-                    baseline for the minutes is 4 since from the BOSCH documentation the standard amount of sleep time for the ULP
+                    baseline is the reading period minus 2 seconds, from the BOSCH documentation the standard amount of sleep time for the ULP
                     sample rate is 4 minutes and 58 seconds
                 */
                 after_time = time_us_64();
-                secs = secs - (after_time-before_time)/1000000;
+                uint32_t elapsed_s = (after_time - before_time) / 1000000;
+                uint32_t sleep_s = settings.reading_period_s - 2 > elapsed_s ? settings.reading_period_s - 2 - elapsed_s : 1;
                 sleep_run_from_xosc();
-                rtc_sleep(secs, 4, 0);
+                rtc_sleep(sleep_s % 60, sleep_s / 60, 0);
+                //the timer stopped with the clocks, the duty cycle of the sub-bands still runs
+                lorawan_sleep_elapsed_ms(sleep_s * 1000);
             }
         }
     }
@@ -695,42 +970,230 @@ int main( void )
  * @brief fills the fields for the uplink
  * 
  * @param pkt actual uplink packet
- * @param output values obtained from the bsec library
- * @param len length of the output array
+ * @param win statistics of the values obtained from the bsec library
  */
-void make_pkt(struct uplink* pkt, bsec_output_t* output, int len){
-    for(int i = 0; i<len; i++){
-        /*
-            BSEC_OUTPUT_STATIC_IAQ if the accuracy is above 1 (sensor is still calibrating but readings have meanings) take the value*10 to consider the first decimal, otherwise 0
-            BSEC_OUTPUT_CO2_EQUIVALENT accuracy as above, gets the signal as it is without considering decimal precision since doens't matter that much
-            BSEC_OUTPUT_RAW_TEMPERATURE get the temperature value*100 to consider the first two decimals
-            BSEC_OUTPUT_RAW_HUMIDITY get the humidity value*100 to consider the first two decimals
-            BSEC_OUTPUT_RAW_PRESSURE pressure values are in [Pa] but [hPa] makes more sense, check if there's the need to round by excess, then take the [Pa] value without the last digit and rounded
-                                     the actual value that is sent out is in the form of daPa
-        */
-        switch(output[i].sensor_id){
+void make_pkt(struct payload_reading* pkt, const struct stats_window* win){
+    /*
+        the channels are already in the unit of the uplink, see where they are added
+        BSEC_OUTPUT_IAQ and BSEC_OUTPUT_CO2_EQUIVALENT are already smoothed by the library, the mean of the window is sent as for the raw values
+        BSEC_OUTPUT_RAW_PRESSURE is rounded to daPa by the conversion of the channel
+        a channel without samples keeps the value sent in the previous uplink
+    */
+    for(uint8_t i = 0; i < win->n_channels; i++){
+        const struct stats_channel* ch = &win->channel[i];
+        if(ch->count == 0)
+            continue;
+        switch(ch->sensor_id){
             case BSEC_OUTPUT_IAQ:
-                /*pkt->AQI = output[i].accuracy < 2 ? 0 : (uint16_t)(output[i].signal*10);*/
-                pkt->AQI = (uint16_t)(output[i].signal*10);
+                pkt->AQI = (uint16_t)stats_mean(ch);
                 break;
             case BSEC_OUTPUT_CO2_EQUIVALENT:
-                /*pkt->CO2 = output[i].accuracy < 2 ? 0 : (uint16_t)output[i].signal;*/
-                pkt->CO2 = (uint16_t)output[i].signal;
+                pkt->CO2 = (uint16_t)stats_mean(ch);
                 break;
             case BSEC_OUTPUT_RAW_TEMPERATURE:
-                pkt->temp = (int16_t)(output[i].signal*100);
+                pkt->temp = (int16_t)stats_mean(ch);
                 break;
             case BSEC_OUTPUT_RAW_HUMIDITY:
-                pkt->hum = (uint16_t)(output[i].signal*100);
+                pkt->hum = (uint16_t)stats_mean(ch);
                 break;
             case BSEC_OUTPUT_RAW_PRESSURE:
-                pkt->press = ((uint16_t)output[i].signal % 10 >= 5) ? (uint16_t)(output[i].signal/10)+1 : (uint16_t)(output[i].signal/10);
+                pkt->press = (uint16_t)stats_mean(ch);
                 break;
         }
+    #ifdef DEBUG
+        printf("Window of %u: id %u mean %ld min %ld max %ld last %ld ewma %ld\n", ch->count, ch->sensor_id,
+            (long)stats_mean(ch), (long)ch->min, (long)ch->max, (long)ch->last, (long)stats_ewma(ch));
+    #endif
     }
-    
 }
 
+int drain_uplink_queue(uint8_t* frame){
+    int sent = 0;
+    for(uint8_t i = 0; i < UPLINK_QUEUE_DRAIN; i++){
+        uint8_t port;
+        int len = uplink_queue_peek(&uplink_queue, &port, frame, BATCH_MAX_PAYLOAD);
+        if(len == UPLINK_QUEUE_E_CORRUPTED)
+            continue;
+        if(len <= 0)
+            break;
+        //a frame built for a faster datarate would never fit in the current one, it isn't worth blocking the queue
+        int max_payload = lorawan_max_payload_size();
+        if(max_payload == 0)
+            break;
+        if(len > max_payload){
+        #ifdef DEBUG
+            printf("Queued frame of %d bytes doesn't fit in %d, dropped\n", len, max_payload);
+        #endif
+            uplink_queue_pop(&uplink_queue);
+            continue;
+        }
+        //the sub-bands are still closed by the duty cycle, the frames wait in the queue for the next wake up
+        uint32_t wait_ms = lorawan_next_tx_possible_ms();
+        if(wait_ms > 0){
+        #ifdef DEBUG
+            printf("Duty cycle: next uplink possible in %lu ms, %u frames waiting\n", (unsigned long)wait_ms, uplink_queue.count);
+        #endif
+            break;
+        }
+        if(lorawan_send_confirmed(frame, len, port) < 0){
+        #ifdef DEBUG
+            printf("Send refused, %u frames waiting\n", uplink_queue.count);
+        #endif
+            break;
+        }
+        sent++;
+        /*
+            process LoRaWAN events until the acknowledgment, it also gives time to the irq do go down before deep sleep,
+            otherwise it bugs and the next time it tries to send the irq results busy
+        */
+        lorawan_process_timeout_ms(4500);
+        if(lorawan_confirmed_status() != LORAWAN_CONFIRMED_ACK){
+        #ifdef DEBUG
+            printf("Frame not acknowledged, %u frames waiting\n", uplink_queue.count);
+        #endif
+            break;
+        }
+        uplink_queue_pop(&uplink_queue);
+    #ifdef DEBUG
+        printf("Frame acknowledged, %u frames waiting\n", uplink_queue.count);
+    #endif
+    }
+    return sent;
+}
+
+uint32_t batch_max_age(uint16_t interval, uint16_t period_s){
+    return interval > 1 ? (uint32_t)(interval - 1) * period_s : 0;
+}
+
+static uint8_t cmd_interval(const uint8_t* value, uint8_t len, void* ctx){
+    struct settings* s = ctx;
+    uint16_t interval = (uint16_t)downlink_uint(value, len);
+    if(interval == 0 || interval > MAX_INTERVAL)
+        return DOWNLINK_BAD_VALUE;
+    s->interval = interval;
+#ifdef DEBUG
+    printf("New interval: %u\n", interval);
+#endif
+    return DOWNLINK_OK;
+}
+
+static uint8_t cmd_save_interval(const uint8_t* value, uint8_t len, void* ctx){
+    struct settings* s = ctx;
+    uint16_t save_interval = (uint16_t)downlink_uint(value, len);
+    if(save_interval == 0 || save_interval > MAX_SAVE_INTERVAL)
+        return DOWNLINK_BAD_VALUE;
+    s->save_interval = save_interval;
+    return DOWNLINK_OK;
+}
+
+/*
+    every output follows the new sample rate, the subscription is given back to the library
+    and the old rate is restored if the library refuses it
+*/
+static uint8_t cmd_sample_rate(const uint8_t* value, uint8_t len, void* ctx){
+    (void)len;
+    struct settings* s = ctx;
+    float sample_rate;
+    uint16_t period_s;
+    switch(value[0]){
+        case SAMPLE_RATE_ULP:
+            sample_rate = BSEC_SAMPLE_RATE_ULP;
+            period_s = READING_PERIOD_ULP_S;
+            break;
+        case SAMPLE_RATE_LP:
+            sample_rate = BSEC_SAMPLE_RATE_LP;
+            period_s = READING_PERIOD_LP_S;
+            break;
+        default:
+            return DOWNLINK_BAD_VALUE;
+    }
+    float old_rate = requested_virtual_sensors[0].sample_rate;
+    for(uint8_t i = 0; i < n_requested_virtual_sensors; i++)
+        requested_virtual_sensors[i].sample_rate = sample_rate;
+    n_required_sensor_settings = BSEC_MAX_PHYSICAL_SENSOR;
+    rslt_bsec = bsec_update_subscription(requested_virtual_sensors, n_requested_virtual_sensors, required_sensor_settings, &n_required_sensor_settings);
+    if(rslt_bsec != BSEC_OK){
+        for(uint8_t i = 0; i < n_requested_virtual_sensors; i++)
+            requested_virtual_sensors[i].sample_rate = old_rate;
+        n_required_sensor_settings = BSEC_MAX_PHYSICAL_SENSOR;
+        bsec_update_subscription(requested_virtual_sensors, n_requested_virtual_sensors, required_sensor_settings, &n_required_sensor_settings);
+        return DOWNLINK_FAILED;
+    }
+    s->reading_period_s = period_s;
+    return DOWNLINK_OK;
+}
+
+static uint8_t cmd_datarate(const uint8_t* value, uint8_t len, void* ctx){
+    (void)len;
+    (void)ctx;
+    if(lorawan_set_datarate((int8_t)value[0]) < 0)
+        return DOWNLINK_BAD_VALUE;
+    return DOWNLINK_OK;
+}
+
+static uint8_t cmd_save_state(const uint8_t* value, uint8_t len, void* ctx){
+    (void)value;
+    (void)len;
+    struct settings* s = ctx;
+    s->save_state = true;
+    return DOWNLINK_OK;
+}
+
+static uint8_t cmd_reboot(const uint8_t* value, uint8_t len, void* ctx){
+    (void)value;
+    (void)len;
+    struct settings* s = ctx;
+    s->reboot = true;
+    return DOWNLINK_OK;
+}
+
+/*
+    the datarate in use goes along to the new frequency, a frequency the region can't use is refused
+    and the node stays where it is
+*/
+static uint8_t cmd_channel(const uint8_t* value, uint8_t len, void* ctx){
+    (void)len;
+    (void)ctx;
+    uint32_t frequency = (uint32_t)value[0] | (uint32_t)value[1] << 8 | (uint32_t)value[2] << 16 | (uint32_t)value[3] << 24;
+    if(frequency == 0)
+        return lorawan_set_single_channel(NULL) < 0 ? DOWNLINK_FAILED : DOWNLINK_OK;
+    const struct lorawan_single_channel* current = lorawan_single_channel();
+    struct lorawan_single_channel channel = {
+        .frequency = frequency,
+        .datarate = current != NULL ? current->datarate : LORAWAN_SINGLE_CHANNEL_DR,
+    };
+    if(lorawan_set_single_channel(&channel) < 0)
+        return DOWNLINK_BAD_VALUE;
+    return DOWNLINK_OK;
+}
+
+#ifdef UPLINK_DELTA
+int make_delta_frame(const struct batch* b, uint8_t* frame, int max_payload, uint32_t now_s, uint8_t* n_readings){
+    *n_readings = 0;
+    //id and at least the header of the series
+    if(max_payload < (int)sizeof(uint16_t) + TS_HEADER_LEN)
+        return 0;
+
+    frame[0] = (uint8_t)(DEV_ID & 0xFF);
+    frame[1] = (uint8_t)(DEV_ID >> 8);
+    struct ts_encoder enc;
+    ts_encoder_init(&enc, DELTA_CHANNELS, delta_quantum, &frame[2], (uint8_t)(max_payload - 2));
+    for(uint8_t i = 0; i < b->count; i++){
+        uint32_t time_s;
+        const uint8_t* record = batch_record(b, i, &time_s);
+        struct payload_reading reading;
+        payload_reading_decode(&reading, record);
+        int32_t values[DELTA_CHANNELS] = {reading.temp, reading.hum, reading.press, reading.AQI, reading.CO2};
+        if(ts_encoder_add(&enc, values, time_s) < 0)
+            break;
+    }
+    *n_readings = enc.count;
+    if(enc.count == 0)
+        return 0;
+    return 2 + ts_encoder_finish(&enc, now_s);
+}
+#endif
+
 uint8_t processData(int64_t currTimeNs, const struct bme68x_data data, bsec_input_t* inputs){
     uint8_t n_input = 0;
     /* 
@@ -826,42 +1289,30 @@ void save_state_file(){
     #ifdef DEBUG
         printf("...Saving the file\n");
     #endif
-        //mount the fs 
-    
-    //open the file in write mode, no create because it should've been created already
-    int state_file = pico_open(state_file_name, LFS_O_CREAT | LFS_O_WRONLY);
-    //check_fs_error(state_file, "Error opening state file write"); 
-    if(state_file < 0){
-        gpio_put(PICO_DEFAULT_LED_PIN, 0);
-        return;
-    }
-    //get the state file
+    uint32_t scratch_top = scratch_mark();
+    uint8_t* serialized_state = scratch_alloc(n_serialized_state_max);
+    uint8_t* work_buffer_state = scratch_alloc(n_work_buffer_size);
+    check_scratch(serialized_state, "the state");
+    check_scratch(work_buffer_state, "the state work buffer");
+    //get the state, n_serialized_state holds the bytes actually used
     rslt_bsec = bsec_get_state(0, serialized_state, n_serialized_state_max, work_buffer_state, n_work_buffer_size, &n_serialized_state);
     check_rslt_bsec(rslt_bsec, "BSEC_GET_STATE", save_log_file);
-    //write the file and flush
-    rslt_fs = pico_write(state_file, serialized_state, BSEC_MAX_STATE_BLOB_SIZE*sizeof(uint8_t));
-    if(rslt_fs < 0){
+    /*
+        the store writes the slot not holding the newest state and
+        skips the write if the state didn't change since the last save
+    */
+    int written = state_store_save(&state_store, serialized_state, n_serialized_state);
+    scratch_release(scratch_top);
+    if(written < 0){
         gpio_put(PICO_DEFAULT_LED_PIN, 0);
         return;
     }
-    pico_fflush(state_file);
-    //log the number of bytes written
-    int pos = pico_lseek(state_file, 0, LFS_SEEK_CUR);
 #ifdef DEBUG
-    printf("Written %d byte for file %s\n", pos, state_file_name);
+    if(written == STATE_STORE_UNCHANGED)
+        printf("State unchanged, nothing written\n");
+    else
+        printf("Written %d byte for file %s\n", written, state_store.slot_name[state_store.current]);
 #endif
-    //rewind the pointer to the beginning of the file just to be sure
-    rslt_fs = pico_rewind(state_file);
-    if(rslt_fs < 0){
-        gpio_put(PICO_DEFAULT_LED_PIN, 0);
-        return;
-    }
-    //close the file
-    rslt_fs = pico_close(state_file);
-    if(rslt_fs < 0){
-        gpio_put(PICO_DEFAULT_LED_PIN, 0);
-        return;
-    }
     //turn off the led, system can be shut down 
     gpio_put(PICO_DEFAULT_LED_PIN, 0);
     sleep_ms(200);
@@ -916,3 +1367,13 @@ void check_fs_error(int rslt, char msg[]){
     }
 }
 
+void check_scratch(const void* block, char msg[]){
+    (void)msg;
+    if(block == NULL){
+    #ifdef DEBUG
+        printf("Scratch arena too small for %s\n", msg);
+    #endif
+        blink();
+    }
+}
+
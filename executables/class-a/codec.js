@@ -1,36 +1,284 @@
-function uintToInt(uint, nbit) {
-    nbit = +nbit || 32;
-    if (nbit > 32) throw new RangeError('uintToInt only supports ints up to 32 bits');
-    uint <<= 32 - nbit;
-    uint >>= 32 - nbit;
-    return uint;
+/* payloadgen begin, generated by tools/payloadgen/payloadgen.py from payload.json, do not edit by hand */
+function payloadU8(bytes, idx){
+    return bytes[idx] & 0xFF;
 }
 
-function returnInt(bytes, idx){
-    var num = bytes[idx] | bytes[idx+1] << 8;
-    return uintToInt(num, 16);
+function payloadI8(bytes, idx){
+    var v = bytes[idx] & 0xFF;
+    return v & 0x80 ? v - 0x100 : v;
 }
 
-function intToInt(bytes, idx){
-    var sign = bytes[idx+1] & (1 << 7);
-    var x = ((bytes[idx] & 0xFF) | ((bytes[idx+1] & 0xFF) << 8));
-    if(sign) return 0xFFFF0000 | x;
-    else return x;
+function payloadU16(bytes, idx){
+    return (bytes[idx] & 0xFF) | ((bytes[idx+1] & 0xFF) << 8);
 }
 
+function payloadI16(bytes, idx){
+    var v = payloadU16(bytes, idx);
+    return v & 0x8000 ? v - 0x10000 : v;
+}
 
-function Decode(fport, bytes, variables){
-    var AQI = returnInt(bytes, 8);
-    var CO2 = returnInt(bytes, 10);
+function payloadI32(bytes, idx){
+    return (bytes[idx] & 0xFF) | ((bytes[idx+1] & 0xFF) << 8) | ((bytes[idx+2] & 0xFF) << 16) | ((bytes[idx+3] & 0xFF) << 24);
+}
+
+function payloadU32(bytes, idx){
+    return payloadI32(bytes, idx) >>> 0;
+}
+
+/* reading of the class-a sensor, element of the batch and delta frames */
+var PAYLOAD_READING_LEN = 10;
+
+/* converts the integer fields to the physical values */
+function scaleReading(raw){
+    return{
+        "temp": raw.temp/100,
+        "hum": raw.hum/100,
+        "press": raw.press/10,
+        "AQI": raw.AQI == 0 ? 'nan' : raw.AQI/10,
+        "CO2": raw.CO2 == 0 ? 'nan' : raw.CO2,
+    };
+}
+
+function decodeReading(bytes, idx){
+    return scaleReading({
+        "temp": payloadI16(bytes, idx+0),
+        "hum": payloadU16(bytes, idx+2),
+        "press": payloadU16(bytes, idx+4),
+        "AQI": payloadU16(bytes, idx+6),
+        "CO2": payloadU16(bytes, idx+8),
+    });
+}
+
+/* single reading with the id of the device, sent by hello-abp */
+var PAYLOAD_UPLINK_LEN = 12;
+var PAYLOAD_UPLINK_PORT = 2;
+
+/* converts the integer fields to the physical values */
+function scaleUplink(raw){
+    return{
+        "id": raw.id,
+        "temp": raw.temp/100,
+        "hum": raw.hum/100,
+        "press": raw.press/10,
+        "AQI": raw.AQI == 0 ? 'nan' : raw.AQI/10,
+        "CO2": raw.CO2 == 0 ? 'nan' : raw.CO2,
+    };
+}
+
+function decodeUplink(bytes, idx){
+    return scaleUplink({
+        "id": payloadU16(bytes, idx+0),
+        "temp": payloadI16(bytes, idx+2),
+        "hum": payloadU16(bytes, idx+4),
+        "press": payloadU16(bytes, idx+6),
+        "AQI": payloadU16(bytes, idx+8),
+        "CO2": payloadU16(bytes, idx+10),
+    });
+}
+
+/* mean probability of the gases over the readings since the last uplink, sent by class-c */
+var PAYLOAD_GAS_UPLINK_LEN = 10;
+var PAYLOAD_GAS_UPLINK_PORT = 2;
+
+/* converts the integer fields to the physical values */
+function scaleGasUplink(raw){
+    return{
+        "id": raw.id,
+        "p1": raw.p1/10000,
+        "p2": raw.p2/10000,
+        "p3": raw.p3/10000,
+        "p4": raw.p4/10000,
+    };
+}
+
+function decodeGasUplink(bytes, idx){
+    return scaleGasUplink({
+        "id": payloadU16(bytes, idx+0),
+        "p1": payloadU16(bytes, idx+2),
+        "p2": payloadU16(bytes, idx+4),
+        "p3": payloadU16(bytes, idx+6),
+        "p4": payloadU16(bytes, idx+8),
+    });
+}
+
+/* payloadgen end */
+
+/* port of the frames holding a batch of readings, see lib/batch/batch.h */
+var BATCH_PORT = 4;
+/* bytes of the age in front of every reading */
+var BATCH_AGE_LEN = 2;
+
+/* port of the frames holding a delta compressed series, see lib/tscodec/tscodec.h */
+var DELTA_PORT = 5;
+/* channels of the delta frame and their quantization, same as delta_quantum in class_a.c */
+var DELTA_FIELDS = ["temp", "hum", "press", "AQI", "CO2"];
+var DELTA_QUANTUM = [5, 10, 1, 10, 1];
+
+/* port of the command frames, see lib/downlink/downlink.h and the command table in class_a.c */
+var DOWNLINK_PORT = 10;
+/* type, length in bytes and range of every command, value little endian */
+var COMMANDS = {
+    "interval": { "type": 0x01, "len": 2, "min": 1, "max": 12 * 24 },
+    "save_interval": { "type": 0x02, "len": 2, "min": 1, "max": 12 * 24 * 7 },
+    "sample_rate": { "type": 0x03, "len": 1, "min": 0, "max": 1 },
+    "datarate": { "type": 0x04, "len": 1, "min": -1, "max": 15 },
+    "save_state": { "type": 0x05, "len": 0 },
+    "reboot": { "type": 0x06, "len": 0 },
+    "channel": { "type": 0x07, "len": 4, "min": 0, "max": 1000000000 },
+};
+var ACK_STATUS = ["ok", "unknown", "bad length", "bad value", "failed", "malformed"];
+
+/*
+    ack of the last command frame, at the end of the uplink after the readings:
+    sequence number of the command frame and the status of each command in order
+*/
+function decodeAck(bytes, pos){
+    if(pos >= bytes.length)
+        return undefined;
+    var status = [];
+    for(var i = pos + 1; i < bytes.length; i++)
+        status.push(ACK_STATUS[bytes[i]] || bytes[i]);
+    return { "seq": bytes[pos], "status": status };
+}
+
+/*
+    id, count and then count times the age in seconds before the frame was sent followed by the reading,
+    the readings are oldest first
+*/
+function decodeBatch(bytes){
+    var count = bytes[2];
+    var readings = [];
+    var idx = 3;
+    for(var i = 0; i < count && idx + BATCH_AGE_LEN + PAYLOAD_READING_LEN <= bytes.length; i++){
+        var reading = decodeReading(bytes, idx + BATCH_AGE_LEN);
+        reading["age"] = payloadU16(bytes, idx);
+        readings.push(reading);
+        idx += BATCH_AGE_LEN + PAYLOAD_READING_LEN;
+    }
+    return{
+        "id": payloadU16(bytes, 0),
+        "readings": readings,
+        "ack": decodeAck(bytes, idx),
+    };
+}
+
+/* varint, 7 bits per byte with the high bit set when another byte follows */
+function readVarint(bytes, pos){
+    var value = 0;
+    var mul = 1;
+    for(var n = 0; n < 5 && pos < bytes.length; n++){
+        var b = bytes[pos++];
+        value += (b & 0x7F) * mul;
+        mul *= 128;
+        if(!(b & 0x80))
+            return { "value": value, "pos": pos };
+    }
+    throw new RangeError('truncated varint');
+}
+
+function unzigzag(value){
+    return (value % 2) ? -(value + 1) / 2 : value / 2;
+}
+
+/*
+    id, count, age of the newest reading, then the keyframe with the absolute quantized values
+    and for every other reading the change of the seconds from the previous one and the differences of the values
+*/
+function decodeDelta(bytes){
+    var count = bytes[2];
+    var newest_age = payloadU16(bytes, 3);
+    var pos = 5;
+    var q = [0, 0, 0, 0, 0];
+    var times = [];
+    var readings = [];
+    var time = 0;
+    var dt = 0;
+    var v;
+    for(var i = 0; i < count; i++){
+        if(i > 0){
+            v = readVarint(bytes, pos);
+            pos = v.pos;
+            dt += unzigzag(v.value);
+            time += dt;
+        }
+        times.push(time);
+        var raw = {};
+        for(var c = 0; c < q.length; c++){
+            v = readVarint(bytes, pos);
+            pos = v.pos;
+            q[c] += unzigzag(v.value);
+            raw[DELTA_FIELDS[c]] = q[c] * DELTA_QUANTUM[c];
+        }
+        readings.push(scaleReading(raw));
+    }
+    for(var i = 0; i < count; i++)
+        readings[i]["age"] = newest_age + (time - times[i]);
     return{
-        "id": returnInt(bytes, 0),
-        "temp": intToInt(bytes, 2)/100,
-        "hum": returnInt(bytes, 4)/100,
-        "press": returnInt(bytes, 6)/100,
-        "AQI": AQI == 0 ? 'nan' : AQI/10,
-        "CO2": CO2 == 0 ? 'nan' : CO2,
+        "id": payloadU16(bytes, 0),
+        "readings": readings,
+        "ack": decodeAck(bytes, pos),
     };
 }
+
+/* port of the link telemetry digest, see src/include/pico/link-telemetry.h */
+var LINK_DIGEST_PORT = 11;
+var LINK_DIGEST_RSSI_MIN = -128;
+var LINK_DIGEST_RSSI_STEP = 12;
+var LINK_DIGEST_SNR_MIN = -20;
+var LINK_DIGEST_SNR_STEP = 4;
+var LINK_DIGEST_BUCKETS = 8;
+/* margin not known, no LinkCheckAns or no downlink in the period */
+var LINK_DIGEST_NO_MARGIN = 127;
+
+function linkMargin(bytes, idx){
+    var v = payloadI8(bytes, idx);
+    return v === LINK_DIGEST_NO_MARGIN ? null : v;
+}
+
+/*
+    header with the counters of the period, then for every datarate in the mask the uplinks sent and the
+    histograms of the downlinks, the bucket is named after its lower edge, the first and the last one are open
+*/
+function decodeLinkDigest(bytes){
+    var digest = {
+        "version": bytes[0],
+        "acked": payloadU16(bytes, 1),
+        "missed": payloadU16(bytes, 3),
+        "rx1": payloadU16(bytes, 5),
+        "rx2": payloadU16(bytes, 7),
+        "rx_other": payloadU16(bytes, 9),
+        "link_check_margin": linkMargin(bytes, 11),
+        "link_check_gateways": bytes[12],
+        "devstatus_margin": linkMargin(bytes, 13),
+        "min_downlink_margin": linkMargin(bytes, 14),
+        "datarates": {},
+    };
+    var mask = bytes[15];
+    var idx = 16;
+    for(var dr = 0; dr < 8; dr++){
+        if(!(mask & (1 << dr)) || idx + 1 + 2 * LINK_DIGEST_BUCKETS > bytes.length)
+            continue;
+        var rssi = {};
+        var snr = {};
+        for(var b = 0; b < LINK_DIGEST_BUCKETS; b++){
+            rssi[LINK_DIGEST_RSSI_MIN + b * LINK_DIGEST_RSSI_STEP] = bytes[idx + 1 + b];
+            snr[LINK_DIGEST_SNR_MIN + b * LINK_DIGEST_SNR_STEP] = bytes[idx + 1 + LINK_DIGEST_BUCKETS + b];
+        }
+        digest["datarates"]["DR" + dr] = { "uplinks": bytes[idx], "rssi": rssi, "snr": snr };
+        idx += 1 + 2 * LINK_DIGEST_BUCKETS;
+    }
+    return digest;
+}
+
+function Decode(fport, bytes, variables){
+    if(fport === BATCH_PORT)
+        return decodeBatch(bytes);
+    if(fport === DELTA_PORT)
+        return decodeDelta(bytes);
+    if(fport === LINK_DIGEST_PORT)
+        return decodeLinkDigest(bytes);
+    return decodeUplink(bytes, 0);
+}
 var bytes = [0x04, 0x00, 0xa6, 0x09, 0x22, 0x0f, 0xef, 0x26, 00, 00, 00, 00]
 
 /*var obj = Decode(0, bytes, 0);
@@ -41,28 +289,32 @@ console.log(obj['press']);
 console.log(obj['AQI']);
 console.log(obj['CO2']);*/
 
-var obj = {'interval': 300}
+var obj = {'seq': 1, 'interval': 24, 'save_state': true}
 
-function intToBytes(integer) {
-    var b = [0, 0];
-    /* uint16_t is more than enought to give an interval (uint8_t stayed under a day) */
-    if(integer > 65535)
-        return [];
-    for(var i = 0; i < 2; i++){
-        b[i] = integer & 0xff;
-        integer >>= 8;
-    }
-    return b.reverse();
-}
-  
+/*
+    command frame for DOWNLINK_PORT: sequence number (obj.seq, 0 if missing) and a TLV for every known
+    field of obj in the order of COMMANDS, the commands without a value are sent when their field is true
+*/
 function Encode(fPort, obj, variables) {
-    var intervalValue;
-    for(var v in obj){
-        if(v === 'interval' && obj[v] > 0){
-            intervalValue = intToBytes(obj[v])
+    var bytes = [(obj.seq || 0) & 0xff];
+    for(var name in COMMANDS){
+        var cmd = COMMANDS[name];
+        if(!(name in obj))
+            continue;
+        if(cmd.len === 0){
+            if(obj[name])
+                bytes.push(cmd.type, 0);
+            continue;
+        }
+        var value = obj[name];
+        if(value < cmd.min || value > cmd.max)
+            throw new RangeError(name + ' out of range');
+        bytes.push(cmd.type, cmd.len);
+        for(var i = 0; i < cmd.len; i++){
+            bytes.push(value & 0xff);
+            value >>= 8;
         }
     }
-    
-    return intervalValue;
+    return bytes;
 }
-console.log(Encode(0, obj, 0))
\ No newline at end of file
+console.log(Encode(DOWNLINK_PORT, obj, 0))
@@ -16,17 +16,36 @@
 #define LORAWAN_DEV_ADDR                "xxxxxxxx"
 
 // LoRaWAN Network Session Key (128-bit)
-#define LORAWAN_NETWORK_SESSION_KEY     "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"
+#define LORAWAN_NETWORK_SESSION_KEY     "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"
 
 // LoRaWAN Application Session Key (128-bit)
-#define LORAWAN_APP_SESSION_KEY         "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"
+#define LORAWAN_APP_SESSION_KEY         "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"
 
-// LoRaWAN Channel Mask, NULL value will use the default channel mask 
-// for the region
-#define LORAWAN_CHANNEL_MASK            NULL
+// define to join over the air with DEV_EUI, LORAWAN_APP_EUI and LORAWAN_APP_KEY instead of the ABP keys,
+// the session and the DevNonce are kept in the NVM so a reboot doesn't join again
+//#define LORAWAN_OTAA
+
+// LoRaWAN Join EUI (64-bit)
+#define LORAWAN_APP_EUI                 "0000000000000000"
+
+// LoRaWAN Application Key (128-bit)
+#define LORAWAN_APP_KEY                 "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"
+
+// LoRaWAN Channel Mask, 24 hex digits converted to binary with the keys at compile time,
+// comment out to use the default channel mask for the region
+//#define LORAWAN_CHANNEL_MASK            "00ff00000000000000000000"
+
+// single-channel gateway (nanogateway): frequency in Hz and datarate of every uplink, RX2 answers on the same ones,
+// comment out to use every channel of the region. DR0 is SF12BW125 in EU868, a join needs one of the default channels
+#define LORAWAN_SINGLE_CHANNEL_FREQ     868100000
+#define LORAWAN_SINGLE_CHANNEL_DR       0
+
+// GPS time kept within this error by AppTimeReq sent from lorawan_process when the drift says so, comment out for no
+// clock sync. An AppTimeAns corrects by whole seconds, at 1000 ms or less an AppTimeReq goes out every 10 minutes
+#define CLOCK_SYNC_ACCURACY_MS          10000
 
 #ifdef DEBUG 
-    #define INTERVAL          1  /*number of readings to skip before sending, each reading happens in an interval of 5 minutes*/
+    #define INTERVAL          1  /*highest number of readings sent together in a frame, each reading happens in an interval of 5 minutes*/
 #else
     #define INTERVAL          12 
 #endif
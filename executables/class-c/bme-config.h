@@ -1,9 +1,11 @@
 #define PIN_FORMAT_OUTPUT   16
 #define PIN_FORMAT_INPUT    17
 #define SAVE_INTERVAL       72  //21600/300
+#define BSEC_CONFIG_PORT    3   //downlink port used to select the bsec configuration by id
+#define LINK_DIGEST_PORT    11  //uplink port of the link telemetry digest, see src/include/pico/link-telemetry.h
+#define LINK_DIGEST_EVERY   48  //uplinks between two digests, queued by the lorawan library, 0 to turn it off
 
 const char* state_file_name = "state_file.config";
-const char* config_file_name = "2022_05_17_01_09_bsec_h2s_nonh2s_2_2_0_0.config"; 
 /**
  * @brief saves the file on littlefs afters some time has passed
  * 
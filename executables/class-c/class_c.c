@@ -23,6 +23,10 @@
 #include "../lib/bme/bme_api/bme68x_API.h"
 #include "../lib/bme/bsec2_4/bsec_datatypes.h"
 #include "../lib/bme/bsec2_4/bsec_interface.h"
+#include "../lib/bsec_config/bsec_config.h"
+#include "../lib/scratch/scratch.h"
+#include "../lib/stats/stats.h"
+#include "../lib/payload/payload.h"
 
 //littlefs
 #include "pico_hal.h"
@@ -39,6 +43,8 @@
 #define REQUESTED_OUTPUT        2
 #define BME68X_VALID_DATA       UINT8_C(0xB0)
 #define BSEC_CHECK_INPUT(x, shift)		(x & (1 << (shift-1)))
+//time kept free before a ping slot or the beacon on top of the wait for a measurement, in ms
+#define CLASS_B_GUARD_MS        20
 /*
     Variables handling the rtc sleep
     registers and clocks
@@ -63,34 +69,54 @@ const struct lorawan_sx12xx_settings sx12xx_settings = {
     .dio1 = 20
 };
 
-/*
-    ABP settings
-*/ 
-const struct lorawan_abp_settings abp_settings = {
-    .device_address = LORAWAN_DEV_ADDR,
-    .network_session_key = LORAWAN_NETWORK_SESSION_KEY,
-    .app_session_key = LORAWAN_APP_SESSION_KEY,
-    .channel_mask = LORAWAN_CHANNEL_MASK
-};
+#ifdef LORAWAN_SINGLE_CHANNEL_FREQ
+#define SINGLE_CHANNEL_FLAG     PROVISION_SINGLE_CHANNEL
+#else
+#define SINGLE_CHANNEL_FLAG     0
+#define LORAWAN_SINGLE_CHANNEL_FREQ     0
+#define LORAWAN_SINGLE_CHANNEL_DR       0
+#endif
+
+#ifdef LORAWAN_CHANNEL_MASK
+#define CHANNEL_MASK_FLAG       PROVISION_CHANNEL_MASK
+#else
+#define CHANNEL_MASK_FLAG       0
+#endif
 
 /*
-    variables for receiving lora downlinks (if any)
+    ABP keys of lora-config.h converted to binary by the compiler, used when the provisioning sector of the flash holds
+    no record of tools/provision. With a single channel every uplink goes on the frequency and the datarate the
+    nanogateway listens to
 */
-int receive_length = 0;
-uint8_t receive_buffer[242];
-uint8_t receive_port = 0;
+const struct provision_record provision = {
+    PROVISION_HEADER,
+    .region = LORAWAN_REGION,
+    .flags = PROVISION_DEV_ADDR | CHANNEL_MASK_FLAG | SINGLE_CHANNEL_FLAG,
+    .dev_addr = PROVISION_HEX_U32(LORAWAN_DEV_ADDR),
+    .nwk_s_key = PROVISION_HEX_16(LORAWAN_NETWORK_SESSION_KEY),
+    .app_s_key = PROVISION_HEX_16(LORAWAN_APP_SESSION_KEY),
+#ifdef LORAWAN_CHANNEL_MASK
+    .channel_mask = PROVISION_HEX_MASK(LORAWAN_CHANNEL_MASK),
+#endif
+    .frequency = LORAWAN_SINGLE_CHANNEL_FREQ,
+    .datarate = LORAWAN_SINGLE_CHANNEL_DR,
+};
+
+//the conversions above read past a string too short without a warning, the lengths are checked here
+_Static_assert(sizeof(LORAWAN_DEV_ADDR) == 9, "LORAWAN_DEV_ADDR must be 8 hex digits");
+_Static_assert(sizeof(LORAWAN_NETWORK_SESSION_KEY) == 33, "LORAWAN_NETWORK_SESSION_KEY must be 32 hex digits");
+_Static_assert(sizeof(LORAWAN_APP_SESSION_KEY) == 33, "LORAWAN_APP_SESSION_KEY must be 32 hex digits");
+#ifdef LORAWAN_CHANNEL_MASK
+_Static_assert(sizeof(LORAWAN_CHANNEL_MASK) == 25, "LORAWAN_CHANNEL_MASK must be 24 hex digits");
+#endif
 
 /*
-    Structure of the uplink, total of 10 Bytes
-    the structure holds the probability for the different gases
+    the uplink holds the mean probability for the different gases over the readings since the last uplink,
+    see struct payload_gas_uplink in payload.json
 */
-struct uplink {
-    uint16_t id; 
-    uint16_t p1;
-    uint16_t p2;
-    uint16_t p3;
-    uint16_t p4;
-};
+//conversion factor of the probabilities in the uplink
+#define PROBABILITY_SCALE       10000.0f
+#define STATS_EWMA_SHIFT        3
 
 //measurements basically
 bsec_sensor_configuration_t requested_virtual_sensors[REQUESTED_OUTPUT];
@@ -101,19 +127,21 @@ uint8_t n_required_sensor_settings = BSEC_MAX_PHYSICAL_SENSOR;
 //configuration coming from bsec
 bsec_bme_settings_t conf_bsec;
 
-//state to save
-uint8_t serialized_state[BSEC_MAX_STATE_BLOB_SIZE];
+//state to save, the buffers are taken from the scratch arena only while restoring or saving
 uint32_t n_serialized_state_max = BSEC_MAX_STATE_BLOB_SIZE;
 uint32_t n_serialized_state = BSEC_MAX_STATE_BLOB_SIZE;
-uint8_t work_buffer_state[BSEC_MAX_WORKBUFFER_SIZE];
 uint32_t n_work_buffer_size = BSEC_MAX_WORKBUFFER_SIZE;
 
-//settings to load
-uint8_t serialized_settings[BSEC_MAX_PROPERTY_BLOB_SIZE];
-uint32_t n_serialized_settings_max = BSEC_MAX_PROPERTY_BLOB_SIZE;
-uint8_t work_buffer[BSEC_MAX_WORKBUFFER_SIZE];
+//configuration to load, the blob is in flash so only the work buffer is needed
 uint32_t n_work_buffer = BSEC_MAX_WORKBUFFER_SIZE;
 
+/*
+    scratch region shared by the bsec buffers, sized for the largest set alive at the same time
+    (state and its work buffer), the configuration work buffer never overlaps with them
+*/
+#define SCRATCH_SIZE            (SCRATCH_ROUND(BSEC_MAX_STATE_BLOB_SIZE) + SCRATCH_ROUND(BSEC_MAX_WORKBUFFER_SIZE))
+static uint8_t scratch_region[SCRATCH_SIZE] __attribute__((aligned(SCRATCH_ALIGN)));
+
 /*
     BSEC VARIABLES
 */
@@ -129,6 +157,21 @@ void software_reset()
     while(1);
 }
 
+/**
+ * @brief stops on a block the scratch arena could not give, SCRATCH_SIZE is too small for the buffers alive together
+ * 
+ * @param block result of scratch_alloc
+ * @param msg buffer requested
+ */
+void check_scratch(const void* block, char msg[]){
+    (void)msg;
+    if(block == NULL){
+    #ifdef DEBUG
+        printf("Scratch arena too small for %s\n", msg);
+    #endif
+        blink();
+    }
+}
 
 /**
  * @brief utility to print out the results
@@ -140,13 +183,28 @@ void software_reset()
 void print_results(int id, float signal, int accuracy);
 
 /**
- * @brief adds the probabilites of the different gases obtained throught the reading cycles
+ * @brief fills the probabilites of the different gases with the mean of the reading cycles since the last uplink
  * 
  * @param pkt uplink packet
- * @param id id of the probability 
- * @param signal value of the probability
+ * @param win statistics of the probabilities
  */
-void add_probabilites(struct uplink* pkt, int id, float signal);
+void add_probabilites(struct payload_gas_uplink* pkt, const struct stats_window* win);
+
+/**
+ * @brief loads a configuration from the registry, the blob is given to the bsec library straight from flash
+ *          and the virtual sensors are subscribed again since a new configuration resets them
+ * 
+ * @param id id of the configuration in the registry
+ * @return bsec_library_return_t result of the bsec operations, BSEC_E_CONFIG_EMPTY if the id is unknown
+ */
+bsec_library_return_t load_bsec_config(uint8_t id);
+
+/**
+ * @brief registers the BSEC configuration of the last FUOTA session, the blob stays in the flash of the store
+ * 
+ * @return int id of the configuration, -1 if the applied file is not a BSEC configuration
+ */
+int register_fuota_config();
 
 uint8_t processData(int64_t currTimeNs, const struct bme68x_data d, bsec_input_t* inputs){
     uint8_t n_input = 0;
@@ -204,13 +262,14 @@ int main( void )
     /*
         PKT AND CONSTANT VALUES
     */
-    struct uplink pkt = {
+    struct payload_gas_uplink pkt = {
         .id = DEV_ID,
         .p1 = 0,
         .p2 = 0,
         .p3 = 0,
         .p4 = 0,
     };   
+    uint8_t frame[PAYLOAD_GAS_UPLINK_LEN];
     //
     uint32_t time_us;
     /*
@@ -310,31 +369,8 @@ int main( void )
         blink();
     }
 
-    //open settings file and set
-    fr = f_open(&fil, config_file_name, FA_READ);
-    if(fr != FR_OK && fr != FR_NO_FILE){
-    #ifdef DEBUG
-        printf("Error opening the file\n");
-    #endif
-        blink();    
-    }
-    uint8_t ss[2048];
-
-    if(fr == FR_OK){
-        fr = f_read(&fil, serialized_settings, BSEC_MAX_PROPERTY_BLOB_SIZE*sizeof(uint8_t), &bread);
-        if(fr != FR_OK){
-        #ifdef DEBUG
-            printf("Error reading the file\n");
-        #endif
-            blink();
-        }
-    }
-    if(fr == FR_NO_FILE){
-        #ifdef DEBUG
-            printf("There is no settings file saved\n");
-        #endif
-    }
-    f_close(&fil);
+    scratch_init(scratch_region, sizeof(scratch_region));
+    uint32_t scratch_top = scratch_mark();
     rslt_bsec = bsec_init();
     check_rslt_bsec( rslt_bsec, "BSEC_INIT");
     /*
@@ -348,10 +384,19 @@ int main( void )
     /*
         load the configuration with the parameters for the gas recognition, the configuration is obtained through the bosch bme ai sensor software
         there's the chance to load the figuration as a file but it doesn't work, it was nontheless used through a sd card reader connected to the pico
+        the blob is kept in flash by the registry and can be switched with a downlink on BSEC_CONFIG_PORT
     */
-    const uint8_t bsec_config_selectivity[1974] = {0,0,4,2,189,1,0,0,0,0,0,0,158,7,0,0,176,0,1,0,0,168,19,73,64,49,119,76,0,192,40,72,0,192,40,72,137,65,0,191,205,204,204,190,0,0,64,191,225,122,148,190,10,0,3,0,0,0,96,64,23,183,209,56,0,0,0,0,0,0,0,0,0,0,0,0,205,204,204,189,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,128,63,82,73,157,188,95,41,203,61,118,224,108,63,155,230,125,63,191,14,124,63,0,0,160,65,0,0,32,66,0,0,160,65,0,0,32,66,0,0,32,66,0,0,160,65,0,0,32,66,0,0,160,65,8,0,2,0,236,81,133,66,16,0,3,0,10,215,163,60,10,215,35,59,10,215,35,59,13,0,5,0,0,0,0,0,100,254,131,137,87,88,0,9,0,7,240,150,61,0,0,0,0,0,0,0,0,28,124,225,61,52,128,215,63,0,0,160,64,0,0,0,0,0,0,0,0,205,204,12,62,103,213,39,62,230,63,76,192,0,0,0,0,0,0,0,0,145,237,60,191,251,58,64,63,177,80,131,64,0,0,0,0,0,0,0,0,93,254,227,62,54,60,133,191,0,0,64,64,12,0,10,0,0,0,0,0,0,0,0,0,13,5,11,0,0,0,2,97,212,217,189,123,211,184,190,246,39,132,190,206,174,109,189,251,75,175,189,235,9,110,62,137,144,36,63,45,8,80,62,144,77,210,188,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,40,255,226,62,40,255,226,190,0,0,0,0,0,0,0,0,76,31,165,190,5,133,25,190,99,111,16,191,4,102,151,189,223,240,98,190,35,221,96,62,233,47,232,61,154,195,212,62,246,23,39,191,0,0,0,0,208,204,147,189,31,212,43,190,235,102,187,62,96,223,37,190,68,35,41,190,176,189,140,62,167,195,139,189,61,247,59,62,197,184,64,62,0,0,0,0,244,158,240,189,150,236,38,62,220,212,82,190,97,85,116,190,38,131,133,189,226,168,44,62,210,144,202,190,155,4,251,62,111,28,141,62,0,0,0,0,11,238,37,61,214,142,233,189,152,81,180,190,225,50,209,62,51,229,221,62,153,207,193,59,0,126,171,60,100,47,212,62,12,59,73,189,0,0,0,0,109,51,81,189,246,41,221,189,14,235,164,190,106,152,64,62,146,87,64,62,211,57,245,189,85,105,18,61,201,169,91,190,254,132,14,189,0,0,0,0,67,219,100,62,66,204,199,190,41,243,253,189,179,13,234,189,8,59,224,190,29,6,33,190,164,176,176,190,54,130,42,63,55,59,158,189,0,0,0,0,180,113,104,190,83,10,224,190,121,202,43,190,103,45,12,190,15,201,28,190,45,147,66,63,59,77,166,189,87,205,216,189,202,231,80,190,0,0,0,0,61,78,135,190,204,10,107,190,83,139,36,62,193,61,191,62,98,160,17,190,189,93,7,63,134,130,186,61,225,40,223,189,104,13,99,190,0,0,0,0,255,48,206,190,218,86,40,189,67,21,240,190,140,32,28,61,216,22,56,190,200,133,35,190,235,148,37,62,54,40,19,63,59,144,196,190,0,0,0,0,56,41,1,191,129,1,168,190,155,197,38,190,19,130,161,190,172,193,237,189,76,39,22,62,156,12,115,63,153,230,241,59,251,43,182,190,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,159,49,7,191,186,149,18,63,0,0,0,0,0,0,0,0,24,104,156,190,241,167,235,189,0,0,0,0,0,0,0,0,42,27,1,190,234,50,155,62,0,0,0,0,0,0,0,0,104,247,151,189,48,189,192,62,0,0,0,0,0,0,0,0,223,179,175,190,87,168,137,190,0,0,0,0,0,0,0,0,44,240,99,62,155,142,95,191,0,0,0,0,0,0,0,0,74,14,53,63,152,160,21,191,0,0,0,0,0,0,0,0,115,135,204,62,33,73,249,190,0,0,0,0,0,0,0,0,138,35,98,191,36,48,73,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,9,0,2,88,154,50,72,197,13,232,75,9,255,180,75,145,98,131,75,167,32,87,73,174,158,62,73,8,35,45,73,12,163,26,72,242,227,55,72,126,235,71,72,0,0,0,0,0,0,0,0,0,0,0,0,184,21,18,72,175,32,249,75,207,100,195,75,164,64,141,75,117,176,79,73,115,35,54,73,215,19,36,73,36,167,240,71,157,166,10,72,81,152,20,72,0,0,128,63,0,0,128,63,0,0,128,63,0,0,0,88,1,254,0,2,1,5,48,117,100,0,44,1,112,23,151,7,132,3,197,0,92,4,144,1,64,1,64,1,144,1,48,117,48,117,48,117,48,117,100,0,100,0,100,0,48,117,48,117,48,117,100,0,100,0,48,117,48,117,8,7,8,7,8,7,8,7,8,7,100,0,100,0,100,0,100,0,48,117,48,117,48,117,100,0,100,0,100,0,48,117,48,117,100,0,100,0,255,255,255,255,255,255,255,255,255,255,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,1,255,255,255,255,255,255,255,255,255,255,112,23,112,23,112,23,112,23,8,7,8,7,8,7,8,7,112,23,112,23,112,23,112,23,112,23,112,23,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,112,23,112,23,112,23,112,23,255,255,255,255,220,5,220,5,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,220,5,220,5,220,5,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,48,117,0,5,10,5,0,2,0,10,0,30,0,5,0,5,0,5,0,5,0,5,0,5,0,64,1,100,0,100,0,100,0,200,0,200,0,200,0,64,1,64,1,64,1,10,1,0,0,0,0,183,167,0,0};
-    rslt_bsec = bsec_set_configuration(bsec_config_selectivity, n_serialized_settings_max, work_buffer, n_work_buffer);
+    const struct bsec_config_entry* bsec_config = bsec_config_find(BSEC_CONFIG_ID_SELECTIVITY);
+    uint8_t* work_buffer = scratch_alloc(n_work_buffer);
+    check_scratch(work_buffer, "the configuration work buffer");
+    rslt_bsec = bsec_set_configuration(bsec_config->blob, bsec_config->len, work_buffer, n_work_buffer);
     check_rslt_bsec( rslt_bsec, "BSEC_SET_CONFIGURATION");
+    scratch_release(scratch_top);
+    //kept until the state is given to the bsec library
+    uint8_t* serialized_state = scratch_alloc(n_serialized_state_max);
+    uint8_t* work_buffer_state = scratch_alloc(n_work_buffer_size);
+    check_scratch(serialized_state, "the state");
+    check_scratch(work_buffer_state, "the state work buffer");
     //state file operations
     if(!format){//if not format mount and read, otherwise avoid
         printf("Loading state\n");
@@ -366,7 +411,7 @@ int main( void )
         printf("Opened state\n");
 
         if(fr == FR_OK){
-            fr = f_read(&fil, serialized_state, BSEC_MAX_WORKBUFFER_SIZE*sizeof(uint8_t), &bread);
+            fr = f_read(&fil, serialized_state, n_serialized_state_max, &bread);
             if(fr != FR_OK){
             #ifdef DEBUG
                 printf("Error reading the file\n");
@@ -393,9 +438,10 @@ int main( void )
     #ifdef DEBUG
         printf("...resuming the state, read %d bytes\n", bread);
     #endif
-        bsec_set_state(serialized_state, n_serialized_state, work_buffer_state, n_work_buffer_size);
+        rslt_bsec = bsec_set_state(serialized_state, bread, work_buffer_state, n_work_buffer_size);
         check_rslt_bsec( rslt_bsec, "BSEC_SET_STATE");
     }
+    scratch_release(scratch_top);
 
 
     sleep_ms(1000);
@@ -410,24 +456,32 @@ int main( void )
     #ifdef DEBUG
     lorawan_debug(true);
     printf("Pico LoRaWAN - lora and bme sensor\n\n");
-    printf("Erasing NVM ... ");
-    
-    if (lorawan_erase_nvm() < 0) {
-        printf("failed!!!\n");
-    } else {
+#endif
+    /*
+        the LoRaWAN session stored in the NVM is resumed at boot, it is thrown away
+        only with the format pin, together with the state files, or when the keys change
+    */
+    if (format) {
+    #ifdef DEBUG
+        printf("Erasing NVM ... ");
+    #endif
+        if (lorawan_erase_nvm() < 0) {
+        #ifdef DEBUG
+            printf("failed!!!\n");
+        #endif
+            blink();
+        }
+    #ifdef DEBUG
         printf("success!\n");
+    #endif
     }
-#else 
-    if (lorawan_erase_nvm() < 0) {
-        blink();
-    } 
-#endif
 
     // initialize the LoRaWAN stack
 #ifdef DEBUG
     printf("Initilizating LoRaWAN ... ");
 #endif
-    if (lorawan_init_abp(&sx12xx_settings, LORAWAN_REGION, &abp_settings) < 0) {
+    const struct provision_record* record = lorawan_provision_flash();
+    if (lorawan_init_provisioned(&sx12xx_settings, record != NULL ? record : &provision) < 0) {
     #ifdef DEBUG
         printf("Fail, restarting\n");
     #endif
@@ -435,9 +489,8 @@ int main( void )
 
     }
 #ifdef DEBUG
-    else {
-        printf("Success!\n");
-    }
+    printf("Success!\n");
+    printf("%s session\n", lorawan_session_state() == LORAWAN_SESSION_RESTORED ? "Restored" : "New");
 #endif
     /*initialize state for temp/hum/press with impossible values*/
     double previous_temp = -400;
@@ -449,8 +502,30 @@ int main( void )
     while (!lorawan_is_joined()) {
         lorawan_process();
     }
+    //a configuration received over FUOTA before the reset can be selected again with a downlink
+    uint32_t fuota_applied = lorawan_fuota_applied();
+    register_fuota_config();
+    //the node is always awake, the library sends the link digest on its own with lorawan_process
+    lorawan_link_digest_every(LINK_DIGEST_EVERY, LINK_DIGEST_PORT);
+#ifdef LORAWAN_CLASS_B_PERIODICITY
+    //downlinks wait for the ping slots, in class A until the beacon is found, a lost beacon is looked for again by the library
+    if (lorawan_request_class_b(LORAWAN_CLASS_B_PERIODICITY) < 0) {
+    #ifdef DEBUG
+        printf("Class B not available, staying in class C\n");
+    #endif
+    }
+#endif
     conf_bsec.next_call = BME68X_SLEEP_MODE;
-    uint8_t number_samples = 0;
+    /*
+        the probabilities are accumulated in fixed-point between two uplinks,
+        summing the floats in the uint16_t fields of the packet truncated every sample
+    */
+    struct stats_window window;
+    stats_init(&window, STATS_EWMA_SHIFT);
+    stats_add_channel(&window, BSEC_OUTPUT_GAS_ESTIMATE_1, PROBABILITY_SCALE);
+    stats_add_channel(&window, BSEC_OUTPUT_GAS_ESTIMATE_2, PROBABILITY_SCALE);
+    stats_add_channel(&window, BSEC_OUTPUT_GAS_ESTIMATE_3, PROBABILITY_SCALE);
+    stats_add_channel(&window, BSEC_OUTPUT_GAS_ESTIMATE_4, PROBABILITY_SCALE);
     // loop forever
     uint64_t last_send_time = 0; 
     while (1) {
@@ -499,27 +574,22 @@ int main( void )
                             printf("--------------Sleep Mode--------------\n");
                             rslt_api = bme68x_set_op_mode(BME68X_SLEEP_MODE, &bme); 
                             current_op_mode = BME68X_SLEEP_MODE;
-                            if(number_samples > 0 && (time_us_64() - last_send_time) > 3000000){
-                                pkt.p1 /= number_samples;
-                                pkt.p2 /= number_samples;
-                                pkt.p3 /= number_samples;
-                                pkt.p4 /= number_samples;
+                            if(stats_get(&window, BSEC_OUTPUT_GAS_ESTIMATE_1)->count > 0 && (time_us_64() - last_send_time) > 3000000){
+                                add_probabilites(&pkt, &window);
+                                payload_gas_uplink_encode(&pkt, frame);
                             #ifdef DEBUG
                                 printf("\n");
-                                if (lorawan_send_unconfirmed(&pkt, sizeof(struct uplink), 2) < 0) {
+                                if (lorawan_send_unconfirmed(frame, sizeof(frame), PAYLOAD_GAS_UPLINK_PORT) < 0) {
                                     printf("failed!!!\n");
                                 } else {
                                     printf("success!\n");
                                 }
                             #else
-                                lorawan_send_unconfirmed(&pkt, sizeof(struct uplink), 2) >= 0
+                                lorawan_send_unconfirmed(frame, sizeof(frame), PAYLOAD_GAS_UPLINK_PORT);
                             #endif
-                                
+                                last_send_time = time_us_64();
+                                stats_reset(&window);
                             }
-                            pkt.p1 = 0;
-                            pkt.p2 = 0;
-                            pkt.p3 = 0;
-                            pkt.p4 = 0;
                         }
                         break;
                 }
@@ -529,6 +599,11 @@ int main( void )
                 
                 if(conf_bsec.op_mode == BME68X_PARALLEL_MODE){
                     del_period = bme68x_get_meas_dur(BME68X_PARALLEL_MODE, &conf, &bme) + (heatr_conf.shared_heatr_dur * 1000);
+                #ifdef LORAWAN_CLASS_B_PERIODICITY
+                    //the stack opens the ping slots and the beacon window in lorawan_process, the wait must not cover them
+                    while(lorawan_class_b_next_ms() <= del_period / 1000 + CLASS_B_GUARD_MS)
+                        lorawan_process();
+                #endif
                     bme.delay_us(del_period, bme.intf_ptr);
                     
                     rslt_api = bme68x_get_op_mode(&current_op_mode, &bme);
@@ -550,7 +625,7 @@ int main( void )
                                 #ifdef DEBUG
                                     print_results(output[i].sensor_id, output[i].signal, output[i].accuracy);
                                 #endif
-                                add_probabilites(&pkt, output[i].sensor_id, output[i].signal);
+                                stats_update(&window, output[i].sensor_id, output[i].signal);
                                 }
                             }
                         }
@@ -560,30 +635,83 @@ int main( void )
         }
         
         if (lorawan_process() == 0) { 
-            // check if a downlink message was received
-            receive_length = lorawan_receive(receive_buffer, sizeof(receive_buffer), &receive_port);
+            // check if downlink messages were received, a class C node can get several between two loops
+            const struct lorawan_downlink* downlink;
+            while((downlink = lorawan_downlink_peek()) != NULL){
+                // one byte on the configuration port selects the bsec configuration by id
+                if(downlink->size == 1 && downlink->port == BSEC_CONFIG_PORT){
+                    rslt_bsec = load_bsec_config(downlink->data[0]);
+                #ifdef DEBUG
+                    printf("Switching to configuration %u: %d\n", downlink->data[0], rslt_bsec);
+                #endif
+                }
+                lorawan_downlink_consume();
+            }
+            // a new configuration was rebuilt from the fragments and passed its CRC, it replaces the current one
+            if(lorawan_fuota_applied() != fuota_applied){
+                fuota_applied = lorawan_fuota_applied();
+                int id = register_fuota_config();
+                if(id >= 0){
+                    rslt_bsec = load_bsec_config(id);
+                #ifdef DEBUG
+                    printf("FUOTA configuration %d loaded: %d\n", id, rslt_bsec);
+                #endif
+                }
+            }
         }
     }
     save_state_file();
     return 0;
 }
 
-void add_probabilites(struct uplink* pkt, int id, float signal){
-    switch(id){
-        case BSEC_OUTPUT_GAS_ESTIMATE_1:
-            pkt->p1 += signal;
-            break;
-        case BSEC_OUTPUT_GAS_ESTIMATE_2:
-            pkt->p2 += signal;
-            break;
-        case BSEC_OUTPUT_GAS_ESTIMATE_3:
-            pkt->p3 += signal;
-            break;
-        case BSEC_OUTPUT_GAS_ESTIMATE_4:
-            pkt->p4 += signal;
-            break;
-        default:
-            break;
+bsec_library_return_t load_bsec_config(uint8_t id){
+    const struct bsec_config_entry* entry = bsec_config_find(id);
+    if(entry == NULL)
+        return BSEC_E_CONFIG_EMPTY;
+
+    uint32_t scratch_top = scratch_mark();
+    uint8_t* work_buffer = scratch_alloc(n_work_buffer);
+    if(work_buffer == NULL)
+        return BSEC_E_CONFIG_INSUFFICIENTWORKBUFFER;
+    bsec_library_return_t rslt = bsec_set_configuration(entry->blob, entry->len, work_buffer, n_work_buffer);
+    scratch_release(scratch_top);
+    if(rslt != BSEC_OK)
+        return rslt;
+
+    n_required_sensor_settings = BSEC_MAX_PHYSICAL_SENSOR;
+    return bsec_update_subscription(requested_virtual_sensors, n_requested_virtual_sensors, required_sensor_settings, &n_required_sensor_settings);
+}
+
+int register_fuota_config(){
+    const struct lorawan_fuota_file* file = lorawan_fuota_file();
+    if(file == NULL || file->kind != LORAWAN_FUOTA_BSEC_CONFIG)
+        return -1;
+
+    if(bsec_config_register(file->id, "fuota", file->data, file->size) < 0)
+        return -1;
+    return file->id;
+}
+
+void add_probabilites(struct payload_gas_uplink* pkt, const struct stats_window* win){
+    for(uint8_t i = 0; i < win->n_channels; i++){
+        const struct stats_channel* ch = &win->channel[i];
+        uint16_t mean = (uint16_t)stats_mean(ch);
+        switch(ch->sensor_id){
+            case BSEC_OUTPUT_GAS_ESTIMATE_1:
+                pkt->p1 = mean;
+                break;
+            case BSEC_OUTPUT_GAS_ESTIMATE_2:
+                pkt->p2 = mean;
+                break;
+            case BSEC_OUTPUT_GAS_ESTIMATE_3:
+                pkt->p3 = mean;
+                break;
+            case BSEC_OUTPUT_GAS_ESTIMATE_4:
+                pkt->p4 = mean;
+                break;
+            default:
+                break;
+        }
     }
 }
 
@@ -692,9 +820,16 @@ void save_state_file(){
             printf("ERROR: Could not create file (%d)\r\n", fr);
             blink();
     }
+    uint32_t scratch_top = scratch_mark();
+    uint8_t* serialized_state = scratch_alloc(n_serialized_state_max);
+    uint8_t* work_buffer_state = scratch_alloc(n_work_buffer_size);
+    check_scratch(serialized_state, "the state");
+    check_scratch(work_buffer_state, "the state work buffer");
     rslt_bsec = bsec_get_state(0, serialized_state, n_serialized_state_max, work_buffer_state, n_work_buffer_size, &n_serialized_state);
     check_rslt_bsec(rslt_bsec, "BSEC_GET_STATE");
-    fr = f_write(&fil, serialized_state, BSEC_MAX_PROPERTY_BLOB_SIZE*sizeof(uint8_t), &bwritten);
+    //only the bytes actually used by the state are written
+    fr = f_write(&fil, serialized_state, n_serialized_state, &bwritten);
+    scratch_release(scratch_top);
     if(fr != FR_OK){
             printf("ERROR: Could not write file (%d)\r\n", fr);
             blink();
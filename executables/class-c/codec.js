@@ -0,0 +1,160 @@
+/* payloadgen begin, generated by tools/payloadgen/payloadgen.py from payload.json, do not edit by hand */
+function payloadU8(bytes, idx){
+    return bytes[idx] & 0xFF;
+}
+
+function payloadI8(bytes, idx){
+    var v = bytes[idx] & 0xFF;
+    return v & 0x80 ? v - 0x100 : v;
+}
+
+function payloadU16(bytes, idx){
+    return (bytes[idx] & 0xFF) | ((bytes[idx+1] & 0xFF) << 8);
+}
+
+function payloadI16(bytes, idx){
+    var v = payloadU16(bytes, idx);
+    return v & 0x8000 ? v - 0x10000 : v;
+}
+
+function payloadI32(bytes, idx){
+    return (bytes[idx] & 0xFF) | ((bytes[idx+1] & 0xFF) << 8) | ((bytes[idx+2] & 0xFF) << 16) | ((bytes[idx+3] & 0xFF) << 24);
+}
+
+function payloadU32(bytes, idx){
+    return payloadI32(bytes, idx) >>> 0;
+}
+
+/* reading of the class-a sensor, element of the batch and delta frames */
+var PAYLOAD_READING_LEN = 10;
+
+/* converts the integer fields to the physical values */
+function scaleReading(raw){
+    return{
+        "temp": raw.temp/100,
+        "hum": raw.hum/100,
+        "press": raw.press/10,
+        "AQI": raw.AQI == 0 ? 'nan' : raw.AQI/10,
+        "CO2": raw.CO2 == 0 ? 'nan' : raw.CO2,
+    };
+}
+
+function decodeReading(bytes, idx){
+    return scaleReading({
+        "temp": payloadI16(bytes, idx+0),
+        "hum": payloadU16(bytes, idx+2),
+        "press": payloadU16(bytes, idx+4),
+        "AQI": payloadU16(bytes, idx+6),
+        "CO2": payloadU16(bytes, idx+8),
+    });
+}
+
+/* single reading with the id of the device, sent by hello-abp */
+var PAYLOAD_UPLINK_LEN = 12;
+var PAYLOAD_UPLINK_PORT = 2;
+
+/* converts the integer fields to the physical values */
+function scaleUplink(raw){
+    return{
+        "id": raw.id,
+        "temp": raw.temp/100,
+        "hum": raw.hum/100,
+        "press": raw.press/10,
+        "AQI": raw.AQI == 0 ? 'nan' : raw.AQI/10,
+        "CO2": raw.CO2 == 0 ? 'nan' : raw.CO2,
+    };
+}
+
+function decodeUplink(bytes, idx){
+    return scaleUplink({
+        "id": payloadU16(bytes, idx+0),
+        "temp": payloadI16(bytes, idx+2),
+        "hum": payloadU16(bytes, idx+4),
+        "press": payloadU16(bytes, idx+6),
+        "AQI": payloadU16(bytes, idx+8),
+        "CO2": payloadU16(bytes, idx+10),
+    });
+}
+
+/* mean probability of the gases over the readings since the last uplink, sent by class-c */
+var PAYLOAD_GAS_UPLINK_LEN = 10;
+var PAYLOAD_GAS_UPLINK_PORT = 2;
+
+/* converts the integer fields to the physical values */
+function scaleGasUplink(raw){
+    return{
+        "id": raw.id,
+        "p1": raw.p1/10000,
+        "p2": raw.p2/10000,
+        "p3": raw.p3/10000,
+        "p4": raw.p4/10000,
+    };
+}
+
+function decodeGasUplink(bytes, idx){
+    return scaleGasUplink({
+        "id": payloadU16(bytes, idx+0),
+        "p1": payloadU16(bytes, idx+2),
+        "p2": payloadU16(bytes, idx+4),
+        "p3": payloadU16(bytes, idx+6),
+        "p4": payloadU16(bytes, idx+8),
+    });
+}
+
+/* payloadgen end */
+
+/* port of the link telemetry digest, see src/include/pico/link-telemetry.h */
+var LINK_DIGEST_PORT = 11;
+var LINK_DIGEST_RSSI_MIN = -128;
+var LINK_DIGEST_RSSI_STEP = 12;
+var LINK_DIGEST_SNR_MIN = -20;
+var LINK_DIGEST_SNR_STEP = 4;
+var LINK_DIGEST_BUCKETS = 8;
+/* margin not known, no LinkCheckAns or no downlink in the period */
+var LINK_DIGEST_NO_MARGIN = 127;
+
+function linkMargin(bytes, idx){
+    var v = payloadI8(bytes, idx);
+    return v === LINK_DIGEST_NO_MARGIN ? null : v;
+}
+
+/*
+    header with the counters of the period, then for every datarate in the mask the uplinks sent and the
+    histograms of the downlinks, the bucket is named after its lower edge, the first and the last one are open
+*/
+function decodeLinkDigest(bytes){
+    var digest = {
+        "version": bytes[0],
+        "acked": payloadU16(bytes, 1),
+        "missed": payloadU16(bytes, 3),
+        "rx1": payloadU16(bytes, 5),
+        "rx2": payloadU16(bytes, 7),
+        "rx_other": payloadU16(bytes, 9),
+        "link_check_margin": linkMargin(bytes, 11),
+        "link_check_gateways": bytes[12],
+        "devstatus_margin": linkMargin(bytes, 13),
+        "min_downlink_margin": linkMargin(bytes, 14),
+        "datarates": {},
+    };
+    var mask = bytes[15];
+    var idx = 16;
+    for(var dr = 0; dr < 8; dr++){
+        if(!(mask & (1 << dr)) || idx + 1 + 2 * LINK_DIGEST_BUCKETS > bytes.length)
+            continue;
+        var rssi = {};
+        var snr = {};
+        for(var b = 0; b < LINK_DIGEST_BUCKETS; b++){
+            rssi[LINK_DIGEST_RSSI_MIN + b * LINK_DIGEST_RSSI_STEP] = bytes[idx + 1 + b];
+            snr[LINK_DIGEST_SNR_MIN + b * LINK_DIGEST_SNR_STEP] = bytes[idx + 1 + LINK_DIGEST_BUCKETS + b];
+        }
+        digest["datarates"]["DR" + dr] = { "uplinks": bytes[idx], "rssi": rssi, "snr": snr };
+        idx += 1 + 2 * LINK_DIGEST_BUCKETS;
+    }
+    return digest;
+}
+
+function Decode(fport, bytes, variables){
+    if(fport === LINK_DIGEST_PORT)
+        return decodeLinkDigest(bytes);
+    return decodeGasUplink(bytes, 0);
+}
@@ -16,14 +16,23 @@
 #define LORAWAN_DEV_ADDR                "xxxxxxxx"
 
 // LoRaWAN Network Session Key (128-bit)
-#define LORAWAN_NETWORK_SESSION_KEY     "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"
+#define LORAWAN_NETWORK_SESSION_KEY     "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"
 
 // LoRaWAN Application Session Key (128-bit)
-#define LORAWAN_APP_SESSION_KEY         "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"
+#define LORAWAN_APP_SESSION_KEY         "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"
 
-// LoRaWAN Channel Mask, NULL value will use the default channel mask 
-// for the region
-#define LORAWAN_CHANNEL_MASK            NULL
+// LoRaWAN Channel Mask, 24 hex digits converted to binary with the keys at compile time,
+// comment out to use the default channel mask for the region
+//#define LORAWAN_CHANNEL_MASK            "00ff00000000000000000000"
+
+// single-channel gateway (nanogateway): frequency in Hz and datarate of every uplink, RX2 answers on the same ones,
+// comment out to use every channel of the region. DR0 is SF12BW125 in EU868, a join needs one of the default channels
+#define LORAWAN_SINGLE_CHANNEL_FREQ     868100000
+#define LORAWAN_SINGLE_CHANNEL_DR       0
+
+// class B instead of class C once joined: a ping slot every 2^LORAWAN_CLASS_B_PERIODICITY seconds (0 to 7) and the
+// radio asleep in between, the library needs PICO_LORAWAN_CLASS_B (on by default). Comment out to stay in class C
+//#define LORAWAN_CLASS_B_PERIODICITY     2
 
 #ifdef DEBUG 
     #define INTERVAL          12  /*time between lora send in seconds*/
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "lora-config.h"
+#include "../lib/payload/payload.h"
 
 const struct lorawan_sx12xx_settings sx12xx_settings = {
     .spi = {
@@ -31,18 +32,10 @@ int receive_length = 0;
 uint8_t receive_buffer[242];
 uint8_t receive_port = 0;
 
-struct uplink {//modified from 16 bits to 32 cause of expected 18 bytes
-    uint32_t id; 
-    int32_t temp; //-273.15 - 90.00 -> -27315 - 9000
-    uint32_t hum; //0.00 - 100.00 -> 0 - 10000
-    uint32_t press; //840.0 - 1013.25 [hPa] -> 8400 - 10133
-    uint32_t AQI; //50.0 - 500.0 -> 500 - 5000
-    uint32_t CO2; //600 - 10000 [ppm] -> 600 - 10000
-};
-
 int main( void )
 {
-    struct uplink pkt = {
+    //layout in payload.json, the same decoder of class-a reads it
+    struct payload_uplink pkt = {
         .id = DEV_ID,
         .temp = 0,
         .hum = 0,
@@ -50,6 +43,8 @@ int main( void )
         .AQI = 0,
         .CO2 = 0,
     }; 
+    uint8_t frame[PAYLOAD_UPLINK_LEN];
+    payload_uplink_encode(&pkt, frame);
     // initialize stdio and wait for USB CDC connect
     stdio_init_all();
     sleep_ms(5000);
@@ -58,7 +53,6 @@ int main( void )
 
     // uncomment next line to enable debug
     lorawan_debug(true);
-    lorawan_erase_nvm();
     // initialize the LoRaWAN stack
     printf("Initilizating LoRaWAN ... ");
     if (lorawan_init_abp(&sx12xx_settings, LORAWAN_REGION, &abp_settings) < 0) {
@@ -77,7 +71,7 @@ int main( void )
     while (!lorawan_is_joined()) {
         lorawan_process();
     }
-    printf("joined successfully!\n");
+    printf("joined successfully! (%s session)\n", lorawan_session_state() == LORAWAN_SESSION_RESTORED ? "restored" : "new");
 
     uint32_t last_message_time = 0;
 
@@ -92,7 +86,7 @@ int main( void )
         
         if ((now - last_message_time) > 30000) {
             // try to send an unconfirmed uplink message
-            if (lorawan_send_unconfirmed(&pkt, sizeof(struct uplink), 2) < 0) {
+            if (lorawan_send_unconfirmed(frame, sizeof(frame), PAYLOAD_UPLINK_PORT) < 0) {
                 printf("failed!!!\n");
             } else {
                 printf("success!\n");
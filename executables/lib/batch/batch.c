@@ -0,0 +1,96 @@
+#include "batch.h"
+#include <string.h>
+
+/**
+ * @brief number of readings that fit in a payload
+ *
+ * @param b batch
+ * @param max_payload application payload allowed by the datarate
+ * @return uint8_t readings
+ */
+static uint8_t fitting(const struct batch* b, uint8_t max_payload){
+    if(max_payload < BATCH_HEADER_LEN)
+        return 0;
+    return (max_payload - BATCH_HEADER_LEN) / (BATCH_AGE_LEN + b->record_len);
+}
+
+void batch_init(struct batch* b, uint16_t id, uint8_t record_len, uint32_t max_age_s){
+    b->id = id;
+    b->record_len = record_len;
+    b->count = 0;
+    b->urgent = false;
+    b->max_age_s = max_age_s;
+}
+
+int batch_add(struct batch* b, const uint8_t* record, uint32_t now_s, bool urgent){
+    if(b->count >= BATCH_MAX_READINGS || (b->count + 1) * b->record_len > BATCH_MAX_PAYLOAD)
+        return BATCH_E_FULL;
+
+    memcpy(&b->records[b->count * b->record_len], record, b->record_len);
+    b->time_s[b->count] = now_s;
+    b->count++;
+    b->urgent = b->urgent || urgent;
+    return b->count;
+}
+
+uint8_t batch_pending(const struct batch* b, uint32_t now_s, uint8_t max_payload){
+    uint8_t reasons = BATCH_FLUSH_NONE;
+    if(b->count == 0)
+        return reasons;
+
+    if(b->count + 1 > fitting(b, max_payload))
+        reasons |= BATCH_FLUSH_SIZE;
+    if(now_s - b->time_s[0] >= b->max_age_s)
+        reasons |= BATCH_FLUSH_AGE;
+    if(b->urgent)
+        reasons |= BATCH_FLUSH_URGENT;
+    return reasons;
+}
+
+int batch_encode(struct batch* b, uint8_t* frame, uint8_t max_payload, uint32_t now_s){
+    if(b->count == 0)
+        return 0;
+
+    uint8_t n = fitting(b, max_payload);
+    if(n == 0)
+        return BATCH_E_TOO_SMALL;
+    if(n > b->count)
+        n = b->count;
+
+    frame[0] = (uint8_t)(b->id & 0xFF);
+    frame[1] = (uint8_t)(b->id >> 8);
+    frame[2] = n;
+    uint8_t* p = &frame[BATCH_HEADER_LEN];
+    for(uint8_t i = 0; i < n; i++){
+        //the age saturates instead of wrapping, the decoder sees it as "at least 18 hours old"
+        uint32_t age = now_s - b->time_s[i];
+        if(age > UINT16_MAX)
+            age = UINT16_MAX;
+        p[0] = (uint8_t)(age & 0xFF);
+        p[1] = (uint8_t)(age >> 8);
+        memcpy(&p[BATCH_AGE_LEN], &b->records[i * b->record_len], b->record_len);
+        p += BATCH_AGE_LEN + b->record_len;
+    }
+
+    batch_drop(b, n);
+    return (int)(p - frame);
+}
+
+const uint8_t* batch_record(const struct batch* b, uint8_t i, uint32_t* time_s){
+    if(i >= b->count)
+        return NULL;
+    *time_s = b->time_s[i];
+    return &b->records[i * b->record_len];
+}
+
+void batch_drop(struct batch* b, uint8_t n){
+    if(n > b->count)
+        n = b->count;
+    //the readings left are moved at the beginning, oldest first
+    b->count -= n;
+    memmove(b->records, &b->records[n * b->record_len], b->count * b->record_len);
+    memmove(b->time_s, &b->time_s[n], b->count * sizeof(b->time_s[0]));
+    //the urgent reading is the newest one, the flag stays until it has been sent as well
+    if(b->count == 0)
+        b->urgent = false;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file batch.h
+ * @brief packs several timestamped readings in a single uplink, so that the fixed overhead of a LoRaWAN
+ *          frame (preamble, MHDR, FHDR, FPort, MIC) is paid once for many readings.
+ *          Frame layout, little endian:
+ *
+ *          | id (2) | count (1) | age_0 (2) | reading_0 (record_len) | ... | age_n (2) | reading_n (record_len) |
+ *
+ *          age is the number of seconds between the reading and the creation of the frame, so the decoder
+ *          gets the time of every reading from the reception time without the device needing a real clock.
+ *          Readings are kept oldest first and a frame is flushed when another reading wouldn't fit in the
+ *          payload allowed by the datarate, when the oldest reading gets too old or when an urgent reading is added
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*largest application payload of any datarate*/
+#define BATCH_MAX_PAYLOAD           242
+/*bytes of id and count at the beginning of the frame*/
+#define BATCH_HEADER_LEN            3
+/*bytes of the age in front of every reading*/
+#define BATCH_AGE_LEN               2
+/*highest number of readings held, enough to fill the largest payload with 1 byte readings*/
+#define BATCH_MAX_READINGS          ((BATCH_MAX_PAYLOAD - BATCH_HEADER_LEN) / (BATCH_AGE_LEN + 1))
+
+/*reasons to flush returned by batch_pending, more than one can be set*/
+#define BATCH_FLUSH_NONE            0
+#define BATCH_FLUSH_SIZE            (1 << 0)    //another reading wouldn't fit in the payload
+#define BATCH_FLUSH_AGE             (1 << 1)    //the oldest reading reached the max age
+#define BATCH_FLUSH_URGENT          (1 << 2)    //an urgent reading is waiting
+
+/*returned by batch_add when the buffer is full and the reading is dropped*/
+#define BATCH_E_FULL                (-1)
+/*returned by batch_encode when not even one reading fits in the payload*/
+#define BATCH_E_TOO_SMALL           (-2)
+
+/*
+    readings waiting to be sent, the bytes of the readings are stored already encoded
+*/
+struct batch {
+    uint16_t id;            //id of the device, first field of the frame
+    uint8_t record_len;     //bytes of a single reading without the age
+    uint8_t count;          //readings waiting
+    bool urgent;            //an urgent reading is waiting
+    uint32_t max_age_s;     //age of the oldest reading that triggers a flush
+    uint32_t time_s[BATCH_MAX_READINGS];
+    uint8_t records[BATCH_MAX_PAYLOAD];
+};
+
+/**
+ * @brief initializes an empty batch
+ *
+ * @param b batch
+ * @param id id of the device written in every frame
+ * @param record_len bytes of a single reading
+ * @param max_age_s age in seconds of the oldest reading that triggers a flush, 0 flushes every reading
+ */
+void batch_init(struct batch* b, uint16_t id, uint8_t record_len, uint32_t max_age_s);
+
+/**
+ * @brief appends a reading
+ *
+ * @param b batch
+ * @param record encoded reading, record_len bytes
+ * @param now_s time of the reading in seconds, any monotonic time base
+ * @param urgent requests the frame to be sent as soon as possible
+ * @return int number of readings waiting, BATCH_E_FULL if the reading was dropped
+ */
+int batch_add(struct batch* b, const uint8_t* record, uint32_t now_s, bool urgent);
+
+/**
+ * @brief checks if the frame should be sent
+ *
+ * @param b batch
+ * @param now_s current time, same time base of batch_add
+ * @param max_payload application payload allowed by the current datarate
+ * @return uint8_t BATCH_FLUSH_NONE or a combination of the BATCH_FLUSH_* reasons
+ */
+uint8_t batch_pending(const struct batch* b, uint32_t now_s, uint8_t max_payload);
+
+/**
+ * @brief encodes the oldest readings that fit in the payload and removes them from the batch,
+ *          the readings that don't fit stay for the next frame
+ *
+ * @param b batch
+ * @param frame buffer of at least max_payload bytes
+ * @param max_payload application payload allowed by the current datarate
+ * @param now_s current time, used for the age of the readings
+ * @return int length of the frame, 0 if there is nothing to send, BATCH_E_TOO_SMALL if a reading doesn't fit
+ */
+int batch_encode(struct batch* b, uint8_t* frame, uint8_t max_payload, uint32_t now_s);
+
+/**
+ * @brief gives access to a reading waiting, for callers that build their own frame
+ *
+ * @param b batch
+ * @param i index of the reading, 0 is the oldest
+ * @param time_s filled with the time of the reading
+ * @return const uint8_t* the encoded reading, NULL if there is no such reading
+ */
+const uint8_t* batch_record(const struct batch* b, uint8_t i, uint32_t* time_s);
+
+/**
+ * @brief removes the oldest readings, once they have been sent
+ *
+ * @param b batch
+ * @param n number of readings to remove
+ */
+void batch_drop(struct batch* b, uint8_t n);
+
+#endif
@@ -105,6 +105,12 @@ static int8_t get_mem_page(struct bme68x_dev *dev);
 /* This internal API is used to check the bme68x_dev for null pointers */
 static int8_t null_ptr_check(const struct bme68x_dev *dev);
 
+/* This internal API is used to serve a register read from the control register shadow */
+static uint8_t shadow_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, const struct bme68x_dev *dev);
+
+/* This internal API is used to keep the control register shadow in sync with the sensor */
+static void shadow_update(uint8_t reg_addr, uint8_t reg_data, struct bme68x_dev *dev);
+
 /* This internal API is used to set heater configurations */
 static int8_t set_conf(const struct bme68x_heatr_conf *conf, uint8_t op_mode, uint8_t *nb_conv, struct bme68x_dev *dev);
 
@@ -213,6 +219,12 @@ int8_t bme68x_set_regs(const uint8_t *reg_addr, const uint8_t *reg_data, uint32_
                     rslt = BME68X_E_COM_FAIL;
                 }
             }
+
+            /* Write-through of the control registers */
+            for (index = 0; (index < len) && (rslt == BME68X_OK); index++)
+            {
+                shadow_update(reg_addr[index], reg_data[index], dev);
+            }
         }
         else
         {
@@ -233,25 +245,36 @@ int8_t bme68x_set_regs(const uint8_t *reg_addr, const uint8_t *reg_data, uint32_
 int8_t bme68x_get_regs(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, struct bme68x_dev *dev)
 {
     int8_t rslt;
+    uint8_t shadow_addr = reg_addr;
+    uint32_t index;
 
     /* Check for null pointer in the device structure*/
     rslt = null_ptr_check(dev);
     if ((rslt == BME68X_OK) && reg_data)
     {
-        if (dev->intf == BME68X_SPI_INTF)
+        /* Control registers already known are not read again from the bus */
+        if (!shadow_read(reg_addr, reg_data, len, dev))
         {
-            /* Set the memory page */
-            rslt = set_mem_page(reg_addr, dev);
-            if (rslt == BME68X_OK)
+            if (dev->intf == BME68X_SPI_INTF)
             {
-                reg_addr = reg_addr | BME68X_SPI_RD_MSK;
+                /* Set the memory page */
+                rslt = set_mem_page(reg_addr, dev);
+                if (rslt == BME68X_OK)
+                {
+                    reg_addr = reg_addr | BME68X_SPI_RD_MSK;
+                }
             }
-        }
 
-        dev->intf_rslt = dev->read(reg_addr, reg_data, len, dev->intf_ptr);
-        if (dev->intf_rslt != 0)
-        {
-            rslt = BME68X_E_COM_FAIL;
+            dev->intf_rslt = dev->read(reg_addr, reg_data, len, dev->intf_ptr);
+            if (dev->intf_rslt != 0)
+            {
+                rslt = BME68X_E_COM_FAIL;
+            }
+
+            for (index = 0; (index < len) && (rslt == BME68X_OK); index++)
+            {
+                shadow_update((uint8_t)(shadow_addr + index), reg_data[index], dev);
+            }
         }
     }
     else
@@ -287,6 +310,9 @@ int8_t bme68x_soft_reset(struct bme68x_dev *dev)
         {
             rslt = bme68x_set_regs(&reg_addr, &soft_rst_cmd, 1, dev);
 
+            /* The registers are back to their reset values, drop the shadow */
+            dev->shadow_valid = 0;
+
             /* Wait for 5ms */
             dev->delay_us(BME68X_PERIOD_RESET, dev->intf_ptr);
             if (rslt == BME68X_OK)
@@ -738,6 +764,7 @@ int8_t bme68x_selftest_check(const struct bme68x_dev *dev)
     t_dev.intf = dev->intf;
     t_dev.delay_us = dev->delay_us;
     t_dev.intf_ptr = dev->intf_ptr;
+    t_dev.shadow_en = dev->shadow_en;
     rslt = bme68x_init(&t_dev);
     if (rslt == BME68X_OK)
     {
@@ -1392,6 +1419,9 @@ static int8_t set_mem_page(uint8_t reg_addr, struct bme68x_dev *dev)
                 {
                     rslt = BME68X_E_COM_FAIL;
                 }
+
+                /* The page register aliases 0x73 inside the shadow window */
+                shadow_update(BME68X_REG_MEM_PAGE & BME68X_SPI_WR_MSK, reg, dev);
             }
         }
     }
@@ -1461,6 +1491,53 @@ static int8_t null_ptr_check(const struct bme68x_dev *dev)
     return rslt;
 }
 
+/* This internal API is used to serve a register read from the control register shadow */
+static uint8_t shadow_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, const struct bme68x_dev *dev)
+{
+    uint8_t hit = 0;
+    uint8_t mask;
+    uint8_t i;
+
+    if ((dev->shadow_en == BME68X_ENABLE) && (reg_addr >= BME68X_REG_CTRL_GAS_0) && (len > 0) &&
+        ((reg_addr - BME68X_REG_CTRL_GAS_0 + len) <= BME68X_LEN_SHADOW))
+    {
+        mask = (uint8_t)(((1u << len) - 1u) << (reg_addr - BME68X_REG_CTRL_GAS_0));
+        if ((dev->shadow_valid & mask) == mask)
+        {
+            for (i = 0; i < len; i++)
+            {
+                reg_data[i] = dev->shadow[reg_addr - BME68X_REG_CTRL_GAS_0 + i];
+            }
+
+            hit = 1;
+        }
+    }
+
+    return hit;
+}
+
+/* This internal API is used to keep the control register shadow in sync with the sensor */
+static void shadow_update(uint8_t reg_addr, uint8_t reg_data, struct bme68x_dev *dev)
+{
+    uint8_t idx;
+
+    if ((dev->shadow_en == BME68X_ENABLE) && (reg_addr >= BME68X_REG_CTRL_GAS_0) && (reg_addr <= BME68X_REG_CONFIG))
+    {
+        idx = reg_addr - BME68X_REG_CTRL_GAS_0;
+
+        /* Forced mode falls back to sleep on its own, only a sleeping CTRL_MEAS can be trusted */
+        if ((reg_addr == BME68X_REG_CTRL_MEAS) && ((reg_data & BME68X_MODE_MSK) != BME68X_SLEEP_MODE))
+        {
+            dev->shadow_valid &= (uint8_t)~(1u << idx);
+        }
+        else
+        {
+            dev->shadow[idx] = reg_data;
+            dev->shadow_valid |= (uint8_t)(1u << idx);
+        }
+    }
+}
+
 /* This internal API is used to set heater configurations */
 static int8_t set_conf(const struct bme68x_heatr_conf *conf, uint8_t op_mode, uint8_t *nb_conv, struct bme68x_dev *dev)
 {
@@ -339,6 +339,9 @@
 /* Length of the interleaved buffer */
 #define BME68X_LEN_INTERLEAVE_BUFF                UINT8_C(20)
 
+/* Length of the control register shadow, BME68X_REG_CTRL_GAS_0(0x70) up to BME68X_REG_CONFIG(0x75) */
+#define BME68X_LEN_SHADOW                         UINT8_C(6)
+
 /* Coefficient index macros */
 
 /* Coefficient T2 LSB position */
@@ -966,6 +969,19 @@ struct bme68x_dev
 
     /*! Store the info messages */
     uint8_t info_msg;
+
+    /*!
+     * Enables the write-through shadow of the control registers, when set
+     * reads of BME68X_REG_CTRL_GAS_0 to BME68X_REG_CONFIG are served from RAM
+     * once the value is known. Invalidated on soft reset.
+     */
+    uint8_t shadow_en;
+
+    /*! Bit mask of the valid entries of the shadow, bit n is register 0x70 + n */
+    uint8_t shadow_valid;
+
+    /*! Shadow copy of the control registers */
+    uint8_t shadow[BME68X_LEN_SHADOW];
 };
 
 #endif /* BME68X_DEFS_H_ */
@@ -116,6 +116,9 @@ int8_t bme_interface_init(struct bme68x_dev *bme, uint8_t intf){
     bme->intf_ptr = &dev_addr;
     bme->amb_temp = 20;
     bme->delay_us = delay_us;
+    //control registers are cached in RAM, the shadow becomes valid after bme68x_init resets the sensor
+    bme->shadow_en = BME68X_ENABLE;
+    bme->shadow_valid = 0;
     return 0;
 }
 
@@ -0,0 +1,37 @@
+#include "bsec_config.h"
+#include <stddef.h>
+
+static struct bsec_config_entry dynamic_table[BSEC_CONFIG_MAX_DYNAMIC];
+
+const struct bsec_config_entry* bsec_config_find(uint8_t id){
+    for(int i = 0; i < BSEC_CONFIG_MAX_DYNAMIC; i++){
+        if(dynamic_table[i].blob != NULL && dynamic_table[i].id == id)
+            return &dynamic_table[i];
+    }
+    for(int i = 0; i < bsec_config_table_len; i++){
+        if(bsec_config_table[i].id == id)
+            return &bsec_config_table[i];
+    }
+    return NULL;
+}
+
+int bsec_config_register(uint8_t id, const char* name, const uint8_t* blob, uint32_t len){
+    struct bsec_config_entry* free_entry = NULL;
+
+    for(int i = 0; i < BSEC_CONFIG_MAX_DYNAMIC; i++){
+        if(dynamic_table[i].blob != NULL && dynamic_table[i].id == id){
+            free_entry = &dynamic_table[i];
+            break;
+        }
+        if(dynamic_table[i].blob == NULL && free_entry == NULL)
+            free_entry = &dynamic_table[i];
+    }
+    if(free_entry == NULL)
+        return -1;
+
+    free_entry->id = id;
+    free_entry->name = name;
+    free_entry->blob = blob;
+    free_entry->len = len;
+    return 0;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file bsec_config.h
+ * @brief registry of the BSEC configuration blobs, referenced by ID
+ *          the built-in blobs live in XIP flash (see bsec_config_2_x.c, one table per BSEC version)
+ *          and more can be registered at runtime as long as they are in memory that stays mapped,
+ *          the registry only keeps pointers so the blob can be given straight to bsec_set_configuration
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef _BSEC_CONFIG_H_
+#define _BSEC_CONFIG_H_
+
+#include <stdint.h>
+
+/*IDs of the built-in configurations*/
+#define BSEC_CONFIG_ID_SELECTIVITY      UINT8_C(1)
+
+/*number of configurations that can be registered at runtime*/
+#define BSEC_CONFIG_MAX_DYNAMIC         2
+
+struct bsec_config_entry {
+    uint8_t id;
+    const char* name;
+    const uint8_t* blob;    //pointer to the serialized configuration, never copied
+    uint32_t len;           //length of the configuration in bytes
+};
+
+/*
+    built-in table, defined by the bsec_config_2_x library linked with the executable
+*/
+extern const struct bsec_config_entry bsec_config_table[];
+extern const uint8_t bsec_config_table_len;
+
+/**
+ * @brief looks for a configuration, registered ones override the built-in ones with the same id
+ *
+ * @param id id of the configuration
+ * @return const struct bsec_config_entry* the entry, NULL if there is no configuration with that id
+ */
+const struct bsec_config_entry* bsec_config_find(uint8_t id);
+
+/**
+ * @brief registers a configuration at runtime, an entry with the same id is replaced
+ *
+ * @param id id of the configuration
+ * @param name name of the configuration
+ * @param blob serialized configuration, must stay valid for as long as it is registered
+ * @param len length of the configuration in bytes
+ * @return int 0 on success, -1 if the registry is full
+ */
+int bsec_config_register(uint8_t id, const char* name, const uint8_t* blob, uint32_t len);
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ * @file bsec_config_2_4.c
+ * @brief configuration blobs for BSEC 2.4
+ *          the arrays are const at file scope so they stay in XIP flash and are passed to
+ *          bsec_set_configuration without being copied in RAM
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include "bsec_config.h"
+
+/*
+    selectivity configuration generated with BME AI-Studio for BSEC 2.4, used by the class c node
+*/
+static const uint8_t bsec_config_selectivity[] = {
+    0,0,4,2,189,1,0,0,0,0,0,0,158,7,0,0,176,0,1,0,0,168,19,73,
+    64,49,119,76,0,192,40,72,0,192,40,72,137,65,0,191,205,204,204,190,0,0,64,191,
+    225,122,148,190,10,0,3,0,0,0,96,64,23,183,209,56,0,0,0,0,0,0,0,0,
+    0,0,0,0,205,204,204,189,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,
+    0,0,128,63,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,128,63,
+    0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,128,63,82,73,157,188,
+    95,41,203,61,118,224,108,63,155,230,125,63,191,14,124,63,0,0,160,65,0,0,32,66,
+    0,0,160,65,0,0,32,66,0,0,32,66,0,0,160,65,0,0,32,66,0,0,160,65,
+    8,0,2,0,236,81,133,66,16,0,3,0,10,215,163,60,10,215,35,59,10,215,35,59,
+    13,0,5,0,0,0,0,0,100,254,131,137,87,88,0,9,0,7,240,150,61,0,0,0,
+    0,0,0,0,0,28,124,225,61,52,128,215,63,0,0,160,64,0,0,0,0,0,0,0,
+    0,205,204,12,62,103,213,39,62,230,63,76,192,0,0,0,0,0,0,0,0,145,237,60,
+    191,251,58,64,63,177,80,131,64,0,0,0,0,0,0,0,0,93,254,227,62,54,60,133,
+    191,0,0,64,64,12,0,10,0,0,0,0,0,0,0,0,0,13,5,11,0,0,0,2,
+    97,212,217,189,123,211,184,190,246,39,132,190,206,174,109,189,251,75,175,189,235,9,110,62,
+    137,144,36,63,45,8,80,62,144,77,210,188,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,40,255,226,62,40,255,226,190,0,0,0,0,0,0,0,0,
+    76,31,165,190,5,133,25,190,99,111,16,191,4,102,151,189,223,240,98,190,35,221,96,62,
+    233,47,232,61,154,195,212,62,246,23,39,191,0,0,0,0,208,204,147,189,31,212,43,190,
+    235,102,187,62,96,223,37,190,68,35,41,190,176,189,140,62,167,195,139,189,61,247,59,62,
+    197,184,64,62,0,0,0,0,244,158,240,189,150,236,38,62,220,212,82,190,97,85,116,190,
+    38,131,133,189,226,168,44,62,210,144,202,190,155,4,251,62,111,28,141,62,0,0,0,0,
+    11,238,37,61,214,142,233,189,152,81,180,190,225,50,209,62,51,229,221,62,153,207,193,59,
+    0,126,171,60,100,47,212,62,12,59,73,189,0,0,0,0,109,51,81,189,246,41,221,189,
+    14,235,164,190,106,152,64,62,146,87,64,62,211,57,245,189,85,105,18,61,201,169,91,190,
+    254,132,14,189,0,0,0,0,67,219,100,62,66,204,199,190,41,243,253,189,179,13,234,189,
+    8,59,224,190,29,6,33,190,164,176,176,190,54,130,42,63,55,59,158,189,0,0,0,0,
+    180,113,104,190,83,10,224,190,121,202,43,190,103,45,12,190,15,201,28,190,45,147,66,63,
+    59,77,166,189,87,205,216,189,202,231,80,190,0,0,0,0,61,78,135,190,204,10,107,190,
+    83,139,36,62,193,61,191,62,98,160,17,190,189,93,7,63,134,130,186,61,225,40,223,189,
+    104,13,99,190,0,0,0,0,255,48,206,190,218,86,40,189,67,21,240,190,140,32,28,61,
+    216,22,56,190,200,133,35,190,235,148,37,62,54,40,19,63,59,144,196,190,0,0,0,0,
+    56,41,1,191,129,1,168,190,155,197,38,190,19,130,161,190,172,193,237,189,76,39,22,62,
+    156,12,115,63,153,230,241,59,251,43,182,190,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,128,63,159,49,7,191,186,149,18,63,0,0,0,0,0,0,0,0,
+    24,104,156,190,241,167,235,189,0,0,0,0,0,0,0,0,42,27,1,190,234,50,155,62,
+    0,0,0,0,0,0,0,0,104,247,151,189,48,189,192,62,0,0,0,0,0,0,0,0,
+    223,179,175,190,87,168,137,190,0,0,0,0,0,0,0,0,44,240,99,62,155,142,95,191,
+    0,0,0,0,0,0,0,0,74,14,53,63,152,160,21,191,0,0,0,0,0,0,0,0,
+    115,135,204,62,33,73,249,190,0,0,0,0,0,0,0,0,138,35,98,191,36,48,73,63,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    9,0,2,88,154,50,72,197,13,232,75,9,255,180,75,145,98,131,75,167,32,87,73,174,
+    158,62,73,8,35,45,73,12,163,26,72,242,227,55,72,126,235,71,72,0,0,0,0,0,
+    0,0,0,0,0,0,0,184,21,18,72,175,32,249,75,207,100,195,75,164,64,141,75,117,
+    176,79,73,115,35,54,73,215,19,36,73,36,167,240,71,157,166,10,72,81,152,20,72,0,
+    0,128,63,0,0,128,63,0,0,128,63,0,0,0,88,1,254,0,2,1,5,48,117,100,
+    0,44,1,112,23,151,7,132,3,197,0,92,4,144,1,64,1,64,1,144,1,48,117,48,
+    117,48,117,48,117,100,0,100,0,100,0,48,117,48,117,48,117,100,0,100,0,48,117,48,
+    117,8,7,8,7,8,7,8,7,8,7,100,0,100,0,100,0,100,0,48,117,48,117,48,
+    117,100,0,100,0,100,0,48,117,48,117,100,0,100,0,255,255,255,255,255,255,255,255,255,
+    255,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,
+    1,44,1,44,1,255,255,255,255,255,255,255,255,255,255,112,23,112,23,112,23,112,23,8,
+    7,8,7,8,7,8,7,112,23,112,23,112,23,112,23,112,23,112,23,255,255,255,255,255,
+    255,255,255,255,255,255,255,255,255,255,255,255,255,112,23,112,23,112,23,112,23,255,255,255,
+    255,220,5,220,5,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+    255,255,255,220,5,220,5,220,5,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+    255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,
+    255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,48,
+    117,0,5,10,5,0,2,0,10,0,30,0,5,0,5,0,5,0,5,0,5,0,5,0,
+    64,1,100,0,100,0,100,0,200,0,200,0,200,0,64,1,64,1,64,1,10,1,0,0,
+    0,0,183,167,0,0
+};
+
+const struct bsec_config_entry bsec_config_table[] = {
+    {
+        .id = BSEC_CONFIG_ID_SELECTIVITY,
+        .name = "selectivity",
+        .blob = bsec_config_selectivity,
+        .len = sizeof(bsec_config_selectivity),
+    },
+};
+
+const uint8_t bsec_config_table_len = sizeof(bsec_config_table)/sizeof(bsec_config_table[0]);
@@ -0,0 +1,36 @@
+#include "deadband.h"
+
+void deadband_init(struct deadband* db, uint8_t n_channels, const int32_t* threshold, uint32_t max_silence_s){
+    db->n_channels = n_channels > DEADBAND_MAX_CHANNELS ? DEADBAND_MAX_CHANNELS : n_channels;
+    db->reported = false;
+    db->max_silence_s = max_silence_s;
+    db->last_time = 0;
+    db->threshold = threshold;
+    for(uint8_t c = 0; c < DEADBAND_MAX_CHANNELS; c++)
+        db->last[c] = 0;
+}
+
+uint8_t deadband_check(const struct deadband* db, const int32_t* values, uint32_t now_s){
+    if(!db->reported)
+        return DEADBAND_REPORT_FIRST;
+
+    uint8_t reasons = DEADBAND_REPORT_NONE;
+    for(uint8_t c = 0; c < db->n_channels; c++){
+        //the difference is taken in 64 bits, channels can span the whole int32_t range
+        int64_t diff = (int64_t)values[c] - db->last[c];
+        if(diff > db->threshold[c] || -diff > db->threshold[c]){
+            reasons |= DEADBAND_REPORT_CHANGE;
+            break;
+        }
+    }
+    if(db->max_silence_s > 0 && now_s - db->last_time >= db->max_silence_s)
+        reasons |= DEADBAND_REPORT_HEARTBEAT;
+    return reasons;
+}
+
+void deadband_reported(struct deadband* db, const int32_t* values, uint32_t now_s){
+    for(uint8_t c = 0; c < db->n_channels; c++)
+        db->last[c] = values[c];
+    db->last_time = now_s;
+    db->reported = true;
+}
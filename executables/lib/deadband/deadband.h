@@ -0,0 +1,67 @@
+/**
+ * @file deadband.h
+ * @brief change driven reporting: a reading is reported only when at least one channel moved by more than its
+ *          dead-band from the last value reported, or when nothing has been reported for the max silence
+ *          (heartbeat), so that the network server knows the node is alive.
+ *          The comparison is always against the last value reported, not the previous reading, so a slow drift
+ *          is reported as soon as it adds up to the dead-band and the receiver never is more than a dead-band away
+ *          holding the last value it got
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef _DEADBAND_H_
+#define _DEADBAND_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*highest number of channels of a reading*/
+#define DEADBAND_MAX_CHANNELS       8
+
+/*reasons to report returned by deadband_check, more than one can be set*/
+#define DEADBAND_REPORT_NONE        0
+#define DEADBAND_REPORT_FIRST       (1 << 0)    //nothing has been reported yet
+#define DEADBAND_REPORT_CHANGE      (1 << 1)    //a channel moved out of its dead-band
+#define DEADBAND_REPORT_HEARTBEAT   (1 << 2)    //the max silence has been reached
+
+struct deadband {
+    uint8_t n_channels;
+    bool reported;                                  //at least a reading has been reported
+    uint32_t max_silence_s;                         //seconds without reports that trigger a heartbeat, 0 disables it
+    uint32_t last_time;                             //time of the last report
+    const int32_t* threshold;                       //dead-band of every channel, a reading is reported when |value - last| > threshold
+    int32_t last[DEADBAND_MAX_CHANNELS];            //values of the last report
+};
+
+/**
+ * @brief initializes the dead-band, the first reading checked is always reported
+ *
+ * @param db dead-band
+ * @param n_channels channels of a reading, at most DEADBAND_MAX_CHANNELS
+ * @param threshold dead-band of every channel in the unit of the values, it must outlive db
+ * @param max_silence_s seconds after the last report that trigger a heartbeat, 0 disables the heartbeat
+ */
+void deadband_init(struct deadband* db, uint8_t n_channels, const int32_t* threshold, uint32_t max_silence_s);
+
+/**
+ * @brief checks if a reading has to be reported, the dead-band is not updated
+ *
+ * @param db dead-band
+ * @param values reading, n_channels values
+ * @param now_s time of the reading in seconds, any monotonic time base
+ * @return uint8_t DEADBAND_REPORT_NONE or a combination of the DEADBAND_REPORT_* reasons
+ */
+uint8_t deadband_check(const struct deadband* db, const int32_t* values, uint32_t now_s);
+
+/**
+ * @brief records a reading as reported, the next readings are compared against it
+ *
+ * @param db dead-band
+ * @param values reading, n_channels values
+ * @param now_s time of the reading, same time base of deadband_check
+ */
+void deadband_reported(struct deadband* db, const int32_t* values, uint32_t now_s);
+
+#endif
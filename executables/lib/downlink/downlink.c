@@ -0,0 +1,104 @@
+#include "downlink.h"
+#include <stddef.h>
+
+/**
+ * @brief finds the table of a port
+ *
+ * @param ports tables
+ * @param n_ports number of tables
+ * @param port port
+ * @return const struct downlink_port* table, NULL if the port is not a command port
+ */
+static const struct downlink_port* find_port(const struct downlink_port* ports, uint8_t n_ports, uint8_t port){
+    for(uint8_t i = 0; i < n_ports; i++)
+        if(ports[i].port == port)
+            return &ports[i];
+    return NULL;
+}
+
+/**
+ * @brief finds a command in the table of a port
+ *
+ * @param p table
+ * @param type type of the command
+ * @return const struct downlink_command* entry, NULL if the type is unknown
+ */
+static const struct downlink_command* find_command(const struct downlink_port* p, uint8_t type){
+    for(uint8_t i = 0; i < p->n_commands; i++)
+        if(p->commands[i].type == type)
+            return &p->commands[i];
+    return NULL;
+}
+
+int downlink_process(const struct downlink_port* ports, uint8_t n_ports, uint8_t port, const uint8_t* buf, uint8_t len,
+                        void* ctx, struct downlink_ack* ack){
+    const struct downlink_port* p = find_port(ports, n_ports, port);
+    if(p == NULL)
+        return DOWNLINK_E_PORT;
+
+    ack->pending = true;
+    ack->seq = len > 0 ? buf[0] : 0;
+    ack->count = 0;
+
+    //the frame is walked once before running anything, a truncated frame runs no command
+    uint8_t n = 0;
+    uint16_t pos = 1;
+    while(pos < len){
+        if(pos + DOWNLINK_TLV_HEADER_LEN > len || pos + DOWNLINK_TLV_HEADER_LEN + buf[pos + 1] > len || n == DOWNLINK_MAX_COMMANDS)
+            break;
+        pos += DOWNLINK_TLV_HEADER_LEN + buf[pos + 1];
+        n++;
+    }
+    if(len == 0 || pos != len){
+        ack->count = 1;
+        ack->status[0] = DOWNLINK_MALFORMED;
+        return DOWNLINK_E_MALFORMED;
+    }
+
+    int applied = 0;
+    pos = 1;
+    for(uint8_t i = 0; i < n; i++){
+        uint8_t type = buf[pos];
+        uint8_t value_len = buf[pos + 1];
+        const uint8_t* value = &buf[pos + DOWNLINK_TLV_HEADER_LEN];
+        const struct downlink_command* cmd = find_command(p, type);
+        uint8_t status;
+        if(cmd == NULL)
+            status = DOWNLINK_UNKNOWN;
+        else if(value_len < cmd->min_len || value_len > cmd->max_len)
+            status = DOWNLINK_BAD_LENGTH;
+        else
+            status = cmd->handler(value, value_len, ctx);
+        if(status == DOWNLINK_OK)
+            applied++;
+        ack->status[ack->count++] = status;
+        pos += DOWNLINK_TLV_HEADER_LEN + value_len;
+    }
+    return applied;
+}
+
+uint8_t downlink_ack_len(const struct downlink_ack* ack){
+    return ack->pending ? 1 + ack->count : 0;
+}
+
+uint8_t downlink_ack_encode(const struct downlink_ack* ack, uint8_t* buf, uint8_t max_len){
+    uint8_t len = downlink_ack_len(ack);
+    if(len == 0 || len > max_len)
+        return 0;
+    buf[0] = ack->seq;
+    for(uint8_t i = 0; i < ack->count; i++)
+        buf[1 + i] = ack->status[i];
+    return len;
+}
+
+void downlink_ack_clear(struct downlink_ack* ack){
+    ack->pending = false;
+    ack->count = 0;
+}
+
+uint32_t downlink_uint(const uint8_t* value, uint8_t len){
+    uint32_t v = 0;
+    for(uint8_t i = 0; i < len && i < 4; i++)
+        v |= (uint32_t)value[i] << (8 * i);
+    return v;
+}
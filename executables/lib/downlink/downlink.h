@@ -0,0 +1,125 @@
+/**
+ * @file downlink.h
+ * @brief table driven processor of the downlink commands. Every port has its own table of commands,
+ *          a frame on a command port is a sequence number followed by commands in TLV form, little endian:
+ *
+ *          | seq (1) | type (1) | len (1) | value (len) | type (1) | len (1) | value (len) | ...
+ *
+ *          the whole frame is checked before running any command: a TLV running past the end of the frame
+ *          rejects the frame. Each command is then checked against the length allowed by its table entry
+ *          and handed to its handler, which checks the value and applies it.
+ *          The outcome is kept as an ack to piggyback on the next uplink:
+ *
+ *          | seq (1) | status of the first command (1) | ... | status of the last command (1) |
+ *
+ *          Nothing is allocated, the parsing works in place on the received buffer
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef _DOWNLINK_H_
+#define _DOWNLINK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*highest number of commands in a frame, one status each in the ack*/
+#define DOWNLINK_MAX_COMMANDS       16
+/*bytes of type and length in front of every value*/
+#define DOWNLINK_TLV_HEADER_LEN     2
+
+/*status of a command in the ack*/
+#define DOWNLINK_OK                 0   //applied
+#define DOWNLINK_UNKNOWN            1   //type not in the table of the port
+#define DOWNLINK_BAD_LENGTH         2   //length not allowed for the type
+#define DOWNLINK_BAD_VALUE          3   //value out of range, not applied
+#define DOWNLINK_FAILED             4   //valid but it could not be applied
+#define DOWNLINK_MALFORMED          5   //only status of the ack, the frame is truncated or has too many commands
+
+/*returned by downlink_process when the port has no table*/
+#define DOWNLINK_E_PORT             (-1)
+/*returned by downlink_process when the frame is rejected as a whole*/
+#define DOWNLINK_E_MALFORMED        (-2)
+
+/*
+    entry of a command table
+    the handler gets the value of the command, already checked against the length, and returns a DOWNLINK_* status
+*/
+struct downlink_command {
+    uint8_t type;
+    uint8_t min_len;
+    uint8_t max_len;
+    uint8_t (*handler)(const uint8_t* value, uint8_t len, void* ctx);
+};
+
+/*
+    commands accepted on a port
+*/
+struct downlink_port {
+    uint8_t port;
+    const struct downlink_command* commands;
+    uint8_t n_commands;
+};
+
+/*
+    outcome of the last command frame, waiting to be sent
+*/
+struct downlink_ack {
+    bool pending;
+    uint8_t seq;
+    uint8_t count;
+    uint8_t status[DOWNLINK_MAX_COMMANDS];
+};
+
+/**
+ * @brief dispatches a downlink to the table of its port and runs the commands in order,
+ *          the ack replaces any ack still waiting
+ *
+ * @param ports tables of the command ports
+ * @param n_ports number of tables
+ * @param port port of the downlink
+ * @param buf frame received
+ * @param len bytes of the frame
+ * @param ctx passed to the handlers
+ * @param ack filled with the outcome, untouched if the port has no table
+ * @return int number of commands applied, DOWNLINK_E_PORT or DOWNLINK_E_MALFORMED
+ */
+int downlink_process(const struct downlink_port* ports, uint8_t n_ports, uint8_t port, const uint8_t* buf, uint8_t len,
+                        void* ctx, struct downlink_ack* ack);
+
+/**
+ * @brief bytes needed by the ack
+ *
+ * @param ack ack
+ * @return uint8_t 0 if no ack is waiting
+ */
+uint8_t downlink_ack_len(const struct downlink_ack* ack);
+
+/**
+ * @brief writes the ack, it stays pending until downlink_ack_clear
+ *
+ * @param ack ack
+ * @param buf output
+ * @param max_len size of the output
+ * @return uint8_t bytes written, 0 if no ack is waiting or it doesn't fit
+ */
+uint8_t downlink_ack_encode(const struct downlink_ack* ack, uint8_t* buf, uint8_t max_len);
+
+/**
+ * @brief forgets the ack, once the uplink holding it is on its way
+ *
+ * @param ack ack
+ */
+void downlink_ack_clear(struct downlink_ack* ack);
+
+/**
+ * @brief reads a little endian unsigned value of 1 to 4 bytes
+ *
+ * @param value value of the command
+ * @param len bytes of the value
+ * @return uint32_t value
+ */
+uint32_t downlink_uint(const uint8_t* value, uint8_t len);
+
+#endif
@@ -0,0 +1,123 @@
+/**
+ * @file payload.h
+ * @brief encoders and decoders of the uplink payloads, generated by tools/payloadgen/payloadgen.py from payload.json,
+ *          do not edit by hand: change the schema and run the generator again.
+ *          Every field is written byte by byte in little endian, so the layout doesn't depend on the padding
+ *          or on the endianness of the compiler; the functions are static inline so that each one becomes a
+ *          straight sequence of stores where it is used
+ */
+
+#ifndef _PAYLOAD_H_
+#define _PAYLOAD_H_
+
+#include <stdint.h>
+
+/*
+    reading of the class-a sensor, element of the batch and delta frames
+*/
+#define PAYLOAD_READING_LEN         10
+
+struct payload_reading {
+    int16_t temp; //-273.15 - 90.00 [C] -> -27315 - 9000 {100}
+    uint16_t hum; //0.00 - 100.00 [%] -> 0 - 10000 {100}
+    uint16_t press; //840.0 - 1013.3 [hPa] -> 8400 - 10133 {10}
+    uint16_t AQI; //50.0 - 500.0 -> 500 - 5000 {10}
+    uint16_t CO2; //600 - 10000 [ppm]
+};
+
+static inline void payload_reading_encode(const struct payload_reading* m, uint8_t* buf){
+    buf[0] = (uint8_t)((uint16_t)m->temp);
+    buf[1] = (uint8_t)((uint16_t)m->temp >> 8);
+    buf[2] = (uint8_t)((uint16_t)m->hum);
+    buf[3] = (uint8_t)((uint16_t)m->hum >> 8);
+    buf[4] = (uint8_t)((uint16_t)m->press);
+    buf[5] = (uint8_t)((uint16_t)m->press >> 8);
+    buf[6] = (uint8_t)((uint16_t)m->AQI);
+    buf[7] = (uint8_t)((uint16_t)m->AQI >> 8);
+    buf[8] = (uint8_t)((uint16_t)m->CO2);
+    buf[9] = (uint8_t)((uint16_t)m->CO2 >> 8);
+}
+
+static inline void payload_reading_decode(struct payload_reading* m, const uint8_t* buf){
+    m->temp = (int16_t)((uint16_t)buf[0] | (uint16_t)buf[1] << 8);
+    m->hum = (uint16_t)((uint16_t)buf[2] | (uint16_t)buf[3] << 8);
+    m->press = (uint16_t)((uint16_t)buf[4] | (uint16_t)buf[5] << 8);
+    m->AQI = (uint16_t)((uint16_t)buf[6] | (uint16_t)buf[7] << 8);
+    m->CO2 = (uint16_t)((uint16_t)buf[8] | (uint16_t)buf[9] << 8);
+}
+
+/*
+    single reading with the id of the device, sent by hello-abp
+*/
+#define PAYLOAD_UPLINK_LEN          12
+#define PAYLOAD_UPLINK_PORT         2
+
+struct payload_uplink {
+    uint16_t id; //id of the device
+    int16_t temp; //-273.15 - 90.00 [C] -> -27315 - 9000 {100}
+    uint16_t hum; //0.00 - 100.00 [%] -> 0 - 10000 {100}
+    uint16_t press; //840.0 - 1013.3 [hPa] -> 8400 - 10133 {10}
+    uint16_t AQI; //50.0 - 500.0 -> 500 - 5000 {10}
+    uint16_t CO2; //600 - 10000 [ppm]
+};
+
+static inline void payload_uplink_encode(const struct payload_uplink* m, uint8_t* buf){
+    buf[0] = (uint8_t)((uint16_t)m->id);
+    buf[1] = (uint8_t)((uint16_t)m->id >> 8);
+    buf[2] = (uint8_t)((uint16_t)m->temp);
+    buf[3] = (uint8_t)((uint16_t)m->temp >> 8);
+    buf[4] = (uint8_t)((uint16_t)m->hum);
+    buf[5] = (uint8_t)((uint16_t)m->hum >> 8);
+    buf[6] = (uint8_t)((uint16_t)m->press);
+    buf[7] = (uint8_t)((uint16_t)m->press >> 8);
+    buf[8] = (uint8_t)((uint16_t)m->AQI);
+    buf[9] = (uint8_t)((uint16_t)m->AQI >> 8);
+    buf[10] = (uint8_t)((uint16_t)m->CO2);
+    buf[11] = (uint8_t)((uint16_t)m->CO2 >> 8);
+}
+
+static inline void payload_uplink_decode(struct payload_uplink* m, const uint8_t* buf){
+    m->id = (uint16_t)((uint16_t)buf[0] | (uint16_t)buf[1] << 8);
+    m->temp = (int16_t)((uint16_t)buf[2] | (uint16_t)buf[3] << 8);
+    m->hum = (uint16_t)((uint16_t)buf[4] | (uint16_t)buf[5] << 8);
+    m->press = (uint16_t)((uint16_t)buf[6] | (uint16_t)buf[7] << 8);
+    m->AQI = (uint16_t)((uint16_t)buf[8] | (uint16_t)buf[9] << 8);
+    m->CO2 = (uint16_t)((uint16_t)buf[10] | (uint16_t)buf[11] << 8);
+}
+
+/*
+    mean probability of the gases over the readings since the last uplink, sent by class-c
+*/
+#define PAYLOAD_GAS_UPLINK_LEN      10
+#define PAYLOAD_GAS_UPLINK_PORT     2
+
+struct payload_gas_uplink {
+    uint16_t id; //id of the device
+    uint16_t p1; //0.0000 - 1.0000 -> 0 - 10000 {10000}
+    uint16_t p2; //0.0000 - 1.0000 -> 0 - 10000 {10000}
+    uint16_t p3; //0.0000 - 1.0000 -> 0 - 10000 {10000}
+    uint16_t p4; //0.0000 - 1.0000 -> 0 - 10000 {10000}
+};
+
+static inline void payload_gas_uplink_encode(const struct payload_gas_uplink* m, uint8_t* buf){
+    buf[0] = (uint8_t)((uint16_t)m->id);
+    buf[1] = (uint8_t)((uint16_t)m->id >> 8);
+    buf[2] = (uint8_t)((uint16_t)m->p1);
+    buf[3] = (uint8_t)((uint16_t)m->p1 >> 8);
+    buf[4] = (uint8_t)((uint16_t)m->p2);
+    buf[5] = (uint8_t)((uint16_t)m->p2 >> 8);
+    buf[6] = (uint8_t)((uint16_t)m->p3);
+    buf[7] = (uint8_t)((uint16_t)m->p3 >> 8);
+    buf[8] = (uint8_t)((uint16_t)m->p4);
+    buf[9] = (uint8_t)((uint16_t)m->p4 >> 8);
+}
+
+static inline void payload_gas_uplink_decode(struct payload_gas_uplink* m, const uint8_t* buf){
+    m->id = (uint16_t)((uint16_t)buf[0] | (uint16_t)buf[1] << 8);
+    m->p1 = (uint16_t)((uint16_t)buf[2] | (uint16_t)buf[3] << 8);
+    m->p2 = (uint16_t)((uint16_t)buf[4] | (uint16_t)buf[5] << 8);
+    m->p3 = (uint16_t)((uint16_t)buf[6] | (uint16_t)buf[7] << 8);
+    m->p4 = (uint16_t)((uint16_t)buf[8] | (uint16_t)buf[9] << 8);
+}
+
+#endif
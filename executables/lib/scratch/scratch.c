@@ -0,0 +1,39 @@
+#include "scratch.h"
+#include <stddef.h>
+
+static uint8_t* scratch_base = NULL;
+static uint32_t scratch_size = 0;
+static uint32_t scratch_top = 0;
+static uint32_t scratch_peak = 0;
+
+void scratch_init(void* region, uint32_t size){
+    scratch_base = (uint8_t*)region;
+    scratch_size = size;
+    scratch_top = 0;
+    scratch_peak = 0;
+}
+
+void* scratch_alloc(uint32_t size){
+    uint32_t rounded = SCRATCH_ROUND(size);
+    if(scratch_base == NULL || rounded < size || rounded > scratch_size - scratch_top)
+        return NULL;
+
+    void* block = scratch_base + scratch_top;
+    scratch_top += rounded;
+    if(scratch_top > scratch_peak)
+        scratch_peak = scratch_top;
+    return block;
+}
+
+uint32_t scratch_mark(){
+    return scratch_top;
+}
+
+void scratch_release(uint32_t mark){
+    if(mark <= scratch_top)
+        scratch_top = mark;
+}
+
+uint32_t scratch_high_water(){
+    return scratch_peak;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file scratch.h
+ * @brief static scratch arena with scoped (stack-like) allocation
+ *          buffers that are only needed for the duration of an operation (bsec state and configuration
+ *          work buffers, serialized blobs, log formatting) are taken from a single region instead of
+ *          being reserved forever as separate globals. Allocations are released in LIFO order by going
+ *          back to a mark taken before them:
+ *
+ *          uint32_t top = scratch_mark();
+ *          uint8_t* buf = scratch_alloc(len);
+ *          ...
+ *          scratch_release(top);
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef _SCRATCH_H_
+#define _SCRATCH_H_
+
+#include <stdint.h>
+
+/*alignment of every allocation, enough for any type used by the bsec library*/
+#define SCRATCH_ALIGN               8
+/*rounds a size up to the alignment, use it to size the region*/
+#define SCRATCH_ROUND(size)         (((size) + SCRATCH_ALIGN - 1) & ~(SCRATCH_ALIGN - 1))
+
+/**
+ * @brief sets the region used by the arena, everything previously allocated is lost
+ *
+ * @param region memory of the arena, aligned to SCRATCH_ALIGN
+ * @param size size of the region in bytes
+ */
+void scratch_init(void* region, uint32_t size);
+
+/**
+ * @brief allocates a block on top of the arena
+ *
+ * @param size bytes requested
+ * @return void* the block aligned to SCRATCH_ALIGN, NULL if the arena doesn't have enough space
+ */
+void* scratch_alloc(uint32_t size);
+
+/**
+ * @brief returns the current top of the arena, to be passed to scratch_release
+ *
+ * @return uint32_t the mark
+ */
+uint32_t scratch_mark();
+
+/**
+ * @brief frees every block allocated after the mark was taken
+ *
+ * @param mark value returned by scratch_mark
+ */
+void scratch_release(uint32_t mark);
+
+/**
+ * @brief highest number of bytes used at the same time since the init, useful to size the region
+ *
+ * @return uint32_t bytes
+ */
+uint32_t scratch_high_water();
+
+#endif
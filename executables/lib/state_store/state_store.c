@@ -0,0 +1,121 @@
+#include "state_store.h"
+#include "pico/crc32.h"
+#include <stdbool.h>
+#include <string.h>
+
+/**
+ * @brief reads the header of a slot
+ *
+ * @param name file of the slot
+ * @param hdr header to fill
+ * @return true if the slot exists and the header is well formed
+ */
+static bool read_header(const char* name, struct state_store_header* hdr){
+    int file = pico_open(name, LFS_O_RDONLY);
+    if(file < 0)
+        return false;
+    int rslt = (int)pico_read(file, hdr, sizeof(struct state_store_header));
+    pico_close(file);
+    return rslt == sizeof(struct state_store_header) && hdr->magic == STATE_STORE_MAGIC;
+}
+
+/**
+ * @brief reads the blob of a slot and checks it against the CRC in the header
+ *
+ * @param name file of the slot
+ * @param hdr header previously read
+ * @param blob buffer to fill
+ * @return true if the blob is complete and the CRC matches
+ */
+static bool read_blob(const char* name, const struct state_store_header* hdr, uint8_t* blob){
+    int file = pico_open(name, LFS_O_RDONLY);
+    if(file < 0)
+        return false;
+    int rslt = (int)pico_lseek(file, sizeof(struct state_store_header), LFS_SEEK_SET);
+    if(rslt >= 0)
+        rslt = (int)pico_read(file, blob, hdr->len);
+    pico_close(file);
+    return rslt == (int)hdr->len && lorawan_crc32(0, blob, hdr->len) == hdr->crc;
+}
+
+void state_store_init(struct state_store* store, const char* slot_a, const char* slot_b){
+    store->slot_name[0] = slot_a;
+    store->slot_name[1] = slot_b;
+    store->current = -1;
+    store->seq = 0;
+    store->len = 0;
+    store->crc = 0;
+}
+
+int state_store_restore(struct state_store* store, uint8_t* blob, uint32_t max_len){
+    struct state_store_header hdr[STATE_STORE_SLOTS];
+    bool valid[STATE_STORE_SLOTS];
+    bool too_big = false;
+
+    store->current = -1;
+    for(int i = 0; i < STATE_STORE_SLOTS; i++){
+        valid[i] = read_header(store->slot_name[i], &hdr[i]);
+        if(valid[i] && hdr[i].len > max_len){
+            valid[i] = false;
+            too_big = true;
+        }
+        //keep counting from the highest sequence seen, even if that slot turns out to be corrupted
+        if(valid[i] && (int32_t)(hdr[i].seq - store->seq) > 0)
+            store->seq = hdr[i].seq;
+    }
+
+    //newest first, the older one is the fallback
+    int first = 0;
+    if(valid[1] && (!valid[0] || (int32_t)(hdr[1].seq - hdr[0].seq) > 0))
+        first = 1;
+
+    for(int n = 0; n < STATE_STORE_SLOTS; n++){
+        int i = n == 0 ? first : 1 - first;
+        if(valid[i] && read_blob(store->slot_name[i], &hdr[i], blob)){
+            store->current = i;
+            store->len = hdr[i].len;
+            store->crc = hdr[i].crc;
+            return (int)hdr[i].len;
+        }
+    }
+
+    return too_big ? STATE_STORE_E_TOO_BIG : STATE_STORE_E_NO_STATE;
+}
+
+int state_store_save(struct state_store* store, const uint8_t* blob, uint32_t len){
+    uint32_t crc = lorawan_crc32(0, blob, len);
+
+    //nothing changed since the last save, spare the flash
+    if(store->current >= 0 && store->len == len && store->crc == crc)
+        return STATE_STORE_UNCHANGED;
+
+    //always overwrite the slot that doesn't hold the newest state
+    int target = store->current < 0 ? 0 : 1 - store->current;
+    struct state_store_header hdr = {
+        .magic = STATE_STORE_MAGIC,
+        .seq = store->seq + 1,
+        .len = len,
+        .crc = crc,
+    };
+
+    int file = pico_open(store->slot_name[target], LFS_O_CREAT | LFS_O_WRONLY | LFS_O_TRUNC);
+    if(file < 0)
+        return file;
+    int rslt = (int)pico_write(file, &hdr, sizeof(hdr));
+    if(rslt == sizeof(hdr))
+        rslt = (int)pico_write(file, blob, len);
+    //the new content is committed by littlefs only when the file is closed
+    int rslt_close = pico_close(file);
+    if(rslt < 0)
+        return rslt;
+    if(rslt != (int)len)
+        return LFS_ERR_IO;
+    if(rslt_close < 0)
+        return rslt_close;
+
+    store->current = target;
+    store->seq = hdr.seq;
+    store->len = len;
+    store->crc = crc;
+    return (int)len;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file state_store.h
+ * @brief double buffered store for the BSEC state on littlefs
+ *          the state is written alternately in two slot files, each one starting with a header that holds
+ *          the length of the blob, its CRC32 and a sequence number. On restore the newest slot with a valid
+ *          CRC is used, so a power cut while saving only loses the save in progress and never the previous state
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef _STATE_STORE_H_
+#define _STATE_STORE_H_
+
+#include <stdint.h>
+#include "pico_hal.h"
+
+#define STATE_STORE_MAGIC           UINT32_C(0x53544153) /*"SATS" little endian*/
+#define STATE_STORE_SLOTS           2
+/*returned by state_store_save when the blob is the same as the last one saved*/
+#define STATE_STORE_UNCHANGED       0
+/*returned when no slot holds a valid blob*/
+#define STATE_STORE_E_NO_STATE      (-100)
+/*returned when the blob saved does not fit in the buffer*/
+#define STATE_STORE_E_TOO_BIG       (-101)
+
+/*
+    header written at the beginning of every slot file, followed by len bytes of blob
+*/
+struct state_store_header {
+    uint32_t magic;
+    uint32_t seq;   //incremented at every save, the highest valid one is the newest
+    uint32_t len;   //bytes of blob following the header
+    uint32_t crc;   //CRC32 of the blob
+};
+
+/*
+    handle of the store, keeps the info of the newest valid slot
+    so that unchanged blobs are not written again
+*/
+struct state_store {
+    const char* slot_name[STATE_STORE_SLOTS];
+    int8_t current;     //index of the newest valid slot, -1 if none
+    uint32_t seq;
+    uint32_t len;
+    uint32_t crc;
+};
+
+/**
+ * @brief initializes the handle of the store, no filesystem operation is done
+ *
+ * @param store handle of the store
+ * @param slot_a name of the file used as first slot
+ * @param slot_b name of the file used as second slot
+ */
+void state_store_init(struct state_store* store, const char* slot_a, const char* slot_b);
+
+/**
+ * @brief reads back the newest valid blob, the other slot is used if the newest one is corrupted.
+ *          blob is only meaningful if the return value is positive
+ *
+ * @param store handle of the store
+ * @param blob buffer filled with the state
+ * @param max_len size of the buffer
+ * @return int number of bytes of the restored blob, STATE_STORE_E_NO_STATE if there is no valid slot
+ */
+int state_store_restore(struct state_store* store, uint8_t* blob, uint32_t max_len);
+
+/**
+ * @brief saves the blob in the oldest slot, skipped if the blob is the same as the newest one saved
+ *
+ * @param store handle of the store
+ * @param blob state to save
+ * @param len length of the state
+ * @return int number of bytes written, STATE_STORE_UNCHANGED if skipped, < 0 littlefs error
+ */
+int state_store_save(struct state_store* store, const uint8_t* blob, uint32_t len);
+
+#endif
@@ -0,0 +1,108 @@
+#include "stats.h"
+#include <stddef.h>
+
+/**
+ * @brief converts a signal to fixed-point, rounding to the nearest and saturating to the int32 range
+ *
+ * @param signal value of the output
+ * @param scale conversion factor
+ * @return int32_t the fixed-point value
+ */
+static int32_t to_fixed(float signal, float scale){
+    float value = signal * scale;
+    if(value >= 2147483647.0f)
+        return INT32_MAX;
+    if(value <= -2147483648.0f)
+        return INT32_MIN;
+    return (int32_t)(value >= 0 ? value + 0.5f : value - 0.5f);
+}
+
+/**
+ * @brief divides rounding half away from zero, the divisor is positive
+ *
+ * @param num dividend
+ * @param den divisor
+ * @return int64_t the rounded quotient
+ */
+static int64_t div_round(int64_t num, int64_t den){
+    return num >= 0 ? (num + den / 2) / den : (num - den / 2) / den;
+}
+
+void stats_init(struct stats_window* win, uint8_t ewma_shift){
+    win->n_channels = 0;
+    win->ewma_shift = ewma_shift;
+}
+
+int stats_add_channel(struct stats_window* win, uint8_t sensor_id, float scale){
+    if(win->n_channels >= STATS_MAX_CHANNELS)
+        return STATS_E_FULL;
+
+    struct stats_channel* ch = &win->channel[win->n_channels];
+    ch->sensor_id = sensor_id;
+    ch->scale = scale;
+    ch->ewma = 0;
+    ch->ewma_valid = false;
+    ch->count = 0;
+    ch->sum = 0;
+    ch->min = 0;
+    ch->max = 0;
+    ch->last = 0;
+    return win->n_channels++;
+}
+
+bool stats_update(struct stats_window* win, uint8_t sensor_id, float signal){
+    struct stats_channel* ch = (struct stats_channel*)stats_get(win, sensor_id);
+    if(ch == NULL)
+        return false;
+
+    int32_t value = to_fixed(signal, ch->scale);
+    if(ch->count == 0 || value < ch->min)
+        ch->min = value;
+    if(ch->count == 0 || value > ch->max)
+        ch->max = value;
+    ch->last = value;
+    //the window is closed by the caller, a window that is never closed keeps the mean of its first samples
+    if(ch->count < UINT16_MAX){
+        ch->sum += value;
+        ch->count++;
+    }
+
+    /*
+        ewma += (value - ewma) / 2^shift, the first sample seeds the average
+        right shift of a negative value is arithmetic on the compilers used for the pico
+    */
+    int64_t value_q = (int64_t)value * (1 << STATS_EWMA_FRAC);
+    if(!ch->ewma_valid){
+        ch->ewma = value_q;
+        ch->ewma_valid = true;
+    }else{
+        ch->ewma += (value_q - ch->ewma) >> win->ewma_shift;
+    }
+    return true;
+}
+
+void stats_reset(struct stats_window* win){
+    for(uint8_t i = 0; i < win->n_channels; i++){
+        win->channel[i].count = 0;
+        win->channel[i].sum = 0;
+    }
+}
+
+const struct stats_channel* stats_get(const struct stats_window* win, uint8_t sensor_id){
+    for(uint8_t i = 0; i < win->n_channels; i++)
+        if(win->channel[i].sensor_id == sensor_id)
+            return &win->channel[i];
+    return NULL;
+}
+
+int32_t stats_mean(const struct stats_channel* ch){
+    if(ch->count == 0)
+        return 0;
+    return (int32_t)div_round(ch->sum, ch->count);
+}
+
+int32_t stats_ewma(const struct stats_channel* ch){
+    if(!ch->ewma_valid)
+        return 0;
+    return (int32_t)((ch->ewma + (1 << (STATS_EWMA_FRAC - 1))) >> STATS_EWMA_FRAC);
+}
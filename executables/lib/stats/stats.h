@@ -0,0 +1,110 @@
+/**
+ * @file stats.h
+ * @brief streaming statistics over a reporting window for the outputs of the bsec library
+ *          every output is converted once to a fixed-point integer (signal * scale, rounded) and then
+ *          only integer arithmetic is used: mean, min, max and last are computed over the window,
+ *          the EWMA keeps going across windows. The scale of a channel is the same factor used in
+ *          the uplink, so the statistics can be copied in the packet as they are
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*highest number of outputs followed by a window*/
+#define STATS_MAX_CHANNELS          8
+/*fractional bits kept by the EWMA accumulator*/
+#define STATS_EWMA_FRAC             8
+/*returned by stats_add_channel when there is no free channel*/
+#define STATS_E_FULL                (-1)
+
+/*
+    statistics of a single output, the values are in fixed-point (signal * scale)
+*/
+struct stats_channel {
+    uint8_t sensor_id;  //id of the bsec output followed
+    float scale;        //conversion factor applied to the signal
+    uint16_t count;     //samples in the current window
+    int64_t sum;
+    int32_t min;
+    int32_t max;
+    int32_t last;
+    int64_t ewma;       //with STATS_EWMA_FRAC fractional bits, meaningful once the first sample arrived
+    bool ewma_valid;
+};
+
+/*
+    set of outputs followed over the same reporting window
+*/
+struct stats_window {
+    struct stats_channel channel[STATS_MAX_CHANNELS];
+    uint8_t n_channels;
+    uint8_t ewma_shift; //weight of the new sample is 1/2^ewma_shift
+};
+
+/**
+ * @brief initializes the window without any channel
+ *
+ * @param win window
+ * @param ewma_shift weight of the newest sample in the EWMA, as power of two (e.g. 3 -> 1/8)
+ */
+void stats_init(struct stats_window* win, uint8_t ewma_shift);
+
+/**
+ * @brief follows a new output
+ *
+ * @param win window
+ * @param sensor_id id of the bsec output
+ * @param scale factor used to convert the signal to fixed-point, e.g. 100 keeps two decimals
+ * @return int index of the channel, STATS_E_FULL if there are already STATS_MAX_CHANNELS channels
+ */
+int stats_add_channel(struct stats_window* win, uint8_t sensor_id, float scale);
+
+/**
+ * @brief adds a sample, meant to be called for every element of the bsec_output_t array
+ *
+ * @param win window
+ * @param sensor_id id of the bsec output
+ * @param signal value of the output
+ * @return true if the output is followed by the window, false if it was ignored
+ */
+bool stats_update(struct stats_window* win, uint8_t sensor_id, float signal);
+
+/**
+ * @brief starts a new window, the EWMA is kept
+ *
+ * @param win window
+ */
+void stats_reset(struct stats_window* win);
+
+/**
+ * @brief looks for the channel of an output
+ *
+ * @param win window
+ * @param sensor_id id of the bsec output
+ * @return const struct stats_channel* the channel, NULL if the output is not followed
+ */
+const struct stats_channel* stats_get(const struct stats_window* win, uint8_t sensor_id);
+
+/**
+ * @brief mean of the window, rounded to the nearest integer
+ *
+ * @param ch channel
+ * @return int32_t mean in fixed-point, 0 if the window is empty
+ */
+int32_t stats_mean(const struct stats_channel* ch);
+
+/**
+ * @brief current value of the EWMA, rounded to the nearest integer
+ *
+ * @param ch channel
+ * @return int32_t EWMA in fixed-point, 0 if no sample arrived yet
+ */
+int32_t stats_ewma(const struct stats_channel* ch);
+
+#endif
@@ -0,0 +1,158 @@
+#include "tscodec.h"
+
+uint32_t ts_zigzag(int32_t value){
+    return value < 0 ? ~((uint32_t)value << 1) : (uint32_t)value << 1;
+}
+
+int32_t ts_unzigzag(uint32_t value){
+    return (value & 1) ? (int32_t)~(value >> 1) : (int32_t)(value >> 1);
+}
+
+/**
+ * @brief writes a varint
+ *
+ * @param buf output, at least TS_VARINT_MAX_LEN bytes
+ * @param value value to write
+ * @return uint8_t bytes written
+ */
+static uint8_t put_varint(uint8_t* buf, uint32_t value){
+    uint8_t n = 0;
+    while(value >= 0x80){
+        buf[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buf[n++] = (uint8_t)value;
+    return n;
+}
+
+/**
+ * @brief reads a varint
+ *
+ * @param buf input
+ * @param len bytes left in the input
+ * @param value filled with the value
+ * @return int bytes read, TS_E_MALFORMED if the varint is truncated or too long
+ */
+static int get_varint(const uint8_t* buf, uint8_t len, uint32_t* value){
+    *value = 0;
+    for(uint8_t n = 0; n < len && n < TS_VARINT_MAX_LEN; n++){
+        *value |= (uint32_t)(buf[n] & 0x7F) << (7 * n);
+        if(!(buf[n] & 0x80))
+            return n + 1;
+    }
+    return TS_E_MALFORMED;
+}
+
+/**
+ * @brief quantizes a value rounding half away from zero
+ *
+ * @param value value
+ * @param quantum quantization step
+ * @return int32_t quantized value
+ */
+static int32_t quantize(int32_t value, uint16_t quantum){
+    if(quantum <= 1)
+        return value;
+    int32_t half = quantum / 2;
+    return value >= 0 ? (value + half) / quantum : (value - half) / quantum;
+}
+
+void ts_encoder_init(struct ts_encoder* enc, uint8_t n_channels, const uint16_t* quantum, uint8_t* buf, uint8_t max_len){
+    enc->n_channels = n_channels > TS_MAX_CHANNELS ? TS_MAX_CHANNELS : n_channels;
+    enc->quantum = quantum;
+    enc->buf = buf;
+    enc->max_len = max_len;
+    enc->len = TS_HEADER_LEN;
+    enc->count = 0;
+    enc->prev_time = 0;
+    enc->prev_dt = 0;
+    buf[0] = 0;
+    buf[1] = 0;
+    buf[2] = 0;
+}
+
+int ts_encoder_add(struct ts_encoder* enc, const int32_t* values, uint32_t time_s){
+    if(enc->count == UINT8_MAX || (enc->count > 0 && (int32_t)(time_s - enc->prev_time) < 0))
+        return TS_E_INVALID;
+
+    /*
+        the reading is written in a temporary buffer first, so a reading that doesn't fit
+        leaves the series untouched and the caller can send what is there
+    */
+    uint8_t tmp[TS_VARINT_MAX_LEN * (TS_MAX_CHANNELS + 1)];
+    int32_t q[TS_MAX_CHANNELS];
+    uint8_t n = 0;
+    uint32_t dt = enc->count > 0 ? time_s - enc->prev_time : 0;
+    if(enc->count > 0)
+        n += put_varint(&tmp[n], ts_zigzag((int32_t)(dt - enc->prev_dt)));
+    for(uint8_t c = 0; c < enc->n_channels; c++){
+        q[c] = quantize(values[c], enc->quantum[c]);
+        //the keyframe holds the absolute value, the difference wraps like the decoder does
+        int32_t delta = enc->count > 0 ? (int32_t)((uint32_t)q[c] - (uint32_t)enc->prev[c]) : q[c];
+        n += put_varint(&tmp[n], ts_zigzag(delta));
+    }
+    if(enc->len + n > enc->max_len)
+        return TS_E_NO_SPACE;
+
+    for(uint8_t i = 0; i < n; i++)
+        enc->buf[enc->len + i] = tmp[i];
+    enc->len += n;
+    for(uint8_t c = 0; c < enc->n_channels; c++)
+        enc->prev[c] = q[c];
+    enc->prev_time = time_s;
+    enc->prev_dt = dt;
+    enc->count++;
+    return enc->len;
+}
+
+int ts_encoder_finish(struct ts_encoder* enc, uint32_t now_s){
+    uint32_t age = enc->count > 0 ? now_s - enc->prev_time : 0;
+    //the age saturates, the decoder sees it as "at least 18 hours old"
+    if(age > UINT16_MAX)
+        age = UINT16_MAX;
+    enc->buf[0] = enc->count;
+    enc->buf[1] = (uint8_t)(age & 0xFF);
+    enc->buf[2] = (uint8_t)(age >> 8);
+    return enc->len;
+}
+
+int ts_decode(const uint8_t* buf, uint8_t len, uint8_t n_channels, const uint16_t* quantum,
+                int32_t* values, uint32_t* ages, uint8_t max_readings){
+    if(len < TS_HEADER_LEN || n_channels > TS_MAX_CHANNELS)
+        return TS_E_MALFORMED;
+    uint8_t count = buf[0];
+    if(count > max_readings)
+        return TS_E_MALFORMED;
+
+    int32_t q[TS_MAX_CHANNELS] = {0};
+    uint32_t time_s = 0;
+    uint32_t dt = 0;
+    uint8_t pos = TS_HEADER_LEN;
+    for(uint8_t i = 0; i < count; i++){
+        uint32_t v;
+        int rslt;
+        if(i > 0){
+            rslt = get_varint(&buf[pos], len - pos, &v);
+            if(rslt < 0)
+                return rslt;
+            pos += rslt;
+            dt += (uint32_t)ts_unzigzag(v);
+            time_s += dt;
+        }
+        //ages are first filled with the time from the oldest reading and turned around at the end
+        ages[i] = time_s;
+        for(uint8_t c = 0; c < n_channels; c++){
+            rslt = get_varint(&buf[pos], len - pos, &v);
+            if(rslt < 0)
+                return rslt;
+            pos += rslt;
+            q[c] = (int32_t)((uint32_t)q[c] + (uint32_t)ts_unzigzag(v));
+            values[i * n_channels + c] = q[c] * (quantum[c] > 1 ? quantum[c] : 1);
+        }
+    }
+
+    uint32_t newest_age = buf[1] | ((uint32_t)buf[2] << 8);
+    for(uint8_t i = 0; i < count; i++)
+        ages[i] = newest_age + (time_s - ages[i]);
+    return count;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file tscodec.h
+ * @brief compact codec for a time series of readings with several channels.
+ *          The first reading (keyframe) carries the absolute values, every following reading only the difference
+ *          from the previous one. Values are quantized before the difference so the rounding never accumulates,
+ *          signed numbers are zigzag mapped (0, -1, 1, -2 ... -> 0, 1, 2, 3 ...) and written as varints (7 bits per
+ *          byte, the high bit set when another byte follows), so a channel that didn't change takes a single byte.
+ *          Layout of the encoded series:
+ *
+ *          | count (1) | age of the newest reading (2, little endian) | keyframe | delta_1 | ... | delta_n |
+ *          keyframe = zigzag(q_0) ... zigzag(q_c)
+ *          delta_i  = zigzag(dt_i - dt_i-1) zigzag(q_0 - prev_q_0) ... zigzag(q_c - prev_q_c)
+ *
+ *          where q = round(value / quantum) and dt_i = t_i - t_i-1 (dt_0 = 0), readings taken at a fixed period
+ *          only pay a byte for the time. The decoder gets the time of the newest reading from the reception
+ *          time and the age, then goes back with the time differences
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef _TSCODEC_H_
+#define _TSCODEC_H_
+
+#include <stdint.h>
+
+/*highest number of channels of a reading*/
+#define TS_MAX_CHANNELS             8
+/*bytes of count and age at the beginning of the series*/
+#define TS_HEADER_LEN               3
+/*longest varint of a 32 bits value*/
+#define TS_VARINT_MAX_LEN           5
+
+/*returned by ts_encoder_add when the reading doesn't fit, the series is left as it was*/
+#define TS_E_NO_SPACE               (-1)
+/*returned by ts_encoder_add when the time goes backwards or the series already holds 255 readings*/
+#define TS_E_INVALID                (-2)
+/*returned by ts_decode when the series is truncated or malformed*/
+#define TS_E_MALFORMED              (-3)
+
+/*
+    state of a series being encoded in a caller provided buffer
+*/
+struct ts_encoder {
+    uint8_t n_channels;
+    const uint16_t* quantum;        //quantization step of every channel, 1 keeps the value as it is
+    uint8_t* buf;
+    uint8_t max_len;
+    uint8_t len;                    //bytes used so far
+    uint8_t count;                  //readings encoded
+    int32_t prev[TS_MAX_CHANNELS];  //quantized values of the previous reading
+    uint32_t prev_time;
+    uint32_t prev_dt;               //time between the previous two readings
+};
+
+/**
+ * @brief maps a signed value on an unsigned one, small magnitudes stay small
+ *
+ * @param value signed value
+ * @return uint32_t zigzag value
+ */
+uint32_t ts_zigzag(int32_t value);
+
+/**
+ * @brief opposite of ts_zigzag
+ *
+ * @param value zigzag value
+ * @return int32_t signed value
+ */
+int32_t ts_unzigzag(uint32_t value);
+
+/**
+ * @brief starts a new series
+ *
+ * @param enc encoder
+ * @param n_channels values of every reading, at most TS_MAX_CHANNELS
+ * @param quantum quantization step of every channel, must stay valid while encoding
+ * @param buf output buffer
+ * @param max_len size of the buffer, at least TS_HEADER_LEN
+ */
+void ts_encoder_init(struct ts_encoder* enc, uint8_t n_channels, const uint16_t* quantum, uint8_t* buf, uint8_t max_len);
+
+/**
+ * @brief appends a reading to the series
+ *
+ * @param enc encoder
+ * @param values n_channels values of the reading, in the same unit used by the decoder before the quantization
+ * @param time_s time of the reading in seconds, not earlier than the previous one
+ * @return int bytes of the series so far, TS_E_NO_SPACE or TS_E_INVALID if the reading was not added
+ */
+int ts_encoder_add(struct ts_encoder* enc, const int32_t* values, uint32_t time_s);
+
+/**
+ * @brief completes the header, to be called right before sending
+ *
+ * @param enc encoder
+ * @param now_s current time, in the time base of the readings
+ * @return int bytes of the series
+ */
+int ts_encoder_finish(struct ts_encoder* enc, uint32_t now_s);
+
+/**
+ * @brief decodes a series, the values are given back multiplied by the quantum
+ *
+ * @param buf encoded series
+ * @param len length of the series
+ * @param n_channels values of every reading
+ * @param quantum quantization step of every channel
+ * @param values filled with count * n_channels values, one reading after the other
+ * @param ages filled with count ages in seconds with respect to the reception, oldest first
+ * @param max_readings room in values and ages
+ * @return int number of readings decoded, TS_E_MALFORMED if the series is not valid
+ */
+int ts_decode(const uint8_t* buf, uint8_t len, uint8_t n_channels, const uint16_t* quantum,
+                int32_t* values, uint32_t* ages, uint8_t max_readings);
+
+#endif
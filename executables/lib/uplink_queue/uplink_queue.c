@@ -0,0 +1,304 @@
+#include "uplink_queue.h"
+#include "pico/crc32.h"
+#include <string.h>
+
+#define RECORD_HEADER_LEN           sizeof(struct uplink_queue_record)
+#define RECORD_CRC_LEN              sizeof(uint32_t)
+
+/**
+ * @brief CRC32 of a record, header and payload
+ *
+ * @param r header
+ * @param payload r->len bytes
+ * @return uint32_t CRC
+ */
+static uint32_t record_crc(const struct uplink_queue_record* r, const uint8_t* payload){
+    uint32_t crc = lorawan_crc32(0, (const uint8_t*)r, RECORD_HEADER_LEN);
+    return lorawan_crc32(crc, payload, r->len);
+}
+
+/**
+ * @brief reads and checks a record
+ *
+ * @param file log opened for reading
+ * @param offset position of the record
+ * @param r filled with the header
+ * @param payload buffer of UPLINK_QUEUE_MAX_PAYLOAD bytes filled with the payload
+ * @return int bytes of the whole record, -1 if the record is truncated, not a record or fails the CRC
+ */
+static int read_record(int file, uint32_t offset, struct uplink_queue_record* r, uint8_t* payload){
+    uint32_t crc;
+    if(pico_lseek(file, offset, LFS_SEEK_SET) < 0)
+        return -1;
+    if((int)pico_read(file, r, RECORD_HEADER_LEN) != (int)RECORD_HEADER_LEN)
+        return -1;
+    if((r->magic != UPLINK_QUEUE_ENTRY && r->magic != UPLINK_QUEUE_ACK) || r->len > UPLINK_QUEUE_MAX_PAYLOAD)
+        return -1;
+    if((int)pico_read(file, payload, r->len) != r->len)
+        return -1;
+    if((int)pico_read(file, &crc, RECORD_CRC_LEN) != (int)RECORD_CRC_LEN || crc != record_crc(r, payload))
+        return -1;
+    return RECORD_HEADER_LEN + r->len + RECORD_CRC_LEN;
+}
+
+/**
+ * @brief writes a record with its CRC in a single write
+ *
+ * @param file log opened for writing
+ * @param r header
+ * @param payload r->len bytes
+ * @return int bytes written, a negative littlefs error
+ */
+static int write_record(int file, const struct uplink_queue_record* r, const uint8_t* payload){
+    uint8_t buf[RECORD_HEADER_LEN + UPLINK_QUEUE_MAX_PAYLOAD + RECORD_CRC_LEN];
+    uint32_t crc = record_crc(r, payload);
+    int len = RECORD_HEADER_LEN + r->len + RECORD_CRC_LEN;
+    memcpy(buf, r, RECORD_HEADER_LEN);
+    if(r->len > 0)
+        memcpy(&buf[RECORD_HEADER_LEN], payload, r->len);
+    memcpy(&buf[RECORD_HEADER_LEN + r->len], &crc, RECORD_CRC_LEN);
+    int rslt = (int)pico_write(file, buf, len);
+    if(rslt < 0)
+        return rslt;
+    return rslt == len ? len : LFS_ERR_NOSPC;
+}
+
+/**
+ * @brief appends a record at the end of the log, littlefs commits it when the file is closed
+ *
+ * @param q queue
+ * @param r header
+ * @param payload r->len bytes
+ * @return int offset of the record, a negative littlefs error
+ */
+static int append_record(struct uplink_queue* q, const struct uplink_queue_record* r, const uint8_t* payload){
+    int file = pico_open(q->name, LFS_O_CREAT | LFS_O_WRONLY | LFS_O_APPEND);
+    if(file < 0)
+        return file;
+    int rslt = write_record(file, r, payload);
+    int rslt_close = pico_close(file);
+    if(rslt < 0)
+        return rslt;
+    if(rslt_close < 0)
+        return rslt_close;
+    int offset = (int)q->size;
+    q->size += rslt;
+    return offset;
+}
+
+/**
+ * @brief rewrites the log with the pending entries only, renumbered from head_seq,
+ *          the entries that fail the CRC are dropped
+ *
+ * @param q queue
+ * @return int frames waiting, a negative littlefs error, the old log is still valid in that case
+ */
+static int compact(struct uplink_queue* q){
+    uint8_t payload[UPLINK_QUEUE_MAX_PAYLOAD];
+    uint32_t offset[UPLINK_QUEUE_MAX_ENTRIES];
+    struct uplink_queue_record r;
+    uint8_t count = 0;
+    uint32_t size = 0;
+
+    if(q->count == 0){
+        //nothing waiting, the log is simply removed
+        pico_remove(q->name);
+        q->head = 0;
+        q->size = 0;
+        return 0;
+    }
+
+    int in = pico_open(q->name, LFS_O_RDONLY);
+    if(in < 0)
+        return in;
+    int out = pico_open(q->tmp_name, LFS_O_CREAT | LFS_O_WRONLY | LFS_O_TRUNC);
+    if(out < 0){
+        pico_close(in);
+        return out;
+    }
+
+    int rslt = 0;
+    for(uint8_t i = 0; i < q->count && rslt >= 0; i++){
+        uint8_t idx = (q->head + i) % UPLINK_QUEUE_MAX_ENTRIES;
+        if(read_record(in, q->offset[idx], &r, payload) < 0 || r.magic != UPLINK_QUEUE_ENTRY){
+            q->dropped++;
+            continue;
+        }
+        r.seq = q->head_seq + count;
+        rslt = write_record(out, &r, payload);
+        if(rslt >= 0){
+            offset[count++] = size;
+            size += rslt;
+        }
+    }
+    pico_close(in);
+    int rslt_close = pico_close(out);
+    if(rslt < 0 || rslt_close < 0){
+        pico_remove(q->tmp_name);
+        return rslt < 0 ? rslt : rslt_close;
+    }
+
+    //littlefs replaces the log atomically, a power cut leaves either the old or the new one
+    if(count == 0){
+        pico_remove(q->name);
+        pico_remove(q->tmp_name);
+    }else{
+        rslt = pico_rename(q->tmp_name, q->name);
+        if(rslt < 0){
+            pico_remove(q->tmp_name);
+            return rslt;
+        }
+    }
+    memcpy(q->offset, offset, count * sizeof(offset[0]));
+    q->count = count;
+    q->head = 0;
+    q->size = size;
+    return count;
+}
+
+/**
+ * @brief removes the oldest entry from the ring, the log is not touched
+ *
+ * @param q queue
+ */
+static void forget_oldest(struct uplink_queue* q){
+    q->head = (q->head + 1) % UPLINK_QUEUE_MAX_ENTRIES;
+    q->head_seq++;
+    q->count--;
+}
+
+int uplink_queue_open(struct uplink_queue* q, const char* name, const char* tmp_name, uint8_t capacity, uint8_t policy){
+    uint8_t payload[UPLINK_QUEUE_MAX_PAYLOAD];
+    struct uplink_queue_record r;
+    bool rewrite = false;
+
+    q->name = name;
+    q->tmp_name = tmp_name;
+    q->capacity = capacity > UPLINK_QUEUE_MAX_ENTRIES ? UPLINK_QUEUE_MAX_ENTRIES : capacity;
+    q->policy = policy;
+    q->count = 0;
+    q->head = 0;
+    q->head_seq = 0;
+    q->size = 0;
+    q->dropped = 0;
+
+    //a temporary file means the compaction didn't get to the rename, the log is still the old one
+    pico_remove(tmp_name);
+
+    int file = pico_open(name, LFS_O_RDONLY);
+    if(file < 0)
+        return 0;
+    int end = (int)pico_lseek(file, 0, LFS_SEEK_END);
+    uint32_t offset = 0;
+    while(offset < (uint32_t)end){
+        int len = read_record(file, offset, &r, payload);
+        if(len < 0)
+            break;
+        if(r.magic == UPLINK_QUEUE_ENTRY){
+            if(q->count == 0){
+                q->head_seq = r.seq;
+            }else if(r.seq != q->head_seq + q->count){
+                //entries are always consecutive, anything else is not part of the log
+                break;
+            }
+            if(q->count == q->capacity){
+                //the capacity got smaller since the log was written
+                forget_oldest(q);
+                q->dropped++;
+                rewrite = true;
+            }
+            q->offset[(q->head + q->count) % UPLINK_QUEUE_MAX_ENTRIES] = offset;
+            q->count++;
+        }else{
+            while(q->count > 0 && (int32_t)(r.seq - q->head_seq) >= 0)
+                forget_oldest(q);
+        }
+        offset += len;
+    }
+    pico_close(file);
+    q->size = offset;
+
+    //a record torn by a power cut is left out, the next records would be appended after it otherwise
+    if(rewrite || offset != (uint32_t)end || q->count == 0)
+        return compact(q);
+    return q->count;
+}
+
+int uplink_queue_push(struct uplink_queue* q, uint8_t port, const uint8_t* data, uint8_t len){
+    if(len > UPLINK_QUEUE_MAX_PAYLOAD)
+        return UPLINK_QUEUE_E_TOO_BIG;
+    if(q->count >= q->capacity){
+        q->dropped++;
+        if(q->policy == UPLINK_QUEUE_DROP_NEWEST)
+            return UPLINK_QUEUE_E_FULL;
+        int rslt = uplink_queue_pop(q);
+        if(rslt < 0)
+            return rslt;
+    }
+
+    struct uplink_queue_record r = {
+        .magic = UPLINK_QUEUE_ENTRY,
+        .port = port,
+        .len = len,
+        .reserved = 0,
+        .seq = q->head_seq + q->count,
+    };
+    int offset = append_record(q, &r, data);
+    if(offset < 0){
+        //whatever reached the flash is cut off by rewriting the log
+        compact(q);
+        return offset;
+    }
+    q->offset[(q->head + q->count) % UPLINK_QUEUE_MAX_ENTRIES] = (uint32_t)offset;
+    q->count++;
+    return q->count;
+}
+
+int uplink_queue_peek(struct uplink_queue* q, uint8_t* port, uint8_t* data, uint8_t max_len){
+    uint8_t payload[UPLINK_QUEUE_MAX_PAYLOAD];
+    struct uplink_queue_record r;
+
+    if(q->count == 0)
+        return 0;
+    int file = pico_open(q->name, LFS_O_RDONLY);
+    if(file < 0)
+        return file;
+    int len = read_record(file, q->offset[q->head], &r, payload);
+    pico_close(file);
+    if(len < 0 || r.magic != UPLINK_QUEUE_ENTRY){
+        q->dropped++;
+        uplink_queue_pop(q);
+        return UPLINK_QUEUE_E_CORRUPTED;
+    }
+    if(r.len > max_len)
+        return UPLINK_QUEUE_E_TOO_BIG;
+
+    *port = r.port;
+    memcpy(data, payload, r.len);
+    return r.len;
+}
+
+int uplink_queue_pop(struct uplink_queue* q){
+    if(q->count == 0)
+        return 0;
+
+    struct uplink_queue_record r = {
+        .magic = UPLINK_QUEUE_ACK,
+        .port = 0,
+        .len = 0,
+        .reserved = 0,
+        .seq = q->head_seq,
+    };
+    forget_oldest(q);
+    //the last entry gone or a log too big are rewritten, the ack is not needed then
+    if(q->count == 0 || q->size + RECORD_HEADER_LEN + RECORD_CRC_LEN > UPLINK_QUEUE_COMPACT_SIZE)
+        return compact(q);
+    int rslt = append_record(q, &r, NULL);
+    if(rslt < 0){
+        //the ring is already ahead of the log, rewriting it keeps the two together
+        rslt = compact(q);
+        if(rslt < 0)
+            return rslt;
+    }
+    return q->count;
+}
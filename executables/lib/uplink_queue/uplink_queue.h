@@ -0,0 +1,118 @@
+/**
+ * @file uplink_queue.h
+ * @brief bounded persistent queue of uplinks on littlefs, frames that have not been acknowledged yet survive
+ *          a reset or a power cut and are sent again oldest first.
+ *          The queue is a single append-only log of records:
+ *
+ *          | magic (1) | port (1) | len (1) | reserved (1) | seq (4) | payload (len) | crc (4) |
+ *
+ *          an entry record holds a frame, an ack record (len 0) marks every entry up to seq as gone.
+ *          Entries are always removed oldest first, so an ack only needs the seq of the last entry removed.
+ *          Every record ends with the CRC32 of header and payload: a record torn by a power cut fails the check,
+ *          the scan on open stops there and the log is rewritten without it.
+ *          The log is compacted when it gets too big: the pending entries are copied in a temporary file that
+ *          is renamed over the log, littlefs renames atomically so either the old or the new log is found on open
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef _UPLINK_QUEUE_H_
+#define _UPLINK_QUEUE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico_hal.h"
+
+#define UPLINK_QUEUE_ENTRY          0xE5
+#define UPLINK_QUEUE_ACK            0xAC
+/*highest number of frames waiting, the offsets of the entries are kept in RAM*/
+#define UPLINK_QUEUE_MAX_ENTRIES    64
+/*largest payload of a frame*/
+#define UPLINK_QUEUE_MAX_PAYLOAD    242
+/*size of the log that triggers a compaction once an entry is removed*/
+#define UPLINK_QUEUE_COMPACT_SIZE   (8 * 1024)
+
+/*what happens to a frame pushed in a full queue*/
+#define UPLINK_QUEUE_DROP_OLDEST    0   //the oldest frame waiting is dropped to make room
+#define UPLINK_QUEUE_DROP_NEWEST    1   //the new frame is dropped
+
+/*returned when the queue is full and the policy drops the new frame*/
+#define UPLINK_QUEUE_E_FULL         (-200)
+/*returned by uplink_queue_peek when the oldest entry fails the CRC, the entry has been dropped*/
+#define UPLINK_QUEUE_E_CORRUPTED    (-201)
+/*returned when the payload doesn't fit*/
+#define UPLINK_QUEUE_E_TOO_BIG      (-202)
+
+/*
+    header of every record, followed by len bytes of payload and the CRC32 of header and payload
+*/
+struct uplink_queue_record {
+    uint8_t magic;      //UPLINK_QUEUE_ENTRY or UPLINK_QUEUE_ACK
+    uint8_t port;       //LoRaWAN port of the frame
+    uint8_t len;        //bytes of payload
+    uint8_t reserved;
+    uint32_t seq;       //increasing number of the entry, for an ack the last entry removed
+};
+
+/*
+    handle of the queue, the pending entries are a ring of offsets in the log
+*/
+struct uplink_queue {
+    const char* name;               //file of the log
+    const char* tmp_name;           //file used while compacting
+    uint8_t capacity;               //highest number of frames waiting
+    uint8_t policy;                 //UPLINK_QUEUE_DROP_*
+    uint8_t count;                  //frames waiting
+    uint8_t head;                   //index in offset of the oldest frame
+    uint32_t head_seq;              //seq of the oldest frame, the others follow
+    uint32_t size;                  //bytes of valid records in the log
+    uint32_t dropped;               //frames dropped because the queue was full or corrupted, since open
+    uint32_t offset[UPLINK_QUEUE_MAX_ENTRIES];
+};
+
+/**
+ * @brief opens the queue, the log is scanned to find the frames still waiting,
+ *          a torn record at the end or an unfinished compaction are cleaned up
+ *
+ * @param q queue
+ * @param name file of the log
+ * @param tmp_name file used while compacting
+ * @param capacity highest number of frames waiting, at most UPLINK_QUEUE_MAX_ENTRIES
+ * @param policy UPLINK_QUEUE_DROP_OLDEST or UPLINK_QUEUE_DROP_NEWEST
+ * @return int frames waiting, a negative littlefs error if the log cannot be rewritten
+ */
+int uplink_queue_open(struct uplink_queue* q, const char* name, const char* tmp_name, uint8_t capacity, uint8_t policy);
+
+/**
+ * @brief appends a frame, the record is on flash when the function returns
+ *
+ * @param q queue
+ * @param port LoRaWAN port of the frame
+ * @param data payload
+ * @param len bytes of payload, at most UPLINK_QUEUE_MAX_PAYLOAD
+ * @return int frames waiting, UPLINK_QUEUE_E_FULL, UPLINK_QUEUE_E_TOO_BIG or a negative littlefs error
+ */
+int uplink_queue_push(struct uplink_queue* q, uint8_t port, const uint8_t* data, uint8_t len);
+
+/**
+ * @brief reads the oldest frame without removing it
+ *
+ * @param q queue
+ * @param port filled with the LoRaWAN port of the frame
+ * @param data buffer of max_len bytes
+ * @param max_len size of the buffer
+ * @return int bytes of the frame, 0 if the queue is empty, UPLINK_QUEUE_E_CORRUPTED, UPLINK_QUEUE_E_TOO_BIG
+ *          or a negative littlefs error
+ */
+int uplink_queue_peek(struct uplink_queue* q, uint8_t* port, uint8_t* data, uint8_t max_len);
+
+/**
+ * @brief removes the oldest frame, once it has been acknowledged
+ *
+ * @param q queue
+ * @return int frames waiting, a negative littlefs error
+ */
+int uplink_queue_pop(struct uplink_queue* q);
+
+#endif
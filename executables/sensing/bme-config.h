@@ -2,6 +2,7 @@
 #define PIN_FORMAT_INPUT 17
 
 const char* state_file_name = "coffee";
+const char* state_file_name_b = "coffee_b";
 /**
  * @brief saves the file on littlefs afters some time has passed
  * 
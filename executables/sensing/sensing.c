@@ -20,12 +20,15 @@
 #include "../lib/bme/bme_api/bme68x_API.h"
 #include "../lib/bme/bsec2_0/bsec_datatypes.h"
 #include "../lib/bme/bsec2_0/bsec_interface.h"
+#include "../lib/bsec_config/bsec_config.h"
 #include "pico/sleep.h"
 #include "hardware/clocks.h"
 #include "hardware/rosc.h"
 #include "hardware/structs/scb.h"
 //littlefs
 #include "pico_hal.h"
+#include "../lib/state_store/state_store.h"
+#include "../lib/scratch/scratch.h"
 
 #include "hardware/watchdog.h"
 
@@ -49,17 +52,19 @@ uint8_t n_required_sensor_settings = BSEC_MAX_PHYSICAL_SENSOR;
 //configuration coming from bsec
 bsec_bme_settings_t conf_bsec;
 
-//state to save
-uint8_t serialized_state[BSEC_MAX_STATE_BLOB_SIZE];
+//state to save, the buffers are taken from the scratch arena only while restoring or saving
 uint32_t n_serialized_state_max = BSEC_MAX_STATE_BLOB_SIZE;
 uint32_t n_serialized_state = BSEC_MAX_STATE_BLOB_SIZE;
-uint8_t work_buffer_state[BSEC_MAX_WORKBUFFER_SIZE];
 uint32_t n_work_buffer_size = BSEC_MAX_WORKBUFFER_SIZE;
-//configuration on shut down
-uint8_t serialized_settings[BSEC_MAX_PROPERTY_BLOB_SIZE];
-uint32_t n_serialized_settings_max = BSEC_MAX_PROPERTY_BLOB_SIZE;
-uint8_t work_buffer[BSEC_MAX_WORKBUFFER_SIZE];
+//A/B slots holding the state
+struct state_store state_store;
+//configuration, the blob is in flash so only the work buffer is needed
 uint32_t n_work_buffer = BSEC_MAX_WORKBUFFER_SIZE;
+/*
+    scratch region shared by the bsec buffers, sized for the largest set alive at the same time (state and its work buffer)
+*/
+#define SCRATCH_SIZE            (SCRATCH_ROUND(BSEC_MAX_STATE_BLOB_SIZE) + SCRATCH_ROUND(BSEC_MAX_WORKBUFFER_SIZE))
+static uint8_t scratch_region[SCRATCH_SIZE] __attribute__((aligned(SCRATCH_ALIGN)));
 /*
     File System variables
 */
@@ -98,6 +103,14 @@ void print_results(int id, float signal, int accuracy);
  */
 void check_fs_error(int rslt_api, char msg[]);
 
+/**
+ * @brief stops on a block the scratch arena could not give, SCRATCH_SIZE is too small for the buffers alive together
+ * 
+ * @param block result of scratch_alloc
+ * @param msg buffer requested
+ */
+void check_scratch(const void* block, char msg[]);
+
 uint8_t processData(int64_t currTimeNs, const struct bme68x_data d, bsec_input_t* inputs){
     uint8_t n_input = 0;
     
@@ -303,37 +316,41 @@ int main( void )
     gpio_put(PIN_FORMAT_OUTPUT, 0);
 
 
-    //read state to get the previous state and avoid restarting everything
-    int state_file = pico_open(state_file_name, LFS_O_CREAT | LFS_O_RDONLY );
-    check_fs_error(state_file, "Error opening state file"); 
-    
-    rslt_fs = pico_read(state_file, serialized_state, BSEC_MAX_STATE_BLOB_SIZE*sizeof(uint8_t));
-    check_fs_error(state_file, "Error while reading state file");  
-
-    pico_rewind(state_file);
-    check_fs_error(state_file, "Error while rewinding state file");
+    //read state to get the previous state and avoid restarting everything, only a state with a valid CRC is returned
+    scratch_init(scratch_region, sizeof(scratch_region));
+    uint32_t scratch_top = scratch_mark();
+    uint8_t* serialized_state = scratch_alloc(n_serialized_state_max);
+    uint8_t* work_buffer_state = scratch_alloc(n_work_buffer_size);
+    check_scratch(serialized_state, "the state");
+    check_scratch(work_buffer_state, "the state work buffer");
+    state_store_init(&state_store, state_file_name, state_file_name_b);
+    int state_len = state_store_restore(&state_store, serialized_state, n_serialized_state_max);
     pico_unmount();
     sleep_ms(1000);
     gpio_deinit(PIN_FORMAT_INPUT);
     gpio_deinit(PIN_FORMAT_OUTPUT);
-    if(rslt_fs > 0){
+    if(state_len > 0){
     #ifdef DEBUG
-        printf("...resuming the state, read %d bytes\n", rslt_fs);
+        printf("...resuming the state, read %d bytes\n", state_len);
     #endif
         //set the state if there is one saved
-        rslt_bsec = bsec_set_state(serialized_state, n_serialized_state, work_buffer, n_work_buffer_size);
+        rslt_bsec = bsec_set_state(serialized_state, state_len, work_buffer_state, n_work_buffer_size);
         check_rslt_bsec(rslt_bsec, "BSEC_SET_STATE");
     }
+    scratch_release(scratch_top);
     gpio_put(PICO_DEFAULT_LED_PIN, 0);
     
 #ifdef DEBUG
     printf("...initialization BSEC\n");
 #endif
 
-    /*Set configuration and state but it's optional so for now we leave it commented out*/
-    const uint8_t bsec_config_selectivity[BSEC_MAX_PROPERTY_BLOB_SIZE] = {0,0,2,2,189,1,0,0,0,0,0,0,213,8,0,0,52,0,1,0,0,168,19,73,64,49,119,76,0,192,40,72,0,192,40,72,137,65,0,191,205,204,204,190,0,0,64,191,225,122,148,190,10,0,3,0,216,85,0,100,0,0,96,64,23,183,209,56,28,0,2,0,0,244,1,150,0,50,0,0,128,64,0,0,32,65,144,1,0,0,112,65,0,0,0,63,16,0,3,0,10,215,163,60,10,215,35,59,10,215,35,59,13,0,5,0,0,0,0,0,100,254,131,137,87,88,0,9,0,7,240,150,61,0,0,0,0,0,0,0,0,28,124,225,61,52,128,215,63,0,0,160,64,0,0,0,0,0,0,0,0,205,204,12,62,103,213,39,62,230,63,76,192,0,0,0,0,0,0,0,0,145,237,60,191,251,58,64,63,177,80,131,64,0,0,0,0,0,0,0,0,93,254,227,62,54,60,133,191,0,0,64,64,12,0,10,0,0,0,0,0,0,0,0,0,173,6,11,0,0,0,2,97,212,217,189,123,211,184,190,246,39,132,190,206,174,109,189,251,75,175,189,235,9,110,62,137,144,36,63,45,8,80,62,144,77,210,188,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,40,255,226,62,40,255,226,190,0,0,0,0,0,0,0,0,76,31,165,190,5,133,25,190,99,111,16,191,4,102,151,189,223,240,98,190,35,221,96,62,233,47,232,61,154,195,212,62,246,23,39,191,0,0,0,0,208,204,147,189,31,212,43,190,235,102,187,62,96,223,37,190,68,35,41,190,176,189,140,62,167,195,139,189,61,247,59,62,197,184,64,62,0,0,0,0,244,158,240,189,150,236,38,62,220,212,82,190,97,85,116,190,38,131,133,189,226,168,44,62,210,144,202,190,155,4,251,62,111,28,141,62,0,0,0,0,11,238,37,61,214,142,233,189,152,81,180,190,225,50,209,62,51,229,221,62,153,207,193,59,0,126,171,60,100,47,212,62,12,59,73,189,0,0,0,0,109,51,81,189,246,41,221,189,14,235,164,190,106,152,64,62,146,87,64,62,211,57,245,189,85,105,18,61,201,169,91,190,254,132,14,189,0,0,0,0,67,219,100,62,66,204,199,190,41,243,253,189,179,13,234,189,8,59,224,190,29,6,33,190,164,176,176,190,54,130,42,63,55,59,158,189,0,0,0,0,180,113,104,190,83,10,224,190,121,202,43,190,103,45,12,190,15,201,28,190,45,147,66,63,59,77,166,189,87,205,216,189,202,231,80,190,0,0,0,0,61,78,135,190,204,10,107,190,83,139,36,62,193,61,191,62,98,160,17,190,189,93,7,63,134,130,186,61,225,40,223,189,104,13,99,190,0,0,0,0,255,48,206,190,218,86,40,189,67,21,240,190,140,32,28,61,216,22,56,190,200,133,35,190,235,148,37,62,54,40,19,63,59,144,196,190,0,0,0,0,56,41,1,191,129,1,168,190,155,197,38,190,19,130,161,190,172,193,237,189,76,39,22,62,156,12,115,63,153,230,241,59,251,43,182,190,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,63,159,49,7,191,186,149,18,63,0,0,0,0,0,0,0,0,24,104,156,190,241,167,235,189,0,0,0,0,0,0,0,0,42,27,1,190,234,50,155,62,0,0,0,0,0,0,0,0,104,247,151,189,48,189,192,62,0,0,0,0,0,0,0,0,223,179,175,190,87,168,137,190,0,0,0,0,0,0,0,0,44,240,99,62,155,142,95,191,0,0,0,0,0,0,0,0,74,14,53,63,152,160,21,191,0,0,0,0,0,0,0,0,115,135,204,62,33,73,249,190,0,0,0,0,0,0,0,0,138,35,98,191,36,48,73,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,9,0,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,88,154,50,72,197,13,232,75,9,255,180,75,145,98,131,75,167,32,87,73,174,158,62,73,8,35,45,73,12,163,26,72,242,227,55,72,126,235,71,72,0,0,0,0,0,0,0,0,0,0,0,0,184,21,18,72,175,32,249,75,207,100,195,75,164,64,141,75,117,176,79,73,115,35,54,73,215,19,36,73,36,167,240,71,157,166,10,72,81,152,20,72,0,0,128,63,0,0,128,63,0,0,128,63,0,0,0,87,1,254,0,2,1,5,48,117,100,0,44,1,112,23,151,7,132,3,197,0,92,4,144,1,64,1,64,1,144,1,48,117,48,117,48,117,48,117,100,0,100,0,100,0,48,117,48,117,48,117,100,0,100,0,48,117,48,117,8,7,8,7,8,7,8,7,8,7,100,0,100,0,100,0,100,0,48,117,48,117,48,117,100,0,100,0,100,0,48,117,48,117,100,0,100,0,255,255,255,255,255,255,255,255,255,255,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,1,44,1,255,255,255,255,255,255,255,255,255,255,8,7,8,7,8,7,8,7,8,7,8,7,8,7,8,7,8,7,8,7,8,7,8,7,8,7,8,7,255,255,255,255,255,255,255,255,255,255,112,23,112,23,112,23,112,23,112,23,112,23,112,23,112,23,112,23,112,23,112,23,112,23,112,23,112,23,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,220,5,220,5,220,5,255,255,255,255,255,255,220,5,220,5,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,48,117,0,5,10,5,0,2,0,10,0,30,0,5,0,5,0,5,0,5,0,5,0,5,0,64,1,100,0,100,0,100,0,200,0,200,0,200,0,64,1,64,1,64,1,10,0,0,0,0,217,86,0,0};
-    rslt_bsec = bsec_set_configuration(bsec_config_selectivity, n_serialized_settings_max, work_buffer, n_work_buffer);
+    /*Set configuration, the blob is read by the library straight from flash*/
+    const struct bsec_config_entry* bsec_config = bsec_config_find(BSEC_CONFIG_ID_SELECTIVITY);
+    uint8_t* work_buffer = scratch_alloc(n_work_buffer);
+    check_scratch(work_buffer, "the configuration work buffer");
+    rslt_bsec = bsec_set_configuration(bsec_config->blob, bsec_config->len, work_buffer, n_work_buffer);
     check_rslt_bsec( rslt_bsec, "BSEC_SET_CONFIGURATION");
+    scratch_release(scratch_top);
     requested_virtual_sensors[0].sensor_id = BSEC_OUTPUT_RAW_TEMPERATURE;
     requested_virtual_sensors[0].sample_rate = BSEC_SAMPLE_RATE_ULP;
     requested_virtual_sensors[1].sensor_id = BSEC_OUTPUT_RAW_HUMIDITY;
@@ -577,33 +594,31 @@ void save_state_file(){
     #ifdef DEBUG
         printf("...Saving the file\n");
     #endif
-        //mount the fs 
-    if (pico_mount(true) != LFS_ERR_OK) {
+        //mount the fs, without formatting since it would wipe both slots
+    if (pico_mount(false) != LFS_ERR_OK) {
     #ifdef DEBUG
         printf("Error mounting FS\n");
     #endif
         blink();
     }
-    //open the file in write mode, no create because it should've been created already
-    int state_file = pico_open(state_file_name, LFS_O_CREAT | LFS_O_WRONLY);
-    check_fs_error(state_file, "Error opening state file write"); 
-    //get the state file
-    rslt_bsec = bsec_get_state(0, serialized_state, n_serialized_state_max, work_buffer, n_work_buffer_size, &n_serialized_state);
+    //get the state, n_serialized_state holds the bytes actually used
+    uint32_t scratch_top = scratch_mark();
+    uint8_t* serialized_state = scratch_alloc(n_serialized_state_max);
+    uint8_t* work_buffer_state = scratch_alloc(n_work_buffer_size);
+    check_scratch(serialized_state, "the state");
+    check_scratch(work_buffer_state, "the state work buffer");
+    rslt_bsec = bsec_get_state(0, serialized_state, n_serialized_state_max, work_buffer_state, n_work_buffer_size, &n_serialized_state);
     check_rslt_bsec(rslt_bsec, "BSEC_GET_STATE");
-    //write the file and flush
-    rslt_fs = pico_write(state_file, serialized_state, BSEC_MAX_STATE_BLOB_SIZE*sizeof(uint8_t));
-    check_fs_error(rslt_fs, "Error writing the file");
-    pico_fflush(state_file);
-    //log the number of bytes written
-    int pos = pico_lseek(state_file, 0, LFS_SEEK_CUR);
+    //write the oldest slot, skipped if the state didn't change
+    int written = state_store_save(&state_store, serialized_state, n_serialized_state);
+    scratch_release(scratch_top);
+    check_fs_error(written, "Error writing the file");
 #ifdef DEBUG
-    printf("Written %d byte for file %s\n", pos, state_file);
+    if(written == STATE_STORE_UNCHANGED)
+        printf("State unchanged, nothing written\n");
+    else
+        printf("Written %d byte for file %s\n", written, state_store.slot_name[state_store.current]);
 #endif
-    //rewind the pointer to the beginning of the file just to be sure
-    rslt_fs = pico_rewind(state_file);
-    check_fs_error(state_file, "Error while rewinding state file");
-    //close the file
-    rslt_fs = pico_close(state_file);
     //unmount the fs
     pico_unmount();
     //turn off the led, system can be shut down 
@@ -618,4 +633,14 @@ void check_fs_error(int rslt, char msg[]){
     #endif
         blink();
     }
+}
+
+void check_scratch(const void* block, char msg[]){
+    (void)msg;
+    if(block == NULL){
+    #ifdef DEBUG
+        printf("Scratch arena too small for %s\n", msg);
+    #endif
+        blink();
+    }
 }
\ No newline at end of file
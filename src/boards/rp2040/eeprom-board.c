@@ -12,20 +12,67 @@
 
 #include "utilities.h"
 #include "eeprom-board.h"
+#include "eeprom-journal.h"
+#include "pico/flash-layout.h"
 
-#define EEPROM_SIZE    (FLASH_SECTOR_SIZE)
-#define EEPROM_OFFSET  (PICO_FLASH_SIZE_BYTES - EEPROM_SIZE)
+// the journal takes the sectors below littlefs, the LoRaMac context is a small part of a sector
+#define EEPROM_SIZE    (EEPROM_JOURNAL_MAX_SIZE)
+#define EEPROM_OFFSET  (EEPROM_JOURNAL_OFFSET)
 #define EEPROM_ADDRESS ((const uint8_t*)(XIP_BASE + EEPROM_OFFSET))
 
 static uint8_t eeprom_write_cache[EEPROM_SIZE];
 
+static struct eeprom_journal eeprom_journal;
+
+static int EepromFlashRead( uint32_t offset, void* buffer, uint32_t size )
+{
+    memcpy(buffer, EEPROM_ADDRESS + offset, size);
+
+    return 0;
+}
+
+static int EepromFlashProg( uint32_t offset, const void* buffer, uint32_t size )
+{
+    uint32_t mask;
+
+    BoardCriticalSectionBegin(&mask);
+    flash_range_program(EEPROM_OFFSET + offset, buffer, size);
+    BoardCriticalSectionEnd(&mask);
+
+    return 0;
+}
+
+static int EepromFlashErase( uint32_t offset )
+{
+    uint32_t mask;
+
+    BoardCriticalSectionBegin(&mask);
+    flash_range_erase(EEPROM_OFFSET + offset, FLASH_SECTOR_SIZE);
+    BoardCriticalSectionEnd(&mask);
+
+    return 0;
+}
+
+static const struct eeprom_journal_flash eeprom_flash = {
+    .sector_size = FLASH_SECTOR_SIZE,
+    .page_size = FLASH_PAGE_SIZE,
+    .sectors = EEPROM_JOURNAL_SECTORS,
+    .read = EepromFlashRead,
+    .prog = EepromFlashProg,
+    .erase = EepromFlashErase,
+};
+
 void EepromMcuInit()
 {
-    memcpy(eeprom_write_cache, EEPROM_ADDRESS, sizeof(eeprom_write_cache));
+    eeprom_journal_mount(&eeprom_journal, &eeprom_flash, eeprom_write_cache, sizeof(eeprom_write_cache));
 }
 
 uint8_t EepromMcuReadBuffer( uint16_t addr, uint8_t *buffer, uint16_t size )
 {
+    if ((uint32_t)addr + size > sizeof(eeprom_write_cache)) {
+        return FAIL;
+    }
+
     memcpy(buffer, eeprom_write_cache + addr, size);
     
     return SUCCESS;
@@ -33,19 +80,19 @@ uint8_t EepromMcuReadBuffer( uint16_t addr, uint8_t *buffer, uint16_t size )
 
 uint8_t EepromMcuWriteBuffer( uint16_t addr, uint8_t *buffer, uint16_t size )
 {
-    memcpy(eeprom_write_cache + addr, buffer, size);
+    if (eeprom_journal_write(&eeprom_journal, addr, buffer, size) < 0) {
+        return FAIL;
+    }
 
     return SUCCESS;
 }
 
 uint8_t EepromMcuFlush()
 {
-    uint32_t mask;
-
-    BoardCriticalSectionBegin(&mask);
+    // only the bytes changed since the last flush are appended, a sector is erased only when the journal moves on
+    if (eeprom_journal_flush(&eeprom_journal) < 0) {
+        return FAIL;
+    }
 
-    flash_range_erase(EEPROM_OFFSET, sizeof(eeprom_write_cache));
-    flash_range_program(EEPROM_OFFSET, eeprom_write_cache, sizeof(eeprom_write_cache));
-
-    BoardCriticalSectionEnd(&mask);
+    return SUCCESS;
 }
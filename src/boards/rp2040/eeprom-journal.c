@@ -0,0 +1,434 @@
+/**
+ * @file eeprom-journal.c
+ * @brief log-structured store of the emulated EEPROM, see eeprom-journal.h
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <string.h>
+
+#include "eeprom-journal.h"
+#include "pico/crc32.h"
+
+#define JOURNAL_MAGIC           0x4C4E4A45  // "EJNL"
+#define HEADER_LEN              16
+#define RECORD_LEN              8
+#define COMMIT_ADDR             0xFFFE
+#define ERASED_ADDR             0xFFFF
+// dirty runs closer than a record header are written together
+#define RUN_GAP                 RECORD_LEN
+#define ALIGN4( x )             ( ( ( x ) + 3u ) & ~3u )
+
+struct header {
+    uint32_t magic;
+    uint32_t seq;
+    uint16_t size;
+    uint16_t reserved;
+    uint32_t crc;
+};
+
+struct record {
+    uint16_t addr;
+    uint16_t len;
+    uint32_t crc;
+};
+
+/*
+    records are gathered page by page, a page is programmed once it is complete or at the end of the flush
+*/
+struct writer {
+    struct eeprom_journal* j;
+    uint32_t page_offset;
+    bool staged;
+    int rslt;
+    uint8_t page[EEPROM_JOURNAL_MAX_PAGE];
+};
+
+static uint32_t header_crc( const struct header* h )
+{
+    return lorawan_crc32( 0, ( const uint8_t* )h, HEADER_LEN - sizeof( h->crc ) );
+}
+
+/*
+    the sequence number of the sector is part of every record, the leftovers of an older use of the sector don't match
+*/
+static uint32_t record_crc_begin( uint32_t seq, const struct record* r )
+{
+    uint32_t crc = lorawan_crc32( 0, ( const uint8_t* )&seq, sizeof( seq ) );
+    crc = lorawan_crc32( crc, ( const uint8_t* )&r->addr, sizeof( r->addr ) );
+    return lorawan_crc32( crc, ( const uint8_t* )&r->len, sizeof( r->len ) );
+}
+
+static uint32_t sector_offset( const struct eeprom_journal* j, uint8_t sector )
+{
+    return ( uint32_t )sector * j->flash->sector_size;
+}
+
+static void writer_init( struct writer* w, struct eeprom_journal* j )
+{
+    w->j = j;
+    w->staged = false;
+    w->rslt = 0;
+}
+
+static void writer_commit_page( struct writer* w )
+{
+    if (w->staged && w->rslt == 0) {
+        if (w->j->flash->prog( w->page_offset, w->page, w->j->flash->page_size ) < 0) {
+            w->rslt = EEPROM_JOURNAL_E_FLASH;
+        }
+    }
+    w->staged = false;
+}
+
+static void writer_put( struct writer* w, uint32_t offset, const void* data, uint32_t len )
+{
+    const uint8_t* src = data;
+    uint32_t page_size = w->j->flash->page_size;
+
+    while (len > 0) {
+        uint32_t page_offset = offset - offset % page_size;
+        if (!w->staged || page_offset != w->page_offset) {
+            writer_commit_page( w );
+            memset( w->page, 0xFF, page_size );
+            w->page_offset = page_offset;
+            w->staged = true;
+        }
+        uint32_t n = page_size - offset % page_size;
+        if (n > len) {
+            n = len;
+        }
+        memcpy( &w->page[offset % page_size], src, n );
+        src += n;
+        offset += n;
+        len -= n;
+    }
+}
+
+/**
+ * @brief stages a record of the image, the data comes from the image in RAM
+ *
+ * @return uint32_t offset after the record
+ */
+static uint32_t writer_record( struct writer* w, uint32_t offset, uint32_t seq, uint16_t addr, uint16_t len )
+{
+    struct record r = { .addr = addr, .len = len };
+    r.crc = record_crc_begin( seq, &r );
+    if (addr != COMMIT_ADDR) {
+        r.crc = lorawan_crc32( r.crc, &w->j->image[addr], len );
+    }
+    writer_put( w, offset, &r, RECORD_LEN );
+    if (addr != COMMIT_ADDR && len > 0) {
+        writer_put( w, offset + RECORD_LEN, &w->j->image[addr], len );
+    }
+    return offset + RECORD_LEN + ALIGN4( len );
+}
+
+/**
+ * @brief reads and checks the record at offset, the data is not applied
+ *
+ * @return int 1 for a data record, 2 for a commit, 0 for erased flash, -1 for anything else
+ */
+static int check_record( struct eeprom_journal* j, uint32_t base, uint32_t offset, uint32_t seq, struct record* r )
+{
+    uint8_t chunk[32];
+
+    if (offset + RECORD_LEN > j->flash->sector_size) {
+        return -1;
+    }
+    if (j->flash->read( base + offset, r, RECORD_LEN ) < 0) {
+        return -1;
+    }
+    if (r->addr == ERASED_ADDR && r->len == 0xFFFF && r->crc == 0xFFFFFFFF) {
+        return 0;
+    }
+    uint32_t crc = record_crc_begin( seq, r );
+    if (r->addr == COMMIT_ADDR) {
+        return ( r->len == 0 && r->crc == crc ) ? 2 : -1;
+    }
+    if (( uint32_t )r->addr + r->len > j->size || offset + RECORD_LEN + ALIGN4( r->len ) > j->flash->sector_size) {
+        return -1;
+    }
+    for (uint16_t done = 0; done < r->len;) {
+        uint16_t n = r->len - done;
+        if (n > sizeof( chunk )) {
+            n = sizeof( chunk );
+        }
+        if (j->flash->read( base + offset + RECORD_LEN + done, chunk, n ) < 0) {
+            return -1;
+        }
+        crc = lorawan_crc32( crc, chunk, n );
+        done += n;
+    }
+    return crc == r->crc ? 1 : -1;
+}
+
+/**
+ * @brief replays a sector, a flush is applied only once its commit has been found
+ *
+ * @return int 0 if the sector holds a complete snapshot, -1 otherwise
+ */
+static int replay( struct eeprom_journal* j, uint8_t sector, uint32_t seq )
+{
+    uint32_t base = sector_offset( j, sector );
+    uint32_t offset = HEADER_LEN;
+    bool snapshot = false;
+    struct record r;
+
+    memset( j->image, 0xFF, j->size );
+    j->used = 0;
+
+    while (true) {
+        // first pass, the flush must be complete
+        uint32_t end = offset;
+        int kind;
+        while (( kind = check_record( j, base, end, seq, &r ) ) == 1) {
+            end += RECORD_LEN + ALIGN4( r.len );
+        }
+        if (kind != 2) {
+            break;
+        }
+        // second pass, the records are applied
+        while (offset < end) {
+            check_record( j, base, offset, seq, &r );
+            if (j->flash->read( base + offset + RECORD_LEN, &j->image[r.addr], r.len ) < 0) {
+                return -1;
+            }
+            if (r.len > 0 && r.addr + r.len > j->used) {
+                j->used = r.addr + r.len;
+            }
+            offset += RECORD_LEN + ALIGN4( r.len );
+        }
+        offset = end + RECORD_LEN;
+        snapshot = true;
+    }
+    if (!snapshot) {
+        return -1;
+    }
+
+    j->active = true;
+    j->sector = sector;
+    j->seq = seq;
+    j->head = offset;
+
+    // anything but erased flash after the last commit is a flush cut by a power loss, nothing can be appended to it
+    j->rotate = false;
+    uint8_t chunk[32];
+    for (uint32_t pos = offset; pos < j->flash->sector_size && !j->rotate; pos += sizeof( chunk )) {
+        uint32_t n = j->flash->sector_size - pos;
+        if (n > sizeof( chunk )) {
+            n = sizeof( chunk );
+        }
+        if (j->flash->read( base + pos, chunk, n ) < 0) {
+            j->rotate = true;
+            break;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            if (chunk[i] != 0xFF) {
+                j->rotate = true;
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+int eeprom_journal_mount( struct eeprom_journal* j, const struct eeprom_journal_flash* flash, uint8_t* image, uint16_t size )
+{
+    struct header h[EEPROM_JOURNAL_MAX_SECTORS];
+    bool valid[EEPROM_JOURNAL_MAX_SECTORS];
+
+    if (flash->sectors == 0 || flash->sectors > EEPROM_JOURNAL_MAX_SECTORS || flash->page_size > EEPROM_JOURNAL_MAX_PAGE) {
+        return EEPROM_JOURNAL_E_FLASH;
+    }
+
+    j->flash = flash;
+    j->image = image;
+    j->size = size > EEPROM_JOURNAL_MAX_SIZE ? EEPROM_JOURNAL_MAX_SIZE : size;
+    j->used = 0;
+    j->active = false;
+    j->rotate = false;
+    j->sector = flash->sectors - 1;
+    j->seq = 0;
+    j->last_seq = 0;
+    j->head = 0;
+    j->erases = 0;
+    j->flushes = 0;
+    memset( j->dirty, 0, sizeof( j->dirty ) );
+
+    for (uint8_t s = 0; s < flash->sectors; s++) {
+        valid[s] = flash->read( sector_offset( j, s ), &h[s], HEADER_LEN ) == 0 && h[s].magic == JOURNAL_MAGIC
+                    && h[s].crc == header_crc( &h[s] ) && h[s].size == j->size;
+        if (valid[s] && ( int32_t )( h[s].seq - j->last_seq ) > 0) {
+            j->last_seq = h[s].seq;
+        }
+    }
+
+    // newest sector first, a sector whose snapshot was cut by a power loss falls back to the previous one
+    while (true) {
+        int best = -1;
+        for (uint8_t s = 0; s < flash->sectors; s++) {
+            if (valid[s] && ( best < 0 || ( int32_t )( h[s].seq - h[best].seq ) > 0 )) {
+                best = s;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        valid[best] = false;
+        if (replay( j, best, h[best].seq ) == 0) {
+            return j->used;
+        }
+    }
+
+    memset( j->image, 0xFF, j->size );
+    j->used = 0;
+    return 0;
+}
+
+int eeprom_journal_write( struct eeprom_journal* j, uint16_t addr, const uint8_t* data, uint16_t size )
+{
+    if (( uint32_t )addr + size > j->size) {
+        return -1;
+    }
+    for (uint16_t i = 0; i < size; i++) {
+        uint16_t a = addr + i;
+        if (j->image[a] != data[i]) {
+            j->image[a] = data[i];
+            j->dirty[a / 8] |= 1u << ( a % 8 );
+            if (a >= j->used) {
+                j->used = a + 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static bool is_dirty( const struct eeprom_journal* j, uint16_t a )
+{
+    return j->dirty[a / 8] & ( 1u << ( a % 8 ) );
+}
+
+/**
+ * @brief finds the next run of changed bytes, runs closer than RUN_GAP are joined
+ *
+ * @return bool false when there are no more runs
+ */
+static bool next_run( const struct eeprom_journal* j, uint16_t* addr, uint16_t* len )
+{
+    uint16_t a = *addr + *len;
+    while (a < j->used && !is_dirty( j, a )) {
+        a++;
+    }
+    if (a >= j->used) {
+        return false;
+    }
+    uint16_t end = a + 1;
+    uint16_t clean = 0;
+    for (uint16_t b = end; b < j->used && clean <= RUN_GAP; b++) {
+        if (is_dirty( j, b )) {
+            end = b + 1;
+            clean = 0;
+        } else {
+            clean++;
+        }
+    }
+    *addr = a;
+    *len = end - a;
+    return true;
+}
+
+/**
+ * @brief erases the next sector and writes the whole image in it, the active sector is left untouched
+ */
+static int rotate( struct eeprom_journal* j )
+{
+    uint32_t len = HEADER_LEN + ( j->used > 0 ? RECORD_LEN + ALIGN4( j->used ) : 0 ) + RECORD_LEN;
+    if (len > j->flash->sector_size) {
+        return EEPROM_JOURNAL_E_TOO_BIG;
+    }
+
+    // round robin, before the first snapshot the journal starts from sector 0
+    uint8_t sector = ( j->sector + 1 ) % j->flash->sectors;
+    uint32_t base = sector_offset( j, sector );
+    struct header h = {
+        .magic = JOURNAL_MAGIC,
+        .seq = j->last_seq + 1,
+        .size = j->size,
+        .reserved = 0,
+    };
+    h.crc = header_crc( &h );
+
+    j->erases++;
+    if (j->flash->erase( base ) < 0) {
+        return EEPROM_JOURNAL_E_FLASH;
+    }
+    // the sequence number is taken even if the snapshot doesn't make it
+    j->last_seq = h.seq;
+
+    struct writer w;
+    writer_init( &w, j );
+    writer_put( &w, base, &h, HEADER_LEN );
+    uint32_t offset = HEADER_LEN;
+    if (j->used > 0) {
+        offset = writer_record( &w, base + offset, h.seq, 0, j->used ) - base;
+    }
+    offset = writer_record( &w, base + offset, h.seq, COMMIT_ADDR, 0 ) - base;
+    writer_commit_page( &w );
+    if (w.rslt < 0) {
+        return w.rslt;
+    }
+
+    j->active = true;
+    j->rotate = false;
+    j->sector = sector;
+    j->seq = h.seq;
+    j->head = offset;
+    return ( int )len;
+}
+
+int eeprom_journal_flush( struct eeprom_journal* j )
+{
+    uint16_t addr = 0;
+    uint16_t len = 0;
+    uint32_t needed = 0;
+
+    while (next_run( j, &addr, &len )) {
+        needed += RECORD_LEN + ALIGN4( len );
+    }
+    if (needed == 0) {
+        return 0;
+    }
+    needed += RECORD_LEN;
+
+    int rslt;
+    if (!j->active || j->rotate || j->head + needed > j->flash->sector_size) {
+        rslt = rotate( j );
+    } else {
+        uint32_t base = sector_offset( j, j->sector );
+        uint32_t offset = base + j->head;
+        struct writer w;
+        writer_init( &w, j );
+        addr = 0;
+        len = 0;
+        while (next_run( j, &addr, &len )) {
+            offset = writer_record( &w, offset, j->seq, addr, len );
+        }
+        offset = writer_record( &w, offset, j->seq, COMMIT_ADDR, 0 );
+        writer_commit_page( &w );
+        rslt = w.rslt;
+        if (rslt == 0) {
+            j->head = offset - base;
+            rslt = ( int )needed;
+        } else {
+            // whatever reached the flash is not clean anymore
+            j->rotate = true;
+        }
+    }
+    if (rslt > 0) {
+        memset( j->dirty, 0, sizeof( j->dirty ) );
+        j->flushes++;
+    }
+    return rslt;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file eeprom-journal.h
+ * @brief log-structured store behind the emulated EEPROM of the LoRaMac context. The image lives in RAM,
+ *          a flush appends only the bytes changed since the previous flush to the active sector of the journal.
+ *          When the active sector is full the journal moves to the next sector of the region, round robin,
+ *          erases it and writes a snapshot of the image followed by a commit record, the old sector is left
+ *          as it is until its turn comes again. Every sector gets the same number of erases and a sector is
+ *          erased once every few dozens of flushes instead of at every flush.
+ *
+ *          sector: | header (16) | snapshot record | commit | delta records | commit | delta records | commit | erased |
+ *          record: | addr (2) | len (2) | crc (4) | data (len, padded to 4) |
+ *
+ *          every flush is closed by a commit record and it is applied at boot only if the commit is there, so the image
+ *          comes back either as before or as after a flush cut by a power loss, never half way. At boot the sector with
+ *          the highest sequence number holding a complete snapshot is replayed up to the last commit.
+ *          The flash is reached through the callbacks of struct eeprom_journal_flash, the same code runs
+ *          on the board and on the host
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef __EEPROM_JOURNAL_H__
+#define __EEPROM_JOURNAL_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*largest image handled, one bit of the dirty map each byte*/
+#define EEPROM_JOURNAL_MAX_SIZE         4096
+/*largest program unit supported*/
+#define EEPROM_JOURNAL_MAX_PAGE         256
+/*largest number of sectors of the region*/
+#define EEPROM_JOURNAL_MAX_SECTORS      16
+
+#define EEPROM_JOURNAL_E_FLASH          (-1)    // the flash callbacks failed
+#define EEPROM_JOURNAL_E_TOO_BIG        (-2)    // the snapshot of the image doesn't fit in a sector
+
+/*
+    flash region of the journal, offsets are relative to the start of the region
+    prog is called with a page aligned offset and a whole page, bytes left at 0xFF are not touched by the program
+*/
+struct eeprom_journal_flash {
+    uint32_t sector_size;
+    uint32_t page_size;
+    uint8_t sectors;
+    int ( *read )( uint32_t offset, void* buffer, uint32_t size );
+    int ( *prog )( uint32_t offset, const void* buffer, uint32_t size );
+    int ( *erase )( uint32_t offset );
+};
+
+struct eeprom_journal {
+    const struct eeprom_journal_flash* flash;
+    uint8_t* image;                                     // image in RAM, size bytes
+    uint16_t size;
+    uint16_t used;                                      // bytes of the image ever written, the rest is 0xFF
+    uint8_t dirty[EEPROM_JOURNAL_MAX_SIZE / 8];         // bytes changed since the last flush
+    bool active;                                        // a sector holds a complete snapshot
+    bool rotate;                                        // the tail of the active sector is not clean, the next flush moves on
+    uint8_t sector;                                     // active sector
+    uint32_t seq;                                       // sequence number of the active sector
+    uint32_t last_seq;                                  // highest sequence number found, the next sector gets the one after
+    uint32_t head;                                      // offset of the next record in the active sector
+    uint32_t erases;                                    // sectors erased since the mount
+    uint32_t flushes;                                   // flushes that wrote something since the mount
+};
+
+/**
+ * @brief rebuilds the image from the journal, an empty or unreadable journal gives an image of 0xFF
+ *
+ * @param j journal
+ * @param flash flash region
+ * @param image buffer of the image
+ * @param size bytes of the image, up to EEPROM_JOURNAL_MAX_SIZE
+ * @return int bytes of the image restored from the flash, 0 if nothing was found, EEPROM_JOURNAL_E_FLASH for a region not supported
+ */
+int eeprom_journal_mount( struct eeprom_journal* j, const struct eeprom_journal_flash* flash, uint8_t* image, uint16_t size );
+
+/**
+ * @brief changes the image in RAM, only the bytes that differ are marked for the next flush
+ *
+ * @param j journal
+ * @param addr first byte
+ * @param data new bytes
+ * @param size bytes to write
+ * @return int 0, -1 if the range is outside the image
+ */
+int eeprom_journal_write( struct eeprom_journal* j, uint16_t addr, const uint8_t* data, uint16_t size );
+
+/**
+ * @brief writes the changed bytes to the flash, moving to a new sector if they don't fit in the active one
+ *
+ * @param j journal
+ * @return int bytes appended to the flash, 0 if nothing changed, EEPROM_JOURNAL_E_* on errors
+ */
+int eeprom_journal_flush( struct eeprom_journal* j );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __EEPROM_JOURNAL_H__
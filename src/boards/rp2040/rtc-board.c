@@ -13,6 +13,9 @@
 static alarm_pool_t* rtc_alarm_pool = NULL;
 static absolute_time_t rtc_timer_context;
 static alarm_id_t last_rtc_alarm_id = -1;
+// offset of SysTime from the calendar time, set by SysTimeSet after a DeviceTimeAns, class B needs it for the beacons
+static uint32_t rtc_bkup_data0 = 0;
+static uint32_t rtc_bkup_data1 = 0;
 
 void RtcInit( void )
 {
@@ -32,8 +35,8 @@ uint32_t RtcGetCalendarTime( uint16_t *milliseconds )
 
 void RtcBkupRead( uint32_t *data0, uint32_t *data1 )
 {
-    *data0 = 0;
-    *data1 = 0;
+    *data0 = rtc_bkup_data0;
+    *data1 = rtc_bkup_data1;
 }
 
 uint32_t RtcGetTimerElapsedTime( void )
@@ -105,6 +108,8 @@ TimerTime_t RtcTick2Ms( uint32_t tick )
 
 void RtcBkupWrite( uint32_t data0, uint32_t data1 )
 {
+    rtc_bkup_data0 = data0;
+    rtc_bkup_data1 = data1;
 }
 
 void RtcProcess( void )
@@ -0,0 +1,89 @@
+/**
+ * @file class-b.c
+ * @brief class B timing, see class-b.h
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <string.h>
+
+#include "class-b.h"
+
+uint16_t class_b_ping_period( uint8_t periodicity )
+{
+    if (periodicity > CLASS_B_MAX_PERIODICITY) {
+        periodicity = CLASS_B_MAX_PERIODICITY;
+    }
+
+    // pingNb = 2^(7 - periodicity) slots in the 4096 of the beacon window
+    return 32 << periodicity;
+}
+
+uint16_t class_b_ping_offset( const uint8_t* rand, uint8_t periodicity )
+{
+    return ( rand[0] + rand[1] * 256 ) % class_b_ping_period(periodicity);
+}
+
+void class_b_ping_block( uint32_t beacon_time_s, uint32_t dev_addr, uint8_t* block )
+{
+    memset(block, 0, 16);
+
+    for (uint8_t i = 0; i < 4; i++) {
+        block[i] = ( beacon_time_s >> ( 8 * i ) ) & 0xFF;
+        block[4 + i] = ( dev_addr >> ( 8 * i ) ) & 0xFF;
+    }
+}
+
+uint32_t class_b_next_ms( uint64_t gps_ms, uint8_t periodicity, uint16_t ping_offset, bool* beacon )
+{
+    uint32_t t = gps_ms % CLASS_B_BEACON_PERIOD_MS;
+    uint32_t period = class_b_ping_period(periodicity);
+
+    // the beacon reserved belongs to the beacon, whose window opens a little before it by the widening of the clock drift
+    if (t < CLASS_B_BEACON_RESERVED_MS) {
+        *beacon = true;
+        return 0;
+    }
+
+    *beacon = false;
+
+    for (uint32_t slot = ping_offset % period; slot < CLASS_B_SLOTS; slot += period) {
+        uint32_t start = CLASS_B_BEACON_RESERVED_MS + slot * CLASS_B_SLOT_MS;
+
+        if (t < start + CLASS_B_SLOT_MS) {
+            return ( t >= start ) ? 0 : start - t;
+        }
+    }
+
+    *beacon = true;
+
+    return CLASS_B_BEACON_PERIOD_MS - t;
+}
+
+uint32_t class_b_worst_latency_ms( uint8_t periodicity )
+{
+    uint32_t period = class_b_ping_period(periodicity);
+
+    // offset 0 puts the last slot at 4096 - period, an offset of period - 1 in the next period the first one at period - 1
+    return CLASS_B_BEACON_PERIOD_MS - CLASS_B_SLOTS * CLASS_B_SLOT_MS + ( 2 * period - 1 ) * CLASS_B_SLOT_MS;
+}
+
+void class_b_report( const struct class_b_power* power, struct class_b_report* reports )
+{
+    for (uint8_t p = 0; p <= CLASS_B_MAX_PERIODICITY; p++) {
+        struct class_b_report* r = &reports[p];
+        uint32_t period = class_b_ping_period(p);
+        // a beacon and CLASS_B_SLOTS / period empty ping slots every beacon period
+        uint64_t rx_us = power->beacon_rx_us + (uint64_t)( CLASS_B_SLOTS / period ) * power->ping_rx_us;
+
+        r->periodicity = p;
+        r->ping_interval_ms = period * CLASS_B_SLOT_MS;
+        r->worst_latency_ms = class_b_worst_latency_ms(p);
+        r->class_b_ua = power->sleep_ua +
+                        (uint32_t)( ( rx_us * power->rx_ua + CLASS_B_BEACON_PERIOD_MS * 500ull ) /
+                                    ( CLASS_B_BEACON_PERIOD_MS * 1000ull ) );
+        // the radio never stops receiving, the latency is the one of the network server alone
+        r->class_c_ua = power->sleep_ua + power->rx_ua;
+    }
+}
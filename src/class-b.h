@@ -0,0 +1,116 @@
+/**
+ * @file class-b.h
+ * @brief class B timing: the beacon every 128 s of GPS time, the ping slots of a node within the beacon window from
+ *          its ping offset, the wait until the next beacon or ping slot so that the application can keep its blocking
+ *          work away from them, and a current model of class B against class C that gives the same worst-case
+ *          downlink latency. The ping offset comes from an AES of the beacon time and the DevAddr, computed by the
+ *          caller. No dependency on the stack, the same code runs on the board and on the host
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef __CLASS_B_H__
+#define __CLASS_B_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*beacon period, a beacon goes out every time the GPS time is a multiple of it*/
+#define CLASS_B_BEACON_PERIOD_MS        128000
+/*beacon reserved, no ping slot right after the beacon*/
+#define CLASS_B_BEACON_RESERVED_MS      2120
+/*beacon guard, no ping slot right before the next beacon*/
+#define CLASS_B_BEACON_GUARD_MS         3000
+/*ping slots of a beacon window*/
+#define CLASS_B_SLOT_MS                 30
+#define CLASS_B_SLOTS                   4096
+/*periodicity 0 opens a slot every second, 7 every 128 s*/
+#define CLASS_B_MAX_PERIODICITY         7
+
+/*
+    currents and windows of the model
+*/
+struct class_b_power {
+    uint32_t sleep_ua;                                  // MCU and radio between two windows, timers running
+    uint32_t rx_ua;                                     // radio receiving, on top of sleep_ua
+    uint32_t beacon_rx_us;                              // beacon window: time on air, window widening and radio wake-up
+    uint32_t ping_rx_us;                                // empty ping slot: symbol timeout and radio wake-up
+};
+
+/*
+    one line of the comparison
+*/
+struct class_b_report {
+    uint8_t periodicity;
+    uint32_t ping_interval_ms;                          // between two ping slots
+    uint32_t worst_latency_ms;                          // longest wait of a downlink for a ping slot
+    uint32_t class_b_ua;                                // average current in class B
+    uint32_t class_c_ua;                                // average current in class C, reachable at any latency
+};
+
+/**
+ * @brief slots between two ping slots
+ *
+ * @param periodicity 0 to CLASS_B_MAX_PERIODICITY as in PingSlotInfoReq
+ * @return uint16_t pingPeriod, 32 to 4096
+ */
+uint16_t class_b_ping_period( uint8_t periodicity );
+
+/**
+ * @brief ping offset of a beacon period
+ *
+ * @param rand the 16 bytes of aes128_encrypt(zero key, beacon time | DevAddr | zero padding)
+ * @param periodicity ping slot periodicity
+ * @return uint16_t slot of the first ping slot in the beacon window
+ */
+uint16_t class_b_ping_offset( const uint8_t* rand, uint8_t periodicity );
+
+/**
+ * @brief the 16 bytes the ping offset is computed from
+ *
+ * @param beacon_time_s GPS time of the beacon that opens the beacon period, seconds
+ * @param dev_addr device address
+ * @param block AES input
+ */
+void class_b_ping_block( uint32_t beacon_time_s, uint32_t dev_addr, uint8_t* block );
+
+/**
+ * @brief wait until the next beacon or ping slot
+ *
+ * @param gps_ms GPS time, milliseconds
+ * @param periodicity ping slot periodicity
+ * @param ping_offset ping offset of the beacon period gps_ms is in
+ * @param beacon set when the next window is the beacon or gps_ms is in the beacon reserved
+ * @return uint32_t milliseconds, 0 inside a ping slot or the beacon reserved
+ */
+uint32_t class_b_next_ms( uint64_t gps_ms, uint8_t periodicity, uint16_t ping_offset, bool* beacon );
+
+/**
+ * @brief longest wait of a downlink for a ping slot, the ping offset changes every beacon period so that a downlink
+ *          that just missed the last slot of a period waits for the guard, the beacon reserved and up to two ping
+ *          intervals less a slot
+ *
+ * @param periodicity ping slot periodicity
+ * @return uint32_t milliseconds
+ */
+uint32_t class_b_worst_latency_ms( uint8_t periodicity );
+
+/**
+ * @brief average current of class B and class C for every periodicity
+ *
+ * @param power currents and windows
+ * @param reports CLASS_B_MAX_PERIODICITY + 1 lines
+ */
+void class_b_report( const struct class_b_power* power, struct class_b_report* reports );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CLASS_B_H__
@@ -0,0 +1,104 @@
+/**
+ * @file clock-sync.c
+ * @brief GPS time of the node between two synchronizations, see clock-sync.h
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <string.h>
+
+#include "clock-sync.h"
+
+void clock_sync_reset( struct clock_sync* cs )
+{
+    memset(cs, 0, sizeof(*cs));
+}
+
+void clock_sync_slept( struct clock_sync* cs, uint32_t slept_ms )
+{
+    cs->slept_ms += slept_ms;
+}
+
+/*
+    drift that may be left in the estimate, an error of resolution_ms at both ends of the summed sleep
+*/
+static uint32_t residual_ppm( const struct clock_sync* cs )
+{
+    if (!cs->drift_known) {
+        return CLOCK_SYNC_PPM_UNKNOWN;
+    }
+
+    uint64_t ppm = 2ull * cs->resolution_ms * 1000000 / cs->slept_sum_ms;
+
+    return ( ppm < CLOCK_SYNC_PPM_FLOOR ) ? CLOCK_SYNC_PPM_FLOOR : (uint32_t)ppm;
+}
+
+uint64_t clock_sync_gps_ms( const struct clock_sync* cs, uint64_t awake_ms )
+{
+    if (!cs->synced) {
+        return 0;
+    }
+
+    int64_t gps_ms = cs->gps_ms + ( awake_ms - cs->awake_ms ) + cs->slept_ms;
+
+    // a drift from a few short sleeps would be the error of the syncs or the temperature of the moment
+    if (cs->drift_known) {
+        gps_ms += (int64_t)cs->slept_ms * cs->drift_ppm / 1000000;
+    }
+
+    return (uint64_t)gps_ms;
+}
+
+void clock_sync_update( struct clock_sync* cs, uint64_t awake_ms, uint64_t gps_ms, uint32_t resolution_ms )
+{
+    if (cs->synced) {
+        int64_t carried = cs->gps_ms + ( awake_ms - cs->awake_ms ) + cs->slept_ms;
+
+        cs->error_ms = (int32_t)( (int64_t)gps_ms - (int64_t)clock_sync_gps_ms(cs, awake_ms) );
+
+        // the error of the sync before is taken back by this one, only the first and the last stay in the sum
+        if (cs->slept_ms > 0) {
+            cs->error_sum_ms += (int64_t)gps_ms - carried;
+            cs->slept_sum_ms += cs->slept_ms;
+            while (cs->slept_sum_ms > CLOCK_SYNC_WINDOW_MS) {
+                cs->error_sum_ms /= 2;
+                cs->slept_sum_ms /= 2;
+            }
+            cs->drift_ppm = (int32_t)( cs->error_sum_ms * 1000000 / (int64_t)cs->slept_sum_ms );
+            cs->drift_known = ( cs->slept_sum_ms >= CLOCK_SYNC_DRIFT_MIN_MS &&
+                                cs->slept_sum_ms * CLOCK_SYNC_PPM_UNKNOWN > 2ull * resolution_ms * 1000000 );
+        }
+    }
+
+    cs->synced = true;
+    cs->awake_ms = awake_ms;
+    cs->gps_ms = gps_ms;
+    cs->slept_ms = 0;
+    cs->resolution_ms = resolution_ms;
+    cs->syncs++;
+}
+
+uint32_t clock_sync_bound_ms( const struct clock_sync* cs )
+{
+    if (!cs->synced) {
+        return UINT32_MAX;
+    }
+
+    uint64_t bound = cs->resolution_ms + ( cs->slept_ms * residual_ppm(cs) + 999999 ) / 1000000;
+
+    return ( bound > UINT32_MAX ) ? UINT32_MAX : (uint32_t)bound;
+}
+
+uint32_t clock_sync_interval_ms( const struct clock_sync* cs, uint32_t accuracy_ms )
+{
+    uint32_t resolution_ms = cs->synced ? cs->resolution_ms : 0;
+
+    if (accuracy_ms <= resolution_ms) {
+        return 0;
+    }
+
+    uint64_t interval = (uint64_t)( accuracy_ms - resolution_ms ) * 1000000 / residual_ppm(cs);
+
+    return ( interval > UINT32_MAX ) ? UINT32_MAX : (uint32_t)interval;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file clock-sync.h
+ * @brief GPS time of the node between two synchronizations with the network. The time of the last sync is carried
+ *          on by the system timer while the node is awake and by the time slept, told by the application, while the
+ *          timer is stopped in deep sleep. The sleep is where the error builds up: the sleep clock, the wake-up and
+ *          the whole seconds of the RTC alarm, so the drift is estimated on the time slept alone, from the errors
+ *          every sync finds. The errors are summed over the sleep of several syncs, the error of a single sync
+ *          (the whole seconds of an AppTimeAns) doesn't add up and the estimate gets better as the node sleeps.
+ *          The drift is used once a day of sleep is summed, so that the heat of the day and the cold of the night
+ *          are both in it, older syncs weigh half once a week of sleep is summed.
+ *          No dependency on the stack, the same code runs on the board and on the host
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef __CLOCK_SYNC_H__
+#define __CLOCK_SYNC_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*drift assumed before it is estimated, the crystal and wake-ups not counted in the time slept*/
+#define CLOCK_SYNC_PPM_UNKNOWN          200
+/*drift left after the estimate, the crystal of the sleep clock changing with the temperature outdoors*/
+#define CLOCK_SYNC_PPM_FLOOR            10
+/*time slept summed before the drift is used, a whole day of temperature in it*/
+#define CLOCK_SYNC_DRIFT_MIN_MS         ( 24ull * 60 * 60 * 1000 )
+/*time slept summed before older syncs weigh half*/
+#define CLOCK_SYNC_WINDOW_MS            ( 7ull * 24 * 60 * 60 * 1000 )
+
+struct clock_sync {
+    bool synced;
+    uint64_t awake_ms;                                  // system timer at the last sync
+    uint64_t gps_ms;                                    // GPS time at the last sync
+    uint64_t slept_ms;                                  // time slept since the last sync
+    uint32_t resolution_ms;                             // of the last sync
+    int64_t error_sum_ms;                               // errors of the syncs with no drift correction
+    uint64_t slept_sum_ms;                              // time slept before those syncs
+    int32_t drift_ppm;                                  // error of the time slept, + when the node wakes up late
+    bool drift_known;                                   // a day of sleep summed and a drift better than CLOCK_SYNC_PPM_UNKNOWN
+    int32_t error_ms;                                   // error found by the last sync, + when the node was behind
+    uint32_t syncs;
+};
+
+/**
+ * @brief forgets the time and the drift
+ *
+ * @param cs clock
+ */
+void clock_sync_reset( struct clock_sync* cs );
+
+/**
+ * @brief counts time slept with the system timer stopped
+ *
+ * @param cs clock
+ * @param slept_ms time slept by the sleep clock
+ */
+void clock_sync_slept( struct clock_sync* cs, uint32_t slept_ms );
+
+/**
+ * @brief sets the time from the network, the error of the time carried on since the last sync updates the drift
+ *
+ * @param cs clock
+ * @param awake_ms system timer
+ * @param gps_ms GPS time given by the network
+ * @param resolution_ms error of the time given, the whole seconds of an AppTimeAns or 1/256 s of a DeviceTimeAns
+ */
+void clock_sync_update( struct clock_sync* cs, uint64_t awake_ms, uint64_t gps_ms, uint32_t resolution_ms );
+
+/**
+ * @brief GPS time
+ *
+ * @param cs clock
+ * @param awake_ms system timer
+ * @return uint64_t milliseconds since 1980-01-06, 0 before the first sync
+ */
+uint64_t clock_sync_gps_ms( const struct clock_sync* cs, uint64_t awake_ms );
+
+/**
+ * @brief longest error of the time now
+ *
+ * @param cs clock
+ * @return uint32_t milliseconds, UINT32_MAX before the first sync
+ */
+uint32_t clock_sync_bound_ms( const struct clock_sync* cs );
+
+/**
+ * @brief time slept between two syncs that keeps the error within accuracy_ms with the drift known so far
+ *
+ * @param cs clock
+ * @param accuracy_ms error allowed
+ * @return uint32_t milliseconds of sleep, 0 if the syncs are not precise enough for accuracy_ms
+ */
+uint32_t clock_sync_interval_ms( const struct clock_sync* cs, uint32_t accuracy_ms );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CLOCK_SYNC_H__
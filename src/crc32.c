@@ -0,0 +1,31 @@
+/**
+ * @file crc32.c
+ * @brief CRC-32, see pico/crc32.h
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include "pico/crc32.h"
+
+// a table per nibble: 64 bytes of flash and fast enough for the few KB checked at a time
+static const uint32_t crc32_nibble[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+uint32_t lorawan_crc32( uint32_t crc, const void* data, uint32_t len )
+{
+    const uint8_t* bytes = data;
+
+    crc = ~crc;
+    while (len-- > 0) {
+        crc = crc32_nibble[( crc ^ *bytes ) & 0x0F] ^ ( crc >> 4 );
+        crc = crc32_nibble[( crc ^ ( *bytes >> 4 ) ) & 0x0F] ^ ( crc >> 4 );
+        bytes++;
+    }
+
+    return ~crc;
+}
@@ -0,0 +1,434 @@
+/**
+ * @file frag-store.c
+ * @brief flash store of the FUOTA files, see frag-store.h
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <string.h>
+
+#include "frag-store.h"
+#include "pico/crc32.h"
+
+#define SLOT_MAGIC              0x53475246  // "FRGS"
+#define SLOT_HEADER_LEN         24
+#define FILE_MAGIC0             'F'
+#define FILE_MAGIC1             'U'
+#define CHUNK                   64
+
+/*commands of the fragmentation package and the bytes after their identifier, DataFragment takes the rest*/
+#define FRAG_PKG_VERSION_REQ            0x00
+#define FRAG_SESSION_STATUS_REQ         0x01
+#define FRAG_SESSION_SETUP_REQ          0x02
+#define FRAG_SESSION_DELETE_REQ         0x03
+#define FRAG_DATA_FRAGMENT              0x08
+#define FRAG_SESSION_SETUP_LEN          10
+
+struct slot_header {
+    uint32_t magic;
+    uint32_t seq;
+    uint8_t kind;
+    uint8_t id;
+    uint16_t reserved;
+    uint32_t size;
+    uint32_t crc;
+    uint32_t header_crc;
+};
+
+static bool bit_get( const uint8_t* map, uint8_t bit )
+{
+    return ( map[bit / 8] >> ( bit % 8 ) ) & 1;
+}
+
+static void bit_set( uint8_t* map, uint8_t bit, bool value )
+{
+    if (value) {
+        map[bit / 8] |= 1 << ( bit % 8 );
+    } else {
+        map[bit / 8] &= ~( 1 << ( bit % 8 ) );
+    }
+}
+
+static uint32_t slot_size( const struct frag_store* s )
+{
+    return s->flash->slot_sectors * s->flash->sector_size;
+}
+
+static uint32_t slot_offset( const struct frag_store* s, uint8_t slot )
+{
+    return slot * slot_size( s );
+}
+
+/*
+    bytes of a file a slot can hold, the slot header takes the first page
+*/
+static uint32_t slot_capacity( const struct frag_store* s )
+{
+    return slot_size( s ) - s->flash->page_size;
+}
+
+static uint32_t header_crc( const struct slot_header* h )
+{
+    return lorawan_crc32( 0, ( const uint8_t* )h, SLOT_HEADER_LEN - sizeof( h->header_crc ) );
+}
+
+/*
+    CRC of size bytes of the flash from offset
+*/
+static int flash_crc( const struct frag_store* s, uint32_t offset, uint32_t size, uint32_t* crc )
+{
+    uint8_t chunk[CHUNK];
+
+    *crc = 0;
+    while (size > 0) {
+        uint32_t n = ( size < CHUNK ) ? size : CHUNK;
+        if (s->flash->read( offset, chunk, n ) < 0) {
+            return FRAG_STORE_E_FLASH;
+        }
+        *crc = lorawan_crc32( *crc, chunk, n );
+        offset += n;
+        size -= n;
+    }
+    return 0;
+}
+
+/*
+    reads and checks the slot header and the data it covers, 1 for a complete file
+*/
+static int slot_check( struct frag_store* s, uint8_t slot, struct frag_store_file* file )
+{
+    struct slot_header h;
+    uint32_t crc;
+
+    if (s->flash->read( slot_offset( s, slot ), &h, SLOT_HEADER_LEN ) < 0) {
+        return FRAG_STORE_E_FLASH;
+    }
+    if (h.magic != SLOT_MAGIC || h.header_crc != header_crc( &h ) ||
+        h.size > slot_capacity( s ) - FRAG_STORE_FILE_HEADER_LEN) {
+        return 0;
+    }
+    // the sequence number is used up even if the data went bad
+    if (h.seq > s->seq) {
+        s->seq = h.seq;
+    }
+
+    file->kind = h.kind;
+    file->id = h.id;
+    file->size = h.size;
+    file->crc = h.crc;
+    file->offset = slot_offset( s, slot ) + s->flash->page_size + FRAG_STORE_FILE_HEADER_LEN;
+    file->seq = h.seq;
+
+    if (flash_crc( s, file->offset, file->size, &crc ) < 0) {
+        return FRAG_STORE_E_FLASH;
+    }
+    return ( crc == h.crc ) ? 1 : 0;
+}
+
+int frag_store_mount( struct frag_store* s, const struct frag_store_flash* flash, uint8_t* cache )
+{
+    memset( s, 0, sizeof( *s ) );
+    s->flash = flash;
+    s->cache = cache;
+    s->cache_sector = -1;
+
+    if (flash->sector_size > FRAG_STORE_MAX_SECTOR || flash->slot_sectors > FRAG_STORE_MAX_SECTORS ||
+        flash->slot_sectors == 0 || flash->page_size < SLOT_HEADER_LEN || flash->sector_size % flash->page_size != 0) {
+        return FRAG_STORE_E_FLASH;
+    }
+
+    for (uint8_t slot = 0; slot < 2; slot++) {
+        struct frag_store_file file;
+        int rslt = slot_check( s, slot, &file );
+
+        if (rslt < 0) {
+            return rslt;
+        }
+        if (rslt == 1 && ( !s->applied || file.seq > s->file.seq )) {
+            s->file = file;
+            s->active = slot;
+            s->applied = true;
+        }
+    }
+
+    return s->applied ? 1 : 0;
+}
+
+int frag_store_begin( struct frag_store* s, uint32_t size )
+{
+    if (size > slot_capacity( s )) {
+        s->receiving = false;
+        return FRAG_STORE_E_TOO_BIG;
+    }
+
+    s->staging = s->applied ? 1 - s->active : 0;
+    s->size = size;
+    s->cache_sector = -1;
+    s->cache_dirty = false;
+    memset( s->written, 0, sizeof( s->written ) );
+    memset( s->blank, 0, sizeof( s->blank ) );
+    s->erases = 0;
+    s->programs = 0;
+    s->receiving = true;
+
+    return 0;
+}
+
+/*
+    writes the cached sector back: erased first unless it is known to be blank, pages left erased are not programmed
+*/
+static int cache_flush( struct frag_store* s )
+{
+    const struct frag_store_flash* f = s->flash;
+
+    if (s->cache_sector < 0 || !s->cache_dirty) {
+        return 0;
+    }
+
+    uint32_t base = slot_offset( s, s->staging ) + s->cache_sector * f->sector_size;
+
+    if (!bit_get( s->blank, s->cache_sector )) {
+        if (f->erase( base ) < 0) {
+            return FRAG_STORE_E_FLASH;
+        }
+        s->erases++;
+    }
+
+    bool blank = true;
+    for (uint32_t page = 0; page < f->sector_size; page += f->page_size) {
+        const uint8_t* p = &s->cache[page];
+        bool erased = true;
+
+        for (uint32_t i = 0; i < f->page_size && erased; i++) {
+            erased = ( p[i] == 0xFF );
+        }
+        if (erased) {
+            continue;
+        }
+        if (f->prog( base + page, p, f->page_size ) < 0) {
+            return FRAG_STORE_E_FLASH;
+        }
+        s->programs++;
+        blank = false;
+    }
+
+    bit_set( s->blank, s->cache_sector, blank );
+    s->cache_dirty = false;
+
+    return 0;
+}
+
+/*
+    brings a sector of the staging slot in the cache, a sector not written in this session comes in erased
+*/
+static int cache_load( struct frag_store* s, uint8_t sector )
+{
+    const struct frag_store_flash* f = s->flash;
+
+    if (s->cache_sector == sector) {
+        return 0;
+    }
+
+    int rslt = cache_flush( s );
+    if (rslt < 0) {
+        return rslt;
+    }
+
+    if (bit_get( s->written, sector )) {
+        if (f->read( slot_offset( s, s->staging ) + sector * f->sector_size, s->cache, f->sector_size ) < 0) {
+            s->cache_sector = -1;
+            return FRAG_STORE_E_FLASH;
+        }
+    } else {
+        // whatever an older file left there is erased with the first flush
+        memset( s->cache, 0xFF, f->sector_size );
+        s->cache_dirty = true;
+    }
+    s->cache_sector = sector;
+
+    return 0;
+}
+
+/*
+    checks a range of the file and gives its offset in the staging slot
+*/
+static int session_range( const struct frag_store* s, uint32_t offset, uint32_t size, uint32_t* slot_pos )
+{
+    if (!s->receiving) {
+        return FRAG_STORE_E_STATE;
+    }
+    if (offset > s->size || size > s->size - offset) {
+        return FRAG_STORE_E_TOO_BIG;
+    }
+    *slot_pos = s->flash->page_size + offset;
+
+    return 0;
+}
+
+int frag_store_write( struct frag_store* s, uint32_t offset, const uint8_t* data, uint32_t size )
+{
+    uint32_t pos;
+    int rslt = session_range( s, offset, size, &pos );
+
+    while (rslt == 0 && size > 0) {
+        uint8_t sector = pos / s->flash->sector_size;
+        uint32_t at = pos % s->flash->sector_size;
+        uint32_t n = s->flash->sector_size - at;
+
+        if (n > size) {
+            n = size;
+        }
+        rslt = cache_load( s, sector );
+        if (rslt < 0) {
+            break;
+        }
+        if (memcmp( &s->cache[at], data, n ) != 0) {
+            memcpy( &s->cache[at], data, n );
+            s->cache_dirty = true;
+        }
+        bit_set( s->written, sector, true );
+        pos += n;
+        data += n;
+        size -= n;
+    }
+
+    return rslt;
+}
+
+int frag_store_read( struct frag_store* s, uint32_t offset, uint8_t* data, uint32_t size )
+{
+    uint32_t pos;
+    int rslt = session_range( s, offset, size, &pos );
+
+    while (rslt == 0 && size > 0) {
+        uint8_t sector = pos / s->flash->sector_size;
+        uint32_t at = pos % s->flash->sector_size;
+        uint32_t n = s->flash->sector_size - at;
+
+        if (n > size) {
+            n = size;
+        }
+        if (sector == s->cache_sector) {
+            memcpy( data, &s->cache[at], n );
+        } else if (!bit_get( s->written, sector )) {
+            memset( data, 0xFF, n );
+        } else if (s->flash->read( slot_offset( s, s->staging ) + pos, data, n ) < 0) {
+            rslt = FRAG_STORE_E_FLASH;
+        }
+        pos += n;
+        data += n;
+        size -= n;
+    }
+
+    return rslt;
+}
+
+int frag_store_commit( struct frag_store* s )
+{
+    uint8_t fh[FRAG_STORE_FILE_HEADER_LEN];
+    struct slot_header h;
+    uint32_t crc;
+    int rslt;
+
+    if (!s->receiving) {
+        return FRAG_STORE_E_STATE;
+    }
+
+    rslt = cache_flush( s );
+    if (rslt == 0) {
+        rslt = ( s->size < FRAG_STORE_FILE_HEADER_LEN ) ? FRAG_STORE_E_FORMAT :
+               frag_store_read( s, 0, fh, FRAG_STORE_FILE_HEADER_LEN );
+    }
+    s->receiving = false;
+    if (rslt < 0) {
+        return rslt;
+    }
+
+    memset( &h, 0, sizeof( h ) );
+    h.magic = SLOT_MAGIC;
+    h.kind = fh[2];
+    h.id = fh[3];
+    h.size = fh[4] | ( fh[5] << 8 ) | ( fh[6] << 16 ) | ( (uint32_t)fh[7] << 24 );
+    h.crc = fh[8] | ( fh[9] << 8 ) | ( fh[10] << 16 ) | ( (uint32_t)fh[11] << 24 );
+
+    if (fh[0] != FILE_MAGIC0 || fh[1] != FILE_MAGIC1 || h.kind == 0 ||
+        h.size > s->size - FRAG_STORE_FILE_HEADER_LEN) {
+        return FRAG_STORE_E_FORMAT;
+    }
+
+    uint32_t data_offset = slot_offset( s, s->staging ) + s->flash->page_size + FRAG_STORE_FILE_HEADER_LEN;
+    if (flash_crc( s, data_offset, h.size, &crc ) < 0) {
+        return FRAG_STORE_E_FLASH;
+    }
+    if (crc != h.crc) {
+        return FRAG_STORE_E_CRC;
+    }
+
+    // the single page program that applies the file, the first page of the slot was left erased for it
+    uint8_t* page = s->cache;
+    h.seq = s->seq + 1;
+    h.header_crc = header_crc( &h );
+    memset( page, 0xFF, s->flash->page_size );
+    memcpy( page, &h, SLOT_HEADER_LEN );
+    s->cache_sector = -1;
+    if (s->flash->prog( slot_offset( s, s->staging ), page, s->flash->page_size ) < 0) {
+        return FRAG_STORE_E_FLASH;
+    }
+    s->programs++;
+
+    s->seq = h.seq;
+    s->active = s->staging;
+    s->applied = true;
+    s->file.kind = h.kind;
+    s->file.id = h.id;
+    s->file.size = h.size;
+    s->file.crc = h.crc;
+    s->file.offset = data_offset;
+    s->file.seq = h.seq;
+
+    return 0;
+}
+
+const struct frag_store_file* frag_store_file( const struct frag_store* s )
+{
+    return s->applied ? &s->file : NULL;
+}
+
+uint32_t frag_store_session_setup( const uint8_t* buffer, uint32_t size, uint16_t max_nb, uint8_t max_size )
+{
+    uint32_t session = 0;
+    uint32_t i = 0;
+
+    while (i < size) {
+        switch (buffer[i++]) {
+        case FRAG_PKG_VERSION_REQ:
+            break;
+        case FRAG_SESSION_STATUS_REQ:
+        case FRAG_SESSION_DELETE_REQ:
+            i++;
+            break;
+        case FRAG_SESSION_SETUP_REQ: {
+            if (size - i < FRAG_SESSION_SETUP_LEN) {
+                return session;
+            }
+            // | FragSession (1) | NbFrag (2, LE) | FragSize (1) | Control (1) | Padding (1) | Descriptor (4) |
+            uint16_t nb = buffer[i + 1] | ( buffer[i + 2] << 8 );
+            uint8_t frag_size = buffer[i + 3];
+            uint8_t algo = ( buffer[i + 4] >> 3 ) & 0x07;
+            // the checks of the package, a refused setup leaves its session and the decoder as they were
+            if (algo == 0 && nb <= max_nb && frag_size <= max_size) {
+                session = (uint32_t)nb * frag_size;
+            }
+            i += FRAG_SESSION_SETUP_LEN;
+            break;
+        }
+        case FRAG_DATA_FRAGMENT:
+        default:
+            // a fragment takes the rest of the frame, the package stops at a command it doesn't know
+            return session;
+        }
+    }
+
+    return session;
+}
@@ -0,0 +1,170 @@
+/**
+ * @file frag-store.h
+ * @brief flash store of the files received over FUOTA: the fragmentation decoder writes and reads the file through it
+ *          straight into a staging slot of the flash, only one sector is held in RAM, and a file is applied by a
+ *          single page program once its CRC is checked. The region has two slots, the applied file stays in one of
+ *          them while the next one is received in the other, so a power loss during a session or during the apply
+ *          leaves the previous file in place.
+ *
+ *          slot: | slot header (page) | file header (12) | data (size) | padding of the last fragment |
+ *          file header: | 'F' 'U' | kind (1) | id (1) | size (4, LE) | CRC-32 of the data (4, LE) |
+ *
+ *          the slot header is programmed last, the slot with the highest sequence number and a good CRC is the applied
+ *          one. Sectors of the staging slot are erased the first time they are written in a session, a sector not
+ *          written yet reads as erased whatever the flash holds.
+ *          The flash is reached through the callbacks of struct frag_store_flash, the same code runs on the board and
+ *          on the host
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef __FRAG_STORE_H__
+#define __FRAG_STORE_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*largest sector handled, the size of the cache*/
+#define FRAG_STORE_MAX_SECTOR           4096
+/*largest number of sectors of a slot*/
+#define FRAG_STORE_MAX_SECTORS          64
+
+#define FRAG_STORE_FILE_HEADER_LEN      12
+
+/*kinds of file*/
+#define FRAG_STORE_KIND_BSEC_CONFIG     1   // BSEC configuration blob, id is the one of bsec_config
+#define FRAG_STORE_KIND_FIRMWARE        2   // firmware image, stored and checked, applying it is up to a bootloader
+
+#define FRAG_STORE_E_FLASH              (-1)    // the flash callbacks failed or the region is not supported
+#define FRAG_STORE_E_TOO_BIG            (-2)    // the file doesn't fit in a slot
+#define FRAG_STORE_E_FORMAT             (-3)    // no file header or a size past the received bytes
+#define FRAG_STORE_E_CRC                (-4)    // the data doesn't match the CRC of the file header
+#define FRAG_STORE_E_STATE              (-5)    // no session open
+
+/*port of the fragmentation package of LoRaMac-node, LmhpFragmentation.c keeps it to itself*/
+#define FRAG_STORE_PORT                 201     // FRAGMENTATION_PORT
+
+/*
+    flash region of the store, two slots of slot_sectors, offsets are relative to the start of the region
+    prog is called with a page aligned offset and a whole page
+*/
+struct frag_store_flash {
+    uint32_t sector_size;
+    uint32_t page_size;
+    uint8_t slot_sectors;
+    int ( *read )( uint32_t offset, void* buffer, uint32_t size );
+    int ( *prog )( uint32_t offset, const void* buffer, uint32_t size );
+    int ( *erase )( uint32_t offset );
+};
+
+/*
+    file applied
+*/
+struct frag_store_file {
+    uint8_t kind;
+    uint8_t id;
+    uint32_t size;
+    uint32_t crc;
+    uint32_t offset;                                    // first byte of the data in the region
+    uint32_t seq;
+};
+
+struct frag_store {
+    const struct frag_store_flash* flash;
+    uint8_t* cache;                                     // one sector of the staging slot
+    bool applied;                                       // file holds the applied file
+    struct frag_store_file file;
+    uint8_t active;                                     // slot of the applied file
+    uint32_t seq;                                       // highest sequence number found
+    bool receiving;                                     // a session writes to the staging slot
+    uint8_t staging;
+    uint32_t size;                                      // bytes of the session, fragments times their size
+    int16_t cache_sector;                               // sector of the staging slot in the cache, -1 for none
+    bool cache_dirty;
+    uint8_t written[FRAG_STORE_MAX_SECTORS / 8];        // sectors of the staging slot written in this session
+    uint8_t blank[FRAG_STORE_MAX_SECTORS / 8];          // sectors known to be erased in the flash
+    uint32_t erases;                                    // sectors erased since the session opened
+    uint32_t programs;                                  // pages programmed since the session opened
+};
+
+/**
+ * @brief finds the applied file
+ *
+ * @param s store
+ * @param flash flash region
+ * @param cache buffer of one sector
+ * @return int 1 if a file is applied, 0 if none, FRAG_STORE_E_FLASH for a region not supported
+ */
+int frag_store_mount( struct frag_store* s, const struct frag_store_flash* flash, uint8_t* cache );
+
+/**
+ * @brief opens a session in the slot that doesn't hold the applied file, an open session is dropped
+ *
+ * @param s store
+ * @param size bytes the decoder is going to write, fragments times their size
+ * @return int 0, FRAG_STORE_E_TOO_BIG
+ */
+int frag_store_begin( struct frag_store* s, uint32_t size );
+
+/**
+ * @brief writes bytes of the file, the same bytes can be written again
+ *
+ * @param s store
+ * @param offset offset in the file
+ * @param data bytes
+ * @param size number of bytes
+ * @return int 0, FRAG_STORE_E_STATE, FRAG_STORE_E_TOO_BIG past the session, FRAG_STORE_E_FLASH
+ */
+int frag_store_write( struct frag_store* s, uint32_t offset, const uint8_t* data, uint32_t size );
+
+/**
+ * @brief reads bytes of the file
+ *
+ * @param s store
+ * @param offset offset in the file
+ * @param data bytes
+ * @param size number of bytes
+ * @return int 0, FRAG_STORE_E_STATE, FRAG_STORE_E_TOO_BIG past the session, FRAG_STORE_E_FLASH
+ */
+int frag_store_read( struct frag_store* s, uint32_t offset, uint8_t* data, uint32_t size );
+
+/**
+ * @brief checks the file of the session and applies it, the session is closed whatever the outcome
+ *
+ * @param s store
+ * @return int 0, FRAG_STORE_E_* otherwise, the applied file doesn't change
+ */
+int frag_store_commit( struct frag_store* s );
+
+/**
+ * @brief size of the session a downlink of the fragmentation package opens: the commands are walked as
+ *          LmhpFragmentation.c does and a FragSessionSetupReq the package accepts gives the size its FragDecoderInit
+ *          writes, to pass to frag_store_begin before the first fragment
+ *
+ * @param buffer payload of a downlink on FRAG_STORE_PORT
+ * @param size number of bytes
+ * @param max_nb largest number of fragments, FRAG_MAX_NB
+ * @param max_size largest fragment, FRAG_MAX_SIZE
+ * @return uint32_t fragments times their size, 0 if the payload holds no session setup or one the package refuses
+ */
+uint32_t frag_store_session_setup( const uint8_t* buffer, uint32_t size, uint16_t max_nb, uint8_t max_size );
+
+/**
+ * @brief applied file
+ *
+ * @param s store
+ * @return const struct frag_store_file* NULL if none
+ */
+const struct frag_store_file* frag_store_file( const struct frag_store* s );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __FRAG_STORE_H__
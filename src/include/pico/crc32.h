@@ -0,0 +1,34 @@
+/**
+ * @file crc32.h
+ * @brief CRC-32 of zlib and IEEE 802.3 (reflected polynomial 0xEDB88320), the one of the EEPROM journal, the
+ *          FUOTA slots, the provisioning record, the state store and the uplink queue.
+ *          No dependency on the stack, the same code runs on the board and on the host
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef _PICO_CRC32_H_
+#define _PICO_CRC32_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief CRC-32 of data, chained over several buffers by passing the result of the previous call
+ *
+ * @param crc 0 to start
+ * @param data bytes
+ * @param len number of bytes
+ * @return uint32_t CRC, 0xCBF43926 for "123456789"
+ */
+uint32_t lorawan_crc32( uint32_t crc, const void* data, uint32_t len );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,62 @@
+/**
+ * @file flash-layout.h
+ * @brief flash taken by the library at the end of the flash, the program grows from the start:
+ *
+ *          | program ... | provisioning (1 sector) | FUOTA slot 0 | FUOTA slot 1 | EEPROM journal | littlefs (256 KB) |
+ *
+ *          littlefs-lib places its filesystem in the last FS_SIZE bytes of the flash by itself, BSEC state and the
+ *          uplink queue live there, nothing else may be in it. The offsets are from the start of the flash, as
+ *          flash_range_erase takes them, XIP_BASE + offset reads them.
+ *          Needs PICO_FLASH_SIZE_BYTES, FLASH_SECTOR_SIZE and FLASH_PAGE_SIZE (hardware/flash.h), and FRAG_MAX_NB and
+ *          FRAG_MAX_SIZE (the FUOTA options of CMakeLists.txt); the host tools define them for the default build
+ *
+ *          Upgrading a board flashed before this layout wipes what the old one stored, nothing is migrated:
+ *          - the LoRaMac context was in the last 4 sectors, now the top of littlefs: the node starts from a blank
+ *            context, an OTAA node joins again and an ABP node restarts its frame counters, which the network server
+ *            refuses until the counters of the device are reset there. Hold the format pin at the first boot so
+ *            littlefs doesn't mount blocks the old journal wrote
+ *          - the provisioning record was at 0x101b5000 in the default build, it is not looked for there any more:
+ *            the node falls back to the keys of its lora-config.h until the image of tools/provision, built for
+ *            the new LORAWAN_PROVISION_OFFSET, is loaded again
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef _PICO_FLASH_LAYOUT_H_
+#define _PICO_FLASH_LAYOUT_H_
+
+// FS_SIZE of pico_hal.c of littlefs-lib, change both together
+#define LORAWAN_FS_SIZE                 ( 256 * 1024 )
+
+// sectors of the wear-leveled journal of the emulated EEPROM, the LoRaMac context
+#ifndef EEPROM_JOURNAL_SECTORS
+#define EEPROM_JOURNAL_SECTORS          4
+#endif
+
+#define EEPROM_JOURNAL_OFFSET           ( PICO_FLASH_SIZE_BYTES - LORAWAN_FS_SIZE - EEPROM_JOURNAL_SECTORS * FLASH_SECTOR_SIZE )
+
+// sectors of a FUOTA slot, the largest file of the decoder and the slot header
+#ifndef LORAWAN_FUOTA_SLOT_SECTORS
+#define LORAWAN_FUOTA_SLOT_SECTORS      ( ( FRAG_MAX_NB * FRAG_MAX_SIZE + FLASH_PAGE_SIZE + FLASH_SECTOR_SIZE - 1 ) / FLASH_SECTOR_SIZE )
+#endif
+
+// the two FUOTA slots
+#ifndef LORAWAN_FUOTA_OFFSET
+#define LORAWAN_FUOTA_OFFSET            ( EEPROM_JOURNAL_OFFSET - 2 * LORAWAN_FUOTA_SLOT_SECTORS * FLASH_SECTOR_SIZE )
+#endif
+
+// provisioning record of the node, written with the image of tools/provision
+#ifndef LORAWAN_PROVISION_OFFSET
+#define LORAWAN_PROVISION_OFFSET        ( LORAWAN_FUOTA_OFFSET - FLASH_SECTOR_SIZE )
+#endif
+
+// nothing may overlap littlefs nor the next region up
+_Static_assert(EEPROM_JOURNAL_OFFSET + EEPROM_JOURNAL_SECTORS * FLASH_SECTOR_SIZE <=
+               PICO_FLASH_SIZE_BYTES - LORAWAN_FS_SIZE, "the EEPROM journal must end before the littlefs region");
+_Static_assert(LORAWAN_FUOTA_OFFSET + 2 * LORAWAN_FUOTA_SLOT_SECTORS * FLASH_SECTOR_SIZE <= EEPROM_JOURNAL_OFFSET,
+               "the FUOTA slots must end before the EEPROM journal");
+_Static_assert(LORAWAN_PROVISION_OFFSET + FLASH_SECTOR_SIZE <= LORAWAN_FUOTA_OFFSET,
+               "the provisioning sector must end before the FUOTA slots");
+
+#endif
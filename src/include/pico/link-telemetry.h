@@ -0,0 +1,109 @@
+/**
+ * @file link-telemetry.h
+ * @brief link quality seen by the node, kept by src/lorawan.c: RSSI and SNR histograms of the downlinks for every
+ *          datarate, uplinks sent at every datarate, downlinks received in each receive window, confirmed uplinks
+ *          acknowledged or not, the margin and the gateways of the last LinkCheckAns and the SNR the node reports in
+ *          its DevStatusAns. The digest packs it in an uplink of a few dozen bytes.
+ *
+ *          digest: | version (1) | acked (2) | missed (2) | rx1 (2) | rx2 (2) | other (2) | link check margin (1) |
+ *                  | gateways (1) | devstatus margin (1) | lowest downlink margin (1) | datarates (1) | blocks |
+ *          block, for every bit of datarates from DR0: | uplinks (1) | RSSI buckets (8) | SNR buckets (8) |
+ *
+ *          counters little endian and saturated, datarates without any sample or that don't fit are left out.
+ *          No dependency on the stack, the same code runs on the board and on the host
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef _PICO_LINK_TELEMETRY_H_
+#define _PICO_LINK_TELEMETRY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LINK_TELEMETRY_VERSION          1
+#define LINK_TELEMETRY_DATARATES        8
+#define LINK_TELEMETRY_BUCKETS          8
+// lower edge of the first bucket and width of the buckets, the first and the last one are open
+#define LINK_TELEMETRY_RSSI_MIN         (-128)      // dBm
+#define LINK_TELEMETRY_RSSI_STEP        12
+#define LINK_TELEMETRY_SNR_MIN          (-20)       // dB
+#define LINK_TELEMETRY_SNR_STEP         4
+// margin not known yet
+#define LINK_TELEMETRY_NO_MARGIN        127
+
+#define LINK_TELEMETRY_HEADER_LEN       16
+#define LINK_TELEMETRY_BLOCK_LEN        (1 + 2 * LINK_TELEMETRY_BUCKETS)
+
+// receive window of a downlink
+#define LINK_TELEMETRY_RX1              0
+#define LINK_TELEMETRY_RX2              1
+#define LINK_TELEMETRY_RX_OTHER         2           // class B and C windows, multicast
+#define LINK_TELEMETRY_SLOTS            3
+
+struct link_telemetry {
+    uint16_t uplinks[LINK_TELEMETRY_DATARATES];
+    uint16_t rssi[LINK_TELEMETRY_DATARATES][LINK_TELEMETRY_BUCKETS];
+    uint16_t snr[LINK_TELEMETRY_DATARATES][LINK_TELEMETRY_BUCKETS];
+    uint16_t rx_hits[LINK_TELEMETRY_SLOTS];         // downlinks received in each window
+    uint16_t acked;                                 // confirmed uplinks acknowledged
+    uint16_t missed;                                // confirmed uplinks without an acknowledgment in the windows
+    int8_t link_check_margin;                       // dB above the demodulation floor at the best gateway
+    uint8_t link_check_gateways;
+    int8_t devstatus_margin;                        // SNR of the last downlink, the margin of the DevStatusAns
+    int8_t min_downlink_margin;                     // lowest SNR above the demodulation floor of its datarate
+};
+
+/**
+ * @brief clears the counters, the margins become unknown
+ */
+void link_telemetry_reset( struct link_telemetry* t );
+
+/**
+ * @brief counts an uplink at the end of its receive windows
+ *
+ * @param t telemetry
+ * @param datarate datarate of the uplink
+ * @param confirmed confirmed uplink
+ * @param acked acknowledged by the network server, for a confirmed uplink
+ */
+void link_telemetry_uplink( struct link_telemetry* t, uint8_t datarate, bool confirmed, bool acked );
+
+/**
+ * @brief counts a downlink
+ *
+ * @param t telemetry
+ * @param datarate datarate of the downlink
+ * @param rssi dBm
+ * @param snr dB
+ * @param slot LINK_TELEMETRY_RX1, LINK_TELEMETRY_RX2 or LINK_TELEMETRY_RX_OTHER
+ * @param snr_floor lowest SNR the datarate demodulates, dB
+ */
+void link_telemetry_downlink( struct link_telemetry* t, uint8_t datarate, int16_t rssi, int8_t snr, uint8_t slot,
+                              int8_t snr_floor );
+
+/**
+ * @brief keeps the answer to a LinkCheckReq
+ */
+void link_telemetry_link_check( struct link_telemetry* t, uint8_t margin, uint8_t gateways );
+
+/**
+ * @brief packs the telemetry in a digest
+ *
+ * @param t telemetry
+ * @param buf buffer
+ * @param max_len room in the buffer
+ * @return int bytes written, 0 if not even the header fits
+ */
+int link_telemetry_digest( const struct link_telemetry* t, uint8_t* buf, uint8_t max_len );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -17,6 +17,9 @@ extern "C" {
 
 #include "LoRaMac.h"
 
+#include "pico/link-telemetry.h"
+#include "pico/provision.h"
+
 struct lorawan_sx12xx_settings {
     struct {
         spi_inst_t* inst;
@@ -31,11 +34,20 @@ struct lorawan_sx12xx_settings {
     uint dio1;
 };
 
+// single-channel gateway: every uplink on one frequency at one datarate, ADR off, see lorawan_set_single_channel
+struct lorawan_single_channel {
+    uint32_t frequency;                 // Hz, a default channel of the region to join over the air
+    int8_t datarate;                    // datarate of the uplinks and of the join requests
+    uint32_t rx2_frequency;             // Hz, 0 to answer in RX2 on the uplink frequency and datarate
+    int8_t rx2_datarate;                // datarate of RX2 when rx2_frequency is set
+};
+
 struct lorawan_abp_settings {
     const char* device_address;
     const char* network_session_key;
     const char* app_session_key;
     const char* channel_mask;
+    const struct lorawan_single_channel* single_channel;   // NULL for every channel of the region
 };
 
 struct lorawan_otaa_settings {
@@ -43,16 +55,76 @@ struct lorawan_otaa_settings {
     const char* app_eui;
     const char* app_key;
     const char* channel_mask;
+    const struct lorawan_single_channel* single_channel;   // NULL for every channel of the region
+};
+
+// outcome of the last confirmed uplink, returned by lorawan_confirmed_status
+#define LORAWAN_CONFIRMED_NONE          0   // no confirmed uplink sent yet
+#define LORAWAN_CONFIRMED_PENDING       1   // waiting for the end of the receive windows
+#define LORAWAN_CONFIRMED_ACK           2   // acknowledged by the network server
+#define LORAWAN_CONFIRMED_NACK          3   // no acknowledgment received
+
+// how lorawan_init brought the session up, returned by lorawan_session_state
+#define LORAWAN_SESSION_NEW             0   // no usable context in the NVM, the node activates from scratch
+#define LORAWAN_SESSION_RESTORED        1   // the stored session goes on, no join needed
+#define LORAWAN_SESSION_MISMATCH        2   // the stored context was for another region or other keys, it was erased
+
+// class B progress, returned by lorawan_class_b_state
+#define LORAWAN_CLASS_B_OFF             0   // class A or C, class B not asked for
+#define LORAWAN_CLASS_B_ACQUIRING       1   // DeviceTimeReq, beacon search and PingSlotInfoReq in progress
+#define LORAWAN_CLASS_B_ON              2   // beacon locked, the ping slots are open
+#define LORAWAN_CLASS_B_LOST            3   // no beacon for two hours, back in class A until the next acquisition
+
+// kind of a file received over FUOTA, the first bytes of the file tell it
+#define LORAWAN_FUOTA_BSEC_CONFIG       1   // BSEC configuration blob, id is the one of the bsec_config registry
+#define LORAWAN_FUOTA_FIRMWARE          2   // firmware image, checked and kept in flash, a bootloader has to apply it
+
+// downlinks kept until the application consumes them, a downlink arriving with the queue full is dropped
+#ifndef LORAWAN_DOWNLINK_QUEUE_LEN
+#define LORAWAN_DOWNLINK_QUEUE_LEN      4
+#endif
+
+// uplinks waiting in lorawan_send_queued for the duty cycle
+#ifndef LORAWAN_TX_QUEUE_LEN
+#define LORAWAN_TX_QUEUE_LEN            2
+#endif
+
+// largest application payload of a downlink
+#define LORAWAN_DOWNLINK_MAX_SIZE       242
+
+// file applied by the last FUOTA session, the data stays in flash until the next file is applied
+struct lorawan_fuota_file {
+    uint8_t kind;                       // LORAWAN_FUOTA_*
+    uint8_t id;
+    uint32_t size;
+    const uint8_t* data;                // memory mapped flash
+};
+
+struct lorawan_downlink {
+    uint32_t time_ms;                   // milliseconds since boot at the reception
+    int16_t rssi;                       // dBm
+    int8_t snr;                         // dB
+    uint8_t port;
+    uint8_t size;
+    uint8_t data[LORAWAN_DOWNLINK_MAX_SIZE];
 };
 
 const char* lorawan_default_dev_eui(char* dev_eui);
 
+// -1 for a region left out of PICO_LORAWAN_REGIONS, before anything stored is touched
 int lorawan_init(const struct lorawan_sx12xx_settings* sx12xx_settings, LoRaMacRegion_t region);
 
 int lorawan_init_abp(const struct lorawan_sx12xx_settings* sx12xx_settings, LoRaMacRegion_t region, const struct lorawan_abp_settings* abp_settings);
 
 int lorawan_init_otaa(const struct lorawan_sx12xx_settings* sx12xx_settings, LoRaMacRegion_t region, const struct lorawan_otaa_settings* otaa_settings);
 
+// record of the provisioning sector of the flash, NULL if it holds none or one that fails its CRC
+const struct provision_record* lorawan_provision_flash();
+
+// activation, keys, region and radio parameters of a record, from lorawan_provision_flash or built at compile time,
+// nothing is parsed. -1 if the record is not of this version
+int lorawan_init_provisioned(const struct lorawan_sx12xx_settings* sx12xx_settings, const struct provision_record* record);
+
 int lorawan_join();
 
 int lorawan_join_C();
@@ -65,10 +137,101 @@ int lorawan_process_timeout_ms(uint32_t timeout_ms);
 
 int lorawan_send_unconfirmed(const void* data, uint8_t data_len, uint8_t app_port);
 
+int lorawan_send_confirmed(const void* data, uint8_t data_len, uint8_t app_port);
+
+int lorawan_send_queued(const void* data, uint8_t data_len, uint8_t app_port, bool confirmed);
+
+int lorawan_send_pending();
+
+uint32_t lorawan_next_tx_possible_ms();
+
+uint32_t lorawan_airtime_ms();
+
+// the system timer stops in deep sleep, the time slept counts for the duty cycle
+void lorawan_sleep_elapsed_ms(uint32_t sleep_ms);
+
+int lorawan_confirmed_status();
+
+int lorawan_max_payload_size();
+
+int lorawan_set_datarate(int8_t datarate);
+
+// moves the node to a single-channel gateway, the channel mask and the datarate set by the network are put back
+// after every downlink, NULL goes back to the channels of the region with ADR on
+int lorawan_set_single_channel(const struct lorawan_single_channel* single_channel);
+
+// current single-channel setup, NULL when every channel of the region is used
+const struct lorawan_single_channel* lorawan_single_channel();
+
 int lorawan_receive(void* data, uint8_t data_len, uint8_t* app_port);
 
+const struct lorawan_downlink* lorawan_downlink_peek();
+
+void lorawan_downlink_consume();
+
+int lorawan_downlink_pending();
+
+uint32_t lorawan_downlink_overflows();
+
 void lorawan_debug(bool debug);
 
+int lorawan_session_state();
+
+uint32_t lorawan_first_uplink_ms();
+
+int lorawan_join_attempts();
+
+uint32_t lorawan_join_time_ms();
+
+// link quality since the last digest, see pico/link-telemetry.h
+const struct link_telemetry* lorawan_link_telemetry();
+
+// packs the link telemetry in data and starts a new period, returns the length or 0 if data_len is too small
+int lorawan_link_digest(uint8_t* data, uint8_t data_len);
+
+// queues an unconfirmed digest on app_port every so many uplinks with a LinkCheckReq, 0 uplinks turns it off
+void lorawan_link_digest_every(uint16_t uplinks, uint8_t app_port);
+
+// asks the network server for a LinkCheckAns with the next uplink
+int lorawan_link_check();
+
+// asks for class B once joined, a ping slot every 2^ping_slot_periodicity seconds (0 to 7), a lost beacon
+// brings the node back to class A and a new acquisition is tried later, -1 if the stack has no class B
+int lorawan_request_class_b(uint8_t ping_slot_periodicity);
+
+// one of LORAWAN_CLASS_B_*
+int lorawan_class_b_state();
+
+// milliseconds until the next beacon or ping slot, 0 inside a ping slot, UINT32_MAX out of class B.
+// The stack opens the windows from its timers in lorawan_process, blocking work must end before them
+uint32_t lorawan_class_b_next_ms();
+
+// file applied by the last FUOTA session, NULL if none was ever received
+const struct lorawan_fuota_file* lorawan_fuota_file();
+
+// number of files applied since lorawan_init, a change means lorawan_fuota_file has a new file
+uint32_t lorawan_fuota_applied();
+
+// GPS time from the network in milliseconds since 1980-01-06, carried across deep sleep with the time told by
+// lorawan_sleep_elapsed_ms and a drift estimated at every sync, 0 before the first AppTimeAns or DeviceTimeAns
+uint64_t lorawan_gps_time_ms();
+
+// error of the clock found by the last sync, milliseconds the node was behind (negative when ahead)
+int32_t lorawan_clock_sync_error_ms();
+
+// longest error of lorawan_gps_time_ms now, UINT32_MAX before the first sync
+uint32_t lorawan_clock_sync_bound_ms();
+
+// time slept between two syncs that keeps the error within accuracy_ms with the drift known so far,
+// 0 if the one second of an AppTimeAns is already too coarse
+uint32_t lorawan_clock_sync_interval_ms(uint32_t accuracy_ms);
+
+// asks for the time with an AppTimeReq of the clock synchronization package, it goes out as an uplink on port 202
+int lorawan_clock_sync();
+
+// sends the AppTimeReq on its own from lorawan_process to keep the error within accuracy_ms, 0 turns it off
+void lorawan_clock_sync_accuracy(uint32_t accuracy_ms);
+
 int lorawan_erase_nvm();
 
 #ifdef __cplusplus
@@ -0,0 +1,132 @@
+/**
+ * @file provision.h
+ * @brief provisioning record of a node: the activation, the raw keys and the radio parameters in binary, read by
+ *          src/lorawan.c from a sector of the flash of its own (LORAWAN_PROVISION_OFFSET) or built at compile time
+ *          from the strings of a lora-config.h with PROVISION_HEX_*, so nothing is parsed at boot.
+ *
+ *          record, 104 bytes, little endian:
+ *          | magic (4) | version (2) | size (2) | flags (1) | region (1) | datarate (1) | rx2 datarate (1) |
+ *          | DevEUI (8) | JoinEUI (8) | AppKey (16) | DevAddr (4) | NwkSKey (16) | AppSKey (16) |
+ *          | channel mask (6 x 2) | frequency (4) | rx2 frequency (4) | CRC-32 of the bytes before (4) |
+ *
+ *          EUIs and keys are in the order of the hex strings, most significant byte first, as the MIB takes them.
+ *          size is the one of the writer: a newer version may only grow the record, the fields of this one stay.
+ *          tools/provision writes a record per device as a UF2 image of the sector.
+ *          No dependency on the stack, the same code runs on the board and on the host
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef _PICO_PROVISION_H_
+#define _PICO_PROVISION_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PROVISION_MAGIC                 0x564f5250  // "PROV"
+#define PROVISION_VERSION               1
+
+// flags
+#define PROVISION_OTAA                  0x01        // join over the air with DevEUI, JoinEUI and AppKey
+#define PROVISION_DEV_ADDR              0x02        // ABP with DevAddr, a random address without it
+#define PROVISION_CHANNEL_MASK          0x04        // channel mask instead of the default one of the region
+#define PROVISION_SINGLE_CHANNEL        0x08        // single-channel gateway, see struct lorawan_single_channel
+
+#define PROVISION_E_EMPTY               (-1)        // no record, an erased sector or something else
+#define PROVISION_E_VERSION             (-2)        // a record of another version
+#define PROVISION_E_CRC                 (-3)        // the record doesn't match its CRC
+
+struct provision_record {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    uint8_t flags;                      // PROVISION_*
+    uint8_t region;                     // LoRaMacRegion_t
+    int8_t datarate;                    // single-channel datarate
+    int8_t rx2_datarate;                // single-channel RX2 datarate, when rx2_frequency is set
+    uint8_t dev_eui[8];
+    uint8_t join_eui[8];
+    uint8_t app_key[16];
+    uint32_t dev_addr;
+    uint8_t nwk_s_key[16];
+    uint8_t app_s_key[16];
+    uint16_t channel_mask[6];
+    uint32_t frequency;                 // single-channel frequency, Hz
+    uint32_t rx2_frequency;             // Hz, 0 to answer in RX2 on the uplink frequency and datarate
+    uint32_t crc;
+};
+
+/*
+    a hex string literal of a lora-config.h in binary at compile time, PROVISION_HEX_16(LORAWAN_APP_KEY) initializes
+    a key. The compiler folds them into constants, nothing is left for the node to run, but it can't check the string:
+    a string too short gives wrong bytes without a warning, so the length goes in a _Static_assert next to the record
+    and a placeholder that is not hex is up to the user
+*/
+#define PROVISION_NIBBLE(c)             ( (uint8_t)( ( (c) <= '9' ) ? (c) - '0' : ( ( (c) | 0x20 ) - 'a' + 10 ) ) )
+#define PROVISION_BYTE(s, i)            ( (uint8_t)( ( PROVISION_NIBBLE( (s)[2 * (i)] ) << 4 ) | \
+                                                     PROVISION_NIBBLE( (s)[2 * (i) + 1] ) ) )
+#define PROVISION_HEX_U32(s)            ( ( (uint32_t)PROVISION_BYTE(s, 0) << 24 ) | ( (uint32_t)PROVISION_BYTE(s, 1) << 16 ) | \
+                                          ( (uint32_t)PROVISION_BYTE(s, 2) << 8 ) | PROVISION_BYTE(s, 3) )
+#define PROVISION_HEX_8(s)              { PROVISION_BYTE(s, 0), PROVISION_BYTE(s, 1), PROVISION_BYTE(s, 2), \
+                                          PROVISION_BYTE(s, 3), PROVISION_BYTE(s, 4), PROVISION_BYTE(s, 5), \
+                                          PROVISION_BYTE(s, 6), PROVISION_BYTE(s, 7) }
+#define PROVISION_HEX_16(s)             { PROVISION_BYTE(s, 0), PROVISION_BYTE(s, 1), PROVISION_BYTE(s, 2), \
+                                          PROVISION_BYTE(s, 3), PROVISION_BYTE(s, 4), PROVISION_BYTE(s, 5), \
+                                          PROVISION_BYTE(s, 6), PROVISION_BYTE(s, 7), PROVISION_BYTE(s, 8), \
+                                          PROVISION_BYTE(s, 9), PROVISION_BYTE(s, 10), PROVISION_BYTE(s, 11), \
+                                          PROVISION_BYTE(s, 12), PROVISION_BYTE(s, 13), PROVISION_BYTE(s, 14), \
+                                          PROVISION_BYTE(s, 15) }
+#define PROVISION_MASK_WORD(s, i)       ( (uint16_t)( ( PROVISION_BYTE(s, 2 * (i)) << 8 ) | PROVISION_BYTE(s, 2 * (i) + 1) ) )
+#define PROVISION_HEX_MASK(s)           { PROVISION_MASK_WORD(s, 0), PROVISION_MASK_WORD(s, 1), PROVISION_MASK_WORD(s, 2), \
+                                          PROVISION_MASK_WORD(s, 3), PROVISION_MASK_WORD(s, 4), PROVISION_MASK_WORD(s, 5) }
+
+// magic, version and size of a record initialized at compile time, it gets no CRC
+#define PROVISION_HEADER                .magic = PROVISION_MAGIC, .version = PROVISION_VERSION, \
+                                        .size = sizeof(struct provision_record)
+
+/**
+ * @brief sets magic, version and size and seals the record with its CRC
+ */
+void provision_seal( struct provision_record* r );
+
+/**
+ * @brief checks the magic, the version and the size of a record, not its CRC: a record built at compile time
+ *
+ * @return int 0 or PROVISION_E_EMPTY, PROVISION_E_VERSION
+ */
+int provision_valid( const struct provision_record* r );
+
+/**
+ * @brief checks a record written apart from the firmware, the CRC as well
+ *
+ * @return int 0 or PROVISION_E_*
+ */
+int provision_check( const struct provision_record* r );
+
+/**
+ * @brief converts a hex string of exactly 2 * len digits, most significant byte first
+ *
+ * @param hex string, a NULL one fails
+ * @param out len bytes
+ * @param len bytes expected
+ * @return int 0 or -1 if the string is not 2 * len hex digits
+ */
+int provision_hex( const char* hex, uint8_t* out, uint32_t len );
+
+/**
+ * @brief converts a channel mask of 24 hex digits, 6 words of 16 bits most significant first
+ *
+ * @return int 0 or -1
+ */
+int provision_hex_mask( const char* hex, uint16_t* mask );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,30 @@
+/**
+ * @file join-backoff.c
+ * @brief delay between two OTAA join attempts, see join-backoff.h
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include "join-backoff.h"
+
+void join_backoff_reset( struct join_backoff* b, uint32_t min_ms, uint32_t max_ms )
+{
+    b->min_ms = min_ms;
+    b->max_ms = ( max_ms < min_ms ) ? min_ms : max_ms;
+    b->delay_ms = min_ms;
+    b->attempts = 0;
+}
+
+uint32_t join_backoff_next( struct join_backoff* b, uint32_t duty_cycle_ms, uint32_t random )
+{
+    uint32_t half = b->delay_ms / 2;
+    uint32_t wait = half + random % ( b->delay_ms - half + 1 );
+
+    if (b->attempts < UINT16_MAX) {
+        b->attempts++;
+    }
+    b->delay_ms = ( b->delay_ms > b->max_ms / 2 ) ? b->max_ms : b->delay_ms * 2;
+
+    return ( wait < duty_cycle_ms ) ? duty_cycle_ms : wait;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file join-backoff.h
+ * @brief delay between two OTAA join attempts. The delay starts at min_ms and doubles after every failed attempt up to
+ *          max_ms, each attempt waits a random time between half the delay and the delay so that nodes failing together
+ *          don't retry together. The wait is never shorter than the one asked by the duty cycle of the region.
+ *          No dependency on the stack, the same code runs on the board and on the host
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef __JOIN_BACKOFF_H__
+#define __JOIN_BACKOFF_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+struct join_backoff {
+    uint32_t min_ms;
+    uint32_t max_ms;
+    uint32_t delay_ms;                                  // delay of the next failed attempt, before the jitter
+    uint16_t attempts;                                  // attempts since the last reset
+};
+
+/**
+ * @brief starts over from the shortest delay, at boot and after a join accept
+ *
+ * @param b backoff
+ * @param min_ms delay after the first failed attempt
+ * @param max_ms longest delay
+ */
+void join_backoff_reset( struct join_backoff* b, uint32_t min_ms, uint32_t max_ms );
+
+/**
+ * @brief counts a failed attempt and gives the wait before the next one
+ *
+ * @param b backoff
+ * @param duty_cycle_ms wait asked by the duty cycle of the region, 0 if none
+ * @param random any random number, it picks the wait within the jitter
+ * @return uint32_t milliseconds to wait before the next attempt
+ */
+uint32_t join_backoff_next( struct join_backoff* b, uint32_t duty_cycle_ms, uint32_t random );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __JOIN_BACKOFF_H__
@@ -0,0 +1,126 @@
+/**
+ * @file link-telemetry.c
+ * @brief link quality seen by the node, see pico/link-telemetry.h
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <string.h>
+
+#include "pico/link-telemetry.h"
+
+static void count( uint16_t* counter )
+{
+    if (*counter < UINT16_MAX) {
+        (*counter)++;
+    }
+}
+
+static uint8_t bucket( int16_t value, int16_t min, int16_t step )
+{
+    if (value < min) {
+        return 0;
+    }
+
+    int16_t b = ( value - min ) / step;
+
+    return ( b >= LINK_TELEMETRY_BUCKETS ) ? LINK_TELEMETRY_BUCKETS - 1 : (uint8_t)b;
+}
+
+static uint8_t saturate8( uint16_t value )
+{
+    return ( value > UINT8_MAX ) ? UINT8_MAX : (uint8_t)value;
+}
+
+static void put16( uint8_t* buf, uint16_t value )
+{
+    buf[0] = value & 0xFF;
+    buf[1] = value >> 8;
+}
+
+void link_telemetry_reset( struct link_telemetry* t )
+{
+    memset(t, 0, sizeof(*t));
+    t->link_check_margin = LINK_TELEMETRY_NO_MARGIN;
+    t->devstatus_margin = LINK_TELEMETRY_NO_MARGIN;
+    t->min_downlink_margin = LINK_TELEMETRY_NO_MARGIN;
+}
+
+void link_telemetry_uplink( struct link_telemetry* t, uint8_t datarate, bool confirmed, bool acked )
+{
+    if (datarate < LINK_TELEMETRY_DATARATES) {
+        count(&t->uplinks[datarate]);
+    }
+
+    if (confirmed) {
+        count(acked ? &t->acked : &t->missed);
+    }
+}
+
+void link_telemetry_downlink( struct link_telemetry* t, uint8_t datarate, int16_t rssi, int8_t snr, uint8_t slot,
+                              int8_t snr_floor )
+{
+    if (datarate < LINK_TELEMETRY_DATARATES) {
+        count(&t->rssi[datarate][bucket(rssi, LINK_TELEMETRY_RSSI_MIN, LINK_TELEMETRY_RSSI_STEP)]);
+        count(&t->snr[datarate][bucket(snr, LINK_TELEMETRY_SNR_MIN, LINK_TELEMETRY_SNR_STEP)]);
+    }
+
+    count(&t->rx_hits[( slot < LINK_TELEMETRY_SLOTS ) ? slot : LINK_TELEMETRY_RX_OTHER]);
+
+    // the DevStatusAns carries the SNR of the last downlink, between -32 and 31 dB
+    t->devstatus_margin = ( snr < -32 ) ? -32 : ( snr > 31 ) ? 31 : snr;
+
+    int16_t margin = snr - snr_floor;
+    if (t->min_downlink_margin == LINK_TELEMETRY_NO_MARGIN || margin < t->min_downlink_margin) {
+        t->min_downlink_margin = ( margin >= LINK_TELEMETRY_NO_MARGIN ) ? LINK_TELEMETRY_NO_MARGIN - 1 : (int8_t)margin;
+    }
+}
+
+void link_telemetry_link_check( struct link_telemetry* t, uint8_t margin, uint8_t gateways )
+{
+    t->link_check_margin = ( margin >= LINK_TELEMETRY_NO_MARGIN ) ? LINK_TELEMETRY_NO_MARGIN - 1 : (int8_t)margin;
+    t->link_check_gateways = gateways;
+}
+
+int link_telemetry_digest( const struct link_telemetry* t, uint8_t* buf, uint8_t max_len )
+{
+    if (max_len < LINK_TELEMETRY_HEADER_LEN) {
+        return 0;
+    }
+
+    buf[0] = LINK_TELEMETRY_VERSION;
+    put16(&buf[1], t->acked);
+    put16(&buf[3], t->missed);
+    put16(&buf[5], t->rx_hits[LINK_TELEMETRY_RX1]);
+    put16(&buf[7], t->rx_hits[LINK_TELEMETRY_RX2]);
+    put16(&buf[9], t->rx_hits[LINK_TELEMETRY_RX_OTHER]);
+    buf[11] = (uint8_t)t->link_check_margin;
+    buf[12] = t->link_check_gateways;
+    buf[13] = (uint8_t)t->devstatus_margin;
+    buf[14] = (uint8_t)t->min_downlink_margin;
+    buf[15] = 0;
+
+    int len = LINK_TELEMETRY_HEADER_LEN;
+    for (uint8_t dr = 0; dr < LINK_TELEMETRY_DATARATES; dr++) {
+        bool used = t->uplinks[dr] != 0;
+
+        for (uint8_t b = 0; b < LINK_TELEMETRY_BUCKETS && !used; b++) {
+            used = t->rssi[dr][b] != 0;
+        }
+        if (!used || len + LINK_TELEMETRY_BLOCK_LEN > max_len) {
+            continue;
+        }
+
+        buf[15] |= 1 << dr;
+        buf[len++] = saturate8(t->uplinks[dr]);
+        for (uint8_t b = 0; b < LINK_TELEMETRY_BUCKETS; b++) {
+            buf[len++] = saturate8(t->rssi[dr][b]);
+        }
+        for (uint8_t b = 0; b < LINK_TELEMETRY_BUCKETS; b++) {
+            buf[len++] = saturate8(t->snr[dr][b]);
+        }
+    }
+
+    return len;
+}
@@ -24,23 +24,43 @@
  *
  */
 
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "pico/lorawan.h"
 #include "pico/time.h"
+#include "hardware/flash.h"
 #include "board.h"
 #include "rtc-board.h"
 #include "sx126x-board.h"
 #include "pico/board-config.h"
+#include "pico/flash-layout.h"
 
 #include "../../periodic-uplink-lpp/firmwareVersion.h"
 #include "Commissioning.h"
+#include "Region.h"
 #include "RegionCommon.h"
 #include "LmHandler.h"
 #include "LmhpCompliance.h"
+#include "LmhpClockSync.h"
+#include "LmhpFragmentation.h"
+#include "LmhpRemoteMcastSetup.h"
+#include "FragDecoder.h"
 #include "LmHandlerMsgDisplay.h"
 #include "NvmDataMgmt.h"
+#include "nvmm.h"
+#include "utilities.h"
+#include "eeprom-board.h"
+#include "systime.h"
+#include "aes.h"
+
+#include "join-backoff.h"
+#include "tx-scheduler.h"
+#include "single-channel.h"
+#include "class-b.h"
+#include "frag-store.h"
+#include "clock-sync.h"
 
 /*!
  * LoRaWAN default end-device class
@@ -83,6 +103,60 @@
  */
 #define LORAWAN_PUBLIC_NETWORK                      true
 
+/*!
+ * Frame counters skipped when a session is restored from the NVM
+ *
+ * \remark The counter is stored after the MAC has done with an uplink, a reset in between
+ *         would send the same counter again, the network server drops repeated counters
+ */
+#define LORAWAN_NVM_FCNT_GAP                        32
+
+/*!
+ * Marks the session record stored after the LoRaMac context in the NVM
+ */
+#define LORAWAN_NVM_SESSION_MAGIC                   0x53534E4C
+
+/*!
+ * Wait after the first failed OTAA join attempt, doubled at every failure up to LORAWAN_JOIN_BACKOFF_MAX_MS
+ *
+ * \remark The join accept windows alone take 6 s
+ */
+#define LORAWAN_JOIN_BACKOFF_MIN_MS                 15000
+
+/*!
+ * Longest wait between two OTAA join attempts
+ */
+#define LORAWAN_JOIN_BACKOFF_MAX_MS                 ( 60 * 60 * 1000 )
+
+/*!
+ * Wait after a lost beacon before class B is asked again, doubled at every loss up to LORAWAN_CLASS_B_BACKOFF_MAX_MS
+ *
+ * \remark The stack already went two hours without a beacon, a new acquisition keeps the radio on for a beacon period
+ */
+#define LORAWAN_CLASS_B_BACKOFF_MIN_MS              ( 2 * 60 * 1000 )
+
+#define LORAWAN_CLASS_B_BACKOFF_MAX_MS              ( 4 * 60 * 60 * 1000 )
+
+/*!
+ * Error of the time given by a sync: the AppTimeAns of the clock synchronization package corrects by whole seconds
+ * taken against the reception of an uplink that left before, the DeviceTimeAns of the MAC gives 1/256 s at the end
+ * of the uplink
+ */
+#define LORAWAN_APP_TIME_RESOLUTION_MS              1000
+
+#define LORAWAN_DEVICE_TIME_RESOLUTION_MS           4
+
+/*!
+ * Shortest wait between two AppTimeReq sent for lorawan_clock_sync_accuracy, an answer may never come
+ */
+#define LORAWAN_CLOCK_SYNC_RETRY_MS                 ( 10 * 60 * 1000 )
+
+/*!
+ * FUOTA slots and provisioning record, see pico/flash-layout.h
+ */
+#define LORAWAN_FUOTA_ADDRESS                       ( ( const uint8_t* )( XIP_BASE + LORAWAN_FUOTA_OFFSET ) )
+#define LORAWAN_PROVISION_ADDRESS                   ( ( const struct provision_record* )( XIP_BASE + LORAWAN_PROVISION_OFFSET ) )
+
 /*!
  * User application data
  */
@@ -118,6 +192,11 @@ static void OnTxPeriodicityChanged( uint32_t periodicity );
 static void OnTxFrameCtrlChanged( LmHandlerMsgTypes_t isTxConfirmed );
 static void OnPingSlotPeriodicityChanged( uint8_t pingSlotPeriodicity );
 
+static int32_t OnFragWrite( uint32_t addr, uint8_t* data, uint32_t size );
+static int32_t OnFragRead( uint32_t addr, uint8_t* data, uint32_t size );
+static void OnFragProgress( uint16_t fragCounter, uint16_t fragNb, uint8_t fragSize, uint16_t fragNbLost );
+static void OnFragDone( int32_t status, uint32_t size );
+
 static LmHandlerCallbacks_t LmHandlerCallbacks =
 {
     .GetBatteryLevel = BoardGetBatteryLevel,
@@ -157,6 +236,20 @@ static LmhpComplianceParams_t LmhpComplianceParams =
     .OnPingSlotPeriodicityChanged = OnPingSlotPeriodicityChanged,
 };
 
+/*!
+ * The decoder rebuilds the file in the FUOTA staging slot, only a sector of it is held in RAM
+ */
+static LmhpFragmentationParams_t FragmentationParams =
+{
+    .DecoderCallbacks =
+    {
+        .FragDecoderWrite = OnFragWrite,
+        .FragDecoderRead = OnFragRead,
+    },
+    .OnProgress = OnFragProgress,
+    .OnDone = OnFragDone,
+};
+
 /*!
  * Indicates if LoRaMacProcess call is pending.
  * 
@@ -166,203 +259,1700 @@ static volatile uint8_t IsMacProcessPending = 0;
 
 static volatile uint32_t TxPeriodicity = 0;
 
-static const struct lorawan_abp_settings* AbpSettings = NULL;
+/*!
+ * Activation and keys in binary, from the settings of lorawan_init_abp/lorawan_init_otaa or a provisioning record,
+ * nothing is set up before ProvisionActive
+ */
+static struct provision_record Provision;
 
-static const struct lorawan_otaa_settings* OtaaSettings = NULL;
+static bool ProvisionActive = false;
 
-static uint8_t AppRxDataBuffer[LORAWAN_APP_DATA_BUFFER_MAX_SIZE];
+static struct lorawan_single_channel ProvisionSingleChannel;
 
-static LmHandlerAppData_t AppRxData =
+static bool ProvisionOtaa( void )
 {
-    .Buffer = AppRxDataBuffer,
-    .BufferSize = 0,
-    .Port = 0,
+    return ProvisionActive && ( Provision.flags & PROVISION_OTAA );
+}
+
+/*!
+ * Downlinks not consumed yet, DownlinkHead is the oldest one
+ *
+ * \remark OnRxData runs from LmHandlerProcess, in the same context as the application, no locking is needed.
+ *         When the queue is full the new downlink is dropped, the oldest one may be in use through lorawan_downlink_peek
+ */
+static struct lorawan_downlink DownlinkQueue[LORAWAN_DOWNLINK_QUEUE_LEN];
+
+static uint8_t DownlinkHead = 0;
+
+static uint8_t DownlinkCount = 0;
+
+/*!
+ * Downlinks queued since boot and downlinks dropped because the queue was full
+ */
+static uint32_t DownlinkReceived = 0;
+
+static uint32_t DownlinkOverflows = 0;
+
+/*!
+ * Sub-bands of EU868 and their duty cycle, as in RegionEU868
+ */
+static const struct tx_band Eu868Bands[] =
+{
+    { 865000000, 868000000, 100 },
+    { 868000000, 868600000, 100 },
+    { 868700000, 869200000, 1000 },
+    { 869400000, 869650000, 10 },
+    { 869700000, 870000000, 100 },
+    { 863000000, 865000000, 1000 },
 };
 
+/*!
+ * Time on air spent and time-off of the sub-bands, regions without duty cycle only count the time on air
+ */
+static struct tx_scheduler TxScheduler;
+
+/*!
+ * Time spent with the clocks stopped, as told by lorawan_sleep_elapsed_ms
+ */
+static uint64_t SleptMs = 0;
+
+/*!
+ * Milliseconds since boot before which the MAC refuses to send, from the nextTxIn of a refused request
+ */
+static uint64_t MacTxReadyMs = 0;
+
+/*!
+ * Uplinks waiting for the duty cycle, sent by lorawan_process, TxQueueHead is the oldest one
+ */
+typedef struct TxQueueEntry_s
+{
+    uint8_t Port;
+    uint8_t Size;
+    bool Confirmed;
+    uint8_t Data[LORAWAN_APP_DATA_BUFFER_MAX_SIZE];
+} TxQueueEntry_t;
+
+static TxQueueEntry_t TxQueue[LORAWAN_TX_QUEUE_LEN];
+
+static uint8_t TxQueueHead = 0;
+
+static uint8_t TxQueueCount = 0;
+
+/*!
+ * Outcome of the last confirmed uplink, see LORAWAN_CONFIRMED_*
+ */
+static volatile int ConfirmedStatus = LORAWAN_CONFIRMED_NONE;
+
 static bool Debug = false;
 
+/*!
+ * Session record, written after the LoRaMac context when the NVM is set up for a set of keys
+ */
+typedef struct NvmSessionRecord_s
+{
+    uint32_t Magic;
+    uint32_t Fingerprint;
+    /*!
+     * DevNonce reserved for the next join request, it survives a change of keys and lorawan_erase_nvm
+     * because the network server refuses a DevNonce it has already seen
+     */
+    uint16_t DevNonce;
+    uint16_t Reserved;
+    uint32_t Crc32;
+} NvmSessionRecord_t;
+
+static NvmSessionRecord_t SessionRecord;
+
+/*!
+ * How lorawan_init brought the session up, see LORAWAN_SESSION_*
+ */
+static int SessionState = LORAWAN_SESSION_NEW;
+
+/*!
+ * Set when LmHandlerInit found a valid context in the NVM
+ */
+static bool NvmRestored = false;
+
+/*!
+ * The journal behind the emulated EEPROM has been mounted
+ */
+static bool NvmMounted = false;
+
+/*!
+ * Milliseconds from boot to the first uplink handed to the radio, 0 until then
+ */
+static uint32_t FirstUplinkMs = 0;
+
+/*!
+ * Wait between the OTAA join attempts
+ */
+static struct join_backoff JoinBackoff;
+
+/*!
+ * A join attempt is scheduled at JoinRetryTime
+ */
+static bool JoinRetryPending = false;
+
+static absolute_time_t JoinRetryTime;
+
+/*!
+ * Join attempts since boot
+ */
+static uint16_t JoinAttempts = 0;
+
+/*!
+ * Milliseconds since boot of the first join attempt and from it to the join accept, 0 until then
+ */
+static uint32_t JoinStartMs = 0;
+
+static uint32_t JoinTimeMs = 0;
+
+/*!
+ * Link quality since the last digest
+ */
+static struct link_telemetry LinkTelemetry;
+
+/*!
+ * A digest is queued on LinkDigestPort every LinkDigestEvery uplinks, 0 turns it off
+ */
+static uint16_t LinkDigestEvery = 0;
+
+static uint8_t LinkDigestPort = 0;
+
+static uint16_t LinkDigestUplinks = 0;
+
+/*!
+ * Default channels of the regions with a channel list and grids of the regions with fixed channels, as in the
+ * Region*.h files of LoRaMac-node
+ */
+static const uint32_t Eu868Defaults[] = { 868100000, 868300000, 868500000 };
+static const uint32_t Eu433Defaults[] = { 433175000, 433375000, 433575000 };
+static const uint32_t Cn779Defaults[] = { 779500000, 779700000, 779900000 };
+static const uint32_t In865Defaults[] = { 865062500, 865402500, 865985000 };
+static const uint32_t Kr920Defaults[] = { 922100000, 922300000, 922500000 };
+static const uint32_t As923Defaults[] = { 923200000, 923400000 };
+static const uint32_t Ru864Defaults[] = { 868900000, 869100000 };
+
+static const struct single_channel_plan SingleChannelPlans[] =
+{
+    [LORAMAC_REGION_AS923] = { As923Defaults, 2 },
+    [LORAMAC_REGION_AU915] = { NULL, 0, 915200000, 200000, 64, 915900000, 1600000, 8 },
+    [LORAMAC_REGION_CN470] = { NULL, 0, 470300000, 200000, 96, 0, 0, 0 },
+    [LORAMAC_REGION_CN779] = { Cn779Defaults, 3 },
+    [LORAMAC_REGION_EU433] = { Eu433Defaults, 3 },
+    [LORAMAC_REGION_EU868] = { Eu868Defaults, 3 },
+    [LORAMAC_REGION_KR920] = { Kr920Defaults, 3 },
+    [LORAMAC_REGION_IN865] = { In865Defaults, 3 },
+    [LORAMAC_REGION_US915] = { NULL, 0, 902300000, 200000, 64, 903000000, 1600000, 8 },
+    [LORAMAC_REGION_RU864] = { Ru864Defaults, 2 },
+};
+
+/*!
+ * Single-channel setup in use, see lorawan_set_single_channel
+ */
+static struct lorawan_single_channel SingleChannel;
+
+static bool SingleChannelOn = false;
+
+static struct single_channel_setup SingleChannelSetup;
+
+/*!
+ * A downlink may have carried a LinkADRReq, the setup is checked again in lorawan_process
+ */
+static bool SingleChannelCheck = false;
+
+/*!
+ * Class B progress, see lorawan_request_class_b
+ */
+static int ClassBState = LORAWAN_CLASS_B_OFF;
+
+/*!
+ * Ping slot periodicity the network server accepted
+ */
+static uint8_t ClassBPeriodicity = 0;
+
+/*!
+ * A new class B request is due at ClassBRetryTime, after a lost beacon or a switch from class C
+ */
+static struct join_backoff ClassBBackoff;
+
+static bool ClassBRetryPending = false;
+
+static absolute_time_t ClassBRetryTime;
+
+/*!
+ * Ping offset of the beacon period opened at ClassBBeaconTime, GPS seconds
+ */
+static uint32_t ClassBBeaconTime = UINT32_MAX;
+
+static uint16_t ClassBPingOffset = 0;
+
+/*!
+ * MLME confirm of the compliance package, LmHandler doesn't forward the LinkCheckAns, it is taken in front of it
+ */
+static void ( *ComplianceMlmeConfirm )( MlmeConfirm_t* mlmeConfirm ) = NULL;
+
+/*!
+ * Two slot store of the FUOTA files, the applied one and the one being received
+ */
+static struct frag_store FragStore;
+
+static uint8_t FragStoreCache[FLASH_SECTOR_SIZE];
+
+/*!
+ * Files applied since lorawan_init
+ */
+static uint32_t FuotaApplied = 0;
+
+/*!
+ * Start of the session, to measure the time to reassemble
+ */
+static uint32_t FuotaStartMs = 0;
+
+static struct lorawan_fuota_file FuotaFile;
+
+/*!
+ * GPS time from the syncs with the network, carried across deep sleep
+ */
+static struct clock_sync ClockSync;
+
+/*!
+ * Error kept by the syncs sent on their own, 0 for none
+ */
+static uint32_t ClockSyncAccuracyMs = 0;
+
+/*!
+ * NowMs of the last AppTimeReq sent
+ */
+static uint64_t ClockSyncRequestMs = 0;
+
+static bool ClockSyncRequested = false;
+
 extern void EepromMcuInit();
 extern uint8_t EepromMcuFlush();
 
-const char* lorawan_default_dev_eui(char* dev_eui)
+static void NvmMount( void )
 {
-    uint8_t boardId[8];
+    if (!NvmMounted) {
+        EepromMcuInit();
+        NvmMounted = true;
+    }
+}
 
-    BoardGetUniqueId(boardId);
+static uint32_t Fnv1a( uint32_t hash, const void* data, size_t size )
+{
+    const uint8_t* bytes = data;
 
-    sprintf(
-        dev_eui, "%02X%02X%02X%02X%02X%02X%02X%02X",
-        boardId[0], boardId[1], boardId[2], boardId[3],
-        boardId[4], boardId[5], boardId[6], boardId[7]
-    );
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
 
-    return dev_eui;
+    return hash;
 }
 
-int lorawan_init(const struct lorawan_sx12xx_settings* sx12xx_settings, LoRaMacRegion_t region)
+/*!
+ * Fingerprint of the region, the activation and the keys the context is stored for
+ */
+static uint32_t SessionFingerprint( LoRaMacRegion_t region )
 {
-    EepromMcuInit();
+    uint32_t hash = Fnv1a(2166136261u, &region, sizeof(region));
 
-    RtcInit();
- 
-    Gpio_t gpio_busy;
-    Gpio_t gpio_dio1;
-    Gpio_t gpio_reset;
-    Gpio_t gpio_nss;
+    // the fields from the flags to the single-channel setup, the stored channels and masks follow it
+    if (ProvisionActive) {
+        hash = Fnv1a(hash, "P", 1);
+        hash = Fnv1a(hash, &Provision.flags, offsetof(struct provision_record, crc) -
+                                             offsetof(struct provision_record, flags));
+    }
 
-    Spi_t spi1_t;
+    return hash;
+}
 
-    gpio_busy.pin = RADIO_BUSY;
-    gpio_dio1.pin = RADIO_DIO_1;
-    gpio_reset.pin = RADIO_RESET;
-    gpio_nss.pin = RADIO_NSS;
-    spi1_t.Nss = gpio_nss;
-// raspberry pi pico spi1
-    spi1_t.SpiId = SPI_2;
+/*!
+ * Checks the session record against a fingerprint
+ *
+ * \retval 1 the context was stored for the same keys, 0 there is no record, -1 it was stored for other keys
+ */
+static int SessionRecordCheck( uint32_t fingerprint )
+{
+    NvmSessionRecord_t* record = &SessionRecord;
 
-    SX126x.BUSY = gpio_busy;
-    SX126x.DIO1 = gpio_dio1;
-    SX126x.Reset = gpio_reset;
-    SX126x.Spi = spi1_t;
-    SpiInit( &SX126x.Spi, SPI_2, RADIO_MOSI, RADIO_MISO, RADIO_SCLK, RADIO_NSS );
+    if (EepromMcuReadBuffer(sizeof(LoRaMacNvmData_t), (uint8_t*)record, sizeof(*record)) != SUCCESS ||
+        record->Magic != LORAWAN_NVM_SESSION_MAGIC ||
+        record->Crc32 != Crc32((uint8_t*)record, sizeof(*record) - sizeof(record->Crc32))) {
+        memset(record, 0, sizeof(*record));
+        return 0;
+    }
 
-    SX126x.Spi.Nss.pin = sx12xx_settings->spi.nss;
-    SX126x.Reset.pin = sx12xx_settings->reset;
-    SX126x.DIO1.pin = sx12xx_settings->dio1;
+    return (record->Fingerprint == fingerprint) ? 1 : -1;
+}
+
+static void SessionRecordWrite( uint32_t fingerprint )
+{
+    NvmSessionRecord_t* record = &SessionRecord;
+
+    record->Magic = LORAWAN_NVM_SESSION_MAGIC;
+    record->Fingerprint = fingerprint;
+    record->Reserved = 0;
+    record->Crc32 = Crc32((uint8_t*)record, sizeof(*record) - sizeof(record->Crc32));
+    EepromMcuWriteBuffer(sizeof(LoRaMacNvmData_t), (uint8_t*)record, sizeof(*record));
+}
+
+/*!
+ * DevNonce of the crypto group stored in the NVM, 0 if the group is not valid
+ */
+static uint16_t NvmDevNonce( void )
+{
+    LoRaMacCryptoNvmData_t crypto;
+
+    if (EepromMcuReadBuffer(0, (uint8_t*)&crypto, sizeof(crypto)) != SUCCESS ||
+        crypto.Crc32 != Crc32((uint8_t*)&crypto, sizeof(crypto) - sizeof(crypto.Crc32))) {
+        return 0;
+    }
+
+    return crypto.DevNonce;
+}
+
+static LoRaMacCryptoNvmData_t* SessionCrypto( void )
+{
+    MibRequestConfirm_t mibReq;
+
+    mibReq.Type = MIB_NVM_CTXS;
+    if (LoRaMacMibGetRequestConfirm( &mibReq ) != LORAMAC_STATUS_OK) {
+        return NULL;
+    }
+
+    return &mibReq.Param.Contexts->Crypto;
+}
+
+/*!
+ * Writes a crypto group changed here back to the NVM at once, the stack would store it only after its next request
+ */
+static void SessionCryptoStore( LoRaMacCryptoNvmData_t* crypto )
+{
+    crypto->Crc32 = Crc32((uint8_t*)crypto, sizeof(LoRaMacCryptoNvmData_t) - sizeof(crypto->Crc32));
+    NvmmWrite((uint8_t*)crypto, sizeof(LoRaMacCryptoNvmData_t), 0);
+    EepromMcuFlush();
+}
+
+/*!
+ * Moves the uplink counter of a restored session past the ones that may have been sent
+ * without being stored
+ */
+static void SessionAdvanceCounters( void )
+{
+    LoRaMacCryptoNvmData_t* crypto = SessionCrypto();
+
+    if (crypto != NULL) {
+        crypto->FCntList.FCntUp += LORAWAN_NVM_FCNT_GAP;
+        SessionCryptoStore(crypto);
+    }
+}
+
+/*!
+ * Makes the next join request use a DevNonce never used before, even if the context holding the last one was lost
+ */
+static void SessionRestoreDevNonce( void )
+{
+    LoRaMacCryptoNvmData_t* crypto = SessionCrypto();
+
+    if (crypto != NULL && crypto->DevNonce < SessionRecord.DevNonce) {
+        crypto->DevNonce = SessionRecord.DevNonce;
+        SessionCryptoStore(crypto);
+    }
+}
+
+/*!
+ * Starts a join attempt, the DevNonce it is going to use is stored first so that a reset
+ * during the attempt can't make the next one use it again
+ */
+static void SessionJoin( void )
+{
+    LoRaMacCryptoNvmData_t* crypto = SessionCrypto();
+
+    if (ProvisionOtaa() && crypto != NULL) {
+        SessionRecord.DevNonce = crypto->DevNonce + 1;
+        SessionRecordWrite(SessionRecord.Fingerprint);
+        EepromMcuFlush();
+    }
+
+    if (JoinStartMs == 0) {
+        JoinStartMs = to_ms_since_boot(get_absolute_time());
+    }
+    JoinAttempts++;
+    JoinRetryPending = false;
+
+    LmHandlerJoin( );
+}
+
+/*!
+ * Schedules the next join attempt after a failed one
+ */
+static void SessionJoinRetry( uint32_t dutyCycleMs )
+{
+    uint32_t wait = join_backoff_next(&JoinBackoff, dutyCycleMs, randr(0, INT32_MAX));
+
+    JoinRetryTime = make_timeout_time_ms(wait);
+    JoinRetryPending = true;
+
+    if (Debug) {
+        printf("Join attempt %u failed, next one in %lu ms\n", JoinAttempts, (unsigned long)wait);
+    }
+}
+
+/*!
+ * Milliseconds since boot including the deep sleeps, 64 bit so that the time-off of the sub-bands never wraps
+ */
+static uint64_t NowMs( void )
+{
+    return time_us_64() / 1000 + SleptMs;
+}
+
+/*!
+ * Spreading factor and bandwidth of a LoRa datarate of the region, 0 for FSK or a datarate the region doesn't have
+ */
+static uint8_t DatarateSf( int8_t datarate, uint32_t* bw )
+{
+    LoRaMacRegion_t region = LmHandlerParams.Region;
+
+    *bw = 125000;
+    if (region == LORAMAC_REGION_US915) {
+        // DR8 to DR13 are the downlink datarates, 500 kHz
+        if (datarate >= 8 && datarate <= 13) {
+            *bw = 500000;
+            return 20 - datarate;
+        }
+        if (datarate > 4) {
+            return 0;
+        }
+        *bw = (datarate == 4) ? 500000 : 125000;
+        return (datarate == 4) ? 8 : 10 - datarate;
+    } else if (datarate >= 0 && datarate <= 5) {
+        return 12 - datarate;
+    } else if (datarate == 6) {
+        *bw = (region == LORAMAC_REGION_AU915) ? 500000 : 250000;
+        return (region == LORAMAC_REGION_AU915) ? 8 : 7;
+    }
+
+    return 0;
+}
+
+/*!
+ * Time on air of a frame, the PHY payload is taken without FOpts
+ */
+static uint32_t SchedulerAirtimeUs( int8_t datarate, uint8_t port, uint8_t size )
+{
+    // MHDR + FHDR without FOpts + MIC, then FPort with the payload
+    uint16_t length = 12 + ((port != 0 || size != 0) ? 1 + size : 0);
+    uint32_t bw;
+    uint8_t sf = DatarateSf(datarate, &bw);
+
+    if (length > 255) {
+        length = 255;
+    }
+
+    if (sf == 0) {
+        if (LmHandlerParams.Region == LORAMAC_REGION_US915) {
+            return 0;
+        }
+        // FSK 50 kbps: preamble, sync word, length, payload and CRC
+        return ((5 + 3 + 1 + length + 2) * 8 * 1000000u) / 50000;
+    }
+
+    return tx_airtime_us(sf, bw, 1, 8, true, true, (uint8_t)length);
+}
+
+/*!
+ * Frequencies of the channels enabled in the channel mask, the next uplink uses one of them
+ */
+static uint8_t SchedulerFrequencies( uint32_t* freqs )
+{
+    MibRequestConfirm_t mibReq;
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+    ChannelParams_t* channels;
+    uint16_t* mask;
+    uint8_t n = 0;
+
+    mibReq.Type = MIB_CHANNELS;
+    if (LoRaMacMibGetRequestConfirm( &mibReq ) != LORAMAC_STATUS_OK) {
+        return 0;
+    }
+    channels = mibReq.Param.ChannelList;
+
+    mibReq.Type = MIB_CHANNELS_MASK;
+    if (LoRaMacMibGetRequestConfirm( &mibReq ) != LORAMAC_STATUS_OK) {
+        return 0;
+    }
+    mask = mibReq.Param.ChannelsMask;
+
+    getPhy.Attribute = PHY_MAX_NB_CHANNELS;
+    phyParam = RegionGetPhyParam(LmHandlerParams.Region, &getPhy);
+
+    for (uint8_t i = 0; i < phyParam.Value && i < REGION_NVM_MAX_NB_CHANNELS; i++) {
+        if (channels[i].Frequency != 0 && (mask[i / 16] & (1 << (i % 16))) != 0) {
+            freqs[n++] = channels[i].Frequency;
+        }
+    }
+
+    return n;
+}
+
+/*!
+ * Channel mask of the region when every channel is in use
+ */
+static void SingleChannelRegionMask( const struct single_channel_plan* plan, uint16_t* mask )
+{
+    uint8_t channels = (plan->n_defaults > 0) ? plan->n_defaults : plan->grid_channels + plan->wide_channels;
+
+    memset(mask, 0, SINGLE_CHANNEL_MASK_SIZE * sizeof(uint16_t));
+    for (uint8_t i = 0; i < channels; i++) {
+        mask[i / 16] |= 1 << (i % 16);
+    }
+}
+
+static void SingleChannelSetMask( uint16_t* mask )
+{
+    MibRequestConfirm_t mibReq;
+
+    mibReq.Type = MIB_CHANNELS_DEFAULT_MASK;
+    mibReq.Param.ChannelsDefaultMask = mask;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    mibReq.Type = MIB_CHANNELS_MASK;
+    mibReq.Param.ChannelsMask = mask;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+}
+
+static void SingleChannelSetRx2( uint32_t frequency, int8_t datarate )
+{
+    MibRequestConfirm_t mibReq;
+    RxChannelParams_t rx2 = { .Frequency = frequency, .Datarate = datarate };
+
+    mibReq.Type = MIB_RX2_DEFAULT_CHANNEL;
+    mibReq.Param.Rx2DefaultChannel = rx2;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    mibReq.Type = MIB_RX2_CHANNEL;
+    mibReq.Param.Rx2Channel = rx2;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    // class C listens on the RX2 parameters between the windows
+    mibReq.Type = MIB_RXC_DEFAULT_CHANNEL;
+    mibReq.Param.RxCDefaultChannel = rx2;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    mibReq.Type = MIB_RXC_CHANNEL;
+    mibReq.Param.RxCChannel = rx2;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+}
+
+/*!
+ * Puts the channel, the mask, RX2 and the datarate of the single-channel setup in the MAC
+ */
+static int SingleChannelApply( void )
+{
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+
+    if (SingleChannelSetup.add) {
+        ChannelParams_t channel = { 0 };
+
+        getPhy.Attribute = PHY_MIN_TX_DR;
+        phyParam = RegionGetPhyParam(LmHandlerParams.Region, &getPhy);
+        channel.Frequency = SingleChannel.frequency;
+        channel.Rx1Frequency = 0;
+        channel.DrRange.Fields.Min = phyParam.Value;
+        channel.DrRange.Fields.Max = SingleChannel.datarate;
+        if (LoRaMacChannelAdd( SingleChannelSetup.index, channel ) != LORAMAC_STATUS_OK) {
+            return -1;
+        }
+    }
+
+    SingleChannelSetMask(SingleChannelSetup.mask);
+
+    if (SingleChannel.rx2_frequency != 0) {
+        SingleChannelSetRx2(SingleChannel.rx2_frequency, SingleChannel.rx2_datarate);
+    } else {
+        SingleChannelSetRx2(SingleChannel.frequency, SingleChannel.datarate);
+    }
+
+    // ADR would move the node to datarates and channels the gateway doesn't listen to
+    LmHandlerSetAdrEnable(false);
+    if (LmHandlerSetTxDatarate(SingleChannel.datarate) != LORAMAC_HANDLER_SUCCESS) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*!
+ * Puts the setup back if the network changed the mask or the datarate with a LinkADRReq
+ */
+static void SingleChannelEnforce( void )
+{
+    MibRequestConfirm_t mibReq;
+    bool changed = false;
+
+    if (!SingleChannelOn || !SingleChannelCheck || LoRaMacIsBusy()) {
+        return;
+    }
+    SingleChannelCheck = false;
+
+    mibReq.Type = MIB_CHANNELS_MASK;
+    if (LoRaMacMibGetRequestConfirm( &mibReq ) == LORAMAC_STATUS_OK) {
+        changed = memcmp(mibReq.Param.ChannelsMask, SingleChannelSetup.mask, sizeof(SingleChannelSetup.mask)) != 0;
+    }
+
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    if (LoRaMacMibGetRequestConfirm( &mibReq ) == LORAMAC_STATUS_OK) {
+        changed |= mibReq.Param.ChannelsDatarate != SingleChannel.datarate;
+    }
+
+    if (changed) {
+        if (Debug) {
+            printf("Network moved the node off the single channel, setup applied again\n");
+        }
+        SingleChannelApply();
+    }
+}
+
+/*!
+ * Lowest SNR the LoRa datarate of a downlink demodulates, -7.5 dB at SF7 down to -20 dB at SF12
+ */
+static int8_t DatarateSnrFloor( int8_t datarate )
+{
+    uint32_t bw;
+    uint8_t sf = DatarateSf(datarate, &bw);
+
+    return (sf == 0) ? 0 : (20 - 5 * sf) / 2;
+}
+
+/*!
+ * Takes the GPS time the stack just set in SysTime
+ */
+static void ClockSyncUpdate( uint32_t resolutionMs )
+{
+    // SysTime counts from the Unix epoch since the first sync, on the system timer
+    SysTime_t now = SysTimeGet( );
+    uint64_t gps_ms = (uint64_t)( now.Seconds - UNIX_GPS_EPOCH_OFFSET ) * 1000 + now.SubSeconds;
+
+    clock_sync_update(&ClockSync, time_us_64() / 1000, gps_ms, resolutionMs);
+    ClockSyncRequested = false;
+
+    if (Debug) {
+        printf("Clock sync %lu: error %ld ms, drift %ld ppm%s\n", (unsigned long)ClockSync.syncs,
+            (long)ClockSync.error_ms, (long)ClockSync.drift_ppm, ClockSync.drift_known ? "" : " (not known yet)");
+    }
+}
+
+/*!
+ * Sends an AppTimeReq once the time slept since the last sync may have taken the error past ClockSyncAccuracyMs
+ */
+static void ClockSyncRetry( void )
+{
+    if (ClockSyncAccuracyMs == 0 || !lorawan_is_joined() || LoRaMacIsBusy()) {
+        return;
+    }
+    if (ClockSyncRequested && NowMs() - ClockSyncRequestMs < LORAWAN_CLOCK_SYNC_RETRY_MS) {
+        return;
+    }
+    if (ClockSync.synced && ClockSync.slept_ms < clock_sync_interval_ms(&ClockSync, ClockSyncAccuracyMs)) {
+        return;
+    }
+
+    lorawan_clock_sync();
+}
+
+static void OnComplianceMlmeConfirm( MlmeConfirm_t* mlmeConfirm )
+{
+    if (mlmeConfirm->MlmeRequest == MLME_LINK_CHECK && mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK) {
+        link_telemetry_link_check(&LinkTelemetry, mlmeConfirm->DemodMargin, mlmeConfirm->NbGateways);
+
+        if (Debug) {
+            printf("Link check: margin %u dB, %u gateways\n", mlmeConfirm->DemodMargin, mlmeConfirm->NbGateways);
+        }
+    }
+
+    if (mlmeConfirm->MlmeRequest == MLME_DEVICE_TIME && mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK) {
+        ClockSyncUpdate( LORAWAN_DEVICE_TIME_RESOLUTION_MS );
+    }
+
+    if (ComplianceMlmeConfirm != NULL) {
+        ComplianceMlmeConfirm( mlmeConfirm );
+    }
+}
+
+/*!
+ * Empty unconfirmed uplink, it carries the MAC commands waiting in the stack
+ */
+static void SendEmptyUplink( void )
+{
+    LmHandlerAppData_t appData =
+    {
+        .Buffer = NULL,
+        .BufferSize = 0,
+        .Port = 0,
+    };
+    LmHandlerSend( &appData, LORAMAC_HANDLER_UNCONFIRMED_MSG );
+}
+
+/*!
+ * Asks for class B, LmHandler sends a DeviceTimeReq, looks for the beacon once the time is known and sends a
+ * PingSlotInfoReq once it is locked, OnClassChange tells when the ping slots are open
+ */
+static int ClassBRequest( void )
+{
+#ifdef LORAMAC_CLASSB_ENABLED
+    MibRequestConfirm_t mibReq;
+
+    mibReq.Type = MIB_DEVICE_CLASS;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+
+    // class B starts from class A, the switch back from class C sends an uplink, class B is asked after it
+    if (mibReq.Param.Class == CLASS_C) {
+        if (LmHandlerRequestClass( CLASS_A ) != LORAMAC_HANDLER_SUCCESS) {
+            return -1;
+        }
+        ClassBRetryTime = get_absolute_time();
+        ClassBRetryPending = true;
+        ClassBState = LORAWAN_CLASS_B_ACQUIRING;
+        return 0;
+    }
+
+    if (LmHandlerRequestClass( CLASS_B ) != LORAMAC_HANDLER_SUCCESS) {
+        return -1;
+    }
+
+    ClassBRetryPending = false;
+    ClassBState = LORAWAN_CLASS_B_ACQUIRING;
+
+    // the DeviceTimeReq waits for an uplink, it doesn't wait for the application
+    SendEmptyUplink();
+
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/*!
+ * Asks for class B again once the wait after a lost beacon is over, and after the switch from class C
+ */
+static void ClassBRetry( void )
+{
+    if (!ClassBRetryPending || !time_reached(ClassBRetryTime) || !lorawan_is_joined() || LoRaMacIsBusy()) {
+        return;
+    }
+
+    ClassBRequest();
+}
+
+/*!
+ * Queues the digest of the link once LinkDigestEvery uplinks went out, it asks for a LinkCheckAns that comes with it
+ */
+static void LinkDigestRelease( void )
+{
+    uint8_t digest[LORAWAN_APP_DATA_BUFFER_MAX_SIZE];
+
+    if (LinkDigestEvery == 0 || LinkDigestUplinks < LinkDigestEvery || TxQueueCount == LORAWAN_TX_QUEUE_LEN) {
+        return;
+    }
+
+    // one byte left for the LinkCheckReq in FOpts
+    int max_payload = lorawan_max_payload_size() - 1;
+    if (max_payload > (int)sizeof(digest)) {
+        max_payload = sizeof(digest);
+    }
+
+    // too slow a datarate for the header, it waits for a faster one
+    int len = link_telemetry_digest(&LinkTelemetry, digest, (max_payload > 0) ? max_payload : 0);
+    if (len == 0) {
+        return;
+    }
+
+    LinkDigestUplinks = 0;
+    link_telemetry_reset(&LinkTelemetry);
+    LmHandlerLinkCheckReq( );
+    lorawan_send_queued(digest, len, LinkDigestPort, false);
+}
+
+/*!
+ * Sends the oldest queued uplink once the duty cycle allows it
+ */
+static void TxQueueRelease( void )
+{
+    if (TxQueueCount == 0 || !lorawan_is_joined() || LoRaMacIsBusy() || lorawan_next_tx_possible_ms() > 0) {
+        return;
+    }
+
+    TxQueueEntry_t* entry = &TxQueue[TxQueueHead];
+    int max_payload = lorawan_max_payload_size();
+
+    // MAC commands fill the frame, they go first with the next uplink of the stack
+    if (max_payload == 0) {
+        return;
+    }
+
+    // a frame larger than the current datarate allows would be replaced by an empty one, it is dropped
+    if (entry->Size <= max_payload) {
+        int rslt = entry->Confirmed ? lorawan_send_confirmed(entry->Data, entry->Size, entry->Port) :
+                                      lorawan_send_unconfirmed(entry->Data, entry->Size, entry->Port);
+
+        // refused, a duty cycle restriction is in MacTxReadyMs, it is tried again later
+        if (rslt < 0) {
+            return;
+        }
+    } else if (Debug) {
+        printf("Queued uplink of %u bytes doesn't fit in %d, dropped\n", entry->Size, max_payload);
+    }
+
+    TxQueueHead = (TxQueueHead + 1) % LORAWAN_TX_QUEUE_LEN;
+    TxQueueCount--;
+}
+
+static int FuotaFlashRead( uint32_t offset, void* buffer, uint32_t size )
+{
+    memcpy(buffer, LORAWAN_FUOTA_ADDRESS + offset, size);
+
+    return 0;
+}
+
+static int FuotaFlashProg( uint32_t offset, const void* buffer, uint32_t size )
+{
+    uint32_t mask;
+
+    BoardCriticalSectionBegin(&mask);
+    flash_range_program(LORAWAN_FUOTA_OFFSET + offset, buffer, size);
+    BoardCriticalSectionEnd(&mask);
+
+    return 0;
+}
+
+static int FuotaFlashErase( uint32_t offset )
+{
+    uint32_t mask;
+
+    BoardCriticalSectionBegin(&mask);
+    flash_range_erase(LORAWAN_FUOTA_OFFSET + offset, FLASH_SECTOR_SIZE);
+    BoardCriticalSectionEnd(&mask);
+
+    return 0;
+}
+
+static const struct frag_store_flash FuotaFlash = {
+    .sector_size = FLASH_SECTOR_SIZE,
+    .page_size = FLASH_PAGE_SIZE,
+    .slot_sectors = LORAWAN_FUOTA_SLOT_SECTORS,
+    .read = FuotaFlashRead,
+    .prog = FuotaFlashProg,
+    .erase = FuotaFlashErase,
+};
+
+/*!
+ * Finds the file applied by the last FUOTA session
+ */
+static void FuotaMount( void )
+{
+    FuotaApplied = 0;
+
+    if (frag_store_mount(&FragStore, &FuotaFlash, FragStoreCache) < 0 && Debug) {
+        printf("FUOTA region not supported, %u sectors a slot\n", LORAWAN_FUOTA_SLOT_SECTORS);
+    }
+}
+
+const char* lorawan_default_dev_eui(char* dev_eui)
+{
+    uint8_t boardId[8];
+
+    BoardGetUniqueId(boardId);
+
+    sprintf(
+        dev_eui, "%02X%02X%02X%02X%02X%02X%02X%02X",
+        boardId[0], boardId[1], boardId[2], boardId[3],
+        boardId[4], boardId[5], boardId[6], boardId[7]
+    );
+
+    return dev_eui;
+}
+
+int lorawan_init(const struct lorawan_sx12xx_settings* sx12xx_settings, LoRaMacRegion_t region)
+{
+    // LmHandlerInit would fail as well, but only after the stored context of the other region is erased
+    if (!RegionIsActive(region)) {
+        if (Debug) printf("Region %d is not built in, see PICO_LORAWAN_REGIONS\n", region);
+        return -1;
+    }
+
+    NvmMount();
+
+    // the stored context is kept only if it was stored for the same region and keys,
+    // anything else starts from a clean context
+    uint32_t fingerprint = SessionFingerprint(region);
+    int stored = SessionRecordCheck(fingerprint);
+
+    SessionState = (stored < 0) ? LORAWAN_SESSION_MISMATCH : LORAWAN_SESSION_NEW;
+    if (stored != 1) {
+        // the DevNonce goes on from the highest one known, the rest of the context is cleared
+        uint16_t devNonce = NvmDevNonce();
+
+        if (SessionRecord.DevNonce < devNonce) {
+            SessionRecord.DevNonce = devNonce;
+        }
+        NvmDataMgmtFactoryReset();
+        SessionRecordWrite(fingerprint);
+        EepromMcuFlush();
+    }
+    NvmRestored = false;
+    JoinRetryPending = false;
+    JoinAttempts = 0;
+    JoinStartMs = 0;
+    JoinTimeMs = 0;
+    join_backoff_reset(&JoinBackoff, LORAWAN_JOIN_BACKOFF_MIN_MS, LORAWAN_JOIN_BACKOFF_MAX_MS);
+    if (region == LORAMAC_REGION_EU868) {
+        tx_scheduler_init(&TxScheduler, Eu868Bands, sizeof(Eu868Bands) / sizeof(Eu868Bands[0]));
+    } else {
+        tx_scheduler_init(&TxScheduler, NULL, 0);
+    }
+    MacTxReadyMs = 0;
+    TxQueueCount = 0;
+    link_telemetry_reset(&LinkTelemetry);
+    LinkDigestUplinks = 0;
+    ClassBState = LORAWAN_CLASS_B_OFF;
+    ClassBRetryPending = false;
+    ClassBBeaconTime = UINT32_MAX;
+    FuotaMount();
+    clock_sync_reset(&ClockSync);
+    ClockSyncRequested = false;
+
+    RtcInit();
+ 
+    Gpio_t gpio_busy;
+    Gpio_t gpio_dio1;
+    Gpio_t gpio_reset;
+    Gpio_t gpio_nss;
+
+    Spi_t spi1_t;
+
+    gpio_busy.pin = RADIO_BUSY;
+    gpio_dio1.pin = RADIO_DIO_1;
+    gpio_reset.pin = RADIO_RESET;
+    gpio_nss.pin = RADIO_NSS;
+    spi1_t.Nss = gpio_nss;
+// raspberry pi pico spi1
+    spi1_t.SpiId = SPI_2;
+
+    SX126x.BUSY = gpio_busy;
+    SX126x.DIO1 = gpio_dio1;
+    SX126x.Reset = gpio_reset;
+    SX126x.Spi = spi1_t;
+    SpiInit( &SX126x.Spi, SPI_2, RADIO_MOSI, RADIO_MISO, RADIO_SCLK, RADIO_NSS );
+
+    SX126x.Spi.Nss.pin = sx12xx_settings->spi.nss;
+    SX126x.Reset.pin = sx12xx_settings->reset;
+    SX126x.DIO1.pin = sx12xx_settings->dio1;
+
+    SX126xIoInit();
+    LmHandlerParams.Region = region;
+    LmHandlerParams.AdrEnable = LORAMAC_HANDLER_ADR_ON;
+    LmHandlerParams.TxDatarate = LORAWAN_DEFAULT_DATARATE;
+    SingleChannelOn = false;
+    if ( LmHandlerInit( &LmHandlerCallbacks, &LmHandlerParams ) != LORAMAC_HANDLER_SUCCESS )
+    {
+        return -1;
+    }
+
+    // a restored context that was activated goes on with the same session, no join
+    if (NvmRestored && lorawan_is_joined()) {
+        SessionAdvanceCounters();
+        SessionState = LORAWAN_SESSION_RESTORED;
+    } else if (ProvisionOtaa()) {
+        SessionRestoreDevNonce();
+    }
+
+    // a frequency the region can't use stops here rather than at the first uplink
+    if (ProvisionActive && ( Provision.flags & PROVISION_SINGLE_CHANNEL ) &&
+        lorawan_set_single_channel(&ProvisionSingleChannel) < 0) {
+        return -1;
+    }
+
+    // Set system maximum tolerated rx error in milliseconds
+    LmHandlerSetSystemMaxRxError( 20 );
+
+    // The LoRa-Alliance Compliance protocol package should always be
+    // initialized and activated.
+    LmHandlerPackageRegister( PACKAGE_ID_COMPLIANCE, &LmhpComplianceParams );
+
+    // the package lives across lorawan_init calls, it is hooked only once
+    LmhPackage_t* compliance = LmhpCompliancePackageFactory( );
+    if (compliance->OnMlmeConfirmProcess != OnComplianceMlmeConfirm) {
+        ComplianceMlmeConfirm = compliance->OnMlmeConfirmProcess;
+        compliance->OnMlmeConfirmProcess = OnComplianceMlmeConfirm;
+    }
+
+    // the GPS time for timestamps, then FUOTA: the multicast groups and class C sessions of the server, the file fragments sent to them
+    LmHandlerPackageRegister( PACKAGE_ID_CLOCK_SYNC, NULL );
+    LmHandlerPackageRegister( PACKAGE_ID_REMOTE_MCAST_SETUP, NULL );
+    LmHandlerPackageRegister( PACKAGE_ID_FRAGMENTATION, &FragmentationParams );
+
+    return 0;
+}
+
+/*!
+ * Starts a record for the settings of lorawan_init_abp/lorawan_init_otaa, the strings are converted once here
+ */
+static int ProvisionFromSettings( LoRaMacRegion_t region, const char* channelMask,
+                                  const struct lorawan_single_channel* singleChannel )
+{
+    memset(&Provision, 0, sizeof(Provision));
+    ProvisionActive = false;
+    Provision.region = region;
+
+    if (channelMask != NULL) {
+        if (provision_hex_mask(channelMask, Provision.channel_mask) < 0) {
+            return -1;
+        }
+        Provision.flags |= PROVISION_CHANNEL_MASK;
+    }
+
+    if (singleChannel != NULL) {
+        Provision.flags |= PROVISION_SINGLE_CHANNEL;
+        Provision.frequency = singleChannel->frequency;
+        Provision.datarate = singleChannel->datarate;
+        Provision.rx2_frequency = singleChannel->rx2_frequency;
+        Provision.rx2_datarate = singleChannel->rx2_datarate;
+    }
+
+    return 0;
+}
+
+/*!
+ * Takes the record in use, the single-channel setup comes out of it
+ */
+static void ProvisionApply( void )
+{
+    ProvisionSingleChannel.frequency = Provision.frequency;
+    ProvisionSingleChannel.datarate = Provision.datarate;
+    ProvisionSingleChannel.rx2_frequency = Provision.rx2_frequency;
+    ProvisionSingleChannel.rx2_datarate = Provision.rx2_datarate;
+    ProvisionActive = true;
+}
+
+int lorawan_init_abp(const struct lorawan_sx12xx_settings* sx12xx_settings, LoRaMacRegion_t region, const struct lorawan_abp_settings* abp_settings)
+{
+    uint8_t devAddr[4];
+
+    if (ProvisionFromSettings(region, abp_settings->channel_mask, abp_settings->single_channel) < 0 ||
+        provision_hex(abp_settings->network_session_key, Provision.nwk_s_key, 16) < 0 ||
+        provision_hex(abp_settings->app_session_key, Provision.app_s_key, 16) < 0) {
+        if (Debug) {
+            printf("ABP settings are not hex: 32 digits a key, 24 for the channel mask\n");
+        }
+        return -1;
+    }
+
+    // without an address the node picks a random one
+    if (abp_settings->device_address != NULL) {
+        if (provision_hex(abp_settings->device_address, devAddr, sizeof(devAddr)) < 0) {
+            if (Debug) {
+                printf("Device address is not 8 hex digits\n");
+            }
+            return -1;
+        }
+        Provision.flags |= PROVISION_DEV_ADDR;
+        Provision.dev_addr = ( (uint32_t)devAddr[0] << 24 ) | ( (uint32_t)devAddr[1] << 16 ) | ( devAddr[2] << 8 ) | devAddr[3];
+    }
+    ProvisionApply();
+
+    return lorawan_init(sx12xx_settings, region);
+}
+
+int lorawan_init_otaa(const struct lorawan_sx12xx_settings* sx12xx_settings, LoRaMacRegion_t region, const struct lorawan_otaa_settings* otaa_settings)
+{
+    if (ProvisionFromSettings(region, otaa_settings->channel_mask, otaa_settings->single_channel) < 0 ||
+        provision_hex(otaa_settings->device_eui, Provision.dev_eui, 8) < 0 ||
+        provision_hex(otaa_settings->app_key, Provision.app_key, 16) < 0 ||
+        ( otaa_settings->app_eui != NULL && provision_hex(otaa_settings->app_eui, Provision.join_eui, 8) < 0 )) {
+        if (Debug) {
+            printf("OTAA settings are not hex: 16 digits an EUI, 32 for the key, 24 for the channel mask\n");
+        }
+        return -1;
+    }
+    Provision.flags |= PROVISION_OTAA;
+    ProvisionApply();
+
+    return lorawan_init(sx12xx_settings, region);
+}
+
+const struct provision_record* lorawan_provision_flash()
+{
+    const struct provision_record* record = LORAWAN_PROVISION_ADDRESS;
+
+    return ( provision_check(record) == 0 ) ? record : NULL;
+}
+
+int lorawan_init_provisioned(const struct lorawan_sx12xx_settings* sx12xx_settings, const struct provision_record* record)
+{
+    int rslt = provision_valid(record);
+
+    if (rslt < 0) {
+        if (Debug) {
+            printf("Provisioning record not valid (%d)\n", rslt);
+        }
+        return -1;
+    }
+
+    memcpy(&Provision, record, sizeof(Provision));
+    Provision.crc = 0;
+    ProvisionApply();
+
+    return lorawan_init(sx12xx_settings, (LoRaMacRegion_t)record->region);
+}
+
+int lorawan_join()
+{
+    // a restored session is already active, LmHandlerJoin would start an OTAA join over it
+    if (SessionState == LORAWAN_SESSION_RESTORED) {
+        LmHandlerRequestClass( LORAWAN_DEFAULT_CLASS );
+        return 0;
+    }
+
+    SessionJoin();
+
+    return 0;
+}
+
+int lorawan_join_C()
+{
+    if (SessionState == LORAWAN_SESSION_RESTORED) {
+        LmHandlerRequestClass( CLASS_C );
+        return 0;
+    }
+
+    OnClassChange(CLASS_C);
+    SessionJoin();
+
+    return 0;
+}
+
+int lorawan_is_joined()
+{
+    return (LmHandlerJoinStatus() == LORAMAC_HANDLER_SET);
+}
+
+int lorawan_process()
+{
+    int sleep = 0;
+
+    // Processes the LoRaMac events
+    LmHandlerProcess( );
+
+    if (JoinRetryPending && time_reached(JoinRetryTime)) {
+        SessionJoin();
+    }
+
+    SingleChannelEnforce();
+    ClassBRetry();
+    ClockSyncRetry();
+    LinkDigestRelease();
+    TxQueueRelease();
+
+    CRITICAL_SECTION_BEGIN( );
+    if( IsMacProcessPending == 1 )
+    {
+        // Clear flag and prevent MCU to go into low power modes.
+        IsMacProcessPending = 0;
+    }
+    else
+    {
+        // The MCU wakes up through events
+        sleep = 1;
+    }
+    CRITICAL_SECTION_END( );
+
+    return sleep;
+}
+
+int lorawan_process_timeout_ms(uint32_t timeout_ms)
+{
+    absolute_time_t timeout_time = make_timeout_time_ms(timeout_ms);
+
+    bool joined = lorawan_is_joined();
+    bool confirmed_pending = (ConfirmedStatus == LORAWAN_CONFIRMED_PENDING);
+    uint32_t received = DownlinkReceived;
+    
+    do {
+        lorawan_process();
+
+        // only a downlink arrived during this call ends the wait, not one left in the queue
+        if (received != DownlinkReceived) {
+            return 0;
+        } else if (joined != lorawan_is_joined()) {
+            return 0;
+        } else if (confirmed_pending && ConfirmedStatus != LORAWAN_CONFIRMED_PENDING) {
+            return 0;
+        }
+    } while (!best_effort_wfe_or_timeout(timeout_time));
+    
+    return 1; // timed out
+}
+
+int lorawan_send_unconfirmed(const void* data, uint8_t data_len, uint8_t app_port)
+{
+    LmHandlerAppData_t appData;
+
+    appData.Port = app_port;
+    appData.BufferSize = data_len;
+    appData.Buffer = (uint8_t*)data;
+
+    return LmHandlerSend(&appData, LORAMAC_HANDLER_UNCONFIRMED_MSG);
+}
+
+int lorawan_send_confirmed(const void* data, uint8_t data_len, uint8_t app_port)
+{
+    LmHandlerAppData_t appData;
+
+    appData.Port = app_port;
+    appData.BufferSize = data_len;
+    appData.Buffer = (uint8_t*)data;
+
+    if (LmHandlerSend(&appData, LORAMAC_HANDLER_CONFIRMED_MSG) != LORAMAC_HANDLER_SUCCESS) {
+        return -1;
+    }
+
+    ConfirmedStatus = LORAWAN_CONFIRMED_PENDING;
+
+    return 0;
+}
+
+int lorawan_send_queued(const void* data, uint8_t data_len, uint8_t app_port, bool confirmed)
+{
+    if (TxQueueCount == LORAWAN_TX_QUEUE_LEN || data_len > LORAWAN_APP_DATA_BUFFER_MAX_SIZE) {
+        return -1;
+    }
+
+    TxQueueEntry_t* entry = &TxQueue[(TxQueueHead + TxQueueCount) % LORAWAN_TX_QUEUE_LEN];
+
+    entry->Port = app_port;
+    entry->Size = data_len;
+    entry->Confirmed = confirmed;
+    memcpy(entry->Data, data, data_len);
+    TxQueueCount++;
+
+    // sent at once if the duty cycle allows it
+    TxQueueRelease();
+
+    return 0;
+}
+
+int lorawan_send_pending()
+{
+    return TxQueueCount;
+}
+
+uint32_t lorawan_next_tx_possible_ms()
+{
+    uint32_t freqs[REGION_NVM_MAX_NB_CHANNELS];
+    uint8_t n = SchedulerFrequencies(freqs);
+    uint64_t now = NowMs();
+    uint32_t wait = tx_scheduler_wait_ms(&TxScheduler, now, freqs, n);
+
+    if (MacTxReadyMs > now && MacTxReadyMs - now > wait) {
+        wait = (uint32_t)(MacTxReadyMs - now);
+    }
+
+    return wait;
+}
+
+void lorawan_sleep_elapsed_ms(uint32_t sleep_ms)
+{
+    SleptMs += sleep_ms;
+    clock_sync_slept(&ClockSync, sleep_ms);
+
+    // SysTime stopped with the timer, it is put back on the GPS time so that an AppTimeReq carries the right one
+    if (ClockSync.synced) {
+        uint64_t gps_ms = clock_sync_gps_ms(&ClockSync, time_us_64() / 1000);
+        SysTime_t now = { .Seconds = (uint32_t)( gps_ms / 1000 ) + UNIX_GPS_EPOCH_OFFSET, .SubSeconds = gps_ms % 1000 };
+
+        SysTimeSet( now );
+    }
+}
+
+uint32_t lorawan_airtime_ms()
+{
+    uint32_t airtime = TxScheduler.other_airtime_ms;
+
+    for (uint8_t i = 0; i < TX_SCHEDULER_MAX_BANDS; i++) {
+        airtime += TxScheduler.airtime_ms[i];
+    }
+
+    return airtime;
+}
+
+int lorawan_confirmed_status()
+{
+    return ConfirmedStatus;
+}
+
+int lorawan_max_payload_size()
+{
+    LoRaMacTxInfo_t txInfo;
+
+    // the size left for the application once the pending MAC commands are taken into account,
+    // 0 when the MAC commands alone fill the frame at the current datarate
+    if (LoRaMacQueryTxPossible(0, &txInfo) != LORAMAC_STATUS_OK) {
+        return 0;
+    }
+
+    return txInfo.MaxPossibleApplicationDataSize;
+}
+
+int lorawan_set_datarate(int8_t datarate)
+{
+    // a negative datarate gives the choice back to ADR, a single-channel gateway would lose the node
+    if (datarate < 0) {
+        if (SingleChannelOn) {
+            return -1;
+        }
+        LmHandlerSetAdrEnable(true);
+        return 0;
+    }
+
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+
+    getPhy.Attribute = PHY_MIN_TX_DR;
+    phyParam = RegionGetPhyParam(LmHandlerParams.Region, &getPhy);
+    int8_t min_datarate = phyParam.Value;
+    getPhy.Attribute = PHY_MAX_TX_DR;
+    phyParam = RegionGetPhyParam(LmHandlerParams.Region, &getPhy);
+    int8_t max_datarate = phyParam.Value;
+
+    if (datarate < min_datarate || datarate > max_datarate) {
+        return -1;
+    }
+
+    // the gateway listens on a single datarate, the setup moves RX2 along when it follows the uplinks
+    if (SingleChannelOn) {
+        struct lorawan_single_channel singleChannel = SingleChannel;
+
+        singleChannel.datarate = datarate;
+        return lorawan_set_single_channel(&singleChannel);
+    }
+
+    // the stack refuses a fixed datarate while ADR is on
+    LmHandlerSetAdrEnable(false);
+    if (LmHandlerSetTxDatarate(datarate) != LORAMAC_HANDLER_SUCCESS) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int lorawan_set_single_channel(const struct lorawan_single_channel* single_channel)
+{
+    LoRaMacRegion_t region = LmHandlerParams.Region;
+    const struct single_channel_plan* plan = NULL;
+    struct single_channel_setup setup;
+    uint16_t mask[SINGLE_CHANNEL_MASK_SIZE];
+
+    if (region < sizeof(SingleChannelPlans) / sizeof(SingleChannelPlans[0])) {
+        plan = &SingleChannelPlans[region];
+    }
+    if (plan == NULL || (plan->n_defaults == 0 && plan->grid_channels == 0) || LoRaMacIsBusy()) {
+        return -1;
+    }
+
+    if (single_channel == NULL) {
+        if (!SingleChannelOn) {
+            return 0;
+        }
+
+        GetPhyParams_t getPhy;
+        PhyParam_t phyParam;
+
+        if (SingleChannelSetup.add) {
+            LoRaMacChannelRemove( SingleChannelSetup.index );
+        }
+        SingleChannelRegionMask(plan, mask);
+        SingleChannelSetMask(mask);
+        getPhy.Attribute = PHY_DEF_RX2_FREQUENCY;
+        phyParam = RegionGetPhyParam(region, &getPhy);
+        uint32_t rx2Frequency = phyParam.Value;
+        getPhy.Attribute = PHY_DEF_RX2_DR;
+        phyParam = RegionGetPhyParam(region, &getPhy);
+        SingleChannelSetRx2(rx2Frequency, phyParam.Value);
+        SingleChannelOn = false;
+        LmHandlerSetAdrEnable(true);
+
+        return 0;
+    }
+
+    // an OTAA node has to be able to join again on the same channel
+    if (single_channel_setup(plan, single_channel->frequency, ProvisionOtaa(), &setup) < 0) {
+        return -1;
+    }
+
+    // a channel added by an earlier setup is not needed anymore
+    if (SingleChannelOn && SingleChannelSetup.add && (!setup.add || setup.index != SingleChannelSetup.index)) {
+        LoRaMacChannelRemove( SingleChannelSetup.index );
+    }
+
+    SingleChannel = *single_channel;
+    SingleChannelSetup = setup;
+    SingleChannelOn = true;
+    SingleChannelCheck = false;
+
+    if (SingleChannelApply() < 0) {
+        SingleChannelOn = false;
+        return -1;
+    }
+
+    if (Debug) {
+        printf("Single channel: %lu Hz at DR%d, channel %u\n", (unsigned long)single_channel->frequency,
+            single_channel->datarate, setup.index);
+    }
+
+    return 0;
+}
+
+const struct lorawan_single_channel* lorawan_single_channel()
+{
+    return SingleChannelOn ? &SingleChannel : NULL;
+}
+
+int lorawan_receive(void* data, uint8_t data_len, uint8_t* app_port)
+{
+    const struct lorawan_downlink* downlink = lorawan_downlink_peek();
+
+    if (downlink == NULL) {
+        *app_port = 0;
+        return -1;
+    }
+
+    int receive_length = downlink->size;
+
+    if (data_len < receive_length) {
+        receive_length = data_len;
+    }
+
+    *app_port = downlink->port;
+    memcpy(data, downlink->data, receive_length);
+    lorawan_downlink_consume();
+
+    return receive_length;
+}
+
+const struct lorawan_downlink* lorawan_downlink_peek()
+{
+    if (DownlinkCount == 0) {
+        return NULL;
+    }
+
+    return &DownlinkQueue[DownlinkHead];
+}
 
-    SX126xIoInit();
-    LmHandlerParams.Region = region;
-    LmHandlerParams.AdrEnable = LORAMAC_HANDLER_ADR_ON;
-    if ( LmHandlerInit( &LmHandlerCallbacks, &LmHandlerParams ) != LORAMAC_HANDLER_SUCCESS )
-    {
-        return -1;
+void lorawan_downlink_consume()
+{
+    if (DownlinkCount == 0) {
+        return;
     }
 
-    // Set system maximum tolerated rx error in milliseconds
-    LmHandlerSetSystemMaxRxError( 20 );
+    DownlinkHead = (DownlinkHead + 1) % LORAWAN_DOWNLINK_QUEUE_LEN;
+    DownlinkCount--;
+}
 
-    // The LoRa-Alliance Compliance protocol package should always be
-    // initialized and activated.
-    LmHandlerPackageRegister( PACKAGE_ID_COMPLIANCE, &LmhpComplianceParams );
+int lorawan_downlink_pending()
+{
+    return DownlinkCount;
+}
 
-    return 0;
+uint32_t lorawan_downlink_overflows()
+{
+    return DownlinkOverflows;
 }
 
-int lorawan_init_abp(const struct lorawan_sx12xx_settings* sx12xx_settings, LoRaMacRegion_t region, const struct lorawan_abp_settings* abp_settings)
+void lorawan_debug(bool debug)
 {
-    AbpSettings = abp_settings;
-    OtaaSettings = NULL;
+    Debug = debug;
+}
 
-    return lorawan_init(sx12xx_settings, region);
+int lorawan_session_state()
+{
+    return SessionState;
 }
 
-int lorawan_init_otaa(const struct lorawan_sx12xx_settings* sx12xx_settings, LoRaMacRegion_t region, const struct lorawan_otaa_settings* otaa_settings)
+uint32_t lorawan_first_uplink_ms()
 {
-    AbpSettings = NULL;
-    OtaaSettings = otaa_settings;
+    return FirstUplinkMs;
+}
 
-    return lorawan_init(sx12xx_settings, region);
+int lorawan_join_attempts()
+{
+    return JoinAttempts;
 }
 
-int lorawan_join()
+uint32_t lorawan_join_time_ms()
 {
-    LmHandlerJoin( );
+    return JoinTimeMs;
+}
 
-    return 0;
+const struct link_telemetry* lorawan_link_telemetry()
+{
+    return &LinkTelemetry;
 }
 
-int lorawan_join_C()
+int lorawan_link_digest(uint8_t* data, uint8_t data_len)
 {
-    OnClassChange(CLASS_C);
-    LmHandlerJoin( );
+    int len = link_telemetry_digest(&LinkTelemetry, data, data_len);
 
-    return 0;
+    if (len > 0) {
+        link_telemetry_reset(&LinkTelemetry);
+        LinkDigestUplinks = 0;
+    }
+
+    return len;
 }
 
-int lorawan_is_joined()
+void lorawan_link_digest_every(uint16_t uplinks, uint8_t app_port)
 {
-    return (LmHandlerJoinStatus() == LORAMAC_HANDLER_SET);
+    LinkDigestEvery = uplinks;
+    LinkDigestPort = app_port;
+    LinkDigestUplinks = 0;
 }
 
-int lorawan_process()
+int lorawan_link_check()
 {
-    int sleep = 0;
+    if (LmHandlerLinkCheckReq() != LORAMAC_HANDLER_SUCCESS) {
+        return -1;
+    }
 
-    // Processes the LoRaMac events
-    LmHandlerProcess( );
+    return 0;
+}
 
-    CRITICAL_SECTION_BEGIN( );
-    if( IsMacProcessPending == 1 )
-    {
-        // Clear flag and prevent MCU to go into low power modes.
-        IsMacProcessPending = 0;
+int lorawan_request_class_b(uint8_t ping_slot_periodicity)
+{
+    if (ping_slot_periodicity > CLASS_B_MAX_PERIODICITY || !lorawan_is_joined()) {
+        return -1;
     }
-    else
-    {
-        // The MCU wakes up through events
-        sleep = 1;
+
+    LmHandlerParams.PingSlotPeriodicity = ping_slot_periodicity;
+    join_backoff_reset( &ClassBBackoff, LORAWAN_CLASS_B_BACKOFF_MIN_MS, LORAWAN_CLASS_B_BACKOFF_MAX_MS );
+
+    // the MAC is busy with an uplink, lorawan_process asks once it is done
+    if (LoRaMacIsBusy()) {
+        ClassBRetryTime = get_absolute_time();
+        ClassBRetryPending = true;
+        ClassBState = LORAWAN_CLASS_B_ACQUIRING;
+        return 0;
     }
-    CRITICAL_SECTION_END( );
 
-    return sleep;
+    return ClassBRequest();
 }
 
-int lorawan_process_timeout_ms(uint32_t timeout_ms)
+int lorawan_class_b_state()
 {
-    absolute_time_t timeout_time = make_timeout_time_ms(timeout_ms);
+    return ClassBState;
+}
 
-    bool joined = lorawan_is_joined();
-    
-    do {
-        lorawan_process();
+uint32_t lorawan_class_b_next_ms()
+{
+    if (ClassBState != LORAWAN_CLASS_B_ON) {
+        return UINT32_MAX;
+    }
 
-        if (AppRxData.Port) {
-            return 0;
-        } else if (joined != lorawan_is_joined()) {
-            return 0;
-        }
-    } while (!best_effort_wfe_or_timeout(timeout_time));
-    
-    return 1; // timed out
+    // SysTime counts from the Unix epoch since the DeviceTimeAns
+    SysTime_t now = SysTimeGet( );
+    uint64_t gps_ms = (uint64_t)( now.Seconds - UNIX_GPS_EPOCH_OFFSET ) * 1000 + now.SubSeconds;
+    uint32_t beacon_time = (uint32_t)( gps_ms / CLASS_B_BEACON_PERIOD_MS ) * ( CLASS_B_BEACON_PERIOD_MS / 1000 );
+
+    // the ping offset changes every beacon period, as the stack computes it
+    if (beacon_time != ClassBBeaconTime) {
+        MibRequestConfirm_t mibReq;
+        aes_context aesContext;
+        uint8_t zeroKey[16] = { 0 };
+        uint8_t block[16];
+        uint8_t rand[16];
+
+        mibReq.Type = MIB_DEV_ADDR;
+        LoRaMacMibGetRequestConfirm( &mibReq );
+
+        class_b_ping_block( beacon_time, mibReq.Param.DevAddr, block );
+        memset( &aesContext, 0, sizeof( aesContext ) );
+        aes_set_key( zeroKey, 16, &aesContext );
+        aes_encrypt( block, rand, &aesContext );
+
+        ClassBPingOffset = class_b_ping_offset( rand, ClassBPeriodicity );
+        ClassBBeaconTime = beacon_time;
+    }
+
+    bool beacon;
+
+    return class_b_next_ms( gps_ms, ClassBPeriodicity, ClassBPingOffset, &beacon );
 }
 
-int lorawan_send_unconfirmed(const void* data, uint8_t data_len, uint8_t app_port)
+const struct lorawan_fuota_file* lorawan_fuota_file()
 {
-    LmHandlerAppData_t appData;
+    const struct frag_store_file* file = frag_store_file(&FragStore);
 
-    appData.Port = app_port;
-    appData.BufferSize = data_len;
-    appData.Buffer = (uint8_t*)data;
+    if (file == NULL) {
+        return NULL;
+    }
 
-    return LmHandlerSend(&appData, LORAMAC_HANDLER_UNCONFIRMED_MSG);
+    FuotaFile.kind = file->kind;
+    FuotaFile.id = file->id;
+    FuotaFile.size = file->size;
+    FuotaFile.data = LORAWAN_FUOTA_ADDRESS + file->offset;
+
+    return &FuotaFile;
 }
 
-int lorawan_receive(void* data, uint8_t data_len, uint8_t* app_port)
+uint32_t lorawan_fuota_applied()
 {
-    *app_port = AppRxData.Port;
-    if (*app_port == 0) {
-        return -1;
-    }
+    return FuotaApplied;
+}
 
-    int receive_length = AppRxData.BufferSize;
+uint64_t lorawan_gps_time_ms()
+{
+    return clock_sync_gps_ms(&ClockSync, time_us_64() / 1000);
+}
 
-    if (data_len < receive_length) {
-        receive_length = data_len;
+int32_t lorawan_clock_sync_error_ms()
+{
+    return ClockSync.error_ms;
+}
+
+uint32_t lorawan_clock_sync_bound_ms()
+{
+    return clock_sync_bound_ms(&ClockSync);
+}
+
+uint32_t lorawan_clock_sync_interval_ms(uint32_t accuracy_ms)
+{
+    return clock_sync_interval_ms(&ClockSync, accuracy_ms);
+}
+
+int lorawan_clock_sync()
+{
+    if (LmhpClockSyncAppTimeReq( ) != LORAMAC_HANDLER_SUCCESS) {
+        return -1;
     }
 
-    memcpy(data, AppRxData.Buffer, receive_length);
-    AppRxData.Port = 0;
+    ClockSyncRequested = true;
+    ClockSyncRequestMs = NowMs();
 
-    return receive_length;
+    return 0;
 }
 
-void lorawan_debug(bool debug)
+void lorawan_clock_sync_accuracy(uint32_t accuracy_ms)
 {
-    Debug = debug;
+    ClockSyncAccuracyMs = accuracy_ms;
 }
 
 int lorawan_erase_nvm()
 {
+    // the emulated EEPROM lives in RAM, it has to be loaded before a call ahead of lorawan_init
+    NvmMount();
+
     if (!NvmDataMgmtFactoryReset()) {
         return -1;
     }
@@ -383,6 +1973,11 @@ static void OnNvmDataChange( LmHandlerNvmContextStates_t state, uint16_t size )
         DisplayNvmDataChange( state, size );
     }
 
+    if (state == LORAMAC_HANDLER_NVM_RESTORE) {
+        NvmRestored = true;
+        return;
+    }
+
     EepromMcuFlush();
 }
 
@@ -390,30 +1985,33 @@ static void OnNetworkParametersChange( CommissioningParams_t* params )
 {
     MibRequestConfirm_t mibReq;
 
-    const char* device_eui = NULL;
-    const char* app_eui = NULL;
-    const char* device_address = NULL;
-    const char* app_key = NULL;
-    const char* app_session_key = NULL;
-    const char* network_session_key = NULL;
-    const char* channel_mask = NULL;
+    // the keys are in binary already, nothing to parse
+    if (!ProvisionActive) {
+        return;
+    }
 
-    if (OtaaSettings != NULL) {
+    if (Provision.flags & PROVISION_OTAA) {
         params->IsOtaaActivation = 1;
 
-        device_eui = OtaaSettings->device_eui;
-        app_eui = OtaaSettings->app_eui;
-        app_key = OtaaSettings->app_key;
-        channel_mask = OtaaSettings->channel_mask;
-    }
+        mibReq.Type = MIB_DEV_EUI;
+        mibReq.Param.DevEui = Provision.dev_eui;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+        memcpy1( params->DevEui, Provision.dev_eui, 8 );
 
-    if (AbpSettings != NULL) {
-        params->IsOtaaActivation = 0;
+        mibReq.Type = MIB_JOIN_EUI;
+        mibReq.Param.JoinEui = Provision.join_eui;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+        memcpy1( params->JoinEui, Provision.join_eui, 8 );
+
+        mibReq.Type = MIB_APP_KEY;
+        mibReq.Param.AppKey = Provision.app_key;
+        LoRaMacMibSetRequestConfirm( &mibReq );
 
-        device_address = AbpSettings->device_address;
-        app_session_key = AbpSettings->app_session_key;
-        network_session_key = AbpSettings->network_session_key;
-        channel_mask = AbpSettings->channel_mask;
+        mibReq.Type = MIB_NWK_KEY;
+        mibReq.Param.NwkKey = Provision.app_key;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+    } else {
+        params->IsOtaaActivation = 0;
 
         // Tell the MAC layer which network server version are we connecting too.
         mibReq.Type = MIB_ABP_LORAWAN_VERSION;
@@ -424,16 +2022,8 @@ static void OnNetworkParametersChange( CommissioningParams_t* params )
         mibReq.Param.NetID = LORAWAN_NETWORK_ID;
         LoRaMacMibSetRequestConfirm( &mibReq );
 
-        if (device_address != NULL) {
-            params->DevAddr = 0;
-
-            for (int i = 0; i < 4; i++) {
-                uint8_t b;
-
-                sscanf(device_address + i * 2, "%2hhx", &b);
-
-                params->DevAddr = (params->DevAddr << 8) | b;
-            }
+        if (Provision.flags & PROVISION_DEV_ADDR) {
+            params->DevAddr = Provision.dev_addr;
         } else {
             // Random seed initialization
             srand1( LmHandlerCallbacks.GetRandomSeed( ) );
@@ -444,119 +2034,31 @@ static void OnNetworkParametersChange( CommissioningParams_t* params )
         mibReq.Type = MIB_DEV_ADDR;
         mibReq.Param.DevAddr = params->DevAddr;
         LoRaMacMibSetRequestConfirm( &mibReq );
-    }
-
-    if (device_eui != NULL) {
-        uint8_t deviceEui[8];
-
-        for (int i = 0; i < 8; i++) {
-            uint8_t b;
-
-            sscanf(device_eui + i * 2, "%2hhx", &b);
-
-            deviceEui[i] = b;
-        }
-
-        mibReq.Type = MIB_DEV_EUI;
-        mibReq.Param.DevEui = deviceEui;
-        LoRaMacMibSetRequestConfirm( &mibReq );
-        memcpy1( params->DevEui, mibReq.Param.DevEui, 8 );
-    }
-
-    if (app_eui != NULL) {
-        uint8_t joinEui[8];
-
-        for (int i = 0; i < 8; i++) {
-            uint8_t b;
-
-            sscanf(app_eui + i * 2, "%2hhx", &b);
-
-            joinEui[i] = b;
-        }
-
-        mibReq.Type = MIB_JOIN_EUI;
-        mibReq.Param.JoinEui = joinEui;
-        LoRaMacMibSetRequestConfirm( &mibReq );
-        memcpy1( params->JoinEui, mibReq.Param.JoinEui, 8 );
-    }
-
-    if (app_key) {
-        uint8_t appKey[16];
-
-        for (int i = 0; i < 16; i++) {
-            uint8_t b;
-
-            sscanf(app_key + i * 2, "%2hhx", &b);
-
-            appKey[i] = b;
-        }
-
-        mibReq.Type = MIB_APP_KEY;
-        mibReq.Param.AppKey = appKey;
-        LoRaMacMibSetRequestConfirm( &mibReq );
-
-        mibReq.Type = MIB_NWK_KEY;
-        mibReq.Param.NwkKey = appKey;
-        LoRaMacMibSetRequestConfirm( &mibReq );
-    }
-
-    if (app_session_key) {
-        uint8_t appSessionKey[16];
-
-        for (int i = 0; i < 16; i++) {
-            uint8_t b;
 
-            sscanf(app_session_key + i * 2, "%2hhx", &b);
-
-            appSessionKey[i] = b;
-        }
         mibReq.Type = MIB_APP_S_KEY;
-        mibReq.Param.AppSKey = appSessionKey;
-
+        mibReq.Param.AppSKey = Provision.app_s_key;
         LoRaMacMibSetRequestConfirm( &mibReq );
-    }
 
-    if (network_session_key) {
-        uint8_t networkSessionKey[16];
-
-        for (int i = 0; i < 16; i++) {
-            uint8_t b;
-
-            sscanf(network_session_key + i * 2, "%2hhx", &b);
-
-            networkSessionKey[i] = b;
-        }
         mibReq.Type = MIB_F_NWK_S_INT_KEY;
-        mibReq.Param.FNwkSIntKey = networkSessionKey;
+        mibReq.Param.FNwkSIntKey = Provision.nwk_s_key;
         LoRaMacMibSetRequestConfirm( &mibReq );
 
         mibReq.Type = MIB_S_NWK_S_INT_KEY;
-        mibReq.Param.SNwkSIntKey = networkSessionKey;
+        mibReq.Param.SNwkSIntKey = Provision.nwk_s_key;
         LoRaMacMibSetRequestConfirm( &mibReq );
 
         mibReq.Type = MIB_NWK_S_ENC_KEY;
-        mibReq.Param.NwkSEncKey = networkSessionKey;
+        mibReq.Param.NwkSEncKey = Provision.nwk_s_key;
         LoRaMacMibSetRequestConfirm( &mibReq );
     }
 
-    if (channel_mask != NULL) {
-        uint16_t channelMask[6];
-
-        for (int i = 0; i < 6; i++) {
-            uint8_t b[2];
-
-            sscanf(channel_mask + i * 4 + 0, "%2x", &b[0]);
-            sscanf(channel_mask + i * 4 + 2, "%2x", &b[1]);
-
-            channelMask[i] = (b[0] << 8) | b[1];
-        }
-
+    if (Provision.flags & PROVISION_CHANNEL_MASK) {
         mibReq.Type = MIB_CHANNELS_MASK;
-        mibReq.Param.ChannelsMask = channelMask;
+        mibReq.Param.ChannelsMask = Provision.channel_mask;
         LoRaMacMibSetRequestConfirm( &mibReq );
         
         mibReq.Type = MIB_CHANNELS_DEFAULT_MASK;
-        mibReq.Param.ChannelsDefaultMask = channelMask;
+        mibReq.Param.ChannelsDefaultMask = Provision.channel_mask;
         LoRaMacMibSetRequestConfirm( &mibReq );
     }
 
@@ -570,6 +2072,19 @@ static void OnMacMcpsRequest( LoRaMacStatus_t status, McpsReq_t *mcpsReq, TimerT
     if (Debug) {
         DisplayMacMcpsRequestUpdate( status, mcpsReq, nextTxIn );
     }
+
+    if (status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED) {
+        MacTxReadyMs = NowMs() + nextTxIn;
+    }
+
+    if (status == LORAMAC_STATUS_OK && FirstUplinkMs == 0) {
+        FirstUplinkMs = to_ms_since_boot(get_absolute_time());
+
+        if (Debug) {
+            printf("First uplink %lu ms after boot (%s session)\n", (unsigned long)FirstUplinkMs,
+                (SessionState == LORAWAN_SESSION_RESTORED) ? "restored" : "new");
+        }
+    }
 }
 
 static void OnMacMlmeRequest( LoRaMacStatus_t status, MlmeReq_t *mlmeReq, TimerTime_t nextTxIn )
@@ -577,6 +2092,11 @@ static void OnMacMlmeRequest( LoRaMacStatus_t status, MlmeReq_t *mlmeReq, TimerT
     if (Debug) {
         DisplayMacMlmeRequestUpdate( status, mlmeReq, nextTxIn );
     }
+
+    // a join request refused by the MAC gets no confirm, the retry is scheduled here
+    if (mlmeReq->Type == MLME_JOIN && status != LORAMAC_STATUS_OK) {
+        SessionJoinRetry( (status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED) ? nextTxIn : 0 );
+    }
 }
 
 static void OnJoinRequest( LmHandlerJoinParams_t* params )
@@ -587,10 +2107,15 @@ static void OnJoinRequest( LmHandlerJoinParams_t* params )
 
     if( params->Status == LORAMAC_HANDLER_ERROR )
     {
-        LmHandlerJoin( );
+        SessionJoinRetry( 0 );
     }
     else
     {
+        JoinTimeMs = to_ms_since_boot( get_absolute_time( ) ) - JoinStartMs;
+        if (Debug) {
+            printf("Joined after %d attempts in %lu ms\n", lorawan_join_attempts(), (unsigned long)JoinTimeMs);
+        }
+        join_backoff_reset( &JoinBackoff, LORAWAN_JOIN_BACKOFF_MIN_MS, LORAWAN_JOIN_BACKOFF_MAX_MS );
         LmHandlerRequestClass( LORAWAN_DEFAULT_CLASS );
     }
 }
@@ -600,6 +2125,39 @@ static void OnTxData( LmHandlerTxParams_t* params )
     if (Debug) {
         DisplayTxUpdate( params );
     }
+
+    // the MCPS confirm of a confirmed uplink tells if the network server acknowledged it
+    if (params->IsMcpsConfirm && params->MsgType == LORAMAC_HANDLER_CONFIRMED_MSG &&
+        ConfirmedStatus == LORAWAN_CONFIRMED_PENDING) {
+        ConfirmedStatus = params->AckReceived ? LORAWAN_CONFIRMED_ACK : LORAWAN_CONFIRMED_NACK;
+    }
+
+    // the digest itself doesn't count towards the next one
+    if (params->IsMcpsConfirm) {
+        link_telemetry_uplink(&LinkTelemetry, params->Datarate, params->MsgType == LORAMAC_HANDLER_CONFIRMED_MSG,
+                              params->AckReceived);
+        if (LinkDigestEvery != 0 && params->AppData.Port != LinkDigestPort) {
+            LinkDigestUplinks++;
+        }
+    }
+
+    // the confirm comes after the receive windows, counting the frame from now closes the sub-band a bit longer than needed
+    if (params->IsMcpsConfirm) {
+        MibRequestConfirm_t mibReq;
+
+        mibReq.Type = MIB_CHANNELS;
+        if (LoRaMacMibGetRequestConfirm( &mibReq ) == LORAMAC_STATUS_OK && params->Channel < REGION_NVM_MAX_NB_CHANNELS) {
+            uint32_t freq = mibReq.Param.ChannelList[params->Channel].Frequency;
+            uint32_t airtime = SchedulerAirtimeUs(params->Datarate, params->AppData.Port, params->AppData.BufferSize);
+
+            tx_scheduler_record(&TxScheduler, NowMs(), freq, airtime);
+
+            if (Debug) {
+                printf("Uplink on %lu Hz, %lu us on air, %lu ms on air since boot\n", (unsigned long)freq,
+                    (unsigned long)airtime, (unsigned long)lorawan_airtime_ms());
+            }
+        }
+    }
 }
 
 static void OnRxData( LmHandlerAppData_t* appData, LmHandlerRxParams_t* params )
@@ -608,9 +2166,56 @@ static void OnRxData( LmHandlerAppData_t* appData, LmHandlerRxParams_t* params )
         DisplayRxUpdate( appData, params );
     }
 
-    memcpy(AppRxData.Buffer, appData->Buffer, appData->BufferSize);
-    AppRxData.BufferSize = appData->BufferSize;
-    AppRxData.Port = appData->Port;
+    // the MAC commands of the frame are already applied, a LinkADRReq may have changed the channels
+    SingleChannelCheck = true;
+
+    // LmHandler refreshes the RSSI, SNR and window only for a frame with a payload, an empty ack keeps the old ones
+    if (params->IsMcpsIndication && appData->BufferSize > 0) {
+        uint8_t slot = (params->RxSlot == RX_SLOT_WIN_1) ? LINK_TELEMETRY_RX1 :
+                       (params->RxSlot == RX_SLOT_WIN_2) ? LINK_TELEMETRY_RX2 : LINK_TELEMETRY_RX_OTHER;
+
+        link_telemetry_downlink(&LinkTelemetry, params->Datarate, params->Rssi, params->Snr, slot,
+                                DatarateSnrFloor(params->Datarate));
+    }
+
+    // port 0 carries only MAC commands
+    if (appData->Port == 0) {
+        return;
+    }
+
+    // a session setup the fragmentation package accepts opens a new session in the store, the one open is dropped.
+    // The package may get the frame before or after: a sector not written in the session reads as erased anyway,
+    // as FragDecoderInit leaves the file
+    if (appData->Port == FRAG_STORE_PORT) {
+        uint32_t session = frag_store_session_setup(appData->Buffer, appData->BufferSize, FRAG_MAX_NB, FRAG_MAX_SIZE);
+
+        if (session > 0) {
+            int rslt = frag_store_begin(&FragStore, session);
+
+            FuotaStartMs = to_ms_since_boot(get_absolute_time());
+            if (Debug) {
+                printf("FUOTA session of %lu bytes %s (%d)\n", (unsigned long)session,
+                    (rslt == 0) ? "opened" : "refused", rslt);
+            }
+        }
+    }
+
+    if (DownlinkCount == LORAWAN_DOWNLINK_QUEUE_LEN) {
+        DownlinkOverflows++;
+        return;
+    }
+
+    struct lorawan_downlink* downlink = &DownlinkQueue[(DownlinkHead + DownlinkCount) % LORAWAN_DOWNLINK_QUEUE_LEN];
+    uint8_t size = (appData->BufferSize < LORAWAN_DOWNLINK_MAX_SIZE) ? appData->BufferSize : LORAWAN_DOWNLINK_MAX_SIZE;
+
+    downlink->time_ms = to_ms_since_boot(get_absolute_time());
+    downlink->rssi = params->Rssi;
+    downlink->snr = params->Snr;
+    downlink->port = appData->Port;
+    downlink->size = size;
+    memcpy(downlink->data, appData->Buffer, size);
+    DownlinkCount++;
+    DownlinkReceived++;
 }
 
 static void OnClassChange( DeviceClass_t deviceClass )
@@ -619,14 +2224,16 @@ static void OnClassChange( DeviceClass_t deviceClass )
         DisplayClassUpdate( deviceClass );
     }
 
+    // the ping slots are open, a lost beacon comes back here with class A before OnBeaconStatusChange
+    if (deviceClass == CLASS_B) {
+        ClassBPeriodicity = LmHandlerParams.PingSlotPeriodicity;
+        ClassBBeaconTime = UINT32_MAX;
+        ClassBState = LORAWAN_CLASS_B_ON;
+        join_backoff_reset( &ClassBBackoff, LORAWAN_CLASS_B_BACKOFF_MIN_MS, LORAWAN_CLASS_B_BACKOFF_MAX_MS );
+    }
+
     // Inform the server as soon as possible that the end-device has switched to ClassB
-    LmHandlerAppData_t appData =
-    {
-        .Buffer = NULL,
-        .BufferSize = 0,
-        .Port = 0,
-    };
-    LmHandlerSend( &appData, LORAMAC_HANDLER_UNCONFIRMED_MSG );
+    SendEmptyUplink();
 }
 
 static void OnBeaconStatusChange( LoRaMacHandlerBeaconParams_t* params )
@@ -638,8 +2245,22 @@ static void OnBeaconStatusChange( LoRaMacHandlerBeaconParams_t* params )
             break;
         }
         case LORAMAC_HANDLER_BEACON_LOST:
+        {
+            // the stack is back in class A, the acquisition starts over later as it keeps the radio on
+            uint32_t wait = join_backoff_next( &ClassBBackoff, 0, randr( 0, INT32_MAX ) );
+
+            ClassBRetryTime = make_timeout_time_ms( wait );
+            ClassBRetryPending = true;
+            ClassBState = LORAWAN_CLASS_B_LOST;
+
+            if (Debug) {
+                printf("Beacon lost, class B asked again in %lu ms\n", (unsigned long)wait);
+            }
+            break;
+        }
         case LORAMAC_HANDLER_BEACON_NRX:
         {
+            // a missed beacon, the stack keeps the ping slots with wider windows for up to two hours
             break;
         }
         default:
@@ -656,12 +2277,13 @@ static void OnBeaconStatusChange( LoRaMacHandlerBeaconParams_t* params )
 #if( LMH_SYS_TIME_UPDATE_NEW_API == 1 )
 static void OnSysTimeUpdate( bool isSynchronized, int32_t timeCorrection )
 {
-
+    // the clock synchronization package has applied the correction of the AppTimeAns to SysTime
+    ClockSyncUpdate( LORAWAN_APP_TIME_RESOLUTION_MS );
 }
 #else
 static void OnSysTimeUpdate( void )
 {
-
+    ClockSyncUpdate( LORAWAN_APP_TIME_RESOLUTION_MS );
 }
 #endif
 
@@ -679,3 +2301,38 @@ static void OnPingSlotPeriodicityChanged( uint8_t pingSlotPeriodicity )
 {
     LmHandlerParams.PingSlotPeriodicity = pingSlotPeriodicity;
 }
+
+static int32_t OnFragWrite( uint32_t addr, uint8_t* data, uint32_t size )
+{
+    // the session is opened by OnRxData on the FragSessionSetupReq
+    return (frag_store_write(&FragStore, addr, data, size) < 0) ? -1 : 0;
+}
+
+static int32_t OnFragRead( uint32_t addr, uint8_t* data, uint32_t size )
+{
+    return (frag_store_read(&FragStore, addr, data, size) < 0) ? -1 : 0;
+}
+
+static void OnFragProgress( uint16_t fragCounter, uint16_t fragNb, uint8_t fragSize, uint16_t fragNbLost )
+{
+    if (Debug) {
+        printf("FUOTA fragment %u of %u (%u bytes), %u lost\n", fragCounter, fragNb, fragSize, fragNbLost);
+    }
+}
+
+static void OnFragDone( int32_t status, uint32_t size )
+{
+    // the CRC of the file header decides, the file is applied by the last page program or not at all
+    int rslt = frag_store_commit(&FragStore);
+
+    if (rslt == 0) {
+        FuotaApplied++;
+    }
+
+    if (Debug) {
+        printf("FUOTA file of %lu bytes %s (%d) in %lu ms, %lu sector erases and %lu page programs\n",
+            (unsigned long)size, (rslt == 0) ? "applied" : "refused", rslt,
+            (unsigned long)(to_ms_since_boot(get_absolute_time()) - FuotaStartMs), (unsigned long)FragStore.erases,
+            (unsigned long)FragStore.programs);
+    }
+}
@@ -0,0 +1,93 @@
+/**
+ * @file provision.c
+ * @brief provisioning record of a node, see pico/provision.h
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stddef.h>
+
+#include "pico/crc32.h"
+#include "pico/provision.h"
+
+// the CRC covers everything before it
+#define PROVISION_CRC_LEN               offsetof(struct provision_record, crc)
+
+void provision_seal( struct provision_record* r )
+{
+    r->magic = PROVISION_MAGIC;
+    r->version = PROVISION_VERSION;
+    r->size = sizeof(*r);
+    r->crc = lorawan_crc32(0, r, PROVISION_CRC_LEN);
+}
+
+int provision_valid( const struct provision_record* r )
+{
+    if (r->magic != PROVISION_MAGIC) {
+        return PROVISION_E_EMPTY;
+    }
+
+    if (r->version != PROVISION_VERSION || r->size != sizeof(*r)) {
+        return PROVISION_E_VERSION;
+    }
+
+    return 0;
+}
+
+int provision_check( const struct provision_record* r )
+{
+    int rslt = provision_valid(r);
+
+    if (rslt < 0) {
+        return rslt;
+    }
+
+    return ( r->crc == lorawan_crc32(0, r, PROVISION_CRC_LEN) ) ? 0 : PROVISION_E_CRC;
+}
+
+static int nibble( char c )
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+
+    c |= 0x20;
+
+    return ( c >= 'a' && c <= 'f' ) ? c - 'a' + 10 : -1;
+}
+
+int provision_hex( const char* hex, uint8_t* out, uint32_t len )
+{
+    if (hex == NULL) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < len; i++) {
+        // the terminator is not a digit, a short string stops here
+        int hi = nibble(hex[2 * i]);
+        int lo = ( hi < 0 ) ? -1 : nibble(hex[2 * i + 1]);
+
+        if (lo < 0) {
+            return -1;
+        }
+        out[i] = (uint8_t)( ( hi << 4 ) | lo );
+    }
+
+    return ( hex[2 * len] == '\0' ) ? 0 : -1;
+}
+
+int provision_hex_mask( const char* hex, uint16_t* mask )
+{
+    uint8_t bytes[12];
+
+    if (provision_hex(hex, bytes, sizeof(bytes)) < 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < 6; i++) {
+        mask[i] = (uint16_t)( ( bytes[2 * i] << 8 ) | bytes[2 * i + 1] );
+    }
+
+    return 0;
+}
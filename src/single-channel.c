@@ -0,0 +1,94 @@
+/**
+ * @file single-channel.c
+ * @brief single-channel gateway support, see single-channel.h
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <string.h>
+
+#include "single-channel.h"
+#include "tx-scheduler.h"
+
+/*
+    index of freq_hz on a grid, -1 if it isn't on it
+*/
+static int grid_index( uint32_t freq_hz, uint32_t start_hz, uint32_t step_hz, uint8_t channels )
+{
+    if (channels == 0 || step_hz == 0 || freq_hz < start_hz || ( freq_hz - start_hz ) % step_hz != 0) {
+        return -1;
+    }
+
+    uint32_t index = ( freq_hz - start_hz ) / step_hz;
+
+    return ( index < channels ) ? (int)index : -1;
+}
+
+int single_channel_setup( const struct single_channel_plan* plan, uint32_t freq_hz, bool join,
+                          struct single_channel_setup* setup )
+{
+    int index = -1;
+
+    memset(setup, 0, sizeof(*setup));
+
+    if (plan->n_defaults > 0) {
+        for (uint8_t i = 0; i < plan->n_defaults && index < 0; i++) {
+            if (plan->defaults[i] == freq_hz) {
+                index = i;
+            }
+        }
+        // the join requests go out on the default channels only
+        if (index < 0) {
+            if (join) {
+                return -1;
+            }
+            index = plan->n_defaults;
+            setup->add = true;
+        }
+    } else {
+        index = grid_index(freq_hz, plan->grid_hz, plan->grid_step_hz, plan->grid_channels);
+        if (index < 0) {
+            index = grid_index(freq_hz, plan->wide_hz, plan->wide_step_hz, plan->wide_channels);
+            if (index < 0) {
+                return -1;
+            }
+            index += plan->grid_channels;
+            setup->wide = true;
+        }
+    }
+
+    setup->index = index;
+    setup->mask[index / 16] = 1 << ( index % 16 );
+
+    return 0;
+}
+
+void single_channel_rates( uint32_t bw_hz, uint8_t payload_len, uint16_t duty_cycle, uint16_t tx_ma,
+                           struct single_channel_rate* rates )
+{
+    // 10 log10(BW) - 174 dBm/Hz + 6 dB of noise figure, in tenths of dB
+    int16_t noise_x10 = ( bw_hz >= 500000 ) ? -1110 : ( bw_hz >= 250000 ) ? -1140 : -1170;
+
+    if (duty_cycle == 0) {
+        duty_cycle = 1;
+    }
+
+    for (uint8_t i = 0; i < SINGLE_CHANNEL_RATES; i++) {
+        struct single_channel_rate* r = &rates[i];
+        uint8_t sf = SINGLE_CHANNEL_MIN_SF + i;
+
+        r->sf = sf;
+        r->airtime_us = tx_airtime_us(sf, bw_hz, 1, 8, true, true, payload_len);
+        // a frame and its time-off in whole milliseconds, as tx_scheduler_record closes the sub-band
+        uint32_t period_ms = ( ( r->airtime_us + 999 ) / 1000 ) * duty_cycle;
+        r->frames_per_hour = 3600000 / period_ms;
+        // the 13 bytes of MHDR, FHDR, FPort and MIC carry no application data
+        uint32_t app_len = ( payload_len > 13 ) ? payload_len - 13 : 0;
+        r->payload_bytes_per_hour = app_len * r->frames_per_hour;
+        // SNR floor of -7.5 dB at SF7 down to -20 dB at SF12
+        r->sensitivity_dbm_x10 = noise_x10 - ( 25 * sf - 100 );
+        // mA * us / 3600 = nAh
+        r->charge_nah = (uint32_t)( ( (uint64_t)tx_ma * r->airtime_us + 1800 ) / 3600 );
+    }
+}
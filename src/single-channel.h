@@ -0,0 +1,99 @@
+/**
+ * @file single-channel.h
+ * @brief single-channel gateway support: finds the channel of a region that holds a frequency and the channel mask
+ *          that leaves only that channel enabled, and gives for every spreading factor the time on air, the frames an
+ *          hour allowed by the duty cycle, the application bytes an hour, the sensitivity and the charge of a frame, to trade the range
+ *          against the battery. Regions with a channel list (EU868 and the like) keep their default channels and let
+ *          the node add others, regions with fixed channels (US915, AU915, CN470) have them on a grid.
+ *          No dependency on the stack, the same code runs on the board and on the host
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef __SINGLE_CHANNEL_H__
+#define __SINGLE_CHANNEL_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*words of the channel mask, 96 channels as in REGION_NVM_CHANNELS_MASK_SIZE*/
+#define SINGLE_CHANNEL_MASK_SIZE        6
+
+/*spreading factors of the rate table, SF7 to SF12*/
+#define SINGLE_CHANNEL_MIN_SF           7
+#define SINGLE_CHANNEL_RATES            6
+
+/*
+    channel plan of a region
+    with n_defaults > 0 the region has a channel list: defaults are the channels every node has, the join requests only
+    use them, any other frequency is added at index n_defaults. Otherwise the channels are fixed, grid_channels of
+    125 kHz from grid_hz every grid_step_hz followed by wide_channels of 500 kHz from wide_hz every wide_step_hz
+*/
+struct single_channel_plan {
+    const uint32_t* defaults;
+    uint8_t n_defaults;
+    uint32_t grid_hz;
+    uint32_t grid_step_hz;
+    uint8_t grid_channels;
+    uint32_t wide_hz;
+    uint32_t wide_step_hz;
+    uint8_t wide_channels;
+};
+
+/*
+    channel the uplinks use and the mask that enables it alone
+*/
+struct single_channel_setup {
+    uint8_t index;
+    bool add;                                           // not a channel of the region, the node has to add it
+    bool wide;                                          // 500 kHz channel of a fixed plan
+    uint16_t mask[SINGLE_CHANNEL_MASK_SIZE];
+};
+
+/*
+    one line of the rate table
+*/
+struct single_channel_rate {
+    uint8_t sf;
+    uint32_t airtime_us;                                // time on air of a frame
+    uint32_t frames_per_hour;                           // most frames in an hour within the duty cycle
+    uint32_t payload_bytes_per_hour;                    // application bytes an hour at that pace
+    int16_t sensitivity_dbm_x10;                        // noise floor of the bandwidth, 6 dB noise figure, SNR floor
+    uint32_t charge_nah;                                // charge of the transmission, nAh
+};
+
+/**
+ * @brief finds the channel of a frequency
+ *
+ * @param plan channel plan of the region
+ * @param freq_hz frequency of the gateway
+ * @param join the node joins over the air on it
+ * @param setup channel and mask found
+ * @return int 0, -1 if the frequency is not a channel of a fixed plan or, for a join, not a default channel
+ */
+int single_channel_setup( const struct single_channel_plan* plan, uint32_t freq_hz, bool join,
+                          struct single_channel_setup* setup );
+
+/**
+ * @brief rate table from SF7 to SF12
+ *
+ * @param bw_hz bandwidth, 125000, 250000 or 500000
+ * @param payload_len bytes of the PHY payload, 13 more than the application payload without FOpts
+ * @param duty_cycle inverse of the duty cycle as in struct tx_band, 1 for no limit
+ * @param tx_ma current drawn by the radio while transmitting, mA
+ * @param rates SINGLE_CHANNEL_RATES lines
+ */
+void single_channel_rates( uint32_t bw_hz, uint8_t payload_len, uint16_t duty_cycle, uint16_t tx_ma,
+                           struct single_channel_rate* rates );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SINGLE_CHANNEL_H__
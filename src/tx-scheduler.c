@@ -0,0 +1,89 @@
+/**
+ * @file tx-scheduler.c
+ * @brief time on air and duty cycle of the sub-bands, see tx-scheduler.h
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stddef.h>
+
+#include "tx-scheduler.h"
+
+uint32_t tx_airtime_us( uint8_t sf, uint32_t bw_hz, uint8_t cr, uint16_t preamble, bool explicit_header, bool crc,
+                        uint8_t payload_len )
+{
+    // the symbol lasts 2^SF / BW, a whole number of microseconds for the LoRaWAN bandwidths
+    uint64_t symbol_ns = ( 1000000000ull << sf ) / bw_hz;
+    // low datarate optimization is mandatory from 16 ms per symbol
+    uint8_t de = ( symbol_ns >= 16000000ull ) ? 1 : 0;
+    int32_t num = 8 * payload_len - 4 * sf + 28 + ( crc ? 16 : 0 ) - ( explicit_header ? 0 : 20 );
+    int32_t den = 4 * ( sf - 2 * de );
+    uint32_t payload_symbols = 8;
+
+    if (num > 0) {
+        payload_symbols += ( ( num + den - 1 ) / den ) * ( cr + 4 );
+    }
+
+    // preamble + 4.25 symbols of sync word, in quarters of symbol
+    uint64_t quarters = 4ull * ( preamble + payload_symbols ) + 17;
+
+    return (uint32_t)( ( quarters * symbol_ns / 4 + 999 ) / 1000 );
+}
+
+void tx_scheduler_init( struct tx_scheduler* s, const struct tx_band* bands, uint8_t n_bands )
+{
+    s->bands = bands;
+    s->n_bands = ( bands == NULL ) ? 0 : ( n_bands > TX_SCHEDULER_MAX_BANDS ) ? TX_SCHEDULER_MAX_BANDS : n_bands;
+    for (uint8_t i = 0; i < TX_SCHEDULER_MAX_BANDS; i++) {
+        s->ready_ms[i] = 0;
+        s->airtime_ms[i] = 0;
+        s->frames[i] = 0;
+    }
+    s->other_airtime_ms = 0;
+}
+
+int tx_scheduler_band( const struct tx_scheduler* s, uint32_t freq_hz )
+{
+    for (uint8_t i = 0; i < s->n_bands; i++) {
+        if (freq_hz >= s->bands[i].min_hz && freq_hz < s->bands[i].max_hz) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void tx_scheduler_record( struct tx_scheduler* s, uint64_t now_ms, uint32_t freq_hz, uint32_t airtime_us )
+{
+    int band = tx_scheduler_band(s, freq_hz);
+    uint32_t airtime_ms = ( airtime_us + 999 ) / 1000;
+
+    if (band < 0) {
+        s->other_airtime_ms += airtime_ms;
+        return;
+    }
+
+    s->airtime_ms[band] += airtime_ms;
+    s->frames[band]++;
+    // closed for the frame and the time-off after it, a band already closed further keeps the later time
+    uint64_t ready = now_ms + (uint64_t)airtime_ms * s->bands[band].duty_cycle;
+    if (ready > s->ready_ms[band]) {
+        s->ready_ms[band] = ready;
+    }
+}
+
+uint32_t tx_scheduler_wait_ms( const struct tx_scheduler* s, uint64_t now_ms, const uint32_t* freqs, uint8_t n_freqs )
+{
+    uint32_t wait = UINT32_MAX;
+
+    for (uint8_t i = 0; i < n_freqs && wait > 0; i++) {
+        int band = tx_scheduler_band(s, freqs[i]);
+        uint64_t left = ( band < 0 || s->ready_ms[band] <= now_ms ) ? 0 : s->ready_ms[band] - now_ms;
+
+        if (left < wait) {
+            wait = (uint32_t)left;
+        }
+    }
+
+    return ( wait == UINT32_MAX ) ? 0 : wait;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file tx-scheduler.h
+ * @brief time on air of the LoRa frames and duty cycle of the sub-bands. The time on air follows the formula of the
+ *          Semtech datasheets (SX1261/2, SX1276), after every transmission the sub-band holding the frequency is closed
+ *          for the time on air times (1 / duty cycle - 1), as the LoRaMac bands do, so no window of any length ever
+ *          sees more than the duty cycle. The airtime spent is counted for every sub-band.
+ *          Times are milliseconds of a 64 bit clock that never wraps, no dependency on the stack, the same code runs
+ *          on the board and on the host
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef __TX_SCHEDULER_H__
+#define __TX_SCHEDULER_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*largest number of sub-bands of a region*/
+#define TX_SCHEDULER_MAX_BANDS          8
+
+/*
+    sub-band of a region, frequencies in Hz, min included and max excluded
+    duty_cycle is the inverse of the duty cycle as in the LoRaMac band tables: 100 is 1%, 1 means no limit
+*/
+struct tx_band {
+    uint32_t min_hz;
+    uint32_t max_hz;
+    uint16_t duty_cycle;
+};
+
+struct tx_scheduler {
+    const struct tx_band* bands;
+    uint8_t n_bands;
+    uint64_t ready_ms[TX_SCHEDULER_MAX_BANDS];          // the sub-band is closed until then
+    uint32_t airtime_ms[TX_SCHEDULER_MAX_BANDS];        // time on air spent in the sub-band
+    uint32_t frames[TX_SCHEDULER_MAX_BANDS];            // frames sent in the sub-band
+    uint32_t other_airtime_ms;                          // time on air spent outside the sub-bands of the table
+};
+
+/**
+ * @brief time on air of a LoRa frame
+ *
+ * @param sf spreading factor, 7 to 12
+ * @param bw_hz bandwidth in Hz
+ * @param cr coding rate, 1 to 4 for 4/5 to 4/8
+ * @param preamble preamble symbols
+ * @param explicit_header explicit header
+ * @param crc payload CRC on
+ * @param payload_len bytes of the PHY payload
+ * @return uint32_t microseconds
+ */
+uint32_t tx_airtime_us( uint8_t sf, uint32_t bw_hz, uint8_t cr, uint16_t preamble, bool explicit_header, bool crc,
+                        uint8_t payload_len );
+
+/**
+ * @brief starts with every sub-band open
+ *
+ * @param s scheduler
+ * @param bands sub-bands of the region, up to TX_SCHEDULER_MAX_BANDS, NULL for a region without duty cycle
+ * @param n_bands number of sub-bands
+ */
+void tx_scheduler_init( struct tx_scheduler* s, const struct tx_band* bands, uint8_t n_bands );
+
+/**
+ * @brief finds the sub-band of a frequency
+ *
+ * @return int index of the sub-band, -1 outside the table
+ */
+int tx_scheduler_band( const struct tx_scheduler* s, uint32_t freq_hz );
+
+/**
+ * @brief counts a transmission and closes its sub-band
+ *
+ * @param s scheduler
+ * @param now_ms start of the transmission
+ * @param freq_hz frequency used
+ * @param airtime_us time on air
+ */
+void tx_scheduler_record( struct tx_scheduler* s, uint64_t now_ms, uint32_t freq_hz, uint32_t airtime_us );
+
+/**
+ * @brief time left before one of the given frequencies can be used
+ *
+ * @param s scheduler
+ * @param now_ms now
+ * @param freqs frequencies the next frame may use, as enabled in the channel mask
+ * @param n_freqs number of frequencies
+ * @return uint32_t milliseconds, 0 if a frequency can be used now or no frequency is given
+ */
+uint32_t tx_scheduler_wait_ms( const struct tx_scheduler* s, uint64_t now_ms, const uint32_t* freqs, uint8_t n_freqs );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __TX_SCHEDULER_H__
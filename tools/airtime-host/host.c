@@ -0,0 +1,183 @@
+/**
+ * @file host.c
+ * @brief host check of the transmit scheduler of src/lorawan.c (src/tx-scheduler.c). The integer time on air is
+ *          compared with the floating point formula of the Semtech datasheets for every spreading factor, bandwidth,
+ *          coding rate, header and CRC setting and PHY payload length, and with the published values of the join
+ *          request. Then a node sends as soon as the scheduler allows it on the EU868 channels for a day: two frames of
+ *          a sub-band must be apart by at least the time on air of the first one divided by the duty cycle, and every
+ *          window of one hour may hold at most the duty cycle plus the part of a frame started before its end, the
+ *          bound of the time-off rule of the LoRaMac bands.
+ *
+ *          build and run from this folder:
+ *          gcc -O2 -Wall -I../../src host.c ../../src/tx-scheduler.c -o host -lm
+ *          ./host
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "tx-scheduler.h"
+
+#define HOUR_MS         (60u * 60 * 1000)
+#define SIM_MS          (24u * HOUR_MS)
+#define MAX_FRAMES      200000
+
+// same table of src/lorawan.c
+static const struct tx_band eu868_bands[] = {
+    {865000000, 868000000, 100},
+    {868000000, 868600000, 100},
+    {868700000, 869200000, 1000},
+    {869400000, 869650000, 10},
+    {869700000, 870000000, 100},
+    {863000000, 865000000, 1000},
+};
+#define EU868_BANDS     (sizeof(eu868_bands) / sizeof(eu868_bands[0]))
+
+// default channels of EU868 and one channel added by the network in the 10% sub-band
+static const uint32_t channels[] = {868100000, 868300000, 868500000, 869525000};
+#define CHANNELS        (sizeof(channels) / sizeof(channels[0]))
+
+static int failures = 0;
+
+/**
+ * @brief time on air in seconds as written in the datasheets
+ */
+static double reference_airtime(int sf, double bw, int cr, int preamble, int explicit_header, int crc, int pl){
+    double t_sym = pow(2, sf) / bw;
+    int de = t_sym >= 0.016;
+    double n = ceil((8.0 * pl - 4 * sf + 28 + 16 * crc - 20 * !explicit_header) / (4.0 * (sf - 2 * de))) * (cr + 4);
+    double payload_symbols = 8 + (n > 0 ? n : 0);
+    return (preamble + 4.25 + payload_symbols) * t_sym;
+}
+
+static void check_formula(void){
+    const uint32_t bws[] = {125000, 250000, 500000};
+    long cases = 0;
+    double worst = 0;
+    for(int sf = 7; sf <= 12; sf++)
+        for(int b = 0; b < 3; b++)
+            for(int cr = 1; cr <= 4; cr++)
+                for(int h = 0; h <= 1; h++)
+                    for(int crc = 0; crc <= 1; crc++)
+                        for(int pl = 0; pl <= 255; pl++){
+                            double ref_us = reference_airtime(sf, bws[b], cr, 8, h, crc, pl) * 1e6;
+                            uint32_t us = tx_airtime_us(sf, bws[b], cr, 8, h, crc, pl);
+                            //rounded up to the microsecond
+                            double diff = us - ref_us;
+                            if(diff < -1e-6 || diff >= 1){
+                                failures++;
+                                if(failures < 10)
+                                    printf("FAIL SF%d BW%u CR4/%d header %d crc %d len %d: %u us, formula %.3f us\n",
+                                        sf, bws[b], cr + 4, h, crc, pl, us, ref_us);
+                            }
+                            if(diff > worst)
+                                worst = diff;
+                            cases++;
+                        }
+    printf("%ld settings checked against the formula, largest rounding %.3f us\n", cases, worst);
+
+    //join request, 23 bytes, CR 4/5, explicit header, CRC on
+    struct { uint8_t sf; uint32_t us; } published[] = {{7, 61696}, {12, 1482752}};
+    for(int i = 0; i < 2; i++){
+        uint32_t us = tx_airtime_us(published[i].sf, 125000, 1, 8, true, true, 23);
+        if(us != published[i].us){
+            failures++;
+            printf("FAIL join request at SF%u: %u us instead of %u\n", published[i].sf, us, published[i].us);
+        }
+    }
+}
+
+/*
+    transmissions of the day, to measure every window afterwards
+*/
+static uint32_t frame_start[MAX_FRAMES];
+static uint32_t frame_airtime[MAX_FRAMES];
+static int8_t frame_band[MAX_FRAMES];
+
+static void check_duty_cycle(void){
+    struct tx_scheduler s;
+    tx_scheduler_init(&s, eu868_bands, EU868_BANDS);
+    uint32_t now = 0;
+    int n = 0;
+    srand(1);
+    //the clock doesn't start at 0, as after a long uptime
+    const uint64_t base = 60ull * 24 * HOUR_MS;
+    while(now < SIM_MS && n < MAX_FRAMES){
+        uint32_t wait = tx_scheduler_wait_ms(&s, base + now, channels, CHANNELS);
+        now += wait;
+        //the MAC picks a random channel among the free ones
+        uint32_t freq;
+        do
+            freq = channels[rand() % CHANNELS];
+        while(tx_scheduler_wait_ms(&s, base + now, &freq, 1) != 0);
+        uint8_t sf = 7 + rand() % 6;
+        uint32_t us = tx_airtime_us(sf, 125000, 1, 8, true, true, 13 + rand() % 52);
+        tx_scheduler_record(&s, base + now, freq, us);
+        frame_start[n] = now;
+        frame_airtime[n] = (us + 999) / 1000;
+        frame_band[n] = tx_scheduler_band(&s, freq);
+        n++;
+        now += frame_airtime[n - 1];
+    }
+
+    //time-off after every frame, per sub-band
+    int last[EU868_BANDS];
+    for(uint8_t b = 0; b < EU868_BANDS; b++)
+        last[b] = -1;
+    for(int i = 0; i < n; i++){
+        int p = last[frame_band[i]];
+        if(p >= 0 && frame_start[i] - frame_start[p] < frame_airtime[p] * eu868_bands[frame_band[i]].duty_cycle){
+            failures++;
+            if(failures < 10)
+                printf("FAIL sub-band %d: frame at %u ms only %u ms after the previous one of %u ms\n", frame_band[i],
+                    frame_start[i], frame_start[i] - frame_start[p], frame_airtime[p]);
+        }
+        last[frame_band[i]] = i;
+    }
+
+    //every window of one hour starting at a frame, per sub-band
+    uint32_t worst_basis[EU868_BANDS] = {0};
+    for(int i = 0; i < n; i++){
+        uint32_t tail = 0;
+        uint32_t used = 0;
+        for(int j = i; j < n && frame_start[j] < frame_start[i] + HOUR_MS; j++)
+            if(frame_band[j] == frame_band[i]){
+                //only the part of the frame inside the window
+                uint32_t end = frame_start[j] + frame_airtime[j];
+                uint32_t window_end = frame_start[i] + HOUR_MS;
+                used += end > window_end ? window_end - frame_start[j] : frame_airtime[j];
+                tail = frame_airtime[j];
+            }
+        uint32_t limit = HOUR_MS / eu868_bands[frame_band[i]].duty_cycle + tail;
+        if(used > limit){
+            failures++;
+            if(failures < 10)
+                printf("FAIL sub-band %d: %u ms in the hour from %u ms, limit %u ms\n", frame_band[i], used, frame_start[i], limit);
+        }
+        uint32_t basis = (uint32_t)((uint64_t)used * 10000 / HOUR_MS);
+        if(basis > worst_basis[frame_band[i]])
+            worst_basis[frame_band[i]] = basis;
+    }
+    printf("%d frames sent in a day as soon as allowed\n", n);
+    for(uint8_t b = 0; b < EU868_BANDS; b++)
+        if(s.frames[b] > 0)
+            printf("  sub-band %u (%.1f%%): %u frames, %u ms on air, busiest hour %.2f%%\n", b,
+                100.0 / eu868_bands[b].duty_cycle, s.frames[b], s.airtime_ms[b], worst_basis[b] / 100.0);
+
+    //a frequency outside the table is never held back
+    uint32_t outside = 915000000;
+    if(tx_scheduler_wait_ms(&s, base + now, &outside, 1) != 0){
+        failures++;
+        printf("FAIL frequency outside the sub-bands held back\n");
+    }
+}
+
+int main(){
+    check_formula();
+    check_duty_cycle();
+    printf("%s\n", failures ? "FAILED" : "all checks passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,80 @@
+/*
+    second half of the batch host check, reads the JSON of ./host js on stdin:
+    - every frame encoded by lib/batch goes through Decode of executables/class-a/codec.js on the batch port and must
+      give back the id, the readings with their physical values and ages, and no ack
+    - the time on air of tx_airtime_us of the transmit scheduler must match timeOnAir of executables/class-a/airtime.js
+      for every datarate and payload length, within the microsecond the C code rounds to
+    run from this folder with ./host js | node check.js
+*/
+
+var fs = require("fs");
+var path = require("path");
+var vm = require("vm");
+
+var CLASS_A = path.join(__dirname, "..", "..", "executables", "class-a");
+var BATCH_PORT = 4;
+var DEV_ID = 0x0102;
+
+/* a script of class-a run apart from this file with its console.log calls silenced, returning the names asked */
+function load(file, names){
+    var full = path.join(CLASS_A, file);
+    var wrap = "(function(console){\n" + fs.readFileSync(full, "utf8") + "\nreturn { " +
+               names.map(function(n){ return "\"" + n + "\": " + n; }).join(", ") + " };\n})";
+    return vm.runInThisContext(wrap, { "filename": full, "lineOffset": -1 })({ "log": function(){} });
+}
+
+var codec = load("codec.js", ["Decode"]);
+var airtime = load("airtime.js", ["timeOnAir", "DATARATES"]);
+
+var failures = 0;
+function check(cond, msg){
+    if(!cond){
+        failures++;
+        console.log("FAIL: " + msg);
+    }
+}
+
+/* the physical values of a raw reading, as documented for the batch frame in lib/payload/payload.json */
+function expected(raw){
+    return {
+        "temp": raw.temp / 100,
+        "hum": raw.hum / 100,
+        "press": raw.press / 10,
+        "AQI": raw.AQI == 0 ? 'nan' : raw.AQI / 10,
+        "CO2": raw.CO2 == 0 ? 'nan' : raw.CO2,
+        "age": raw.age,
+    };
+}
+
+var input = JSON.parse(fs.readFileSync(0, "utf8"));
+var readings = 0;
+
+input.frames.forEach(function(f, i){
+    var obj = codec.Decode(BATCH_PORT, f.bytes);
+    check(obj.id === DEV_ID, "frame " + i + ": id " + obj.id);
+    check(obj.ack === undefined, "frame " + i + ": ack decoded from the readings");
+    check(obj.readings.length === f.readings.length, "frame " + i + ": " + obj.readings.length + " readings instead of " +
+          f.readings.length);
+    f.readings.forEach(function(raw, r){
+        var want = JSON.stringify(expected(raw));
+        var got = JSON.stringify(obj.readings[r]);
+        check(got === want, "frame " + i + " reading " + r + ": " + got + " instead of " + want);
+    });
+    readings += f.readings.length;
+});
+
+var worst = 0;
+input.airtime.forEach(function(a){
+    var dr = airtime.DATARATES[a.dr];
+    var ms = airtime.timeOnAir(dr, a.len);
+    var diff = Math.abs(ms - a.us / 1000);
+    if(diff > worst)
+        worst = diff;
+    check(diff <= 0.001, "DR" + a.dr + " " + a.len + " bytes: " + a.us + " us in C, " + ms.toFixed(3) + " ms in airtime.js");
+});
+
+console.log("| frames | readings | airtime lengths | largest airtime difference (us) |");
+console.log("|--------|----------|-----------------|---------------------------------|");
+console.log("| " + input.frames.length + " | " + readings + " | " + input.airtime.length + " | " + (worst * 1000).toFixed(1) + " |");
+console.log("\n" + (failures ? "FAILED" : "all checks passed"));
+process.exit(failures ? 1 : 0);
@@ -0,0 +1,264 @@
+/**
+ * @file host.c
+ * @brief host check of the batched uplink of class-a (executables/lib/batch): the three reasons to flush (size of
+ *          the payload of the datarate, age of the oldest reading, urgent reading), the partial encode that leaves
+ *          the readings that don't fit for the next frame, the age of every reading and its saturation, a full
+ *          batch and a payload too small. Then the time on air per reading for every batch size and EU868
+ *          datarate, with the integer time on air of the transmit scheduler (src/tx-scheduler.c).
+ *          With the argument js the frames of a random run, the readings they hold and the table of time on air
+ *          are printed as JSON for check.js, which decodes the frames with executables/class-a/codec.js and
+ *          compares the time on air with executables/class-a/airtime.js.
+ *
+ *          build and run from this folder:
+ *          gcc -O2 -Wall -I../../executables/lib/batch -I../../executables/lib/payload -I../../src host.c \
+ *              ../../executables/lib/batch/batch.c ../../src/tx-scheduler.c -o host
+ *          ./host
+ *          ./host js | node check.js
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "batch.h"
+#include "payload.h"
+#include "tx-scheduler.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do{ \
+        if(!(cond)){ \
+            failures++; \
+            printf("FAIL line %d: ", __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    }while(0)
+
+// MHDR (1) + FHDR without FOpts (7) + FPort (1) + MIC (4), as airtime.js
+#define LORAWAN_OVERHEAD    13
+#define SINGLE_UPLINK_LEN   PAYLOAD_UPLINK_LEN
+#define DEV_ID              0x0102
+
+// EU868 datarates with the max application payload without FOpts, as airtime.js
+static const struct { uint8_t dr, sf; uint8_t max_payload; } datarates[] = {
+    {0, 12, 51}, {1, 11, 51}, {2, 10, 51}, {3, 9, 115}, {4, 8, 222}, {5, 7, 222},
+};
+
+#define N_DATARATES         (sizeof(datarates) / sizeof(datarates[0]))
+
+static struct payload_reading reading_of(uint32_t n){
+    struct payload_reading r = {
+        .temp = (int16_t)(2000 + (int)(n % 900) - 450),
+        .hum = (uint16_t)(4000 + n % 2000),
+        .press = (uint16_t)(9800 + n % 300),
+        .AQI = (uint16_t)(n % 7 == 0 ? 0 : 500 + n % 1000),
+        .CO2 = (uint16_t)(600 + n % 3000),
+    };
+    return r;
+}
+
+static void add(struct batch* b, uint32_t n, uint32_t now_s, bool urgent){
+    uint8_t record[PAYLOAD_READING_LEN];
+    struct payload_reading r = reading_of(n);
+    payload_reading_encode(&r, record);
+    CHECK(batch_add(b, record, now_s, urgent) > 0, "add of reading %u", n);
+}
+
+// the readings of a frame must be first, first + 1.. with the age of their time
+static void check_frame(const uint8_t* frame, int len, uint8_t count, uint32_t first, const uint32_t* time_s,
+                        uint32_t now_s){
+    CHECK(len == BATCH_HEADER_LEN + count * (BATCH_AGE_LEN + PAYLOAD_READING_LEN), "frame of %d bytes for %u readings",
+        len, count);
+    CHECK(frame[0] == (DEV_ID & 0xFF) && frame[1] == (DEV_ID >> 8) && frame[2] == count, "frame header %02x %02x %u",
+        frame[0], frame[1], frame[2]);
+    const uint8_t* p = frame + BATCH_HEADER_LEN;
+    for(uint8_t i = 0; i < count && len > 0; i++, p += BATCH_AGE_LEN + PAYLOAD_READING_LEN){
+        uint8_t expected[PAYLOAD_READING_LEN];
+        struct payload_reading r = reading_of(first + i);
+        uint32_t age = now_s - time_s[i] > UINT16_MAX ? UINT16_MAX : now_s - time_s[i];
+        payload_reading_encode(&r, expected);
+        CHECK((uint32_t)(p[0] | p[1] << 8) == age, "reading %u: age %u instead of %u", i, p[0] | p[1] << 8, age);
+        CHECK(memcmp(p + BATCH_AGE_LEN, expected, sizeof(expected)) == 0, "reading %u differs", i);
+    }
+}
+
+static void check_flush(void){
+    struct batch b;
+    uint8_t frame[BATCH_MAX_PAYLOAD];
+    uint32_t times[BATCH_MAX_READINGS];
+
+    // DR0 takes 4 readings: (51 - 3) / 12
+    batch_init(&b, DEV_ID, PAYLOAD_READING_LEN, 600);
+    CHECK(batch_pending(&b, 0, 51) == BATCH_FLUSH_NONE, "empty batch pending");
+    CHECK(batch_encode(&b, frame, 51, 0) == 0, "empty batch encoded");
+    for(uint32_t i = 0; i < 3; i++){
+        add(&b, i, 10 * i, false);
+        times[i] = 10 * i;
+        CHECK(batch_pending(&b, 10 * i, 51) == BATCH_FLUSH_NONE, "%u readings pending: %x", i + 1,
+            batch_pending(&b, 10 * i, 51));
+    }
+    add(&b, 3, 30, false);
+    times[3] = 30;
+    CHECK(batch_pending(&b, 30, 51) == BATCH_FLUSH_SIZE, "full DR0 frame: %x", batch_pending(&b, 30, 51));
+    CHECK(batch_pending(&b, 30, 222) == BATCH_FLUSH_NONE, "4 readings at DR5: %x", batch_pending(&b, 30, 222));
+
+    // the oldest reading decides the age
+    CHECK(batch_pending(&b, 599, 222) == BATCH_FLUSH_NONE, "age 599");
+    CHECK(batch_pending(&b, 600, 222) == BATCH_FLUSH_AGE, "age 600: %x", batch_pending(&b, 600, 222));
+
+    // an urgent reading asks for a frame at once, the datarate drops to DR0 at the same time
+    add(&b, 4, 40, true);
+    times[4] = 40;
+    CHECK(batch_pending(&b, 600, 51) == (BATCH_FLUSH_SIZE | BATCH_FLUSH_AGE | BATCH_FLUSH_URGENT), "every reason: %x",
+        batch_pending(&b, 600, 51));
+
+    // a partial encode: 4 readings at DR0, the urgent one stays with its flag
+    int len = batch_encode(&b, frame, 51, 100);
+    check_frame(frame, len, 4, 0, times, 100);
+    CHECK(b.count == 1 && batch_pending(&b, 100, 51) == BATCH_FLUSH_URGENT, "left after the partial encode: %u, %x",
+        b.count, batch_pending(&b, 100, 51));
+    uint32_t time_s;
+    CHECK(batch_record(&b, 0, &time_s) != NULL && time_s == 40 && batch_record(&b, 1, &time_s) == NULL,
+        "the reading left is the newest one");
+    len = batch_encode(&b, frame, 51, 100);
+    check_frame(frame, len, 1, 4, times + 4, 100);
+    CHECK(b.count == 0 && !b.urgent && batch_pending(&b, 100, 51) == BATCH_FLUSH_NONE, "empty after the urgent one");
+
+    // max age 0 flushes every reading
+    batch_init(&b, DEV_ID, PAYLOAD_READING_LEN, 0);
+    add(&b, 0, 5, false);
+    CHECK(batch_pending(&b, 5, 222) == BATCH_FLUSH_AGE, "max age 0: %x", batch_pending(&b, 5, 222));
+}
+
+static void check_limits(void){
+    struct batch b;
+    uint8_t frame[BATCH_MAX_PAYLOAD];
+    uint32_t times[BATCH_MAX_READINGS];
+
+    // the age saturates after 18 hours instead of wrapping
+    batch_init(&b, DEV_ID, PAYLOAD_READING_LEN, 100000);
+    add(&b, 0, 0, false);
+    add(&b, 1, 70000, false);
+    times[0] = 0;
+    times[1] = 70000;
+    int len = batch_encode(&b, frame, 222, 70010);
+    check_frame(frame, len, 2, 0, times, 70010);
+
+    // a time base that wraps around gives the right age
+    add(&b, 0, UINT32_MAX - 5, false);
+    times[0] = UINT32_MAX - 5;
+    CHECK(batch_pending(&b, 4, 222) == BATCH_FLUSH_NONE, "age across the wrap");
+    len = batch_encode(&b, frame, 222, 4);
+    check_frame(frame, len, 1, 0, times, 4);
+
+    // the buffer holds BATCH_MAX_PAYLOAD bytes of readings, then they are refused
+    batch_init(&b, DEV_ID, PAYLOAD_READING_LEN, 600);
+    int held = 0;
+    uint8_t record[PAYLOAD_READING_LEN] = {0};
+    while(batch_add(&b, record, 0, false) > 0)
+        held++;
+    CHECK(held == BATCH_MAX_PAYLOAD / PAYLOAD_READING_LEN && b.count == held, "%d readings held", held);
+    CHECK(batch_add(&b, record, 0, false) == BATCH_E_FULL, "a reading more than the buffer");
+
+    // not even one reading fits, nothing is dropped
+    CHECK(batch_encode(&b, frame, BATCH_HEADER_LEN + BATCH_AGE_LEN + PAYLOAD_READING_LEN - 1, 0) == BATCH_E_TOO_SMALL,
+        "payload too small");
+    CHECK(b.count == held, "readings dropped by a payload too small");
+    batch_drop(&b, 255);
+    CHECK(b.count == 0, "drop of more readings than held");
+}
+
+static uint32_t airtime_us(uint8_t sf, int app_payload){
+    return tx_airtime_us(sf, 125000, 1, 8, true, true, (uint8_t)(LORAWAN_OVERHEAD + app_payload));
+}
+
+static void print_airtime(void){
+    printf("time on air per reading (ms), EU868, %d byte readings, against the single %d byte uplink\n\n",
+        PAYLOAD_READING_LEN, SINGLE_UPLINK_LEN);
+    printf("| readings |");
+    for(unsigned d = 0; d < N_DATARATES; d++)
+        printf(" DR%u SF%u |", datarates[d].dr, datarates[d].sf);
+    printf("\n|----------|");
+    for(unsigned d = 0; d < N_DATARATES; d++)
+        printf("---------|");
+    printf("\n| single |");
+    for(unsigned d = 0; d < N_DATARATES; d++)
+        printf(" %.1f |", airtime_us(datarates[d].sf, SINGLE_UPLINK_LEN) / 1000.0);
+    printf("\n");
+    for(int n = 1; n <= (222 - BATCH_HEADER_LEN) / (BATCH_AGE_LEN + PAYLOAD_READING_LEN); n++){
+        printf("| %d |", n);
+        for(unsigned d = 0; d < N_DATARATES; d++){
+            int len = BATCH_HEADER_LEN + n * (BATCH_AGE_LEN + PAYLOAD_READING_LEN);
+            if(len <= datarates[d].max_payload)
+                printf(" %.1f |", airtime_us(datarates[d].sf, len) / 1000.0 / n);
+            else
+                printf(" - |");
+        }
+        printf("\n");
+    }
+}
+
+// a random run of readings and frames at random datarates, as JSON for check.js
+static void print_js(void){
+    struct batch b;
+    uint8_t frame[BATCH_MAX_PAYLOAD];
+    uint32_t next = 0, first = 0, now_s = 1000;
+    const char* sep = "";
+
+    srand(1);
+    batch_init(&b, DEV_ID, PAYLOAD_READING_LEN, 900);
+    printf("{\"frames\": [");
+    for(int f = 0; f < 200; f++){
+        uint8_t max_payload = datarates[rand() % N_DATARATES].max_payload;
+        do{
+            now_s += 30 + rand() % 120;
+            add(&b, next++, now_s, rand() % 40 == 0);
+        }while(batch_pending(&b, now_s, max_payload) == BATCH_FLUSH_NONE);
+
+        uint32_t times[BATCH_MAX_READINGS];
+        for(uint8_t i = 0; i < b.count; i++)
+            batch_record(&b, i, &times[i]);
+        now_s += rand() % 5;
+        int len = batch_encode(&b, frame, max_payload, now_s);
+        int count = len > 0 ? frame[2] : 0;
+
+        printf("%s\n{\"bytes\": [", sep);
+        for(int i = 0; i < len; i++)
+            printf("%s%u", i ? "," : "", frame[i]);
+        printf("], \"readings\": [");
+        for(int i = 0; i < count; i++){
+            struct payload_reading r = reading_of(first + i);
+            printf("%s{\"temp\": %d, \"hum\": %u, \"press\": %u, \"AQI\": %u, \"CO2\": %u, \"age\": %u}", i ? "," : "",
+                r.temp, r.hum, r.press, r.AQI, r.CO2, now_s - times[i]);
+        }
+        printf("]}");
+        first += count;
+        sep = ",";
+    }
+    printf("],\n\"airtime\": [");
+    sep = "";
+    for(unsigned d = 0; d < N_DATARATES; d++)
+        for(int len = 1; len <= datarates[d].max_payload; len++){
+            printf("%s{\"dr\": %u, \"len\": %d, \"us\": %u}", sep, datarates[d].dr, len, airtime_us(datarates[d].sf, len));
+            sep = ",";
+        }
+    printf("]}\n");
+}
+
+int main(int argc, char* argv[]){
+    check_flush();
+    check_limits();
+
+    if(argc > 1 && strcmp(argv[1], "js") == 0){
+        if(failures == 0)
+            print_js();
+        return failures == 0 ? 0 : 1;
+    }
+
+    print_airtime();
+    printf("\n%s\n", failures == 0 ? "all checks passed" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,250 @@
+/**
+ * @file host.c
+ * @brief host check of the control register shadow of executables/lib/bme/bme68x: the driver runs on an emulated
+ *          BME688 on I2C that counts the bus transactions and the time spent in delay_us. The BSEC cycles of the
+ *          executables run with the shadow off and on: a forced mode measurement (sensing), the parallel mode setup
+ *          and read of class-c and the switch back to sleep. The registers of the sensor must end up the same with
+ *          and without the shadow, every valid entry of the shadow must match the sensor and a soft reset must drop
+ *          it. A table gives the bus transactions of each cycle.
+ *
+ *          build and run from this folder:
+ *          gcc -O2 -Wall -I../../executables/lib/bme/bme68x host.c ../../executables/lib/bme/bme68x/bme68x.c -o host
+ *          ./host
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "bme68x.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do{ \
+        if(!(cond)){ \
+            failures++; \
+            printf("FAIL line %d: ", __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    }while(0)
+
+// emulated sensor, the 256 registers of the I2C map
+struct sensor {
+    uint8_t regs[256];
+    unsigned reads;
+    unsigned writes;
+    unsigned long delay_us;
+};
+
+static void sensor_reset(struct sensor* s){
+    // the control registers go back to 0, the trimming and the ids stay
+    memset(s->regs + BME68X_REG_IDAC_HEAT0, 0, BME68X_REG_CONFIG - BME68X_REG_IDAC_HEAT0 + 1);
+}
+
+static void sensor_init(struct sensor* s){
+    memset(s, 0, sizeof(*s));
+    s->regs[BME68X_REG_CHIP_ID] = BME68X_CHIP_ID;
+    s->regs[BME68X_REG_VARIANT_ID] = BME68X_VARIANT_GAS_HIGH;
+    // plausible trimming, the compensation must not divide by zero
+    for(int r = BME68X_REG_COEFF1; r < BME68X_REG_COEFF1 + BME68X_LEN_COEFF1; r++)
+        s->regs[r] = (uint8_t)(0x40 + r);
+    for(int r = BME68X_REG_COEFF2; r < BME68X_REG_COEFF2 + BME68X_LEN_COEFF2; r++)
+        s->regs[r] = (uint8_t)(0x30 + r);
+    for(int r = BME68X_REG_COEFF3; r < BME68X_REG_COEFF3 + BME68X_LEN_COEFF3; r++)
+        s->regs[r] = (uint8_t)(0x20 + r);
+}
+
+// a measurement is always ready: the three fields hold new data with a valid, stable gas reading
+static void sensor_measure(struct sensor* s){
+    for(int f = 0; f < 3; f++){
+        uint8_t* field = s->regs + BME68X_REG_FIELD0 + f * BME68X_LEN_FIELD_OFFSET;
+        field[0] = BME68X_NEW_DATA_MSK | (uint8_t)f;
+        field[1] = (uint8_t)(field[1] + 1);
+        for(int i = 2; i < BME68X_LEN_FIELD; i++)
+            field[i] = (uint8_t)(0x55 + i);
+        field[16] |= BME68X_GASM_VALID_MSK | BME68X_HEAT_STAB_MSK;
+    }
+}
+
+static BME68X_INTF_RET_TYPE bus_read(uint8_t reg_addr, uint8_t* reg_data, uint32_t len, void* intf_ptr){
+    struct sensor* s = intf_ptr;
+    s->reads++;
+    if(reg_addr + len > sizeof(s->regs))
+        return -1;
+    memcpy(reg_data, s->regs + reg_addr, len);
+    return BME68X_INTF_RET_SUCCESS;
+}
+
+static void bus_write_reg(struct sensor* s, uint8_t reg, uint8_t value){
+    if(reg == BME68X_REG_SOFT_RESET){
+        if(value == BME68X_SOFT_RESET_CMD)
+            sensor_reset(s);
+        return;
+    }
+    s->regs[reg] = value;
+    if(reg == BME68X_REG_CTRL_MEAS && (value & BME68X_MODE_MSK) != BME68X_SLEEP_MODE){
+        sensor_measure(s);
+        // forced mode is over at once and the sensor is back to sleep, parallel mode goes on
+        if((value & BME68X_MODE_MSK) == BME68X_FORCED_MODE)
+            s->regs[reg] = value & (uint8_t)~BME68X_MODE_MSK;
+    }
+}
+
+// the driver writes address and value pairs in one transaction, the first address is the register address
+static BME68X_INTF_RET_TYPE bus_write(uint8_t reg_addr, const uint8_t* reg_data, uint32_t len, void* intf_ptr){
+    struct sensor* s = intf_ptr;
+    s->writes++;
+    bus_write_reg(s, reg_addr, reg_data[0]);
+    for(uint32_t i = 1; i + 1 < len; i += 2)
+        bus_write_reg(s, reg_data[i], reg_data[i + 1]);
+    return BME68X_INTF_RET_SUCCESS;
+}
+
+static void delay(uint32_t period, void* intf_ptr){
+    struct sensor* s = intf_ptr;
+    s->delay_us += period;
+}
+
+static void device_init(struct bme68x_dev* dev, struct sensor* s, uint8_t shadow_en){
+    sensor_init(s);
+    memset(dev, 0, sizeof(*dev));
+    dev->read = bus_read;
+    dev->write = bus_write;
+    dev->delay_us = delay;
+    dev->intf = BME68X_I2C_INTF;
+    dev->intf_ptr = s;
+    dev->amb_temp = 20;
+    dev->shadow_en = shadow_en;
+    CHECK(bme68x_init(dev) == BME68X_OK, "bme68x_init");
+}
+
+static void check_shadow(const struct bme68x_dev* dev, const struct sensor* s, const char* when){
+    for(int i = 0; i < BME68X_LEN_SHADOW; i++)
+        if(dev->shadow_valid & (1u << i))
+            CHECK(dev->shadow[i] == s->regs[BME68X_REG_CTRL_GAS_0 + i], "%s: shadow of 0x%02x is 0x%02x, the sensor 0x%02x",
+                when, BME68X_REG_CTRL_GAS_0 + i, dev->shadow[i], s->regs[BME68X_REG_CTRL_GAS_0 + i]);
+}
+
+// settings of bsec_sensor_control in the LP and the parallel mode of the executables
+static uint16_t temp_prof[10] = {320, 100, 100, 100, 200, 200, 200, 320, 320, 320};
+static uint16_t dur_prof[10] = {5, 2, 10, 30, 5, 5, 5, 5, 5, 5};
+
+static void cycle_forced(struct bme68x_dev* dev){
+    struct bme68x_conf conf = { .filter = BME68X_FILTER_OFF, .odr = BME68X_ODR_NONE,
+        .os_hum = BME68X_OS_1X, .os_pres = BME68X_OS_1X, .os_temp = BME68X_OS_1X };
+    struct bme68x_heatr_conf heatr = { .enable = BME68X_ENABLE, .heatr_temp = 320, .heatr_dur = 197 };
+    struct bme68x_data data;
+    uint8_t n_fields;
+    CHECK(bme68x_set_conf(&conf, dev) == BME68X_OK, "forced set_conf");
+    CHECK(bme68x_set_heatr_conf(BME68X_FORCED_MODE, &heatr, dev) == BME68X_OK, "forced set_heatr_conf");
+    CHECK(bme68x_set_op_mode(BME68X_FORCED_MODE, dev) == BME68X_OK, "forced set_op_mode");
+    CHECK(bme68x_get_data(BME68X_FORCED_MODE, &data, &n_fields, dev) == BME68X_OK && n_fields == 1, "forced get_data");
+}
+
+static void cycle_parallel(struct bme68x_dev* dev){
+    struct bme68x_conf conf = { .filter = BME68X_FILTER_OFF, .odr = BME68X_ODR_NONE,
+        .os_hum = BME68X_OS_1X, .os_pres = BME68X_OS_4X, .os_temp = BME68X_OS_2X };
+    struct bme68x_heatr_conf heatr = { .enable = BME68X_ENABLE, .heatr_temp_prof = temp_prof,
+        .heatr_dur_prof = dur_prof, .profile_len = 10 };
+    struct bme68x_data data[3];
+    uint8_t n_fields, op_mode;
+    CHECK(bme68x_set_conf(&conf, dev) == BME68X_OK, "parallel set_conf");
+    heatr.shared_heatr_dur = (uint16_t)(140 - bme68x_get_meas_dur(BME68X_PARALLEL_MODE, &conf, dev) / 1000);
+    CHECK(bme68x_set_heatr_conf(BME68X_PARALLEL_MODE, &heatr, dev) == BME68X_OK, "parallel set_heatr_conf");
+    CHECK(bme68x_set_op_mode(BME68X_PARALLEL_MODE, dev) == BME68X_OK, "parallel set_op_mode");
+    CHECK(bme68x_get_op_mode(&op_mode, dev) == BME68X_OK && op_mode == BME68X_PARALLEL_MODE, "parallel get_op_mode");
+    CHECK(bme68x_get_data(BME68X_PARALLEL_MODE, data, &n_fields, dev) == BME68X_OK && n_fields > 0, "parallel get_data");
+}
+
+static void cycle_sleep(struct bme68x_dev* dev){
+    uint8_t op_mode;
+    CHECK(bme68x_set_op_mode(BME68X_SLEEP_MODE, dev) == BME68X_OK, "sleep set_op_mode");
+    CHECK(bme68x_get_op_mode(&op_mode, dev) == BME68X_OK && op_mode == BME68X_SLEEP_MODE, "sleep get_op_mode");
+}
+
+struct cycle {
+    const char* name;
+    void (*run)(struct bme68x_dev* dev);
+};
+
+static const struct cycle cycles[] = {
+    {"forced measurement (sensing, class-a)", cycle_forced},
+    {"parallel setup and read (class-c)", cycle_parallel},
+    {"back to sleep (class-c)", cycle_sleep},
+};
+
+#define N_CYCLES    (sizeof(cycles) / sizeof(cycles[0]))
+#define ROUNDS      20
+
+struct count {
+    unsigned reads, writes;
+    unsigned long delay_us;
+};
+
+// ROUNDS of the BSEC sequence, the transactions of the last one: the first after init has the shadow still filling
+static void run(uint8_t shadow_en, struct sensor* s, struct count* counts){
+    struct bme68x_dev dev;
+    device_init(&dev, s, shadow_en);
+    for(int round = 0; round < ROUNDS; round++)
+        for(unsigned c = 0; c < N_CYCLES; c++){
+            unsigned reads = s->reads, writes = s->writes;
+            unsigned long delay_us = s->delay_us;
+            cycles[c].run(&dev);
+            counts[c].reads = s->reads - reads;
+            counts[c].writes = s->writes - writes;
+            counts[c].delay_us = s->delay_us - delay_us;
+            check_shadow(&dev, s, cycles[c].name);
+        }
+}
+
+static void check_soft_reset(void){
+    struct sensor s;
+    struct bme68x_dev dev;
+    device_init(&dev, &s, BME68X_ENABLE);
+    cycle_forced(&dev);
+    CHECK(dev.shadow_valid != 0, "the shadow is empty after a forced cycle");
+    CHECK(bme68x_soft_reset(&dev) == BME68X_OK, "soft reset");
+    CHECK(dev.shadow_valid == 0, "the shadow is still valid after a soft reset: 0x%02x", dev.shadow_valid);
+
+    // the shadow is filled again from the bus, the reset values
+    uint8_t regs[BME68X_LEN_SHADOW];
+    unsigned reads = s.reads;
+    CHECK(bme68x_get_regs(BME68X_REG_CTRL_GAS_0, regs, sizeof(regs), &dev) == BME68X_OK, "read after reset");
+    CHECK(s.reads == reads + 1, "the read after reset didn't go to the bus");
+    CHECK(memcmp(regs, s.regs + BME68X_REG_CTRL_GAS_0, sizeof(regs)) == 0, "read after reset differs from the sensor");
+    reads = s.reads;
+    CHECK(bme68x_get_regs(BME68X_REG_CTRL_GAS_0, regs, sizeof(regs), &dev) == BME68X_OK, "second read");
+    CHECK(s.reads == reads, "the second read went to the bus");
+    check_shadow(&dev, &s, "after reset");
+
+    // a register outside the window always goes to the bus
+    uint8_t id;
+    reads = s.reads;
+    CHECK(bme68x_get_regs(BME68X_REG_CHIP_ID, &id, 1, &dev) == BME68X_OK && id == BME68X_CHIP_ID, "chip id");
+    CHECK(s.reads == reads + 1, "the chip id read didn't go to the bus");
+}
+
+int main(void){
+    struct sensor off, on;
+    struct count count_off[N_CYCLES], count_on[N_CYCLES];
+
+    run(BME68X_DISABLE, &off, count_off);
+    run(BME68X_ENABLE, &on, count_on);
+    CHECK(memcmp(off.regs, on.regs, sizeof(off.regs)) == 0, "the sensor registers differ with the shadow");
+    check_soft_reset();
+
+    printf("| BSEC cycle | reads, no shadow | reads, shadow | writes | delay (ms) |\n");
+    printf("|------------|------------------|---------------|--------|------------|\n");
+    for(unsigned c = 0; c < N_CYCLES; c++){
+        CHECK(count_on[c].writes == count_off[c].writes, "%s: %u writes with the shadow, %u without", cycles[c].name,
+            count_on[c].writes, count_off[c].writes);
+        CHECK(count_on[c].reads <= count_off[c].reads, "%s: more reads with the shadow", cycles[c].name);
+        printf("| %s | %u | %u | %u | %lu |\n", cycles[c].name, count_off[c].reads, count_on[c].reads,
+            count_on[c].writes, count_on[c].delay_us / 1000);
+    }
+
+    printf("\n%s\n", failures == 0 ? "all checks passed" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
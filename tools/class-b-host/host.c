@@ -0,0 +1,155 @@
+/**
+ * @file host.c
+ * @brief host check of the class B timing of src/lorawan.c (src/class-b.c): the ping period of every periodicity,
+ *          the AES block of the ping offset, the wait until the next ping slot or beacon walked millisecond by
+ *          millisecond through beacon periods with random ping offsets (as many slots as pingNb, never in the
+ *          beacon reserved or guard, the wait counting down to every slot), and the longest wait of a downlink
+ *          against class_b_worst_latency_ms. Then the average current of class B and of class C at the same
+ *          worst-case latency is printed for every periodicity, with the beacon at SF9 and the ping slots at DR3 of
+ *          EU868.
+ *
+ *          build and run from this folder:
+ *          gcc -O2 -Wall -I../../src host.c ../../src/class-b.c ../../src/tx-scheduler.c -o host
+ *          ./host [sleep current uA] [receive current uA]
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "class-b.h"
+#include "tx-scheduler.h"
+
+#define PERIODS         64
+
+// 17 bytes of EU868 beacon at SF9 BW125, 10 symbols of preamble, implicit header, no PHY CRC
+#define BEACON_SF       9
+#define BEACON_LEN      17
+// window widening of a locked beacon on each side and wake-up of the radio
+#define WIDENING_US     10000
+#define WAKEUP_US       3500
+// an empty ping slot at SF9 closes after 8 symbols of timeout
+#define PING_SYMBOLS    8
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do{ \
+        if(!(cond)){ \
+            failures++; \
+            printf("FAIL line %d: ", __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    }while(0)
+
+static void check_period(void){
+    for(uint8_t p = 0; p <= CLASS_B_MAX_PERIODICITY; p++)
+        CHECK(class_b_ping_period(p) == 32 << p, "periodicity %u: period %u", p, class_b_ping_period(p));
+    CHECK(class_b_ping_period(9) == 4096, "periodicity out of range not capped");
+
+    uint8_t block[16];
+    class_b_ping_block(0x12345680, 0x26011bda, block);
+    const uint8_t expected[16] = {0x80, 0x56, 0x34, 0x12, 0xda, 0x1b, 0x01, 0x26};
+    for(int i = 0; i < 16; i++)
+        CHECK(block[i] == expected[i], "block byte %d is %02x instead of %02x", i, block[i], expected[i]);
+
+    const uint8_t rand_bytes[16] = {0x34, 0x12};
+    CHECK(class_b_ping_offset(rand_bytes, 7) == 0x1234 % 4096, "offset %u", class_b_ping_offset(rand_bytes, 7));
+    CHECK(class_b_ping_offset(rand_bytes, 0) == 0x1234 % 32, "offset %u", class_b_ping_offset(rand_bytes, 0));
+}
+
+/*
+    walks PERIODS beacon periods with a new random offset in each, gives the longest wait of a downlink
+*/
+static uint32_t walk(uint8_t p){
+    uint32_t period = class_b_ping_period(p);
+    uint32_t longest = 0;
+    int64_t last_start = -1;
+
+    for(int b = 0; b < PERIODS; b++){
+        uint8_t rand_bytes[16] = {rand() & 0xff, rand() & 0xff};
+        uint16_t offset = class_b_ping_offset(rand_bytes, p);
+        // the worst pair of offsets comes once, the first slot of a period and the last one of the next
+        if(b == 1)
+            offset = 0;
+        if(b == 2)
+            offset = period - 1;
+        uint32_t slots = 0;
+        uint32_t expected_wait = 0;
+        int in_slot = 0;
+
+        for(uint32_t t = 0; t < CLASS_B_BEACON_PERIOD_MS; t++){
+            uint64_t gps_ms = (uint64_t)(1000 + b) * CLASS_B_BEACON_PERIOD_MS + t;
+            bool beacon;
+            uint32_t wait = class_b_next_ms(gps_ms, p, offset, &beacon);
+
+            if(t < CLASS_B_BEACON_RESERVED_MS){
+                CHECK(wait == 0 && beacon, "periodicity %u: %u ms in the beacon reserved, wait %u", p, t, wait);
+                continue;
+            }
+            if(wait == 0){
+                CHECK(!beacon, "beacon flag inside a ping slot");
+                CHECK(t < CLASS_B_BEACON_PERIOD_MS - CLASS_B_BEACON_GUARD_MS, "periodicity %u: slot in the guard at %u", p, t);
+                if(!in_slot){
+                    slots++;
+                    CHECK((t - CLASS_B_BEACON_RESERVED_MS) % CLASS_B_SLOT_MS == 0 &&
+                          ((t - CLASS_B_BEACON_RESERVED_MS) / CLASS_B_SLOT_MS) % period == offset,
+                          "periodicity %u offset %u: slot at %u", p, offset, t);
+                    CHECK(expected_wait == 0 || expected_wait == 1, "wait ended at %u", expected_wait);
+                    int64_t start = (int64_t)gps_ms;
+                    if(last_start >= 0 && start - last_start > longest)
+                        longest = (uint32_t)(start - last_start);
+                    last_start = start;
+                }
+                in_slot = 1;
+            }else{
+                in_slot = 0;
+                CHECK(expected_wait == 0 || wait == expected_wait - 1, "periodicity %u: wait %u after %u at %u", p, wait,
+                    expected_wait, t);
+                CHECK(beacon == (wait == CLASS_B_BEACON_PERIOD_MS - t), "periodicity %u: beacon flag at %u", p, t);
+            }
+            expected_wait = wait;
+        }
+        CHECK(slots == CLASS_B_SLOTS / period, "periodicity %u: %u slots instead of %u", p, slots, CLASS_B_SLOTS / period);
+    }
+    return longest;
+}
+
+int main(int argc, char** argv){
+    int sleep_ua = argc > 1 ? atoi(argv[1]) : 800;
+    int rx_ua = argc > 2 ? atoi(argv[2]) : 4600;
+    if(sleep_ua < 0 || rx_ua <= 0){
+        printf("usage: %s [sleep current uA] [receive current uA]\n", argv[0]);
+        return 1;
+    }
+    srand(1);
+
+    check_period();
+    for(uint8_t p = 0; p <= CLASS_B_MAX_PERIODICITY; p++){
+        uint32_t longest = walk(p);
+        CHECK(longest == class_b_worst_latency_ms(p), "periodicity %u: longest wait %u, bound %u", p, longest,
+            class_b_worst_latency_ms(p));
+    }
+
+    struct class_b_power power = {
+        .sleep_ua = (uint32_t)sleep_ua,
+        .rx_ua = (uint32_t)rx_ua,
+        .beacon_rx_us = tx_airtime_us(BEACON_SF, 125000, 1, 10, false, false, BEACON_LEN) + 2 * WIDENING_US + WAKEUP_US,
+        .ping_rx_us = PING_SYMBOLS * ((1u << BEACON_SF) * 1000000u / 125000) + WAKEUP_US,
+    };
+    struct class_b_report reports[CLASS_B_MAX_PERIODICITY + 1];
+    class_b_report(&power, reports);
+
+    printf("\nbeacon window %.1f ms, empty ping slot %.1f ms, %d uA asleep with the timers running, %d uA more receiving\n",
+        power.beacon_rx_us / 1000.0, power.ping_rx_us / 1000.0, sleep_ua, rx_ua);
+    printf("| periodicity | ping interval (s) | worst-case latency (s) | class B (uA) | class C (uA) | class C / class B |\n");
+    printf("|-------------|-------------------|------------------------|--------------|--------------|-------------------|\n");
+    for(int p = 0; p <= CLASS_B_MAX_PERIODICITY; p++)
+        printf("| %d | %.2f | %.2f | %u | %u | %.1f |\n", p, reports[p].ping_interval_ms / 1000.0,
+            reports[p].worst_latency_ms / 1000.0, reports[p].class_b_ua, reports[p].class_c_ua,
+            (double)reports[p].class_c_ua / reports[p].class_b_ua);
+
+    printf("%s\n", failures ? "FAILED" : "all checks passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,218 @@
+/**
+ * @file host.c
+ * @brief host check of the GPS time of src/lorawan.c (src/clock-sync.c) on a class-a node: a reading every period,
+ *          awake a few seconds on the system timer, asleep the rest with the timer stopped. The time slept told by
+ *          the application misses the drift of the sleep clock, which goes up and down with the temperature of the
+ *          day, and the wake-up, the real time goes on with both.
+ *          The node syncs when the library says the error may be past the accuracy asked, with the AppTimeAns of
+ *          the clock synchronization package (whole seconds against the reception of an uplink that takes its
+ *          airtime to arrive) or the DeviceTimeAns of the MAC (1/256 s). Checked: the time carried on without drift,
+ *          the drift estimate against the real one, the error staying within the accuracy and within the bound the
+ *          library gives. Then the error found by the syncs, the drift estimated and the syncs a day needed are
+ *          printed for a set of accuracies, with and without the drift estimate.
+ *
+ *          build and run from this folder:
+ *          gcc -O2 -Wall -I../../src host.c ../../src/clock-sync.c -lm -o host
+ *          ./host [drift ppm] [wake-up ms] [period s]
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "clock-sync.h"
+
+#define DAY_MS          (24ull * 60 * 60 * 1000)
+#define DAYS            14
+#define AWAKE_MS        3000
+// AppTimeReq of 6 bytes at SF12, the server takes the time at the end of the uplink
+#define AIRTIME_MS      1155
+// the answer doesn't always come, one sync in this many is lost
+#define LOST_SYNC       5
+// the sleep clock follows the temperature of the day
+#define DAILY_PPM       8
+// GPS time of the first boot
+#define GPS_START_MS    1400000000000ull
+// a sync is retried after this much time without an answer, as LORAWAN_CLOCK_SYNC_RETRY_MS
+#define RETRY_MS        (10 * 60 * 1000)
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do{ \
+        if(!(cond)){ \
+            failures++; \
+            printf("FAIL line %d: ", __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    }while(0)
+
+struct run {
+    uint32_t syncs;
+    uint32_t worst_ms;          // largest error seen
+    uint32_t over_bound;        // times the error was past the bound of the library
+    int32_t drift_ppm;
+    bool drift_known;
+    double real_ppm;            // drift of the time slept over the run
+    uint32_t interval_ms;       // interval the library asks for at the end
+};
+
+/*
+    time given by the network to a node whose clock reads node_ms at the real time true_ms
+*/
+static uint64_t sync_time(bool app_time, uint64_t node_ms, uint64_t true_ms){
+    if(app_time){
+        // the server compares its seconds at the reception with the seconds in the AppTimeReq
+        int64_t correction_s = (int64_t)((true_ms + AIRTIME_MS) / 1000) - (int64_t)(node_ms / 1000);
+        return node_ms + correction_s * 1000;
+    }
+    return (true_ms * 256 / 1000) * 1000 / 256;
+}
+
+/*
+    DAYS of readings every period_s, a sync whenever the library may be past accuracy_ms
+*/
+static struct run simulate(int drift_ppm, uint32_t wakeup_ms, uint32_t period_s, uint32_t accuracy_ms, bool app_time){
+    struct clock_sync cs;
+    struct run r = {0};
+    uint64_t awake = 5000;
+    uint64_t true_ms = GPS_START_MS;
+    uint64_t requested = 0;
+    bool pending = false;
+    uint32_t resolution = app_time ? 1000 : 4;
+    uint64_t slept = 0;
+    double extra = 0;
+    double late_ms = 0;
+
+    clock_sync_reset(&cs);
+    srand(7);
+    for(uint64_t t = 0; t < DAYS * DAY_MS; t += period_s * 1000ull){
+        // awake: the timer is the reference
+        // as ClockSyncRetry of src/lorawan.c
+        bool due = !cs.synced || cs.slept_ms >= clock_sync_interval_ms(&cs, accuracy_ms);
+        if(due && (!pending || t - requested >= RETRY_MS)){
+            pending = true;
+            requested = t;
+            if(rand() % LOST_SYNC != 0){
+                uint64_t node_ms = clock_sync_gps_ms(&cs, awake);
+                if(!cs.synced)
+                    node_ms = awake;
+                clock_sync_update(&cs, awake, sync_time(app_time, node_ms, true_ms), resolution);
+                pending = false;
+                r.syncs++;
+            }
+        }
+        awake += AWAKE_MS;
+        true_ms += AWAKE_MS;
+
+        // asleep: the node counts what it asked for, the real sleep is longer or shorter
+        uint32_t sleep_ms = period_s * 1000 - AWAKE_MS;
+        clock_sync_slept(&cs, sleep_ms);
+        double ppm = drift_ppm + DAILY_PPM * sin(2 * M_PI * (double)(t % DAY_MS) / DAY_MS);
+        // the fractions of a millisecond add up over the sleeps
+        late_ms += sleep_ms * ppm / 1e6 + wakeup_ms;
+        int64_t late = (int64_t)floor(late_ms);
+        late_ms -= late;
+        true_ms += sleep_ms + late;
+        slept += sleep_ms;
+        extra += late;
+
+        if(cs.synced && r.syncs > 1){
+            int64_t error = (int64_t)clock_sync_gps_ms(&cs, awake) - (int64_t)true_ms;
+            uint32_t abs_error = (uint32_t)(error < 0 ? -error : error);
+            if(abs_error > r.worst_ms)
+                r.worst_ms = abs_error;
+            // the airtime of the AppTimeReq is a bias the bound doesn't know about
+            if(abs_error > clock_sync_bound_ms(&cs) + (app_time ? AIRTIME_MS : 1))
+                r.over_bound++;
+        }
+    }
+    r.real_ppm = extra * 1e6 / slept;
+    r.drift_ppm = cs.drift_ppm;
+    r.drift_known = cs.drift_known;
+    r.interval_ms = clock_sync_interval_ms(&cs, accuracy_ms);
+    return r;
+}
+
+static void check_carry(void){
+    struct clock_sync cs;
+    clock_sync_reset(&cs);
+    CHECK(clock_sync_gps_ms(&cs, 1000) == 0, "time before a sync");
+    CHECK(clock_sync_bound_ms(&cs) == UINT32_MAX, "bound before a sync");
+
+    clock_sync_update(&cs, 1000, GPS_START_MS, 4);
+    CHECK(clock_sync_gps_ms(&cs, 3500) == GPS_START_MS + 2500, "awake time not carried");
+    clock_sync_slept(&cs, 60000);
+    CHECK(clock_sync_gps_ms(&cs, 3500) == GPS_START_MS + 62500, "slept time not carried");
+    CHECK(clock_sync_bound_ms(&cs) == 4 + (60000 * CLOCK_SYNC_PPM_UNKNOWN + 999999) / 1000000, "bound %u",
+        clock_sync_bound_ms(&cs));
+
+    // 100 ppm over a day of sleep
+    clock_sync_slept(&cs, DAY_MS - 60000);
+    clock_sync_update(&cs, 3500, GPS_START_MS + 2500 + DAY_MS + DAY_MS / 10000, 4);
+    CHECK(cs.error_ms == (int32_t)(DAY_MS / 10000), "error %d", cs.error_ms);
+    CHECK(cs.drift_known && cs.drift_ppm == 100, "drift %d", cs.drift_ppm);
+    clock_sync_slept(&cs, 1000000);
+    CHECK(clock_sync_gps_ms(&cs, 3500) == GPS_START_MS + 2500 + DAY_MS + DAY_MS / 10000 + 1000100, "drift not applied");
+    CHECK(clock_sync_interval_ms(&cs, 4) == 0, "accuracy under the resolution");
+    CHECK(clock_sync_interval_ms(&cs, 104) == 100ull * 1000000 / CLOCK_SYNC_PPM_FLOOR, "interval %u",
+        clock_sync_interval_ms(&cs, 104));
+
+    // a short sleep with a coarse sync gives no drift
+    clock_sync_reset(&cs);
+    clock_sync_update(&cs, 0, GPS_START_MS, 1000);
+    clock_sync_slept(&cs, 300000);
+    clock_sync_update(&cs, 0, GPS_START_MS + 301000, 1000);
+    CHECK(!cs.drift_known, "drift from 5 minutes of sleep and a 1 s sync");
+    CHECK(clock_sync_gps_ms(&cs, 0) == GPS_START_MS + 301000, "time not set by the sync");
+}
+
+int main(int argc, char** argv){
+    int drift_ppm = argc > 1 ? atoi(argv[1]) : 40;
+    int wakeup_ms = argc > 2 ? atoi(argv[2]) : 30;
+    int period_s = argc > 3 ? atoi(argv[3]) : 300;
+    if(wakeup_ms < 0 || period_s * 1000 <= AWAKE_MS){
+        printf("usage: %s [drift ppm] [wake-up ms] [period s]\n", argv[0]);
+        return 1;
+    }
+
+    check_carry();
+
+    // the wake-up is a drift of the time slept at a fixed period
+    double real_ppm = drift_ppm + wakeup_ms * 1e6 / (period_s * 1000.0 - AWAKE_MS);
+    const uint32_t accuracies[] = {2000, 5000, 10000, 60000};
+
+    printf("\nsleep clock %d +- %d ppm, %d ms of wake-up every %d s: the time slept is %.0f ppm short, %d days, 1 sync"
+        " in %d lost\n", drift_ppm, DAILY_PPM, wakeup_ms, period_s, real_ppm, DAYS, LOST_SYNC);
+    printf("| sync | accuracy (s) | worst error (s) | drift estimated (ppm) | syncs a day | interval asked (h) |\n");
+    printf("|------|--------------|-----------------|-----------------------|-------------|--------------------|\n");
+    for(int app = 1; app >= 0; app--){
+        for(unsigned i = 0; i < sizeof(accuracies) / sizeof(accuracies[0]); i++){
+            struct run r = simulate(drift_ppm, wakeup_ms, period_s, accuracies[i], app);
+            printf("| %s | %.0f | %.2f | %d%s | %.1f | %.1f |\n", app ? "AppTimeAns" : "DeviceTimeAns",
+                accuracies[i] / 1000.0, r.worst_ms / 1000.0, r.drift_ppm, r.drift_known ? "" : " (not known)",
+                (double)r.syncs / DAYS, r.interval_ms / 3600000.0);
+            // the airtime and a lost answer come on top of the accuracy asked
+            uint32_t margin = (app ? AIRTIME_MS + 1000 : 5) + (uint32_t)(real_ppm * (RETRY_MS + period_s * 1000.0) / 1e6);
+            CHECK(r.worst_ms <= accuracies[i] + margin, "accuracy %u: worst error %u", accuracies[i], r.worst_ms);
+            CHECK(r.over_bound == 0, "accuracy %u: past the bound %u times", accuracies[i], r.over_bound);
+            CHECK(!r.drift_known || fabs(r.drift_ppm - r.real_ppm) <= CLOCK_SYNC_PPM_FLOOR,
+                "accuracy %u: drift %d instead of %.0f", accuracies[i], r.drift_ppm, r.real_ppm);
+        }
+    }
+
+    // without the estimate the bound of an unknown drift sets the pace
+    printf("\nwithout the drift estimate, syncs every time the unknown drift of %d ppm may be past the accuracy:\n",
+        CLOCK_SYNC_PPM_UNKNOWN);
+    for(unsigned i = 0; i < sizeof(accuracies) / sizeof(accuracies[0]); i++){
+        uint32_t interval = (uint32_t)((uint64_t)(accuracies[i] - 1000) * 1000000 / CLOCK_SYNC_PPM_UNKNOWN);
+        printf("accuracy %.0f s with AppTimeAns: a sync every %.1f h, %.1f a day\n", accuracies[i] / 1000.0,
+            interval / 3600000.0, (double)DAY_MS / interval);
+    }
+
+    printf("%s\n", failures ? "FAILED" : "all checks passed");
+    return failures ? 1 : 0;
+}
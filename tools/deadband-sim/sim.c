@@ -0,0 +1,179 @@
+/**
+ * @file sim.c
+ * @brief host simulation of the change driven reporting of class-a (executables/lib/deadband) on a trace of readings:
+ *          every reading goes through the dead-band and the readings reported go through the same batch
+ *          (executables/lib/batch) used by the node, the frames are counted and compared with the node reporting
+ *          every reading. The receiver holds the last value reported until the next one, the error of that
+ *          reconstruction against the trace is reported for every channel.
+ *          The trace is the same CSV of tools/tscodec-bench, one reading every 5 minutes in the unit of the uplink:
+ *
+ *          temp,hum,press,AQI,CO2      e.g. 2470,3874,9967,16,600
+ *
+ *          without a file a week of readings is generated (daily cycle plus noise, fixed seed).
+ *
+ *          build and run from this folder:
+ *          gcc -O2 -I../../executables/lib/deadband -I../../executables/lib/batch sim.c \
+ *              ../../executables/lib/deadband/deadband.c ../../executables/lib/batch/batch.c -lm -o sim
+ *          ./sim [trace.csv]
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "deadband.h"
+#include "batch.h"
+
+#define CHANNELS            5
+#define MAX_READINGS        100000
+#define READING_PERIOD_S    300
+//same values of class-a: INTERVAL, MAX_SILENCE and the dead-band of the channels
+#define INTERVAL            12
+#define MAX_SILENCE         (6 * 12)
+#define RECORD_LEN          10
+//payload of the slowest datarate in EU868, the worst case for the number of frames
+#define MAX_PAYLOAD         51
+
+static const int32_t threshold[CHANNELS] = {20, 100, 5, 100, 50};
+//conversion of the channels to the physical unit
+static const double scale[CHANNELS] = {100, 100, 10, 10, 1};
+static const char* channel_name[CHANNELS] = {"temp[C]", "hum[%]", "press[hPa]", "IAQ", "CO2[ppm]"};
+static int32_t trace[MAX_READINGS][CHANNELS];
+
+/**
+ * @brief reads the trace from a CSV file
+ *
+ * @param path file name
+ * @return int readings read, -1 if the file cannot be opened
+ */
+static int load_trace(const char* path){
+    FILE* f = fopen(path, "r");
+    if(f == NULL)
+        return -1;
+    int n = 0;
+    char line[128];
+    while(n < MAX_READINGS && fgets(line, sizeof(line), f) != NULL){
+        int32_t* r = trace[n];
+        if(sscanf(line, "%d,%d,%d,%d,%d", &r[0], &r[1], &r[2], &r[3], &r[4]) == CHANNELS)
+            n++;
+    }
+    fclose(f);
+    return n;
+}
+
+/**
+ * @brief generates a week of readings, slow daily cycle plus sensor noise, same generator of tools/tscodec-bench
+ *
+ * @return int readings generated
+ */
+static int generate_trace(){
+    int n = 7 * 24 * 3600 / READING_PERIOD_S;
+    srand(1);
+    double aqi = 50;
+    for(int i = 0; i < n; i++){
+        double day = 2 * M_PI * i * READING_PERIOD_S / 86400.0;
+        double noise = (rand() / (double)RAND_MAX - 0.5);
+        aqi += (rand() / (double)RAND_MAX - 0.5) * 4;
+        if(aqi < 25) aqi = 25;
+        if(aqi > 300) aqi = 300;
+        trace[i][0] = (int32_t)lround((21 + 3 * sin(day) + noise * 0.1) * 100);
+        trace[i][1] = (int32_t)lround((45 - 8 * sin(day) + noise * 0.5) * 100);
+        trace[i][2] = (int32_t)lround((1013 + 4 * sin(day / 7) + noise * 0.2) * 10);
+        trace[i][3] = (int32_t)lround(aqi * 10);
+        trace[i][4] = (int32_t)lround(400 + aqi * 4);
+    }
+    return n;
+}
+
+/**
+ * @brief runs the trace through the dead-band and the batch
+ *
+ * @param n readings of the trace
+ * @param factor multiplies the dead-band of every channel, a negative factor reports every reading
+ * @param reported filled with the readings reported
+ * @param frames filled with the frames sent
+ * @param max_err filled with the largest error of every channel, physical unit
+ * @param rms_err filled with the rms error of every channel, physical unit
+ */
+static void simulate(int n, double factor, long* reported, long* frames, double* max_err, double* rms_err){
+    int32_t scaled[CHANNELS];
+    for(int c = 0; c < CHANNELS; c++)
+        scaled[c] = factor < 0 ? -1 : (int32_t)lround(threshold[c] * factor);
+    struct deadband db;
+    deadband_init(&db, CHANNELS, scaled, MAX_SILENCE * READING_PERIOD_S);
+    static struct batch b;
+    batch_init(&b, 4, RECORD_LEN, (INTERVAL - 1) * READING_PERIOD_S);
+
+    uint8_t record[RECORD_LEN] = {0};
+    uint8_t frame[MAX_PAYLOAD];
+    double sq[CHANNELS] = {0};
+    *reported = 0;
+    *frames = 0;
+    for(int c = 0; c < CHANNELS; c++)
+        max_err[c] = 0;
+
+    for(int i = 0; i < n; i++){
+        //the uptime of class-a, advanced before the reading is added
+        uint32_t now_s = (uint32_t)(i + 1) * READING_PERIOD_S;
+        if(deadband_check(&db, trace[i], now_s) != DEADBAND_REPORT_NONE){
+            if(batch_add(&b, record, now_s, false) >= 0){
+                deadband_reported(&db, trace[i], now_s);
+                (*reported)++;
+            }
+        }
+        if(batch_pending(&b, now_s, MAX_PAYLOAD) != BATCH_FLUSH_NONE && batch_encode(&b, frame, MAX_PAYLOAD, now_s) > 0)
+            (*frames)++;
+
+        //the receiver holds the last value reported
+        for(int c = 0; c < CHANNELS; c++){
+            double err = fabs((double)trace[i][c] - db.last[c]) / scale[c];
+            if(err > max_err[c])
+                max_err[c] = err;
+            sq[c] += err * err;
+        }
+    }
+    for(int c = 0; c < CHANNELS; c++)
+        rms_err[c] = sqrt(sq[c] / n);
+}
+
+int main(int argc, char* argv[]){
+    int n = argc > 1 ? load_trace(argv[1]) : generate_trace();
+    if(n <= 0){
+        printf("Cannot read the trace\n");
+        return 1;
+    }
+    printf("%d readings, %s, batch of at most %d readings, heartbeat every %d readings, payload %d\n\n",
+        n, argc > 1 ? argv[1] : "generated week", INTERVAL, MAX_SILENCE, MAX_PAYLOAD);
+
+    long base_reported, base_frames;
+    double max_err[CHANNELS], rms_err[CHANNELS];
+    simulate(n, -1, &base_reported, &base_frames, max_err, rms_err);
+
+    printf("dead-band  readings  frames  frames saved  ");
+    for(int c = 0; c < CHANNELS; c++)
+        printf(" %-16s", channel_name[c]);
+    printf("\n%45s", "");
+    for(int c = 0; c < CHANNELS; c++)
+        printf(" %-16s", "max/rms err");
+    printf("\n");
+    const double factors[] = {-1, 0.5, 1, 2, 4};
+    for(unsigned f = 0; f < sizeof(factors) / sizeof(factors[0]); f++){
+        long reported, frames;
+        simulate(n, factors[f], &reported, &frames, max_err, rms_err);
+        if(factors[f] < 0)
+            printf("%9s", "off");
+        else
+            printf("%8.1fx", factors[f]);
+        printf("  %8ld  %6ld  %11.1f%%  ", reported, frames, 100.0 * (base_frames - frames) / base_frames);
+        for(int c = 0; c < CHANNELS; c++)
+            printf(" %7.2f/%-8.3f", max_err[c], rms_err[c]);
+        printf("\n");
+    }
+    printf("\nthe dead-band of class-a (1.0x) is");
+    for(int c = 0; c < CHANNELS; c++)
+        printf(" %s %g", channel_name[c], threshold[c] / scale[c]);
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,178 @@
+/**
+ * @file host.c
+ * @brief host check of the downlink command processor (executables/lib/downlink): well formed frames, unknown types,
+ *          wrong lengths, values refused by the handlers, truncated frames and every truncation of a valid frame,
+ *          the ack written for each of them is compared with the expected one. The frames are the ones written by
+ *          Encode in executables/class-a/codec.js.
+ *
+ *          build and run from this folder:
+ *          gcc -O2 -Wall -I../../executables/lib/downlink host.c ../../executables/lib/downlink/downlink.c -o host
+ *          ./host
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "downlink.h"
+
+#define PORT            10
+
+/*
+    settings changed by the commands, the same ranges of class_a.c
+*/
+struct settings {
+    uint16_t interval;
+    int8_t datarate;
+    bool reboot;
+    int calls;
+};
+
+static uint8_t cmd_interval(const uint8_t* value, uint8_t len, void* ctx){
+    struct settings* s = ctx;
+    uint16_t interval = (uint16_t)downlink_uint(value, len);
+    s->calls++;
+    if(interval == 0 || interval > 12 * 24)
+        return DOWNLINK_BAD_VALUE;
+    s->interval = interval;
+    return DOWNLINK_OK;
+}
+
+static uint8_t cmd_datarate(const uint8_t* value, uint8_t len, void* ctx){
+    (void)len;
+    struct settings* s = ctx;
+    s->calls++;
+    if((int8_t)value[0] > 5)
+        return DOWNLINK_BAD_VALUE;
+    s->datarate = (int8_t)value[0];
+    return DOWNLINK_OK;
+}
+
+static uint8_t cmd_reboot(const uint8_t* value, uint8_t len, void* ctx){
+    (void)value;
+    (void)len;
+    struct settings* s = ctx;
+    s->calls++;
+    s->reboot = true;
+    return DOWNLINK_OK;
+}
+
+static const struct downlink_command commands[] = {
+    {0x01, 2, 2, cmd_interval},
+    {0x04, 1, 1, cmd_datarate},
+    {0x06, 0, 0, cmd_reboot},
+};
+
+static const struct downlink_port ports[] = {
+    {PORT, commands, sizeof(commands) / sizeof(commands[0])},
+};
+
+static int failures = 0;
+
+/**
+ * @brief runs a frame and checks the result and the ack
+ *
+ * @param name name of the case
+ * @param port port of the frame
+ * @param frame frame
+ * @param len bytes of the frame
+ * @param expected_rslt result of downlink_process
+ * @param expected_ack expected ack, NULL if no ack is expected
+ * @param expected_ack_len bytes of the expected ack
+ * @param s settings after the frame
+ */
+static void check(const char* name, uint8_t port, const uint8_t* frame, uint8_t len, int expected_rslt,
+                    const uint8_t* expected_ack, uint8_t expected_ack_len, struct settings* s){
+    struct downlink_ack ack = {0};
+    uint8_t buf[1 + DOWNLINK_MAX_COMMANDS];
+    int rslt = downlink_process(ports, 1, port, frame, len, s, &ack);
+    uint8_t ack_len = downlink_ack_encode(&ack, buf, sizeof(buf));
+    int ok = rslt == expected_rslt && ack_len == expected_ack_len && ack_len == downlink_ack_len(&ack)
+                && (ack_len == 0 || memcmp(buf, expected_ack, ack_len) == 0);
+    downlink_ack_clear(&ack);
+    ok = ok && downlink_ack_len(&ack) == 0;
+    if(!ok){
+        failures++;
+        printf("FAIL %s: result %d (expected %d), ack of %u bytes (expected %u)\n", name, rslt, expected_rslt, ack_len, expected_ack_len);
+    }
+}
+
+int main(){
+    struct settings s = {0};
+
+    //{seq: 1, interval: 24, datarate: 3, reboot: true}
+    const uint8_t all[] = {1, 0x01, 2, 24, 0, 0x04, 1, 3, 0x06, 0};
+    const uint8_t all_ack[] = {1, DOWNLINK_OK, DOWNLINK_OK, DOWNLINK_OK};
+    check("valid", PORT, all, sizeof(all), 3, all_ack, sizeof(all_ack), &s);
+    if(s.interval != 24 || s.datarate != 3 || !s.reboot){
+        failures++;
+        printf("FAIL valid: settings not applied\n");
+    }
+
+    //every truncation of the valid frame must be rejected without running any command
+    for(uint8_t len = 0; len < sizeof(all); len++){
+        //cuts right after a whole TLV are valid shorter frames
+        if(len == 1 || len == 5 || len == 8)
+            continue;
+        const uint8_t malformed_ack[] = {len > 0 ? all[0] : 0, DOWNLINK_MALFORMED};
+        s.calls = 0;
+        check("truncated", PORT, all, len, DOWNLINK_E_MALFORMED, malformed_ack, sizeof(malformed_ack), &s);
+        if(s.calls != 0){
+            failures++;
+            printf("FAIL truncated at %u: %d commands run\n", len, s.calls);
+        }
+    }
+
+    //only the sequence number, an empty list of commands
+    const uint8_t empty[] = {7};
+    const uint8_t empty_ack[] = {7};
+    check("empty", PORT, empty, sizeof(empty), 0, empty_ack, sizeof(empty_ack), &s);
+
+    //unknown type, wrong length and out of range value, the valid command in between is still applied
+    s.interval = 12;
+    const uint8_t mixed[] = {2, 0x7F, 1, 0, 0x01, 1, 5, 0x01, 2, 0, 0, 0x01, 2, 6, 0, 0x04, 1, 9};
+    const uint8_t mixed_ack[] = {2, DOWNLINK_UNKNOWN, DOWNLINK_BAD_LENGTH, DOWNLINK_BAD_VALUE, DOWNLINK_OK, DOWNLINK_BAD_VALUE};
+    check("mixed", PORT, mixed, sizeof(mixed), 1, mixed_ack, sizeof(mixed_ack), &s);
+    if(s.interval != 6){
+        failures++;
+        printf("FAIL mixed: interval %u\n", s.interval);
+    }
+
+    //a negative datarate gives the choice back to ADR
+    const uint8_t adr[] = {3, 0x04, 1, 0xFF};
+    const uint8_t adr_ack[] = {3, DOWNLINK_OK};
+    check("adr", PORT, adr, sizeof(adr), 1, adr_ack, sizeof(adr_ack), &s);
+
+    //a port without a table is not a command frame, no ack
+    s.calls = 0;
+    check("other port", PORT + 1, all, sizeof(all), DOWNLINK_E_PORT, NULL, 0, &s);
+    if(s.calls != 0){
+        failures++;
+        printf("FAIL other port: %d commands run\n", s.calls);
+    }
+
+    //more commands than the ack can hold
+    uint8_t many[1 + (DOWNLINK_MAX_COMMANDS + 1) * 2];
+    many[0] = 4;
+    for(int i = 0; i < DOWNLINK_MAX_COMMANDS + 1; i++){
+        many[1 + 2 * i] = 0x06;
+        many[2 + 2 * i] = 0;
+    }
+    const uint8_t many_ack[] = {4, DOWNLINK_MALFORMED};
+    check("too many", PORT, many, sizeof(many), DOWNLINK_E_MALFORMED, many_ack, sizeof(many_ack), &s);
+    uint8_t full_ack[1 + DOWNLINK_MAX_COMMANDS] = {4};
+    check("as many as the ack", PORT, many, sizeof(many) - 2, DOWNLINK_MAX_COMMANDS, full_ack, sizeof(full_ack), &s);
+
+    //an ack larger than the room left in the frame is not written
+    struct downlink_ack ack = {0};
+    uint8_t buf[4];
+    downlink_process(ports, 1, PORT, mixed, sizeof(mixed), &s, &ack);
+    if(downlink_ack_encode(&ack, buf, sizeof(buf)) != 0 || !ack.pending){
+        failures++;
+        printf("FAIL small buffer: ack written\n");
+    }
+
+    printf("%s\n", failures ? "FAILED" : "all checks passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,210 @@
+/**
+ * @file host.c
+ * @brief host test of the journal behind the emulated EEPROM (src/boards/rp2040/eeprom-journal.c) on a simulated NOR flash:
+ *          a program can only clear bits, a sector erase sets it back to 0xFF and is counted. The workload is the one of
+ *          the LoRaMac context, groups of a few hundred bytes each closed by a CRC, with the frame counter changing at every
+ *          uplink and the rest changing now and then. Power losses are injected in the middle of a program or an erase,
+ *          leaving a random part of the page or of the sector done: after mounting again the image must be the one of
+ *          the last complete flush or the one of the interrupted flush, nothing in between.
+ *
+ *          build and run from this folder:
+ *          gcc -O2 -Wall -I../../src/boards/rp2040 -I../../src/include host.c ../../src/boards/rp2040/eeprom-journal.c \
+ *              ../../src/crc32.c -o host
+ *          ./host [flushes] [sectors]
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include "eeprom-journal.h"
+
+#define SECTOR_SIZE         4096
+#define PAGE_SIZE           256
+#define IMAGE_SIZE          EEPROM_JOURNAL_MAX_SIZE
+//groups of the LoRaMac context, offset and size, the first one holds the frame counters
+#define GROUPS              6
+static const uint16_t group_offset[GROUPS] = {0, 64, 160, 600, 1100, 1900};
+static const uint16_t group_size[GROUPS] = {48, 80, 420, 480, 760, 120};
+
+static uint8_t flash[EEPROM_JOURNAL_MAX_SECTORS * SECTOR_SIZE];
+static uint32_t sector_erases[EEPROM_JOURNAL_MAX_SECTORS];
+static uint32_t programs;
+//flash operations left before the power loss, negative means no power loss
+static long ops_budget = -1;
+static jmp_buf power_loss;
+
+static int nor_read(uint32_t offset, void* buffer, uint32_t size){
+    memcpy(buffer, &flash[offset], size);
+    return 0;
+}
+
+static int nor_prog(uint32_t offset, const void* buffer, uint32_t size){
+    const uint8_t* src = buffer;
+    if(offset % PAGE_SIZE != 0 || size != PAGE_SIZE){
+        printf("Program not aligned to a page: offset %u size %u\n", offset, size);
+        exit(1);
+    }
+    uint32_t n = size;
+    if(ops_budget == 0)
+        n = rand() % size;
+    //NOR flash: a program only clears bits
+    for(uint32_t i = 0; i < n; i++)
+        flash[offset + i] &= src[i];
+    if(ops_budget == 0){
+        //the byte being programmed when the power went may have some bits cleared
+        if(n < size)
+            flash[offset + n] &= src[n] | (uint8_t)rand();
+        longjmp(power_loss, 1);
+    }
+    if(ops_budget > 0)
+        ops_budget--;
+    programs++;
+    return 0;
+}
+
+static int nor_erase(uint32_t offset){
+    uint32_t n = SECTOR_SIZE;
+    if(ops_budget == 0)
+        n = rand() % SECTOR_SIZE;
+    memset(&flash[offset], 0xFF, n);
+    sector_erases[offset / SECTOR_SIZE]++;
+    if(ops_budget == 0)
+        longjmp(power_loss, 1);
+    if(ops_budget > 0)
+        ops_budget--;
+    return 0;
+}
+
+static struct eeprom_journal_flash nor = {
+    .sector_size = SECTOR_SIZE,
+    .page_size = PAGE_SIZE,
+    .sectors = 4,
+    .read = nor_read,
+    .prog = nor_prog,
+    .erase = nor_erase,
+};
+
+/**
+ * @brief CRC closing a group, as the LoRaMac groups do
+ */
+static void close_group(uint8_t* image, uint8_t g){
+    uint32_t sum = 0;
+    for(uint16_t i = 0; i < group_size[g] - 4; i++)
+        sum = sum * 31 + image[group_offset[g] + i];
+    memcpy(&image[group_offset[g] + group_size[g] - 4], &sum, 4);
+}
+
+/**
+ * @brief changes the model as the stack does between two flushes: the frame counter always, another group sometimes
+ */
+static void change(uint8_t* model, uint32_t uplink){
+    memcpy(&model[group_offset[0] + 4], &uplink, sizeof(uplink));
+    close_group(model, 0);
+    if(rand() % 8 == 0){
+        uint8_t g = 1 + rand() % (GROUPS - 1);
+        uint16_t n = 1 + rand() % 16;
+        uint16_t at = rand() % (group_size[g] - 4 - n);
+        for(uint16_t i = 0; i < n; i++)
+            model[group_offset[g] + at + i] = (uint8_t)rand();
+        close_group(model, g);
+    }
+}
+
+/**
+ * @brief writes the groups changed in the model through the journal, whole groups as NvmDataMgmtStore does
+ */
+static void store(struct eeprom_journal* j, const uint8_t* model){
+    for(uint8_t g = 0; g < GROUPS; g++)
+        eeprom_journal_write(j, group_offset[g], &model[group_offset[g]], group_size[g]);
+}
+
+int main(int argc, char* argv[]){
+    long flushes = argc > 1 ? atol(argv[1]) : 20000;
+    nor.sectors = argc > 2 ? atoi(argv[2]) : 4;
+    static uint8_t image[IMAGE_SIZE];
+    static uint8_t committed[IMAGE_SIZE];
+    static uint8_t pending[IMAGE_SIZE];
+    struct eeprom_journal j;
+
+    memset(flash, 0xFF, sizeof(flash));
+    memset(committed, 0xFF, sizeof(committed));
+    //the context starts as written by a factory reset
+    for(uint8_t g = 0; g < GROUPS; g++){
+        memset(&committed[group_offset[g]], 0, group_size[g]);
+        close_group(committed, g);
+    }
+    memcpy(pending, committed, sizeof(pending));
+    if(eeprom_journal_mount(&j, &nor, image, sizeof(image)) != 0){
+        printf("Blank flash not seen as empty\n");
+        return 1;
+    }
+    store(&j, committed);
+    eeprom_journal_flush(&j);
+
+    srand(1);
+    long losses = 0;
+    long kept = 0;
+    long rolled_back = 0;
+    long bytes = 0;
+    for(long f = 0; f < flushes; f++){
+        change(pending, (uint32_t)f);
+        store(&j, pending);
+        //one flush in 10 is hit by a power loss, after a random number of flash operations
+        volatile int lost = rand() % 10 == 0;
+        ops_budget = lost ? rand() % 4 : -1;
+        if(setjmp(power_loss) == 0){
+            int rslt = eeprom_journal_flush(&j);
+            ops_budget = -1;
+            if(rslt < 0){
+                printf("Flush %ld failed: %d\n", f, rslt);
+                return 1;
+            }
+            bytes += rslt;
+            //the flush made it, with a power loss planned the budget was larger than the flush
+            memcpy(committed, pending, sizeof(committed));
+            if(!lost){
+                if(memcmp(image, pending, sizeof(image)) != 0){
+                    printf("Flush %ld: image in RAM differs from the model\n", f);
+                    return 1;
+                }
+                continue;
+            }
+        }
+        ops_budget = -1;
+        //reset: the image in RAM is lost, everything comes from the flash
+        memset(image, 0, sizeof(image));
+        eeprom_journal_mount(&j, &nor, image, sizeof(image));
+        losses++;
+        if(memcmp(image, pending, sizeof(image)) == 0){
+            kept++;
+            memcpy(committed, pending, sizeof(committed));
+        }else if(memcmp(image, committed, sizeof(image)) == 0){
+            rolled_back++;
+            memcpy(pending, committed, sizeof(pending));
+        }else{
+            printf("Flush %ld: image after the power loss is neither the old nor the new one\n", f);
+            return 1;
+        }
+    }
+
+    uint32_t erases = 0;
+    uint32_t min_erases = UINT32_MAX;
+    uint32_t max_erases = 0;
+    for(uint8_t s = 0; s < nor.sectors; s++){
+        erases += sector_erases[s];
+        if(sector_erases[s] < min_erases)
+            min_erases = sector_erases[s];
+        if(sector_erases[s] > max_erases)
+            max_erases = sector_erases[s];
+    }
+    printf("%ld flushes on %u sectors, %ld power losses: %ld kept the flush, %ld rolled it back\n",
+        flushes, nor.sectors, losses, kept, rolled_back);
+    printf("%u sector erases (%u to %u per sector), one every %.1f flushes, a whole sector rewrite would erase %ld times\n",
+        erases, min_erases, max_erases, (double)flushes / erases, flushes);
+    printf("%u pages programmed, %.1f bytes appended per flush on average\n", programs, (double)bytes / flushes);
+    return 0;
+}
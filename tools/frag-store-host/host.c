@@ -0,0 +1,466 @@
+/**
+ * @file host.c
+ * @brief host test of the FUOTA file store of src/lorawan.c (src/frag-store.c) on a simulated NOR flash: a program can
+ *          only clear bits, a sector erase sets it back to 0xFF and is counted. A file is written the way the
+ *          fragmentation decoder of LoRaMac-node does, the whole file set to 0xFF byte by byte first, then the
+ *          fragments in the order they arrive with the lost ones written again later, every read checked against a
+ *          copy in RAM. Then the file is applied, the store mounted again, files with a bad CRC or no header refused,
+ *          and power losses are injected during sessions and applies: after mounting again the applied file must be
+ *          the previous one or the new one, nothing else. Sessions are opened by the FragSessionSetupReq frames of
+ *          the fragmentation package, as src/lorawan.c does, and a setup in the middle of a session drops it.
+ *
+ *          With FRAG_DECODER the file also goes through FragDecoder.c of LoRaMac-node with random fragment loss, the
+ *          coded fragments made by the encoder of the LoRaWAN fragmented data block transport specification, and the
+ *          fragments needed and the time to reassemble are printed.
+ *
+ *          build and run from this folder:
+ *          gcc -O2 -Wall -I../../src -I../../src/include host.c ../../src/frag-store.c ../../src/crc32.c -o host
+ *          ./host [file bytes] [fragment size]
+ *
+ *          with the decoder, once the LoRaMac-node submodule is checked out:
+ *          gcc -O2 -Wall -DFRAG_DECODER -DFRAG_MAX_NB=256 -DFRAG_MAX_SIZE=64 -DFRAG_MAX_REDUNDANCY=64 -I../../src
+ *              -I../../src/include -I../../lib/LoRaMac-node/src/boards -I../../lib/LoRaMac-node/src/apps/LoRaMac/common/LmHandler/packages
+ *              host.c ../../src/frag-store.c ../../src/crc32.c ../../lib/LoRaMac-node/src/apps/LoRaMac/common/LmHandler/packages/FragDecoder.c
+ *              ../../lib/LoRaMac-node/src/boards/mcu/utilities.c -o host
+ *          ./host [file bytes] [fragment size] [loss %]
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <time.h>
+#include "frag-store.h"
+#include "pico/crc32.h"
+#ifdef FRAG_DECODER
+#include "FragDecoder.h"
+#endif
+
+#define SECTOR_SIZE         4096
+#define PAGE_SIZE           256
+#define SLOT_SECTORS        16
+#define REGION_SIZE         (2 * SLOT_SECTORS * SECTOR_SIZE)
+#define POWER_LOSSES        2000
+// typical sector erase and page program of the W25Q16 of the Pico
+#define ERASE_MS            45.0
+#define PROGRAM_MS          0.4
+
+static uint8_t flash[REGION_SIZE];
+static uint32_t erases;
+static uint32_t programs;
+//flash operations left before the power loss, negative means no power loss
+static long ops_budget = -1;
+static jmp_buf power_loss;
+
+static int nor_read(uint32_t offset, void* buffer, uint32_t size){
+    if(offset + size > REGION_SIZE){
+        printf("Read past the region: offset %u size %u\n", offset, size);
+        exit(1);
+    }
+    memcpy(buffer, &flash[offset], size);
+    return 0;
+}
+
+static int nor_prog(uint32_t offset, const void* buffer, uint32_t size){
+    const uint8_t* src = buffer;
+    if(offset % PAGE_SIZE != 0 || size != PAGE_SIZE || offset + size > REGION_SIZE){
+        printf("Program not aligned to a page: offset %u size %u\n", offset, size);
+        exit(1);
+    }
+    uint32_t n = size;
+    if(ops_budget == 0)
+        n = rand() % size;
+    //NOR flash: a program only clears bits
+    for(uint32_t i = 0; i < n; i++)
+        flash[offset + i] &= src[i];
+    if(ops_budget == 0){
+        if(n < size)
+            flash[offset + n] &= src[n] | (uint8_t)rand();
+        longjmp(power_loss, 1);
+    }
+    if(ops_budget > 0)
+        ops_budget--;
+    programs++;
+    return 0;
+}
+
+static int nor_erase(uint32_t offset){
+    uint32_t n = SECTOR_SIZE;
+    if(offset % SECTOR_SIZE != 0 || offset >= REGION_SIZE){
+        printf("Erase not aligned to a sector: offset %u\n", offset);
+        exit(1);
+    }
+    if(ops_budget == 0)
+        n = rand() % SECTOR_SIZE;
+    memset(&flash[offset], 0xFF, n);
+    erases++;
+    if(ops_budget == 0)
+        longjmp(power_loss, 1);
+    if(ops_budget > 0)
+        ops_budget--;
+    return 0;
+}
+
+static const struct frag_store_flash nor = {
+    .sector_size = SECTOR_SIZE,
+    .page_size = PAGE_SIZE,
+    .slot_sectors = SLOT_SECTORS,
+    .read = nor_read,
+    .prog = nor_prog,
+    .erase = nor_erase,
+};
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do{ \
+        if(!(cond)){ \
+            failures++; \
+            printf("FAIL line %d: ", __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    }while(0)
+
+static uint8_t cache[FRAG_STORE_MAX_SECTOR];
+static struct frag_store store;
+
+/*
+    a file as the server sends it: header, data, padding of the last fragment
+*/
+static uint32_t make_file(uint8_t* file, uint32_t data_len, uint8_t frag_size, uint8_t id, uint32_t seed){
+    srand(seed);
+    for(uint32_t i = 0; i < data_len; i++)
+        file[FRAG_STORE_FILE_HEADER_LEN + i] = (uint8_t)rand();
+    uint32_t crc = lorawan_crc32(0, &file[FRAG_STORE_FILE_HEADER_LEN], data_len);
+    file[0] = 'F';
+    file[1] = 'U';
+    file[2] = FRAG_STORE_KIND_BSEC_CONFIG;
+    file[3] = id;
+    for(int i = 0; i < 4; i++){
+        file[4 + i] = (data_len >> (8 * i)) & 0xFF;
+        file[8 + i] = (crc >> (8 * i)) & 0xFF;
+    }
+    uint32_t len = FRAG_STORE_FILE_HEADER_LEN + data_len;
+    uint32_t padded = (len + frag_size - 1) / frag_size * frag_size;
+    memset(&file[len], 0, padded - len);
+    return padded;
+}
+
+static int same_file(const struct frag_store_file* f, const uint8_t* file, uint32_t data_len){
+    return f != NULL && f->size == data_len && memcmp(&flash[f->offset], &file[FRAG_STORE_FILE_HEADER_LEN], data_len) == 0;
+}
+
+/*
+    the write pattern of FragDecoder: the file set to 0xFF, the fragments in a random order, some written again
+*/
+static int receive(const uint8_t* file, uint32_t len, uint8_t frag_size, uint8_t* model){
+    uint16_t frags = len / frag_size;
+    uint8_t ff = 0xFF;
+    int rslt = frag_store_begin(&store, len);
+    if(rslt < 0)
+        return rslt;
+    memset(model, 0xFF, len);
+    for(uint32_t i = 0; i < len; i++)
+        frag_store_write(&store, i, &ff, 1);
+    for(uint32_t k = 0; k < frags * 3u / 2; k++){
+        uint16_t f = (k < frags) ? k : rand() % frags;
+        //a lost fragment is rebuilt later from a coded one, a partial row sits there in between
+        const uint8_t* src = &file[f * frag_size];
+        uint8_t scratch[255];
+        if(k < frags && rand() % 5 == 0){
+            for(int i = 0; i < frag_size; i++)
+                scratch[i] = (uint8_t)rand();
+            src = scratch;
+        }
+        frag_store_write(&store, f * frag_size, src, frag_size);
+        memcpy(&model[f * frag_size], src, frag_size);
+        //the decoder reads back rows to combine them
+        uint16_t r = rand() % frags;
+        uint8_t back[255];
+        frag_store_read(&store, r * frag_size, back, frag_size);
+        CHECK(memcmp(back, &model[r * frag_size], frag_size) == 0, "fragment %u read back wrong", r);
+    }
+    //every fragment ends up right
+    for(uint16_t f = 0; f < frags; f++){
+        frag_store_write(&store, f * frag_size, &file[f * frag_size], frag_size);
+        memcpy(&model[f * frag_size], &file[f * frag_size], frag_size);
+    }
+    return 0;
+}
+
+/*
+    FragSessionSetupReq of the fragmentation package: fragment index 0, multicast group 0, no padding or descriptor
+*/
+static void setup_req(uint8_t* frame, uint16_t nb, uint8_t frag_size, uint8_t algo){
+    memset(frame, 0, 11);
+    frame[0] = 0x02;
+    frame[2] = nb & 0xFF;
+    frame[3] = nb >> 8;
+    frame[4] = frag_size;
+    frame[5] = algo << 3;
+}
+
+static void check_session_setup(uint32_t data_len, uint8_t frag_size){
+    static uint8_t file[SLOT_SECTORS * SECTOR_SIZE];
+    static uint8_t model[SLOT_SECTORS * SECTOR_SIZE];
+    uint8_t frame[32];
+
+    setup_req(frame, 100, 48, 0);
+    CHECK(frag_store_session_setup(frame, 11, 256, 64) == 4800, "setup of 100 fragments of 48 bytes");
+    CHECK(frag_store_session_setup(frame, 10, 256, 64) == 0, "truncated setup");
+    CHECK(frag_store_session_setup(frame, 11, 99, 64) == 0, "setup past the largest number of fragments");
+    CHECK(frag_store_session_setup(frame, 11, 256, 47) == 0, "setup past the largest fragment");
+    setup_req(frame, 100, 48, 1);
+    CHECK(frag_store_session_setup(frame, 11, 256, 64) == 0, "setup with a fragmentation algorithm not supported");
+    //after PackageVersionReq and FragSessionStatusReq, as a server may chain them
+    frame[0] = 0x00;
+    frame[1] = 0x01;
+    frame[2] = 0x00;
+    setup_req(&frame[3], 10, 20, 0);
+    CHECK(frag_store_session_setup(frame, 14, 256, 64) == 200, "setup after other commands");
+    //a DataFragment takes the rest of the frame, its bytes are not commands
+    frame[0] = 0x08;
+    frame[1] = 0x01;
+    frame[2] = 0x00;
+    setup_req(&frame[3], 10, 20, 0);
+    CHECK(frag_store_session_setup(frame, 14, 256, 64) == 0, "setup read in a fragment");
+    //the addr 0 and size 1 write of FragDecoderInit no longer opens anything
+    memset(flash, 0xFF, sizeof(flash));
+    frag_store_mount(&store, &nor, cache);
+    uint8_t ff = 0xFF;
+    CHECK(frag_store_write(&store, 0, &ff, 1) == FRAG_STORE_E_STATE, "write without a session setup");
+
+    //a setup in the middle of a session drops it, the file of the new session is the one applied
+    uint32_t len = make_file(file, data_len, frag_size, 3, 5);
+    receive(file, len, frag_size, model);
+    frag_store_write(&store, 0, (const uint8_t*)"stale", 5);
+    setup_req(frame, len / frag_size, frag_size, 0);
+    uint32_t session = frag_store_session_setup(frame, 11, SLOT_SECTORS * SECTOR_SIZE / frag_size, frag_size);
+    CHECK(session == len, "setup of the file, %u bytes instead of %u", session, len);
+    CHECK(frag_store_begin(&store, session) == 0, "session of the setup refused");
+    uint8_t back[5];
+    frag_store_read(&store, 0, back, sizeof(back));
+    CHECK(memcmp(back, "\xFF\xFF\xFF\xFF\xFF", sizeof(back)) == 0, "bytes of the dropped session read back");
+    for(uint16_t f = 0; f < len / frag_size; f++)
+        frag_store_write(&store, f * frag_size, &file[f * frag_size], frag_size);
+    CHECK(frag_store_commit(&store) == 0 && same_file(frag_store_file(&store), file, data_len),
+        "file of the session opened by the setup");
+}
+
+static void check_sessions(uint32_t data_len, uint8_t frag_size){
+    static uint8_t file[SLOT_SECTORS * SECTOR_SIZE];
+    static uint8_t model[SLOT_SECTORS * SECTOR_SIZE];
+    memset(flash, 0xFF, sizeof(flash));
+
+    CHECK(frag_store_mount(&store, &nor, cache) == 0, "blank flash holds a file");
+    CHECK(frag_store_commit(&store) == FRAG_STORE_E_STATE, "commit without a session");
+
+    uint32_t len = make_file(file, data_len, frag_size, 7, 1);
+    erases = programs = 0;
+    CHECK(receive(file, len, frag_size, model) == 0, "session refused");
+    int rslt = frag_store_commit(&store);
+    CHECK(rslt == 0, "commit %d", rslt);
+    CHECK(same_file(frag_store_file(&store), file, data_len), "applied file differs");
+    CHECK(frag_store_file(&store)->id == 7 && frag_store_file(&store)->kind == FRAG_STORE_KIND_BSEC_CONFIG, "kind or id");
+    printf("%u bytes in fragments of %u: %u sector erases, %u page programs, about %.0f ms of flash\n", data_len,
+        frag_size, erases, programs, erases * ERASE_MS + programs * PROGRAM_MS);
+
+    CHECK(frag_store_mount(&store, &nor, cache) == 1 && same_file(frag_store_file(&store), file, data_len),
+        "file lost by the mount");
+
+    //a second file goes to the other slot, then a bad CRC and a missing header are refused
+    static uint8_t second[SLOT_SECTORS * SECTOR_SIZE];
+    uint32_t len2 = make_file(second, data_len / 2 + 1, frag_size, 9, 2);
+    receive(second, len2, frag_size, model);
+    CHECK(frag_store_commit(&store) == 0 && same_file(frag_store_file(&store), second, data_len / 2 + 1), "second file");
+    uint32_t applied_offset = frag_store_file(&store)->offset;
+    CHECK(applied_offset != (uint32_t)(PAGE_SIZE + FRAG_STORE_FILE_HEADER_LEN), "second file in the slot of the first");
+
+    second[FRAG_STORE_FILE_HEADER_LEN] ^= 1;
+    receive(second, len2, frag_size, model);
+    CHECK(frag_store_commit(&store) == FRAG_STORE_E_CRC, "bad CRC applied");
+    second[FRAG_STORE_FILE_HEADER_LEN] ^= 1;
+    second[0] = 'X';
+    receive(second, len2, frag_size, model);
+    CHECK(frag_store_commit(&store) == FRAG_STORE_E_FORMAT, "file without header applied");
+    second[0] = 'F';
+    CHECK(frag_store_mount(&store, &nor, cache) == 1 && same_file(frag_store_file(&store), second, data_len / 2 + 1),
+        "refused files changed the applied one");
+
+    CHECK(frag_store_begin(&store, SLOT_SECTORS * SECTOR_SIZE) == FRAG_STORE_E_TOO_BIG, "file larger than a slot");
+    frag_store_begin(&store, len);
+    CHECK(frag_store_write(&store, len - 1, file, 2) == FRAG_STORE_E_TOO_BIG, "write past the session");
+}
+
+static void check_power_loss(uint32_t data_len, uint8_t frag_size){
+    static uint8_t files[2][SLOT_SECTORS * SECTOR_SIZE];
+    static uint8_t model[SLOT_SECTORS * SECTOR_SIZE];
+    uint32_t lens[2];
+    int old_files = 0;
+    int new_files = 0;
+
+    memset(flash, 0xFF, sizeof(flash));
+    frag_store_mount(&store, &nor, cache);
+    lens[0] = make_file(files[0], data_len, frag_size, 1, 10);
+    receive(files[0], lens[0], frag_size, model);
+    frag_store_commit(&store);
+    int current = 0;
+
+    for(int i = 0; i < POWER_LOSSES; i++){
+        int next = 1 - current;
+        uint32_t next_len = data_len - (rand() % (data_len / 2));
+        lens[next] = make_file(files[next], next_len, frag_size, 2 + i % 200, 100 + i);
+        srand(1000 + i);
+        uint32_t ops = erases + programs;
+        frag_store_mount(&store, &nor, cache);
+        //count the operations of a whole session once, then cut it at a random one
+        static uint32_t session_ops = 0;
+        if(session_ops == 0){
+            uint8_t backup[REGION_SIZE];
+            memcpy(backup, flash, sizeof(flash));
+            receive(files[next], lens[next], frag_size, model);
+            frag_store_commit(&store);
+            session_ops = erases + programs - ops;
+            memcpy(flash, backup, sizeof(flash));
+            frag_store_mount(&store, &nor, cache);
+        }
+        ops_budget = rand() % (session_ops + 1);
+        int cut = setjmp(power_loss);
+        if(!cut){
+            receive(files[next], lens[next], frag_size, model);
+            frag_store_commit(&store);
+        }
+        ops_budget = -1;
+        frag_store_mount(&store, &nor, cache);
+        const struct frag_store_file* f = frag_store_file(&store);
+        uint32_t size_current = files[current][4] | (files[current][5] << 8) | (files[current][6] << 16);
+        uint32_t size_next = files[next][4] | (files[next][5] << 8) | (files[next][6] << 16);
+        if(same_file(f, files[next], size_next) && f->id == files[next][3]){
+            new_files++;
+            current = next;
+        }else if(same_file(f, files[current], size_current) && f->id == files[current][3]){
+            old_files++;
+        }else{
+            failures++;
+            printf("FAIL power loss %d: the applied file is neither the old one nor the new one\n", i);
+            return;
+        }
+    }
+    printf("%d power losses: %d left the previous file, %d applied the new one\n", POWER_LOSSES, old_files, new_files);
+}
+
+#ifdef FRAG_DECODER
+/*
+    pseudo-random parity row of the fragmented data block transport specification
+*/
+static uint32_t prbs23(uint32_t x){
+    uint32_t b0 = x & 1;
+    uint32_t b1 = (x & 32) >> 5;
+    return (x >> 1) + ((b0 ^ b1) << 22);
+}
+
+static void matrix_line(uint16_t n, uint16_t m, uint8_t* line){
+    uint32_t mm = ((m & (m - 1)) == 0) ? 1 : 0;
+    uint32_t x = 1 + 1001 * n;
+    uint16_t coeffs = 0;
+    memset(line, 0, m);
+    while(coeffs < m / 2){
+        uint32_t r = 1 << 16;
+        while(r >= m || line[r]){
+            x = prbs23(x);
+            r = x % (m + mm);
+        }
+        line[r] = 1;
+        coeffs++;
+    }
+}
+
+static int32_t decoder_write(uint32_t addr, uint8_t* data, uint32_t size){
+    return frag_store_write(&store, addr, data, size) == 0 ? 0 : -1;
+}
+
+static int32_t decoder_read(uint32_t addr, uint8_t* data, uint32_t size){
+    return frag_store_read(&store, addr, data, size) == 0 ? 0 : -1;
+}
+
+static FragDecoderCallbacks_t callbacks = {
+    .FragDecoderWrite = decoder_write,
+    .FragDecoderRead = decoder_read,
+};
+
+static void check_decoder(uint32_t data_len, uint8_t frag_size, int loss){
+    static uint8_t file[SLOT_SECTORS * SECTOR_SIZE];
+    uint8_t line[FRAG_MAX_NB];
+    uint8_t frag[FRAG_MAX_SIZE];
+
+    memset(flash, 0xFF, sizeof(flash));
+    frag_store_mount(&store, &nor, cache);
+    uint32_t len = make_file(file, data_len, frag_size, 5, 3);
+    uint16_t m = len / frag_size;
+    if(m > FRAG_MAX_NB || frag_size > FRAG_MAX_SIZE){
+        printf("%u fragments of %u bytes is past FRAG_MAX_NB or FRAG_MAX_SIZE\n", m, frag_size);
+        failures++;
+        return;
+    }
+    srand(4);
+    erases = programs = 0;
+    clock_t start = clock();
+    //as in OnRxData of src/lorawan.c, the session setup opens the session, then the package inits the decoder
+    uint8_t setup[11];
+    setup_req(setup, m, frag_size, 0);
+    CHECK(frag_store_begin(&store, frag_store_session_setup(setup, sizeof(setup), FRAG_MAX_NB, FRAG_MAX_SIZE)) == 0,
+        "session setup of the decoder refused");
+    FragDecoderInit(m, frag_size, &callbacks);
+    int32_t status = FRAG_SESSION_ONGOING;
+    uint16_t sent = 0;
+    uint16_t n;
+    for(n = 1; n <= m + FRAG_MAX_REDUNDANCY && status == FRAG_SESSION_ONGOING; n++){
+        if(n <= m){
+            memcpy(frag, &file[(n - 1) * frag_size], frag_size);
+        }else{
+            matrix_line(n - m, m, line);
+            memset(frag, 0, frag_size);
+            for(uint16_t j = 0; j < m; j++)
+                if(line[j])
+                    for(uint8_t b = 0; b < frag_size; b++)
+                        frag[b] ^= file[j * frag_size + b];
+        }
+        sent++;
+        if(rand() % 100 < loss)
+            continue;
+        status = FragDecoderProcess(n, frag);
+    }
+    double ms = (clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+    CHECK(status != FRAG_SESSION_ONGOING && FragDecoderGetStatus().MatrixError == 0, "file not rebuilt after %u fragments",
+        sent);
+    CHECK(frag_store_commit(&store) == 0 && same_file(frag_store_file(&store), file, data_len), "rebuilt file differs");
+    printf("decoder: %u fragments of %u bytes, %d%% lost, rebuilt after %u sent, %.1f ms on the host, %u erases and %u"
+        " programs (about %.0f ms of flash)\n", m, frag_size, loss, sent, ms, erases, programs,
+        erases * ERASE_MS + programs * PROGRAM_MS);
+}
+#endif
+
+int main(int argc, char** argv){
+    uint32_t data_len = argc > 1 ? atoi(argv[1]) : 2400;
+    int frag_size = argc > 2 ? atoi(argv[2]) : 48;
+    if(frag_size < 1 || frag_size > 255 || data_len < 16 ||
+       data_len + FRAG_STORE_FILE_HEADER_LEN + frag_size > SLOT_SECTORS * SECTOR_SIZE - PAGE_SIZE){
+        printf("usage: %s [file bytes, up to %u] [fragment size]\n", argv[0],
+            SLOT_SECTORS * SECTOR_SIZE - PAGE_SIZE - FRAG_STORE_FILE_HEADER_LEN - 255);
+        return 1;
+    }
+
+    check_session_setup(data_len, frag_size);
+    check_sessions(data_len, frag_size);
+    check_power_loss(data_len, frag_size);
+#ifdef FRAG_DECODER
+    check_decoder(data_len, frag_size, argc > 3 ? atoi(argv[3]) : 10);
+#endif
+    printf("RAM of the store: %zu bytes of state and a %u byte sector cache\n", sizeof(struct frag_store), SECTOR_SIZE);
+
+    printf("%s\n", failures ? "FAILED" : "all checks passed");
+    return failures ? 1 : 0;
+}
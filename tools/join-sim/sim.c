@@ -0,0 +1,216 @@
+/**
+ * @file sim.c
+ * @brief host simulation of the OTAA join of src/lorawan.c against a network server stand-in. Each node follows the
+ *          same steps as the firmware: the DevNonce about to be used is written to the session record before the
+ *          request, the MAC stores its own context only once the receive windows are over, a failed attempt waits
+ *          as given by join_backoff (src/join-backoff.c) and never less than the join duty cycle of the region
+ *          (1% in the first hour, 0.1% up to the 11th, 0.01% after). The network server stand-in is down for the
+ *          first hours, loses a part of the frames both ways and refuses a DevNonce not higher than the last one
+ *          accepted, as a LoRaWAN 1.0.4 server does. Resets hit the nodes at random times, also in the middle
+ *          of an attempt, a node that already joined must come back with its session and not join again.
+ *
+ *          The same nodes are run with the retry of the old OnJoinRequest (again as soon as the MAC allows it)
+ *          and without the DevNonce kept in the session record, to compare.
+ *
+ *          build and run from this folder:
+ *          gcc -O2 -Wall -I../../src sim.c ../../src/join-backoff.c -o sim -lm
+ *          ./sim [nodes] [outage hours] [loss %] [resets per day]
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "join-backoff.h"
+
+// same values of src/lorawan.c
+#define BACKOFF_MIN_MS          15000
+#define BACKOFF_MAX_MS          (60 * 60 * 1000)
+// join request at SF12 BW125, 23 bytes
+#define JOIN_TOA_MS             1483
+// end of the second join accept window
+#define JOIN_RX2_END_MS         (6000 + 1000)
+#define HOUR_MS                 (60ull * 60 * 1000)
+#define SIM_MS                  (48 * HOUR_MS)
+#define BOOT_MS                 2000
+
+enum strategy { BACKOFF, IMMEDIATE, NO_RECORD };
+static const char* strategy_name[] = {"backoff", "immediate retry", "backoff, no DevNonce record"};
+
+/*
+    network server stand-in, one device each node
+*/
+struct server {
+    uint32_t last_dev_nonce;
+    bool seen;
+    uint32_t accepts;
+    uint32_t replays;                                   // join requests refused for a DevNonce already used
+};
+
+/*
+    what survives a reset
+*/
+struct nvm {
+    uint16_t ctx_dev_nonce;                             // crypto group of the LoRaMac context
+    uint16_t record_dev_nonce;                          // session record of src/lorawan.c
+    bool joined;
+};
+
+struct node {
+    struct nvm nvm;
+    struct server ns;
+    // RAM, lost at every reset
+    uint16_t dev_nonce;
+    bool joined;
+    uint64_t boot_time;
+    uint64_t dc_allowed;                                // next join request allowed by the duty cycle
+    struct join_backoff backoff;
+    // counters
+    uint32_t attempts;
+    uint32_t rejoins;                                   // joins started after a reset while a session was stored
+    uint64_t airtime_ms;
+    uint64_t airtime_first_hour_ms;
+    uint64_t join_time;
+};
+
+static double rnd(void){
+    return rand() / (RAND_MAX + 1.0);
+}
+
+/**
+ * @brief time-off of the join duty cycle after a request, counted from the boot as the MAC does
+ */
+static uint64_t join_time_off(uint64_t since_boot){
+    uint32_t factor = since_boot < HOUR_MS ? 100 : since_boot < 11 * HOUR_MS ? 1000 : 10000;
+    return (uint64_t)JOIN_TOA_MS * (factor - 1);
+}
+
+/**
+ * @brief one join attempt, gives the time of the next event of the node
+ */
+static uint64_t attempt(struct node* n, uint64_t now, enum strategy s, uint64_t outage, double loss, uint64_t reset_at){
+    //SessionJoin: the DevNonce about to be used is stored before the request
+    if(s != NO_RECORD)
+        n->nvm.record_dev_nonce = n->dev_nonce + 1;
+    n->attempts++;
+
+    //the MAC refuses the request while the duty cycle doesn't allow it, OnMacMlmeRequest schedules the retry
+    if(now < n->dc_allowed){
+        uint64_t wait = n->dc_allowed - now;
+        if(s == IMMEDIATE)
+            return now + wait;
+        return now + join_backoff_next(&n->backoff, (uint32_t)wait, (uint32_t)rand());
+    }
+
+    n->dev_nonce++;
+    n->dc_allowed = now + JOIN_TOA_MS + join_time_off(now - n->boot_time);
+    n->airtime_ms += JOIN_TOA_MS;
+    if(now < HOUR_MS)
+        n->airtime_first_hour_ms += JOIN_TOA_MS;
+
+    bool accepted = false;
+    if(now >= outage && rnd() >= loss){
+        if(n->ns.seen && n->dev_nonce <= n->ns.last_dev_nonce){
+            n->ns.replays++;
+        }else{
+            n->ns.seen = true;
+            n->ns.last_dev_nonce = n->dev_nonce;
+            n->ns.accepts++;
+            accepted = rnd() >= loss;
+        }
+    }
+
+    uint64_t done = now + JOIN_TOA_MS + JOIN_RX2_END_MS;
+    //a reset before the end of the windows: the MAC never stored its context
+    if(reset_at < done)
+        return done;
+    n->nvm.ctx_dev_nonce = n->dev_nonce;
+    if(accepted){
+        n->joined = n->nvm.joined = true;
+        n->join_time = done;
+        return UINT64_MAX;
+    }
+    if(s == IMMEDIATE)
+        return n->dc_allowed > done ? n->dc_allowed : done;
+    return done + join_backoff_next(&n->backoff, 0, (uint32_t)rand());
+}
+
+/**
+ * @brief boot as lorawan_init does: a stored session goes on, otherwise the DevNonce starts from the highest one known
+ */
+static uint64_t boot(struct node* n, uint64_t now){
+    n->boot_time = now;
+    n->dc_allowed = 0;
+    join_backoff_reset(&n->backoff, BACKOFF_MIN_MS, BACKOFF_MAX_MS);
+    n->dev_nonce = n->nvm.ctx_dev_nonce > n->nvm.record_dev_nonce ? n->nvm.ctx_dev_nonce : n->nvm.record_dev_nonce;
+    n->joined = n->nvm.joined;
+    return n->joined ? UINT64_MAX : now + BOOT_MS;
+}
+
+static void run(struct node* n, enum strategy s, uint64_t outage, double loss, double resets_per_day){
+    uint64_t now = 0;
+    uint64_t next = boot(n, now);
+    double reset_rate = resets_per_day / (24.0 * HOUR_MS);
+    uint64_t reset_at = reset_rate > 0 ? (uint64_t)(-log(1 - rnd()) / reset_rate) : UINT64_MAX;
+    while(now < SIM_MS){
+        if(reset_at <= next){
+            now = reset_at;
+            next = boot(n, now);
+            if(n->nvm.joined && next != UINT64_MAX)
+                n->rejoins++;
+            reset_at = now + (uint64_t)(-log(1 - rnd()) / reset_rate);
+            continue;
+        }
+        if(next == UINT64_MAX || next >= SIM_MS)
+            break;
+        now = next;
+        next = attempt(n, now, s, outage, loss, reset_at);
+    }
+}
+
+int main(int argc, char* argv[]){
+    int nodes = argc > 1 ? atoi(argv[1]) : 200;
+    double outage_h = argc > 2 ? atof(argv[2]) : 6;
+    double loss = (argc > 3 ? atof(argv[3]) : 20) / 100;
+    double resets_per_day = argc > 4 ? atof(argv[4]) : 4;
+    uint64_t outage = (uint64_t)(outage_h * HOUR_MS);
+    int failures = 0;
+
+    printf("%d nodes, server down for %.1f h, %.0f%% frames lost, %.1f resets a day, %.0f h simulated\n\n",
+        nodes, outage_h, loss * 100, resets_per_day, (double)SIM_MS / HOUR_MS);
+    printf("%-30s %8s %10s %10s %12s %12s %8s %8s\n", "strategy", "joined", "attempts", "airtime s",
+        "1st hour s", "join min", "replays", "rejoins");
+    for(enum strategy s = BACKOFF; s <= NO_RECORD; s++){
+        srand(1);
+        uint32_t joined = 0, replays = 0, rejoins = 0;
+        uint64_t attempts = 0, airtime = 0, first_hour_max = 0, join_time = 0;
+        for(int i = 0; i < nodes; i++){
+            struct node n = {0};
+            run(&n, s, outage, loss, resets_per_day);
+            joined += n.nvm.joined;
+            attempts += n.attempts;
+            airtime += n.airtime_ms;
+            replays += n.ns.replays;
+            rejoins += n.rejoins;
+            if(n.airtime_first_hour_ms > first_hour_max)
+                first_hour_max = n.airtime_first_hour_ms;
+            if(n.nvm.joined)
+                join_time += n.join_time;
+        }
+        printf("%-30s %8u %10.1f %10.1f %12.1f %12.1f %8u %8u\n", strategy_name[s], joined, (double)attempts / nodes,
+            airtime / 1000.0 / nodes, first_hour_max / 1000.0, joined ? join_time / 60000.0 / joined : 0, replays, rejoins);
+
+        //the firmware must never reuse a DevNonce, never exceed 36 s of join airtime in the first hour and never join again
+        if(s == BACKOFF && (replays != 0 || first_hour_max > 36000 || rejoins != 0 || joined != (uint32_t)nodes)){
+            printf("FAIL: the firmware strategy broke a rule\n");
+            failures++;
+        }
+    }
+    printf("\nattempts and airtime are per node, join min is the average minute of the join accept\n");
+    printf("%s\n", failures ? "FAILED" : "all checks passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file lfs-image.c
+ * @brief pico_hal.h on littlefs itself, mounted on an image file with the geometry of the littlefs partition of
+ *          the pico. Build it with lfs.c and lfs_util.c of the littlefs-lib submodule.
+ *          The cut tears the operation it lands on, as a power loss does to NOR flash: the program of a page
+ *          leaves a random part of it written and the rest as it was, an erase leaves a random part of the block
+ *          erased. Every operation after it fails until host_fs_power_cut(-1)
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico_hal.h"
+
+//same geometry of the littlefs partition on the pico
+#define BLOCK_SIZE          4096
+#define PROG_SIZE           256
+#define BLOCK_COUNT         64
+#define MAX_FILES           4
+
+static FILE* image;
+//programs left before the simulated power cut, negative means no cut
+static long prog_budget = -1;
+//the operation the cut landed on is torn, the ones after it don't reach the flash
+static int torn;
+static long progs;
+static lfs_t lfs;
+static lfs_file_t files[MAX_FILES];
+static int file_used[MAX_FILES];
+
+static int bd_read(const struct lfs_config* c, lfs_block_t block, lfs_off_t off, void* buffer, lfs_size_t size){
+    fseek(image, (long)block * c->block_size + off, SEEK_SET);
+    return fread(buffer, 1, size, image) == size ? 0 : LFS_ERR_IO;
+}
+
+static int bd_prog(const struct lfs_config* c, lfs_block_t block, lfs_off_t off, const void* buffer, lfs_size_t size){
+    if(prog_budget == 0){
+        if(!torn){
+            torn = 1;
+            fseek(image, (long)block * c->block_size + off, SEEK_SET);
+            fwrite(buffer, 1, rand() % size, image);
+        }
+        return LFS_ERR_IO;
+    }
+    if(prog_budget > 0)
+        prog_budget--;
+    progs++;
+    fseek(image, (long)block * c->block_size + off, SEEK_SET);
+    return fwrite(buffer, 1, size, image) == size ? 0 : LFS_ERR_IO;
+}
+
+static int bd_erase(const struct lfs_config* c, lfs_block_t block){
+    uint8_t erased[BLOCK_SIZE];
+    memset(erased, 0xFF, sizeof(erased));
+    fseek(image, (long)block * c->block_size, SEEK_SET);
+    if(prog_budget == 0){
+        if(!torn){
+            torn = 1;
+            fwrite(erased, 1, rand() % c->block_size, image);
+        }
+        return LFS_ERR_IO;
+    }
+    return fwrite(erased, 1, c->block_size, image) == c->block_size ? 0 : LFS_ERR_IO;
+}
+
+static int bd_sync(const struct lfs_config* c){
+    (void)c;
+    fflush(image);
+    return 0;
+}
+
+static const struct lfs_config cfg = {
+    .read = bd_read,
+    .prog = bd_prog,
+    .erase = bd_erase,
+    .sync = bd_sync,
+    .read_size = 1,
+    .prog_size = PROG_SIZE,
+    .block_size = BLOCK_SIZE,
+    .block_count = BLOCK_COUNT,
+    .block_cycles = 500,
+    .cache_size = PROG_SIZE,
+    .lookahead_size = 16,
+};
+
+int pico_open(const char* path, int flags){
+    for(int i = 0; i < MAX_FILES; i++){
+        if(!file_used[i]){
+            int rslt = lfs_file_open(&lfs, &files[i], path, flags);
+            if(rslt < 0)
+                return rslt;
+            file_used[i] = 1;
+            return i;
+        }
+    }
+    return LFS_ERR_NOMEM;
+}
+
+int pico_close(int file){
+    file_used[file] = 0;
+    return lfs_file_close(&lfs, &files[file]);
+}
+
+lfs_size_t pico_write(int file, const void* buffer, lfs_size_t size){
+    return lfs_file_write(&lfs, &files[file], buffer, size);
+}
+
+lfs_size_t pico_read(int file, void* buffer, lfs_size_t size){
+    return lfs_file_read(&lfs, &files[file], buffer, size);
+}
+
+lfs_soff_t pico_lseek(int file, lfs_soff_t off, int whence){
+    return lfs_file_seek(&lfs, &files[file], off, whence);
+}
+
+int pico_remove(const char* path){
+    return lfs_remove(&lfs, path);
+}
+
+int pico_rename(const char* oldpath, const char* newpath){
+    return lfs_rename(&lfs, oldpath, newpath);
+}
+
+int host_fs_format(const char* path){
+    image = fopen(path, "w+b");
+    if(image == NULL)
+        return LFS_ERR_IO;
+    uint8_t erased[BLOCK_SIZE];
+    memset(erased, 0xFF, sizeof(erased));
+    for(int b = 0; b < BLOCK_COUNT; b++)
+        fwrite(erased, 1, sizeof(erased), image);
+    progs = 0;
+    int rslt = lfs_format(&lfs, &cfg);
+    return rslt < 0 ? rslt : lfs_mount(&lfs, &cfg);
+}
+
+void host_fs_power_cut(long budget){
+    prog_budget = budget;
+    torn = 0;
+}
+
+int host_fs_reboot(void){
+    memset(file_used, 0, sizeof(file_used));
+    memset(&lfs, 0, sizeof(lfs));
+    return lfs_mount(&lfs, &cfg);
+}
+
+long host_fs_progs(void){
+    return progs;
+}
+
+void host_fs_close(void){
+    lfs_unmount(&lfs);
+    fclose(image);
+}
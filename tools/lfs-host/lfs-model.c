@@ -0,0 +1,253 @@
+/**
+ * @file lfs-model.c
+ * @brief pico_hal.h on a model of littlefs in RAM, for when the littlefs-lib submodule is not checked out.
+ *          It keeps what littlefs v2 guarantees across a power loss and nothing more:
+ *          - the data of a file opened for writing lives in the handle until pico_close, which commits the
+ *            new contents at once (copy on write), a power cut before leaves the old contents whole
+ *          - creating a file, removing it and renaming it are single atomic commits
+ *          - a write that fails leaves the handle broken, its close commits nothing and returns 0 as littlefs does
+ *          - the flash wear is counted in pages: the data of a write when it goes to the flash, a page for the
+ *            commit of the metadata
+ *          Torn pages, block allocation and metadata compaction are littlefs' own business and not modeled, run
+ *          lfs-image.c for them
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "pico_hal.h"
+
+//same capacity of the littlefs partition on the pico
+#define PROG_SIZE           256
+#define FS_SIZE             (64 * 4096)
+#define MAX_FILES           4
+#define MAX_NODES           16
+#define MAX_NAME            32
+
+struct node {
+    char name[MAX_NAME];
+    uint8_t* data;
+    lfs_size_t size;
+};
+
+struct handle {
+    int used;
+    int node;
+    int flags;
+    int dirty;
+    int erred;
+    uint8_t* data;      //contents seen through the handle, committed on close
+    lfs_size_t size;
+    lfs_size_t pos;
+};
+
+static struct node nodes[MAX_NODES];
+static struct handle handles[MAX_FILES];
+//programs left before the simulated power cut, negative means no cut
+static long prog_budget = -1;
+static long progs;
+
+static int prog(long pages){
+    if(prog_budget >= 0 && pages > prog_budget){
+        prog_budget = 0;
+        return LFS_ERR_IO;
+    }
+    if(prog_budget > 0)
+        prog_budget -= pages;
+    progs += pages;
+    return 0;
+}
+
+static int find(const char* path){
+    for(int i = 0; i < MAX_NODES; i++)
+        if(nodes[i].name[0] != '\0' && strcmp(nodes[i].name, path) == 0)
+            return i;
+    return -1;
+}
+
+static lfs_size_t used_space(void){
+    lfs_size_t used = 0;
+    for(int i = 0; i < MAX_NODES; i++)
+        if(nodes[i].name[0] != '\0')
+            used += nodes[i].size;
+    return used;
+}
+
+static void node_free(int n){
+    free(nodes[n].data);
+    memset(&nodes[n], 0, sizeof(nodes[n]));
+}
+
+int pico_open(const char* path, int flags){
+    if(strlen(path) >= MAX_NAME)
+        return LFS_ERR_NAMETOOLONG;
+    int f = 0;
+    while(f < MAX_FILES && handles[f].used)
+        f++;
+    if(f == MAX_FILES)
+        return LFS_ERR_NOMEM;
+
+    int n = find(path);
+    if(n < 0){
+        if(!(flags & LFS_O_CREAT))
+            return LFS_ERR_NOENT;
+        for(n = 0; n < MAX_NODES && nodes[n].name[0] != '\0'; n++)
+            ;
+        if(n == MAX_NODES)
+            return LFS_ERR_NOSPC;
+        //the new empty file is committed with the directory entry
+        int rslt = prog(1);
+        if(rslt < 0)
+            return rslt;
+        strcpy(nodes[n].name, path);
+    }else if((flags & LFS_O_CREAT) && (flags & LFS_O_EXCL)){
+        return LFS_ERR_EXIST;
+    }
+
+    struct handle* h = &handles[f];
+    memset(h, 0, sizeof(*h));
+    h->used = 1;
+    h->node = n;
+    h->flags = flags;
+    if(flags & LFS_O_TRUNC){
+        h->dirty = (flags & LFS_O_WRONLY) != 0;
+    }else if(nodes[n].size > 0){
+        h->data = malloc(nodes[n].size);
+        memcpy(h->data, nodes[n].data, nodes[n].size);
+        h->size = nodes[n].size;
+    }
+    return f;
+}
+
+int pico_close(int file){
+    struct handle* h = &handles[file];
+    if(file < 0 || file >= MAX_FILES || !h->used)
+        return LFS_ERR_BADF;
+    int rslt = 0;
+    if(h->dirty && !h->erred){
+        rslt = prog(1);
+        //a file removed or renamed over while open is gone, littlefs drops its commit as well
+        if(rslt == 0 && nodes[h->node].name[0] != '\0'){
+            struct node* n = &nodes[h->node];
+            free(n->data);
+            n->data = h->data;
+            n->size = h->size;
+            h->data = NULL;
+        }
+    }
+    free(h->data);
+    memset(h, 0, sizeof(*h));
+    return rslt;
+}
+
+lfs_size_t pico_write(int file, const void* buffer, lfs_size_t size){
+    struct handle* h = &handles[file];
+    if(file < 0 || file >= MAX_FILES || !h->used || !(h->flags & LFS_O_WRONLY))
+        return (lfs_size_t)LFS_ERR_BADF;
+    if(h->erred)
+        return (lfs_size_t)LFS_ERR_IO;
+    if(h->flags & LFS_O_APPEND)
+        h->pos = h->size;
+    lfs_size_t end = h->pos + size;
+    if(end > h->size && used_space() - nodes[h->node].size + end > FS_SIZE)
+        return (lfs_size_t)LFS_ERR_NOSPC;
+    if(prog((size + PROG_SIZE - 1) / PROG_SIZE) < 0){
+        h->erred = 1;
+        return (lfs_size_t)LFS_ERR_IO;
+    }
+    if(end > h->size){
+        h->data = realloc(h->data, end);
+        memset(h->data + h->size, 0, h->pos > h->size ? h->pos - h->size : 0);
+        h->size = end;
+    }
+    memcpy(h->data + h->pos, buffer, size);
+    h->pos = end;
+    h->dirty = 1;
+    return size;
+}
+
+lfs_size_t pico_read(int file, void* buffer, lfs_size_t size){
+    struct handle* h = &handles[file];
+    if(file < 0 || file >= MAX_FILES || !h->used || !(h->flags & LFS_O_RDONLY))
+        return (lfs_size_t)LFS_ERR_BADF;
+    if(h->pos >= h->size)
+        return 0;
+    if(size > h->size - h->pos)
+        size = h->size - h->pos;
+    memcpy(buffer, h->data + h->pos, size);
+    h->pos += size;
+    return size;
+}
+
+lfs_soff_t pico_lseek(int file, lfs_soff_t off, int whence){
+    struct handle* h = &handles[file];
+    if(file < 0 || file >= MAX_FILES || !h->used)
+        return LFS_ERR_BADF;
+    int64_t pos = off;
+    if(whence == LFS_SEEK_CUR)
+        pos += h->pos;
+    else if(whence == LFS_SEEK_END)
+        pos += h->size;
+    if(pos < 0)
+        return LFS_ERR_INVAL;
+    h->pos = (lfs_size_t)pos;
+    return (lfs_soff_t)pos;
+}
+
+int pico_remove(const char* path){
+    int n = find(path);
+    if(n < 0)
+        return LFS_ERR_NOENT;
+    int rslt = prog(1);
+    if(rslt < 0)
+        return rslt;
+    node_free(n);
+    return 0;
+}
+
+int pico_rename(const char* oldpath, const char* newpath){
+    int n = find(oldpath);
+    if(n < 0)
+        return LFS_ERR_NOENT;
+    if(strlen(newpath) >= MAX_NAME)
+        return LFS_ERR_NAMETOOLONG;
+    int rslt = prog(1);
+    if(rslt < 0)
+        return rslt;
+    int old = find(newpath);
+    if(old >= 0 && old != n)
+        node_free(old);
+    strcpy(nodes[n].name, newpath);
+    return 0;
+}
+
+int host_fs_format(const char* image){
+    (void)image;
+    host_fs_reboot();
+    for(int n = 0; n < MAX_NODES; n++)
+        node_free(n);
+    progs = 0;
+    return 0;
+}
+
+void host_fs_power_cut(long budget){
+    prog_budget = budget;
+}
+
+int host_fs_reboot(void){
+    for(int f = 0; f < MAX_FILES; f++){
+        free(handles[f].data);
+        memset(&handles[f], 0, sizeof(handles[f]));
+    }
+    return 0;
+}
+
+long host_fs_progs(void){
+    return progs;
+}
+
+void host_fs_close(void){
+    host_fs_format(NULL);
+}
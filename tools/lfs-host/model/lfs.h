@@ -0,0 +1,50 @@
+/**
+ * @file lfs.h
+ * @brief the part of lfs.h of littlefs v2 that pico_hal.h and its users need, with the same values, for the
+ *          model of lfs-model.c. Not on the include path when the real littlefs is built
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef LFS_H
+#define LFS_H
+
+#include <stdint.h>
+
+typedef uint32_t lfs_size_t;
+typedef uint32_t lfs_off_t;
+typedef int32_t lfs_ssize_t;
+typedef int32_t lfs_soff_t;
+
+enum lfs_error {
+    LFS_ERR_OK          = 0,
+    LFS_ERR_IO          = -5,
+    LFS_ERR_CORRUPT     = -84,
+    LFS_ERR_NOENT       = -2,
+    LFS_ERR_EXIST       = -17,
+    LFS_ERR_ISDIR       = -21,
+    LFS_ERR_BADF        = -9,
+    LFS_ERR_INVAL       = -22,
+    LFS_ERR_NOSPC       = -28,
+    LFS_ERR_NOMEM       = -12,
+    LFS_ERR_NAMETOOLONG = -36,
+};
+
+enum lfs_open_flags {
+    LFS_O_RDONLY = 1,
+    LFS_O_WRONLY = 2,
+    LFS_O_RDWR   = 3,
+    LFS_O_CREAT  = 0x0100,
+    LFS_O_EXCL   = 0x0200,
+    LFS_O_TRUNC  = 0x0400,
+    LFS_O_APPEND = 0x0800,
+};
+
+enum lfs_whence_flags {
+    LFS_SEEK_SET = 0,
+    LFS_SEEK_CUR = 1,
+    LFS_SEEK_END = 2,
+};
+
+#endif
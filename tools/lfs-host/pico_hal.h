@@ -0,0 +1,66 @@
+/**
+ * @file pico_hal.h
+ * @brief host replacement of the pico_hal layer of littlefs-lib, the same functions for the libraries using the
+ *          filesystem (uplink_queue, state_store), so that they run unchanged. Two implementations:
+ *          lfs-image.c runs littlefs itself (lfs.c of the littlefs-lib submodule) on an image file with the
+ *          geometry of the flash of the pico, lfs-model.c is a model of what littlefs guarantees across a power
+ *          loss for when the submodule is not checked out (model/lfs.h stands in for lfs.h).
+ *          Both cut the power after a given number of flash programs and mount again as after a reset,
+ *          lfs-image.c also tears the program or the erase the cut lands on.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#ifndef _PICO_HAL_H_
+#define _PICO_HAL_H_
+
+#include "lfs.h"
+
+int pico_open(const char* path, int flags);
+
+int pico_close(int file);
+
+lfs_size_t pico_write(int file, const void* buffer, lfs_size_t size);
+
+lfs_size_t pico_read(int file, void* buffer, lfs_size_t size);
+
+lfs_soff_t pico_lseek(int file, lfs_soff_t off, int whence);
+
+int pico_remove(const char* path);
+
+int pico_rename(const char* oldpath, const char* newpath);
+
+/**
+ * @brief formats and mounts an empty filesystem
+ *
+ * @param image file of the flash image, not used by the model
+ * @return int 0 or < 0 if the image can't be created
+ */
+int host_fs_format(const char* image);
+
+/**
+ * @brief the flash stops programming and erasing after progs more programs of a page, as on a power loss:
+ *          every operation reaching the flash after that fails, lfs-image.c leaves the first of them half done.
+ *          -1 powers the flash again
+ */
+void host_fs_power_cut(long progs);
+
+/**
+ * @brief mounts the filesystem again as after a reset, the open files are forgotten
+ *
+ * @return int 0 or < 0 if the filesystem can't be mounted
+ */
+int host_fs_reboot(void);
+
+/**
+ * @brief pages programmed since the format, the flash wear of the operations run
+ */
+long host_fs_progs(void);
+
+/**
+ * @brief unmounts the filesystem and closes the image
+ */
+void host_fs_close(void);
+
+#endif
@@ -0,0 +1,156 @@
+/**
+ * @file host.c
+ * @brief host check of the link telemetry of src/lorawan.c (src/link-telemetry.c): the RSSI and SNR land in the
+ *          bucket of their lower edge with the first and last bucket open, the counters saturate instead of wrapping,
+ *          the margins start unknown and keep the lowest one seen, and the digest is checked byte by byte, also cut
+ *          at every length from the header to the full size, a datarate block is either whole or left out.
+ *          With an argument the digest of a sample period is printed as a JavaScript array, to feed to Decode of
+ *          executables/class-a/codec.js on LINK_DIGEST_PORT.
+ *
+ *          build and run from this folder:
+ *          gcc -O2 -Wall -I../../src/include host.c ../../src/link-telemetry.c -o host
+ *          ./host [hex]
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/link-telemetry.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do{ \
+        if(!(cond)){ \
+            failures++; \
+            printf("FAIL line %d: ", __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    }while(0)
+
+static int bucket_of(const uint16_t* buckets){
+    for(int b = 0; b < LINK_TELEMETRY_BUCKETS; b++)
+        if(buckets[b] != 0)
+            return b;
+    return -1;
+}
+
+static void check_buckets(void){
+    struct { int16_t rssi; int rssi_bucket; int8_t snr; int snr_bucket; } cases[] = {
+        {-200, 0, -30, 0},
+        {-128, 0, -20, 0},
+        {-117, 0, -17, 0},
+        {-116, 1, -16, 1},
+        {-44, 7, 7, 6},
+        {-45, 6, 8, 7},
+        {0, 7, 40, 7},
+    };
+    for(unsigned i = 0; i < sizeof(cases) / sizeof(cases[0]); i++){
+        struct link_telemetry t;
+        link_telemetry_reset(&t);
+        link_telemetry_downlink(&t, 3, cases[i].rssi, cases[i].snr, LINK_TELEMETRY_RX1, -12);
+        CHECK(bucket_of(t.rssi[3]) == cases[i].rssi_bucket, "RSSI %d in bucket %d instead of %d", cases[i].rssi,
+            bucket_of(t.rssi[3]), cases[i].rssi_bucket);
+        CHECK(bucket_of(t.snr[3]) == cases[i].snr_bucket, "SNR %d in bucket %d instead of %d", cases[i].snr,
+            bucket_of(t.snr[3]), cases[i].snr_bucket);
+    }
+}
+
+static void check_counters(void){
+    struct link_telemetry t;
+    link_telemetry_reset(&t);
+    CHECK(t.link_check_margin == LINK_TELEMETRY_NO_MARGIN && t.devstatus_margin == LINK_TELEMETRY_NO_MARGIN &&
+          t.min_downlink_margin == LINK_TELEMETRY_NO_MARGIN, "margins known after a reset");
+
+    for(int i = 0; i < 70000; i++)
+        link_telemetry_uplink(&t, 5, true, i % 2);
+    CHECK(t.uplinks[5] == UINT16_MAX, "uplinks %u, not saturated", t.uplinks[5]);
+    CHECK(t.acked == 35000 && t.missed == 35000, "acked %u missed %u", t.acked, t.missed);
+
+    link_telemetry_uplink(&t, 200, false, false);
+    CHECK(t.acked == 35000 && t.missed == 35000, "unconfirmed uplink counted as confirmed");
+
+    //the lowest margin stays, the DevStatus margin follows the last downlink within -32..31
+    link_telemetry_downlink(&t, 5, -90, 4, LINK_TELEMETRY_RX1, -7);
+    link_telemetry_downlink(&t, 0, -120, -15, LINK_TELEMETRY_RX2, -20);
+    link_telemetry_downlink(&t, 5, -60, 40, 9, -7);
+    CHECK(t.min_downlink_margin == 5, "lowest margin %d instead of 5", t.min_downlink_margin);
+    CHECK(t.devstatus_margin == 31, "DevStatus margin %d instead of 31", t.devstatus_margin);
+    CHECK(t.rx_hits[LINK_TELEMETRY_RX1] == 1 && t.rx_hits[LINK_TELEMETRY_RX2] == 1 &&
+          t.rx_hits[LINK_TELEMETRY_RX_OTHER] == 1, "windows %u %u %u", t.rx_hits[0], t.rx_hits[1], t.rx_hits[2]);
+
+    link_telemetry_link_check(&t, 200, 3);
+    CHECK(t.link_check_margin == LINK_TELEMETRY_NO_MARGIN - 1 && t.link_check_gateways == 3,
+        "link check margin %d gateways %u", t.link_check_margin, t.link_check_gateways);
+}
+
+/*
+    sample period: uplinks at DR5 and DR0, downlinks at DR5, DR0 and DR3, a link check
+*/
+static void sample(struct link_telemetry* t){
+    link_telemetry_reset(t);
+    for(int i = 0; i < 300; i++)
+        link_telemetry_uplink(t, 5, i % 10 == 0, i % 20 == 0);
+    for(int i = 0; i < 4; i++)
+        link_telemetry_uplink(t, 0, true, true);
+    link_telemetry_downlink(t, 5, -70, 9, LINK_TELEMETRY_RX1, -7);
+    link_telemetry_downlink(t, 5, -101, -2, LINK_TELEMETRY_RX1, -7);
+    link_telemetry_downlink(t, 0, -118, -14, LINK_TELEMETRY_RX2, -20);
+    link_telemetry_downlink(t, 3, -95, 1, LINK_TELEMETRY_RX_OTHER, -12);
+    link_telemetry_link_check(t, 18, 2);
+}
+
+static void check_digest(void){
+    struct link_telemetry t;
+    uint8_t buf[255];
+    sample(&t);
+
+    int len = link_telemetry_digest(&t, buf, sizeof(buf));
+    CHECK(len == LINK_TELEMETRY_HEADER_LEN + 3 * LINK_TELEMETRY_BLOCK_LEN, "digest of %d bytes", len);
+    const uint8_t header[LINK_TELEMETRY_HEADER_LEN] = {
+        1, 19, 0, 15, 0, 2, 0, 1, 0, 1, 0, 18, 2, 1, 5, 0x29
+    };
+    for(int i = 0; i < LINK_TELEMETRY_HEADER_LEN; i++)
+        CHECK(buf[i] == header[i], "header byte %d is %u instead of %u", i, buf[i], header[i]);
+    //DR0 block first, then DR3 without uplinks, then DR5 with its count saturated to a byte
+    const uint8_t* dr0 = &buf[LINK_TELEMETRY_HEADER_LEN];
+    const uint8_t* dr3 = dr0 + LINK_TELEMETRY_BLOCK_LEN;
+    const uint8_t* dr5 = dr3 + LINK_TELEMETRY_BLOCK_LEN;
+    CHECK(dr0[0] == 4 && dr0[1 + 0] == 1 && dr0[1 + LINK_TELEMETRY_BUCKETS + 1] == 1, "DR0 block");
+    CHECK(dr3[0] == 0 && dr3[1 + 2] == 1 && dr3[1 + LINK_TELEMETRY_BUCKETS + 5] == 1, "DR3 block");
+    CHECK(dr5[0] == 255 && dr5[1 + 4] == 1 && dr5[1 + 2] == 1, "DR5 block");
+
+    //every cut keeps the header and whole blocks only
+    CHECK(link_telemetry_digest(&t, buf, LINK_TELEMETRY_HEADER_LEN - 1) == 0, "header cut");
+    for(int max = LINK_TELEMETRY_HEADER_LEN; max < len + 5; max++){
+        int cut = link_telemetry_digest(&t, buf, max);
+        int blocks = 0;
+        for(int dr = 0; dr < LINK_TELEMETRY_DATARATES; dr++)
+            blocks += (buf[15] >> dr) & 1;
+        int whole = (max - LINK_TELEMETRY_HEADER_LEN) / LINK_TELEMETRY_BLOCK_LEN;
+        int expected = whole < 3 ? whole : 3;
+        CHECK(cut <= max && blocks == expected && cut == LINK_TELEMETRY_HEADER_LEN + blocks * LINK_TELEMETRY_BLOCK_LEN,
+            "cut at %d: %d bytes, %d blocks", max, cut, blocks);
+    }
+}
+
+int main(int argc, char** argv){
+    if(argc > 1){
+        struct link_telemetry t;
+        uint8_t buf[255];
+        sample(&t);
+        int len = link_telemetry_digest(&t, buf, sizeof(buf));
+        printf("[");
+        for(int i = 0; i < len; i++)
+            printf("%s0x%02x", i ? ", " : "", buf[i]);
+        printf("]\n");
+        return 0;
+    }
+    check_buckets();
+    check_counters();
+    check_digest();
+    printf("%s\n", failures ? "FAILED" : "all checks passed");
+    return failures ? 1 : 0;
+}
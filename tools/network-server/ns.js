@@ -0,0 +1,979 @@
+/*
+    network server stand-in for end to end tests of src/lorawan.c without a live network server, run with
+        node ns.js [options]
+
+    The gateway side is the UDP protocol of the Semtech packet forwarder (PUSH_DATA, PULL_DATA, PULL_RESP), the one of
+    the nanogateways and of a radio emulator on the host. For every device it keeps a LoRaWAN 1.0.x session:
+      - OTAA: join requests checked with the AppKey, DevNonce higher than the last one accepted (LoRaWAN 1.0.4),
+        join accept in JOIN_ACCEPT_DELAY1 with a new DevAddr, session keys derived as the device does
+      - ABP: session keys given, the DevAddr finds the session
+      - every uplink: MIC with the NwkSKey, 32 bit FCnt rebuilt from the 16 bits sent, replays refused, a confirmed
+        uplink sent again with the same FCnt is acknowledged again but delivered once, FRMPayload decrypted
+      - the application payload decoded by Decode of the codec.js of the executable, the same file a real network
+        server is given
+      - MAC commands answered: LinkCheckReq, DeviceTimeReq and PingSlotInfoReq, and AppTimeReq of the clock
+        synchronization package on port 202
+      - scripted downlinks: port and payload, or an object for Encode of the codec.js, after a given number of
+        uplinks, in RX1 of the next uplink as a class A device expects them
+    Every event is a JSON line on stdout.
+
+    options:
+        --port <udp port>       port of the packet forwarder, 1700 by default
+        --config <config.h>     a device with the keys of the lora-config.h of an executable: the ABP keys, or DEV_EUI,
+                                LORAWAN_APP_EUI and LORAWAN_APP_KEY when LORAWAN_OTAA is defined, can be repeated
+        --devices <file.json>   devices, a list of { "name", "dev_eui", "join_eui", "app_key" } for OTAA or
+                                { "name", "dev_addr", "nwk_s_key", "app_s_key" } for ABP, "codec" optional
+        --codec <codec.js>      decoder of the devices without their own, ../../executables/class-a/codec.js
+        --script <file.json>    downlinks, a list of { "device": name, DevEUI or DevAddr, "after": uplinks of the
+                                session before it's sent, "port", "hex" or "object", "confirmed" }
+        --relax-fcnt            accept an ABP device starting again from FCnt 0 after a reset
+        --quiet                 no line for every frame, the counters every 10 s
+        --check                 checks the crypto and the session handling against a device emulator, and a frame
+                                through UDP
+        --bench [frames] [devices]  frames a second through the server, in process and over UDP
+
+    keys and EUIs are hex strings most significant byte first, as in lora-config.h
+*/
+
+var crypto = require("crypto");
+var dgram = require("dgram");
+var fs = require("fs");
+var path = require("path");
+var vm = require("vm");
+
+var MTYPE_JOIN_REQUEST = 0;
+var MTYPE_JOIN_ACCEPT = 1;
+var MTYPE_UNCONFIRMED_UP = 2;
+var MTYPE_UNCONFIRMED_DOWN = 3;
+var MTYPE_CONFIRMED_UP = 4;
+var MTYPE_CONFIRMED_DOWN = 5;
+var DIR_UP = 0;
+var DIR_DOWN = 1;
+var FCTRL_ADR = 0x80;
+var FCTRL_ADR_ACK_REQ = 0x40;
+var FCTRL_ACK = 0x20;
+var MAX_FOPTS = 15;
+var RX1_DELAY_US = 1000000;
+var JOIN_ACCEPT_DELAY1_US = 5000000;
+/* NetID 0, the DevAddr of the joins from here */
+var NET_ID = 0x000000;
+var DEV_ADDR_BASE = 0x26010000;
+/* clock synchronization package */
+var CLOCK_SYNC_PORT = 202;
+var CLOCK_SYNC_PACKAGE_VERSION = 0x00;
+var CLOCK_SYNC_APP_TIME = 0x01;
+/* 1980-01-06 in unix time and the leap seconds since */
+var GPS_EPOCH_MS = 315964800000;
+var LEAP_SECONDS = 18;
+/* demodulation floor of SF7 to SF12, dB */
+var SNR_FLOOR = { 7: -7.5, 8: -10, 9: -12.5, 10: -15, 11: -17.5, 12: -20 };
+/* length of the MAC commands sent by the device after the CID, to skip the ones not answered here */
+var MAC_UP_LEN = { 0x02: 0, 0x03: 1, 0x04: 0, 0x05: 1, 0x06: 2, 0x07: 1, 0x08: 0, 0x09: 0, 0x0A: 1, 0x0D: 0, 0x10: 1,
+                   0x11: 1, 0x12: 0, 0x13: 1 };
+var CID_LINK_CHECK = 0x02;
+var CID_DEVICE_TIME = 0x0D;
+var CID_PING_SLOT_INFO = 0x10;
+/* Semtech packet forwarder protocol */
+var PF_VERSION = 2;
+var PF_PUSH_DATA = 0x00;
+var PF_PUSH_ACK = 0x01;
+var PF_PULL_DATA = 0x02;
+var PF_PULL_RESP = 0x03;
+var PF_PULL_ACK = 0x04;
+var PF_TX_ACK = 0x05;
+
+/* ---- crypto ---- */
+
+/* an ECB cipher kept for every key, setting up one costs more than the few blocks of a frame */
+var ciphers = new WeakMap();
+
+function aesEncrypt(key, data){
+    var c = ciphers.get(key);
+    if(!c){
+        c = crypto.createCipheriv("aes-128-ecb", key, null);
+        c.setAutoPadding(false);
+        ciphers.set(key, c);
+    }
+    return c.update(data);
+}
+
+function aesDecrypt(key, data){
+    var d = crypto.createDecipheriv("aes-128-ecb", key, null);
+    d.setAutoPadding(false);
+    return d.update(data);
+}
+
+function shiftLeft(block){
+    var out = Buffer.alloc(16);
+    for(var i = 0; i < 16; i++)
+        out[i] = ((block[i] << 1) | (i < 15 ? block[i + 1] >> 7 : 0)) & 0xFF;
+    return out;
+}
+
+/* subkeys of AES-CMAC (RFC 4493), and a CBC cipher of the key kept with the session */
+function cmacSubkeys(key){
+    var l = aesEncrypt(key, Buffer.alloc(16));
+    var k1 = shiftLeft(l);
+    if(l[0] & 0x80)
+        k1[15] ^= 0x87;
+    var k2 = shiftLeft(k1);
+    if(k1[0] & 0x80)
+        k2[15] ^= 0x87;
+    var cbc = crypto.createCipheriv("aes-128-cbc", key, Buffer.alloc(16));
+    cbc.setAutoPadding(false);
+    return { "key": key, "k1": k1, "k2": k2, "cbc": cbc, "chain": Buffer.alloc(16) };
+}
+
+/*
+    AES-CMAC, the whole message in one call of the CBC cipher of the key: the cipher goes on from the last block of
+    the message before, taken out of the first block of this one
+*/
+function cmac(sub, msg){
+    var n = Math.ceil(msg.length / 16);
+    var complete = n > 0 && msg.length % 16 === 0;
+    if(n === 0)
+        n = 1;
+    var data = Buffer.alloc(n * 16);
+    msg.copy(data);
+    if(!complete)
+        data[msg.length] = 0x80;
+    var k = complete ? sub.k1 : sub.k2;
+    for(var i = 0; i < 16; i++){
+        data[(n - 1) * 16 + i] ^= k[i];
+        data[i] ^= sub.chain[i];
+    }
+    var out = sub.cbc.update(data);
+    sub.chain = out.subarray(out.length - 16);
+    return sub.chain;
+}
+
+/* B0 or A block of a data frame */
+function block(first, dir, devAddr, fcnt, last){
+    var b = Buffer.alloc(16);
+    b[0] = first;
+    b[5] = dir;
+    b.writeUInt32LE(devAddr >>> 0, 6);
+    b.writeUInt32LE(fcnt >>> 0, 10);
+    b[15] = last;
+    return b;
+}
+
+function frameMic(sub, dir, devAddr, fcnt, msg){
+    return cmac(sub, Buffer.concat([block(0x49, dir, devAddr, fcnt, msg.length), msg])).subarray(0, 4);
+}
+
+/* FRMPayload encryption, the same both ways */
+function cryptPayload(key, dir, devAddr, fcnt, payload){
+    var n = Math.ceil(payload.length / 16);
+    var a = Buffer.alloc(n * 16);
+    for(var i = 0; i < n; i++)
+        block(0x01, dir, devAddr, fcnt, i + 1).copy(a, i * 16);
+    var s = aesEncrypt(key, a);
+    var out = Buffer.alloc(payload.length);
+    for(var j = 0; j < payload.length; j++)
+        out[j] = payload[j] ^ s[j];
+    return out;
+}
+
+/* NwkSKey (0x01) or AppSKey (0x02) of LoRaWAN 1.0.x */
+function sessionKey(appKey, type, joinNonce, netId, devNonce){
+    var b = Buffer.alloc(16);
+    b[0] = type;
+    b.writeUIntLE(joinNonce, 1, 3);
+    b.writeUIntLE(netId, 4, 3);
+    b.writeUInt16LE(devNonce, 7);
+    return aesEncrypt(appKey, b);
+}
+
+/* ---- helpers ---- */
+
+function hexKey(s, bytes, what){
+    if(typeof s !== "string" || !new RegExp("^[0-9a-fA-F]{" + 2 * bytes + "}$").test(s))
+        throw new Error(what + " must be " + bytes + " bytes of hex, got " + s);
+    return Buffer.from(s, "hex");
+}
+
+/* EUIs are sent least significant byte first */
+function euiKey(s, what){
+    return Buffer.from(hexKey(s, 8, what)).reverse().toString("hex");
+}
+
+function gpsNow(ms){
+    return (ms - GPS_EPOCH_MS) / 1000 + LEAP_SECONDS;
+}
+
+function spreadingFactor(datr){
+    var m = /^SF(\d+)/.exec(datr || "");
+    return m ? parseInt(m[1], 10) : 12;
+}
+
+/* Decode and Encode of a codec.js, run apart from this file with its own console.log calls silenced */
+var codecs = {};
+function loadCodec(file){
+    var full = path.resolve(file);
+    if(!(full in codecs)){
+        var wrap = "(function(console){\n" + fs.readFileSync(full, "utf8") + "\nreturn { \"Decode\": typeof Decode === " +
+                   "\"function\" ? Decode : undefined, \"Encode\": typeof Encode === \"function\" ? Encode : undefined };\n})";
+        codecs[full] = vm.runInThisContext(wrap, { "filename": full, "lineOffset": -1 })({ "log": function(){} });
+    }
+    return codecs[full];
+}
+
+/* #define NAME "value" of a lora-config.h, LORAWAN_OTAA as defined or not */
+function readConfig(file){
+    var text = fs.readFileSync(file, "utf8");
+    var defs = {};
+    var re = /^[ \t]*#define[ \t]+(\w+)(?:[ \t]+"([^"]*)")?/mg;
+    var m;
+    while((m = re.exec(text)) !== null)
+        defs[m[1]] = m[2] === undefined ? true : m[2];
+    var name = path.basename(path.dirname(path.resolve(file)));
+    if(defs.LORAWAN_OTAA)
+        return { "name": name, "dev_eui": defs.DEV_EUI, "join_eui": defs.LORAWAN_APP_EUI, "app_key": defs.LORAWAN_APP_KEY };
+    return { "name": name, "dev_addr": defs.LORAWAN_DEV_ADDR, "nwk_s_key": defs.LORAWAN_NETWORK_SESSION_KEY,
+             "app_s_key": defs.LORAWAN_APP_SESSION_KEY };
+}
+
+/* ---- network server ---- */
+
+function NetworkServer(options){
+    this.options = options || {};
+    this.emit = this.options.emit || function(){};
+    this.byEui = new Map();
+    this.byAddr = new Map();
+    this.byName = new Map();
+    this.nextAddr = DEV_ADDR_BASE;
+    this.counters = { "joins": 0, "join_errors": 0, "uplinks": 0, "retransmissions": 0, "mic_errors": 0,
+                      "fcnt_errors": 0, "unknown": 0, "decode_errors": 0, "downlinks": 0 };
+}
+
+/* a device, OTAA when it has an AppKey */
+NetworkServer.prototype.addDevice = function(d){
+    var dev = { "name": d.name, "codec": d.codec ? loadCodec(d.codec) : this.options.codec, "queue": [],
+                "uplinks": 0, "session": null };
+    if(d.app_key !== undefined){
+        dev.devEui = euiKey(d.dev_eui, "dev_eui");
+        dev.joinEui = euiKey(d.join_eui || "0000000000000000", "join_eui");
+        dev.appKey = cmacSubkeys(hexKey(d.app_key, 16, "app_key"));
+        dev.devNonce = -1;
+        dev.joinNonce = 0;
+        this.byEui.set(dev.devEui, dev);
+    }else{
+        var addr = parseInt(hexKey(d.dev_addr, 4, "dev_addr").toString("hex"), 16);
+        this.startSession(dev, addr, hexKey(d.nwk_s_key, 16, "nwk_s_key"), hexKey(d.app_s_key, 16, "app_s_key"));
+    }
+    if(dev.name === undefined)
+        dev.name = dev.devEui || d.dev_addr;
+    this.byName.set(dev.name, dev);
+    if(d.dev_eui)
+        this.byName.set(d.dev_eui.toLowerCase(), dev);
+    if(d.dev_addr)
+        this.byName.set(d.dev_addr.toLowerCase(), dev);
+    return dev;
+};
+
+NetworkServer.prototype.startSession = function(dev, devAddr, nwkSKey, appSKey){
+    if(dev.session)
+        this.byAddr.delete(dev.session.devAddr);
+    dev.session = { "devAddr": devAddr >>> 0, "nwkSKey": cmacSubkeys(nwkSKey), "appSKey": appSKey, "fcntUp": -1,
+                    "fcntDown": 0, "pending": null };
+    this.byAddr.set(dev.session.devAddr, dev);
+};
+
+/* a scripted downlink, payload as bytes or as an object for Encode of the codec */
+NetworkServer.prototype.schedule = function(item){
+    var dev = this.byName.get(String(item.device).toLowerCase()) || this.byName.get(item.device);
+    if(!dev)
+        throw new Error("script: no device " + item.device);
+    var payload;
+    if(item.object !== undefined){
+        if(!dev.codec || typeof dev.codec.Encode !== "function")
+            throw new Error("script: no Encode for " + dev.name);
+        payload = Buffer.from(dev.codec.Encode(item.port, item.object, {}));
+    }else{
+        payload = Buffer.from(item.hex || "", "hex");
+    }
+    dev.queue.push({ "after": item.after || 0, "port": item.port, "payload": payload, "confirmed": !!item.confirmed });
+};
+
+/*
+    a frame from the gateway, meta has tmst, freq, datr, lsnr, rssi of the rxpk
+    gives the downlink to send, { phy, delay_us }, or null
+*/
+NetworkServer.prototype.uplink = function(phy, meta){
+    meta = meta || {};
+    if(phy.length < 12){
+        this.counters.unknown++;
+        return null;
+    }
+    var mtype = phy[0] >> 5;
+    if(mtype === MTYPE_JOIN_REQUEST)
+        return this.join(phy, meta);
+    if(mtype === MTYPE_UNCONFIRMED_UP || mtype === MTYPE_CONFIRMED_UP)
+        return this.data(phy, meta, mtype === MTYPE_CONFIRMED_UP);
+    this.counters.unknown++;
+    return null;
+};
+
+NetworkServer.prototype.join = function(phy, meta){
+    if(phy.length !== 23){
+        this.counters.join_errors++;
+        return null;
+    }
+    var joinEui = phy.subarray(1, 9).toString("hex");
+    var devEui = phy.subarray(9, 17).toString("hex");
+    var devNonce = phy.readUInt16LE(17);
+    var dev = this.byEui.get(devEui);
+    var euiText = Buffer.from(phy.subarray(9, 17)).reverse().toString("hex");
+    if(!dev || dev.joinEui !== joinEui){
+        this.counters.unknown++;
+        this.emit({ "event": "join_unknown", "dev_eui": euiText });
+        return null;
+    }
+    if(!cmac(dev.appKey, phy.subarray(0, 19)).subarray(0, 4).equals(phy.subarray(19, 23))){
+        this.counters.mic_errors++;
+        this.emit({ "event": "join_mic_error", "device": dev.name });
+        return null;
+    }
+    if(devNonce <= dev.devNonce){
+        this.counters.join_errors++;
+        this.emit({ "event": "join_replay", "device": dev.name, "dev_nonce": devNonce, "last": dev.devNonce });
+        return null;
+    }
+    dev.devNonce = devNonce;
+    dev.joinNonce = (dev.joinNonce + 1) & 0xFFFFFF;
+    var devAddr = dev.session ? dev.session.devAddr : this.nextAddr++;
+
+    // JoinNonce, NetID, DevAddr, DLSettings (RX1DROffset 0, RX2 DR0), RxDelay 1 s, no CFList
+    var accept = Buffer.alloc(13);
+    accept[0] = MTYPE_JOIN_ACCEPT << 5;
+    accept.writeUIntLE(dev.joinNonce, 1, 3);
+    accept.writeUIntLE(NET_ID, 4, 3);
+    accept.writeUInt32LE(devAddr >>> 0, 7);
+    accept[11] = 0x00;
+    accept[12] = 0x01;
+    var body = Buffer.concat([accept.subarray(1), cmac(dev.appKey, accept).subarray(0, 4)]);
+    var appKey = dev.appKey.key;
+    this.startSession(dev, devAddr, sessionKey(appKey, 0x01, dev.joinNonce, NET_ID, devNonce),
+                      sessionKey(appKey, 0x02, dev.joinNonce, NET_ID, devNonce));
+    dev.uplinks = 0;
+    this.counters.joins++;
+    this.emit({ "event": "join", "device": dev.name, "dev_nonce": devNonce,
+                "dev_addr": ("0000000" + devAddr.toString(16)).slice(-8) });
+    // the device runs AES encrypt on the join accept, the server decrypt
+    return { "phy": Buffer.concat([accept.subarray(0, 1), aesDecrypt(appKey, body)]), "delay_us": JOIN_ACCEPT_DELAY1_US };
+};
+
+/* 32 bit FCnt from the 16 bits sent, the MIC tells if the counter went round */
+NetworkServer.prototype.fullFcnt = function(s, fcnt16, phy){
+    var msg = phy.subarray(0, phy.length - 4);
+    var mic = phy.subarray(phy.length - 4);
+    var last = s.fcntUp < 0 ? 0 : s.fcntUp;
+    var fcnt = ((last & ~0xFFFF) | fcnt16) >>> 0;
+    if(s.fcntUp >= 0 && fcnt < last)
+        fcnt += 0x10000;
+    if(frameMic(s.nwkSKey, DIR_UP, s.devAddr, fcnt, msg).equals(mic))
+        return fcnt;
+    // a frame replayed from before the last one, refused on its FCnt
+    if(fcnt > 0xFFFF && frameMic(s.nwkSKey, DIR_UP, s.devAddr, fcnt - 0x10000, msg).equals(mic))
+        return fcnt - 0x10000;
+    // a device that reset its counters
+    if(this.options.relaxFcnt && fcnt !== fcnt16 && frameMic(s.nwkSKey, DIR_UP, s.devAddr, fcnt16, msg).equals(mic))
+        return fcnt16;
+    return -1;
+};
+
+NetworkServer.prototype.data = function(phy, meta, confirmed){
+    var devAddr = phy.readUInt32LE(1);
+    var dev = this.byAddr.get(devAddr);
+    var addrText = ("0000000" + devAddr.toString(16)).slice(-8);
+    if(!dev){
+        this.counters.unknown++;
+        this.emit({ "event": "uplink_unknown", "dev_addr": addrText });
+        return null;
+    }
+    var s = dev.session;
+    var fctrl = phy[5];
+    var foptsLen = fctrl & 0x0F;
+    var fcnt16 = phy.readUInt16LE(6);
+    if(8 + foptsLen + 4 > phy.length){
+        this.counters.unknown++;
+        return null;
+    }
+    var fcnt = this.fullFcnt(s, fcnt16, phy);
+    if(fcnt < 0){
+        this.counters.mic_errors++;
+        this.emit({ "event": "mic_error", "device": dev.name, "fcnt": fcnt16 });
+        return null;
+    }
+
+    var retransmission = fcnt === s.fcntUp;
+    if(fcnt < s.fcntUp && !(this.options.relaxFcnt && fcnt === fcnt16)){
+        this.counters.fcnt_errors++;
+        this.emit({ "event": "fcnt_replay", "device": dev.name, "fcnt": fcnt, "last": s.fcntUp });
+        return null;
+    }
+    if(retransmission){
+        // the frame is delivered once, a confirmed one is acknowledged again as its ack may be what was lost
+        this.counters.retransmissions++;
+        this.emit({ "event": "retransmission", "device": dev.name, "fcnt": fcnt });
+        if(!confirmed || !s.pending)
+            return null;
+        return { "phy": s.pending, "delay_us": RX1_DELAY_US };
+    }
+    s.fcntUp = fcnt;
+    dev.uplinks++;
+    this.counters.uplinks++;
+
+    var fopts = phy.subarray(8, 8 + foptsLen);
+    var rest = phy.subarray(8 + foptsLen, phy.length - 4);
+    var port = rest.length > 0 ? rest[0] : -1;
+    var payload = Buffer.alloc(0);
+    if(rest.length > 1)
+        payload = cryptPayload(port === 0 ? s.nwkSKey.key : s.appSKey, DIR_UP, s.devAddr, fcnt, rest.subarray(1));
+
+    var answers = [];
+    var sf = spreadingFactor(meta.datr);
+    var margin = meta.lsnr === undefined ? 0 : Math.max(0, Math.round(meta.lsnr - SNR_FLOOR[sf]));
+    this.macCommands(port === 0 ? payload : fopts, answers, margin);
+
+    var event = { "event": "uplink", "device": dev.name, "fcnt": fcnt, "confirmed": confirmed, "port": port,
+                  "payload": payload.toString("hex") };
+    if(fctrl & FCTRL_ACK)
+        event.ack = true;
+    if(meta.rssi !== undefined){
+        event.rssi = meta.rssi;
+        event.snr = meta.lsnr;
+    }
+
+    var app = null;
+    if(port === CLOCK_SYNC_PORT){
+        app = this.clockSync(payload);
+    }else if(port > 0 && dev.codec && typeof dev.codec.Decode === "function"){
+        try{
+            event.decoded = dev.codec.Decode(port, Array.prototype.slice.call(payload), {});
+        }catch(e){
+            this.counters.decode_errors++;
+            event.decode_error = String(e.message || e);
+        }
+    }
+    this.emit(event);
+
+    // FRMPayload of the downlink: the answer of the package first, the scripted one waits for the next uplink
+    var item = null;
+    if(!app && dev.queue.length > 0 && dev.queue[0].after < dev.uplinks)
+        item = dev.queue.shift();
+    if(app)
+        item = { "port": CLOCK_SYNC_PORT, "payload": app, "confirmed": false };
+
+    var mac = Buffer.from(answers);
+    if(!confirmed && !item && mac.length === 0 && !(fctrl & FCTRL_ADR_ACK_REQ)){
+        s.pending = null;
+        return null;
+    }
+    var down = this.downlink(dev, confirmed, mac, item);
+    s.pending = down;
+    return { "phy": down, "delay_us": RX1_DELAY_US };
+};
+
+/* the MAC commands of the device answered here, the rest skipped */
+NetworkServer.prototype.macCommands = function(cmds, answers, margin){
+    var i = 0;
+    while(i < cmds.length){
+        var cid = cmds[i++];
+        if(!(cid in MAC_UP_LEN))
+            break;
+        if(cid === CID_LINK_CHECK){
+            answers.push(CID_LINK_CHECK, Math.min(margin, 254), 1);
+        }else if(cid === CID_DEVICE_TIME){
+            var gps = gpsNow(Date.now());
+            var seconds = Math.floor(gps);
+            answers.push(CID_DEVICE_TIME, seconds & 0xFF, (seconds >>> 8) & 0xFF, (seconds >>> 16) & 0xFF,
+                         (seconds >>> 24) & 0xFF, Math.floor((gps - seconds) * 256) & 0xFF);
+        }else if(cid === CID_PING_SLOT_INFO){
+            answers.push(CID_PING_SLOT_INFO);
+        }
+        i += MAC_UP_LEN[cid];
+    }
+};
+
+/* answers of the clock synchronization package: PackageVersionReq and AppTimeReq */
+NetworkServer.prototype.clockSync = function(payload){
+    var out = [];
+    var i = 0;
+    while(i < payload.length){
+        var cid = payload[i++];
+        if(cid === CLOCK_SYNC_PACKAGE_VERSION){
+            out.push(CLOCK_SYNC_PACKAGE_VERSION, 1, 1);
+        }else if(cid === CLOCK_SYNC_APP_TIME && i + 5 <= payload.length){
+            var deviceTime = payload.readUInt32LE(i);
+            var param = payload[i + 4];
+            var correction = Math.round(gpsNow(Date.now())) - deviceTime;
+            var b = Buffer.alloc(6);
+            b[0] = CLOCK_SYNC_APP_TIME;
+            b.writeInt32LE(correction | 0, 1);
+            b[5] = param & 0x0F;
+            out.push.apply(out, Array.prototype.slice.call(b));
+            i += 5;
+        }else{
+            break;
+        }
+    }
+    return out.length > 0 ? Buffer.from(out) : null;
+};
+
+NetworkServer.prototype.downlink = function(dev, ack, mac, item){
+    var s = dev.session;
+    var confirmed = item && item.confirmed;
+    var fopts = mac.length <= MAX_FOPTS ? mac : Buffer.alloc(0);
+    var head = Buffer.alloc(8);
+    head[0] = (confirmed ? MTYPE_CONFIRMED_DOWN : MTYPE_UNCONFIRMED_DOWN) << 5;
+    head.writeUInt32LE(s.devAddr, 1);
+    head[5] = (ack ? FCTRL_ACK : 0) | fopts.length;
+    head.writeUInt16LE(s.fcntDown & 0xFFFF, 6);
+    var parts = [head, fopts];
+    if(mac.length > MAX_FOPTS){
+        // too many answers for FOpts, they go on port 0 and the scripted frame waits
+        if(item && item.port !== CLOCK_SYNC_PORT)
+            dev.queue.unshift(item);
+        parts.push(Buffer.from([0]), cryptPayload(s.nwkSKey.key, DIR_DOWN, s.devAddr, s.fcntDown, mac));
+    }else if(item){
+        parts.push(Buffer.from([item.port]), cryptPayload(s.appSKey, DIR_DOWN, s.devAddr, s.fcntDown, item.payload));
+    }
+    var msg = Buffer.concat(parts);
+    var phy = Buffer.concat([msg, frameMic(s.nwkSKey, DIR_DOWN, s.devAddr, s.fcntDown, msg)]);
+    this.counters.downlinks++;
+    this.emit({ "event": "downlink", "device": dev.name, "fcnt": s.fcntDown, "ack": ack,
+                "port": item && mac.length <= MAX_FOPTS ? item.port : (mac.length > MAX_FOPTS ? 0 : -1),
+                "fopts": fopts.toString("hex") });
+    s.fcntDown++;
+    return phy;
+};
+
+/* ---- packet forwarder ---- */
+
+function listen(ns, port, ready){
+    var sock = dgram.createSocket("udp4");
+    var pull = null;
+
+    sock.on("message", function(msg, rinfo){
+        if(msg.length < 4 || msg[0] !== PF_VERSION)
+            return;
+        var ident = msg[3];
+        if(ident === PF_PULL_DATA){
+            pull = rinfo;
+            sock.send(Buffer.from([PF_VERSION, msg[1], msg[2], PF_PULL_ACK]), rinfo.port, rinfo.address);
+            return;
+        }
+        if(ident === PF_TX_ACK){
+            if(msg.length > 12){
+                try{
+                    var ack = JSON.parse(msg.subarray(12).toString());
+                    if(ack.txpk_ack && ack.txpk_ack.error && ack.txpk_ack.error !== "NONE")
+                        ns.emit({ "event": "tx_error", "error": ack.txpk_ack.error });
+                }catch(e){}
+            }
+            return;
+        }
+        if(ident !== PF_PUSH_DATA || msg.length < 12)
+            return;
+        sock.send(Buffer.from([PF_VERSION, msg[1], msg[2], PF_PUSH_ACK]), rinfo.port, rinfo.address);
+        var body;
+        try{
+            body = JSON.parse(msg.subarray(12).toString());
+        }catch(e){
+            ns.emit({ "event": "bad_push", "error": String(e.message) });
+            return;
+        }
+        (body.rxpk || []).forEach(function(rx){
+            if(rx.stat !== undefined && rx.stat !== 1)
+                return;
+            var down = ns.uplink(Buffer.from(rx.data, "base64"), rx);
+            if(!down || !pull)
+                return;
+            // RX1: same frequency and datarate, the time counted by the concentrator
+            var txpk = { "imme": false, "tmst": ((rx.tmst || 0) + down.delay_us) >>> 0, "freq": rx.freq, "rfch": 0,
+                         "powe": 14, "modu": "LORA", "datr": rx.datr, "codr": rx.codr || "4/5", "ipol": true,
+                         "size": down.phy.length, "data": down.phy.toString("base64") };
+            var token = crypto.randomBytes(2);
+            var head = Buffer.from([PF_VERSION, token[0], token[1], PF_PULL_RESP]);
+            sock.send(Buffer.concat([head, Buffer.from(JSON.stringify({ "txpk": txpk }))]), pull.port, pull.address);
+        });
+    });
+    sock.bind(port, function(){
+        if(ready)
+            ready(sock);
+    });
+    return sock;
+}
+
+/* ---- device emulator, for --check and --bench ---- */
+
+function Device(devAddr, nwkSKey, appSKey){
+    this.devAddr = devAddr >>> 0;
+    this.nwkSKey = cmacSubkeys(nwkSKey);
+    this.appSKey = appSKey;
+    this.fcnt = 0;
+}
+
+Device.prototype.uplink = function(opts){
+    var fcnt = opts.fcnt !== undefined ? opts.fcnt : this.fcnt++;
+    var fopts = opts.fopts || Buffer.alloc(0);
+    var head = Buffer.alloc(8);
+    head[0] = (opts.confirmed ? MTYPE_CONFIRMED_UP : MTYPE_UNCONFIRMED_UP) << 5;
+    head.writeUInt32LE(this.devAddr, 1);
+    head[5] = FCTRL_ADR | (opts.ack ? FCTRL_ACK : 0) | fopts.length;
+    head.writeUInt16LE(fcnt & 0xFFFF, 6);
+    var parts = [head, fopts];
+    if(opts.port !== undefined){
+        var key = opts.port === 0 ? this.nwkSKey.key : this.appSKey;
+        parts.push(Buffer.from([opts.port]), cryptPayload(key, DIR_UP, this.devAddr, fcnt, opts.payload || Buffer.alloc(0)));
+    }
+    var msg = Buffer.concat(parts);
+    return Buffer.concat([msg, frameMic(this.nwkSKey, DIR_UP, this.devAddr, fcnt, msg)]);
+};
+
+Device.prototype.downlink = function(phy){
+    var msg = phy.subarray(0, phy.length - 4);
+    var fcnt = phy.readUInt16LE(6);
+    var foptsLen = phy[5] & 0x0F;
+    var rest = phy.subarray(8 + foptsLen, phy.length - 4);
+    var d = { "mtype": phy[0] >> 5, "ack": !!(phy[5] & FCTRL_ACK), "fcnt": fcnt,
+              "fopts": phy.subarray(8, 8 + foptsLen), "port": rest.length > 0 ? rest[0] : -1,
+              "mic_ok": frameMic(this.nwkSKey, DIR_DOWN, this.devAddr, fcnt, msg).equals(phy.subarray(phy.length - 4)) };
+    d.payload = rest.length > 1 ?
+        cryptPayload(d.port === 0 ? this.nwkSKey.key : this.appSKey, DIR_DOWN, this.devAddr, fcnt, rest.subarray(1)) :
+        Buffer.alloc(0);
+    return d;
+};
+
+function joinRequest(appKey, joinEui, devEui, devNonce){
+    var b = Buffer.alloc(19);
+    b[0] = MTYPE_JOIN_REQUEST << 5;
+    Buffer.from(euiKey(joinEui), "hex").copy(b, 1);
+    Buffer.from(euiKey(devEui), "hex").copy(b, 9);
+    b.writeUInt16LE(devNonce, 17);
+    return Buffer.concat([b, cmac(cmacSubkeys(appKey), b).subarray(0, 4)]);
+}
+
+/* what LoRaMac does with a join accept: AES encrypt, MIC, keys */
+function joinAccept(appKey, phy, devNonce){
+    var plain = Buffer.concat([phy.subarray(0, 1), aesEncrypt(appKey, phy.subarray(1))]);
+    var mic = cmac(cmacSubkeys(appKey), plain.subarray(0, plain.length - 4)).subarray(0, 4);
+    var joinNonce = plain.readUIntLE(1, 3);
+    var netId = plain.readUIntLE(4, 3);
+    return { "mic_ok": mic.equals(plain.subarray(plain.length - 4)), "dev_addr": plain.readUInt32LE(7),
+             "nwk_s_key": sessionKey(appKey, 0x01, joinNonce, netId, devNonce),
+             "app_s_key": sessionKey(appKey, 0x02, joinNonce, netId, devNonce) };
+}
+
+/* ---- check ---- */
+
+var failures = 0;
+
+function CHECK(cond, msg){
+    if(!cond){
+        failures++;
+        console.log("FAIL: " + msg);
+    }
+}
+
+function batchFrame(id, readings){
+    var b = [id & 0xFF, id >> 8, readings.length];
+    readings.forEach(function(r){
+        var v = [r.age, Math.round(r.temp * 100) & 0xFFFF, Math.round(r.hum * 100), Math.round(r.press * 10),
+                 Math.round(r.AQI * 10), r.CO2];
+        v.forEach(function(x){ b.push(x & 0xFF, (x >> 8) & 0xFF); });
+    });
+    return Buffer.from(b);
+}
+
+function check(codecFile, done){
+    var events = [];
+    var codec = loadCodec(codecFile);
+
+    // RFC 4493 test vectors
+    var k = cmacSubkeys(Buffer.from("2b7e151628aed2a6abf7158809cf4f3c", "hex"));
+    CHECK(cmac(k, Buffer.alloc(0)).toString("hex") === "bb1d6929e95937287fa37d129b756746", "CMAC of 0 bytes");
+    CHECK(cmac(k, Buffer.from("6bc1bee22e409f96e93d7e117393172a", "hex")).toString("hex") ===
+          "070a16b46b4d4144f79bdd9dd04a287c", "CMAC of 16 bytes");
+    CHECK(cmac(k, Buffer.from("6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e5130c81c46a35ce411",
+                              "hex")).toString("hex") === "dfa66747de9ae63030ca32611497c827", "CMAC of 40 bytes");
+
+    var ns = new NetworkServer({ "codec": codec, "emit": function(e){ events.push(e); } });
+    var appKey = "2b7e151628aed2a6abf7158809cf4f3c";
+    ns.addDevice({ "name": "otaa", "dev_eui": "e660c0d1c74a4530", "join_eui": "0000000000000000", "app_key": appKey });
+    ns.addDevice({ "name": "abp", "dev_addr": "260b1234", "nwk_s_key": "000102030405060708090a0b0c0d0e0f",
+                   "app_s_key": "0f0e0d0c0b0a09080706050403020100" });
+
+    // join, a DevNonce used again and a wrong MIC are refused
+    var key = Buffer.from(appKey, "hex");
+    var acc = ns.uplink(joinRequest(key, "0000000000000000", "e660c0d1c74a4530", 1), {});
+    CHECK(acc && acc.delay_us === JOIN_ACCEPT_DELAY1_US, "no join accept");
+    var ja = joinAccept(key, acc.phy, 1);
+    var otaa = ns.byName.get("otaa");
+    CHECK(ja.mic_ok, "join accept MIC");
+    CHECK(ja.nwk_s_key.equals(otaa.session.nwkSKey.key) && ja.app_s_key.equals(otaa.session.appSKey),
+          "session keys of the device and of the server differ");
+    CHECK(ns.uplink(joinRequest(key, "0000000000000000", "e660c0d1c74a4530", 1), {}) === null, "DevNonce replayed");
+    var bad = joinRequest(key, "0000000000000000", "e660c0d1c74a4530", 2);
+    bad[20] ^= 1;
+    CHECK(ns.uplink(bad, {}) === null && ns.counters.mic_errors === 1, "join MIC not checked");
+    var acc2 = ns.uplink(joinRequest(key, "0000000000000000", "e660c0d1c74a4530", 2), {});
+    var ja2 = joinAccept(key, acc2.phy, 2);
+    CHECK(ja2.dev_addr === ja.dev_addr && !ja2.nwk_s_key.equals(ja.nwk_s_key), "rejoin with a new DevNonce");
+
+    // a batch frame decoded by the codec
+    var dev = new Device(ja2.dev_addr, ja2.nwk_s_key, ja2.app_s_key);
+    var readings = [{ "age": 300, "temp": 21.5, "hum": 40.25, "press": 1001.3, "AQI": 50.5, "CO2": 600 },
+                    { "age": 0, "temp": -3.2, "hum": 80, "press": 990, "AQI": 0, "CO2": 0 }];
+    CHECK(ns.uplink(dev.uplink({ "port": 4, "payload": batchFrame(4, readings) }), {}) === null,
+          "a downlink for an unconfirmed uplink");
+    var up = events.filter(function(e){ return e.event === "uplink"; }).pop();
+    CHECK(up && up.decoded && up.decoded.id === 4 && up.decoded.readings.length === 2, "batch not decoded");
+    if(up && up.decoded && up.decoded.readings.length === 2){
+        CHECK(up.decoded.readings[0].temp === 21.5 && up.decoded.readings[0].age === 300 &&
+              up.decoded.readings[1].temp === -3.2 && up.decoded.readings[1].AQI === "nan", "batch values");
+    }
+
+    // confirmed uplink: acknowledged, FCntDown counts, the same frame again is acknowledged and not delivered twice
+    var conf = dev.uplink({ "confirmed": true, "port": 2, "payload": Buffer.from("04000a00e80f1f27f4010000", "hex") });
+    var down = ns.uplink(conf, {});
+    var d = down ? dev.downlink(down.phy) : {};
+    CHECK(d.mic_ok && d.ack && d.fcnt === 0 && down.delay_us === RX1_DELAY_US, "ack of a confirmed uplink");
+    var uplinks = ns.counters.uplinks;
+    var again = ns.uplink(conf, {});
+    CHECK(again && again.phy.equals(down.phy) && ns.counters.uplinks === uplinks && ns.counters.retransmissions === 1,
+          "retransmission of a confirmed uplink");
+    // replayed frame and a frame with a wrong MIC
+    CHECK(ns.uplink(dev.uplink({ "port": 2, "payload": Buffer.alloc(12), "fcnt": 0 }), {}) === null &&
+          ns.counters.fcnt_errors === 1, "old FCnt accepted");
+    var tampered = dev.uplink({ "port": 2, "payload": Buffer.alloc(12) });
+    tampered[10] ^= 0x40;
+    CHECK(ns.uplink(tampered, {}) === null && ns.counters.mic_errors === 2, "tampered frame accepted");
+
+    // ABP: FCnt over 16 bits, a reset refused unless relaxed
+    var abp = new Device(0x260b1234, Buffer.from("000102030405060708090a0b0c0d0e0f", "hex"),
+                         Buffer.from("0f0e0d0c0b0a09080706050403020100", "hex"));
+    abp.fcnt = 0xFFFE;
+    ns.uplink(abp.uplink({ "port": 2, "payload": Buffer.alloc(12) }), {});
+    ns.uplink(abp.uplink({ "port": 2, "payload": Buffer.alloc(12) }), {});
+    ns.uplink(abp.uplink({ "port": 2, "payload": Buffer.alloc(12) }), {});
+    CHECK(ns.byName.get("abp").session.fcntUp === 0x10000, "FCnt past 16 bits: " + ns.byName.get("abp").session.fcntUp);
+    abp.fcnt = 0;
+    CHECK(ns.uplink(abp.uplink({ "port": 2, "payload": Buffer.alloc(12) }), {}) === null, "ABP reset accepted");
+    ns.options.relaxFcnt = true;
+    abp.fcnt = 0;
+    ns.uplink(abp.uplink({ "port": 2, "payload": Buffer.alloc(12) }), {});
+    CHECK(ns.byName.get("abp").session.fcntUp === 0, "ABP reset refused with --relax-fcnt");
+    ns.options.relaxFcnt = false;
+
+    // scripted downlink through Encode, in RX1 of the uplink after the 3rd of the session
+    ns.schedule({ "device": "E660C0D1C74A4530", "after": 3, "port": 10, "object": { "seq": 7, "interval": 12 } });
+    var first = ns.uplink(dev.uplink({ "port": 2, "payload": Buffer.alloc(12) }), {});
+    CHECK(first === null, "scripted downlink sent too early");
+    var sd = ns.uplink(dev.uplink({ "port": 2, "payload": Buffer.alloc(12) }), {});
+    var sdd = sd ? dev.downlink(sd.phy) : {};
+    var expected = Buffer.from(codec.Encode(10, { "seq": 7, "interval": 12 }, {}));
+    CHECK(sdd.mic_ok && sdd.port === 10 && sdd.payload.equals(expected) && sdd.fcnt === 1, "scripted downlink");
+
+    // MAC commands in FOpts and the clock synchronization package
+    var mac = ns.uplink(dev.uplink({ "fopts": Buffer.from([CID_LINK_CHECK, CID_DEVICE_TIME]) }),
+                        { "datr": "SF12BW125", "lsnr": -10 });
+    var md = mac ? dev.downlink(mac.phy) : { "fopts": Buffer.alloc(0) };
+    CHECK(md.fopts.length === 9 && md.fopts[0] === CID_LINK_CHECK && md.fopts[1] === 10 && md.fopts[3] === CID_DEVICE_TIME,
+          "LinkCheckAns and DeviceTimeAns: " + md.fopts.toString("hex"));
+    if(md.fopts.length === 9)
+        CHECK(Math.abs(md.fopts.readUInt32LE(4) - gpsNow(Date.now())) < 2, "DeviceTimeAns far from the GPS time");
+    var gps = Math.floor(gpsNow(Date.now()));
+    var req = Buffer.alloc(6);
+    req[0] = CLOCK_SYNC_APP_TIME;
+    req.writeUInt32LE(gps - 100, 1);
+    req[5] = 0x13;
+    var cs = ns.uplink(dev.uplink({ "port": CLOCK_SYNC_PORT, "payload": req }), {});
+    var csd = cs ? dev.downlink(cs.phy) : { "payload": Buffer.alloc(0) };
+    CHECK(csd.port === CLOCK_SYNC_PORT && csd.payload.length === 6 && Math.abs(csd.payload.readInt32LE(1) - 100) <= 1 &&
+          csd.payload[5] === 0x03, "AppTimeAns: " + csd.payload.toString("hex"));
+
+    // a frame through UDP as the packet forwarder sends it
+    var sock = listen(ns, 0, function(s){
+        var gw = dgram.createSocket("udp4");
+        var gotAck = false;
+        var timer = setTimeout(function(){
+            CHECK(false, "no PULL_RESP over UDP");
+            gw.close();
+            s.close();
+            done();
+        }, 2000);
+        gw.on("message", function(msg){
+            if(msg[3] === PF_PULL_ACK){
+                var rx = { "tmst": 4294000000, "freq": 868.1, "datr": "SF12BW125", "codr": "4/5", "rssi": -80, "lsnr": 7,
+                           "stat": 1, "data": dev.uplink({ "confirmed": true, "port": 2, "payload": Buffer.alloc(12) })
+                           .toString("base64") };
+                var head = Buffer.from([PF_VERSION, 0x12, 0x34, PF_PUSH_DATA, 1, 2, 3, 4, 5, 6, 7, 8]);
+                gw.send(Buffer.concat([head, Buffer.from(JSON.stringify({ "rxpk": [rx] }))]), s.address().port, "127.0.0.1");
+            }else if(msg[3] === PF_PUSH_ACK){
+                gotAck = msg[1] === 0x12 && msg[2] === 0x34;
+            }else if(msg[3] === PF_PULL_RESP){
+                var txpk = JSON.parse(msg.subarray(4).toString()).txpk;
+                var dd = dev.downlink(Buffer.from(txpk.data, "base64"));
+                CHECK(gotAck, "no PUSH_ACK");
+                CHECK(dd.mic_ok && dd.ack && txpk.tmst === (4294000000 + RX1_DELAY_US) % 4294967296 && txpk.ipol &&
+                      txpk.datr === "SF12BW125" && txpk.freq === 868.1, "txpk: " + JSON.stringify(txpk));
+                clearTimeout(timer);
+                gw.close();
+                s.close();
+                done();
+            }
+        });
+        gw.send(Buffer.from([PF_VERSION, 0, 1, PF_PULL_DATA, 1, 2, 3, 4, 5, 6, 7, 8]), s.address().port, "127.0.0.1");
+    });
+    return sock;
+}
+
+/* ---- bench ---- */
+
+function bench(codecFile, frames, devices, done){
+    var codec = loadCodec(codecFile);
+    var ns = new NetworkServer({ "codec": codec });
+    var devs = [];
+    for(var i = 0; i < devices; i++){
+        var nwk = crypto.randomBytes(16), app = crypto.randomBytes(16);
+        var addr = (DEV_ADDR_BASE + 0x8000 + i) >>> 0;
+        ns.addDevice({ "name": "d" + i, "dev_addr": addr.toString(16), "nwk_s_key": nwk.toString("hex"),
+                       "app_s_key": app.toString("hex") });
+        devs.push(new Device(addr, nwk, app));
+    }
+    // a batch of 4 readings, one uplink in ten confirmed
+    var readings = [];
+    for(var r = 0; r < 4; r++)
+        readings.push({ "age": 900 - 300 * r, "temp": 20 + r, "hum": 50, "press": 1000, "AQI": 60, "CO2": 700 });
+    var payload = batchFrame(1, readings);
+    var phys = [];
+    for(var f = 0; f < frames; f++)
+        phys.push(devs[f % devices].uplink({ "confirmed": f % 10 === 0, "port": 4, "payload": payload }));
+
+    var t0 = process.hrtime.bigint();
+    for(var p = 0; p < phys.length; p++)
+        ns.uplink(phys[p], { "datr": "SF9BW125", "lsnr": 5 });
+    var inProcess = Number(process.hrtime.bigint() - t0) / 1e9;
+    console.log("| path | frames | devices | frames/s | downlinks |");
+    console.log("|------|--------|---------|----------|-----------|");
+    console.log("| in process | " + frames + " | " + devices + " | " + Math.round(frames / inProcess) + " | " +
+                ns.counters.downlinks + " |");
+    CHECK(ns.counters.uplinks === frames && ns.counters.mic_errors === 0, "bench frames refused");
+
+    // the same frames again over UDP, 8 a PUSH_DATA as a busy concentrator sends them
+    var ns2 = new NetworkServer({ "codec": codec });
+    devs.forEach(function(d, n){
+        ns2.addDevice({ "name": "d" + n, "dev_addr": d.devAddr.toString(16), "nwk_s_key": d.nwkSKey.key.toString("hex"),
+                        "app_s_key": d.appSKey.toString("hex") });
+    });
+    listen(ns2, 0, function(s){
+        var gw = dgram.createSocket("udp4");
+        var acked = 0, sent = 0, packets = Math.ceil(frames / 8);
+        var t1;
+        gw.on("message", function(msg){
+            if(msg[3] === PF_PULL_ACK){
+                t1 = process.hrtime.bigint();
+                pump();
+            }else if(msg[3] === PF_PUSH_ACK && ++acked === packets){
+                var udp = Number(process.hrtime.bigint() - t1) / 1e9;
+                console.log("| UDP, 8 frames a PUSH_DATA | " + ns2.counters.uplinks + " | " + devices + " | " +
+                            Math.round(ns2.counters.uplinks / udp) + " | " + ns2.counters.downlinks + " |");
+                CHECK(ns2.counters.uplinks === frames, "UDP frames lost: " + ns2.counters.uplinks);
+                gw.close();
+                s.close();
+                done();
+            }
+        });
+        // a window of packets in flight, the socket buffers don't drop them
+        function pump(){
+            while(sent < packets && sent - acked < 64){
+                var rxpk = [];
+                for(var j = sent * 8; j < Math.min(frames, sent * 8 + 8); j++)
+                    rxpk.push({ "tmst": j * 1000, "freq": 868.1, "datr": "SF9BW125", "codr": "4/5", "rssi": -90, "lsnr": 5,
+                                "stat": 1, "data": phys[j].toString("base64") });
+                var head = Buffer.from([PF_VERSION, (sent >> 8) & 0xFF, sent & 0xFF, PF_PUSH_DATA, 1, 2, 3, 4, 5, 6, 7, 8]);
+                gw.send(Buffer.concat([head, Buffer.from(JSON.stringify({ "rxpk": rxpk }))]), s.address().port, "127.0.0.1");
+                sent++;
+            }
+            if(sent < packets)
+                setImmediate(pump);
+        }
+        gw.send(Buffer.from([PF_VERSION, 0, 1, PF_PULL_DATA, 1, 2, 3, 4, 5, 6, 7, 8]), s.address().port, "127.0.0.1");
+    });
+}
+
+/* ---- main ---- */
+
+function main(argv){
+    var opts = { "port": 1700, "configs": [], "devices": [], "codec": path.join(__dirname, "../../executables/class-a/codec.js"),
+                 "script": null, "relaxFcnt": false, "quiet": false };
+    for(var i = 0; i < argv.length; i++){
+        var a = argv[i];
+        if(a === "--port") opts.port = parseInt(argv[++i], 10);
+        else if(a === "--config") opts.configs.push(argv[++i]);
+        else if(a === "--devices") opts.devices.push(argv[++i]);
+        else if(a === "--codec") opts.codec = argv[++i];
+        else if(a === "--script") opts.script = argv[++i];
+        else if(a === "--relax-fcnt") opts.relaxFcnt = true;
+        else if(a === "--quiet") opts.quiet = true;
+        else if(a === "--check") opts.check = true;
+        else if(a === "--bench"){
+            opts.bench = [100000, 1000];
+            if(/^\d+$/.test(argv[i + 1] || "")) opts.bench[0] = parseInt(argv[++i], 10);
+            if(/^\d+$/.test(argv[i + 1] || "")) opts.bench[1] = parseInt(argv[++i], 10);
+        }else{
+            console.log("unknown option " + a + ", see the top of ns.js");
+            process.exit(1);
+        }
+    }
+    function finish(){
+        console.log(failures ? "FAILED" : "all checks passed");
+        process.exit(failures ? 1 : 0);
+    }
+    if(opts.check){
+        check(opts.codec, function(){
+            if(!opts.bench)
+                finish();
+            else
+                bench(opts.codec, opts.bench[0], opts.bench[1], finish);
+        });
+        return;
+    }
+    if(opts.bench){
+        bench(opts.codec, opts.bench[0], opts.bench[1], finish);
+        return;
+    }
+
+    var ns = new NetworkServer({ "codec": loadCodec(opts.codec), "relaxFcnt": opts.relaxFcnt,
+                                 "emit": opts.quiet ? function(){} : function(e){
+                                     e.time = new Date().toISOString();
+                                     console.log(JSON.stringify(e));
+                                 } });
+    var list = [];
+    opts.configs.forEach(function(f){ list.push(readConfig(f)); });
+    opts.devices.forEach(function(f){ list = list.concat(JSON.parse(fs.readFileSync(f, "utf8"))); });
+    var added = 0;
+    list.forEach(function(d){
+        try{
+            ns.addDevice(d);
+            added++;
+        }catch(e){
+            console.log(JSON.stringify({ "event": "device_skipped", "device": d.name, "error": e.message }));
+        }
+    });
+    if(opts.script)
+        JSON.parse(fs.readFileSync(opts.script, "utf8")).forEach(function(item){ ns.schedule(item); });
+    listen(ns, opts.port, function(){
+        console.log(JSON.stringify({ "event": "listening", "port": opts.port, "devices": added }));
+    });
+    if(opts.quiet)
+        setInterval(function(){ console.log(JSON.stringify({ "event": "counters", "counters": ns.counters })); }, 10000);
+}
+
+if(require.main === module)
+    main(process.argv.slice(2));
+
+module.exports = { "NetworkServer": NetworkServer, "Device": Device, "listen": listen };
@@ -0,0 +1,943 @@
+/**
+ * @file sim.c
+ * @brief host simulation of a network of class-a nodes around one gateway, to find how many nodes a single-channel
+ *          nanogateway takes at a given reporting interval. Every node runs the uplink path of the firmware on a
+ *          virtual clock: a frame of readings every period pushed on the uplink queue (the oldest dropped when it is
+ *          full), up to UPLINK_QUEUE_DRAIN confirmed uplinks after each reading while the duty cycle of
+ *          src/tx-scheduler.c allows it, a frame not acknowledged left in the queue for the next reading, a frame
+ *          longer than the datarate allows dropped. The MAC is reduced to what puts load on the air: an ABP session,
+ *          RX1 1 s and RX2 2 s after the uplink, the acknowledgment an empty downlink. LoRaMac-node keeps its state
+ *          in statics and can't run as thousands of instances in one process.
+ *
+ *          The nodes are spread on a disk around the gateway, with the path loss of an urban macro cell and a
+ *          shadowing of their place. The nanogateway listens on 868.1 MHz at one spreading factor with a single
+ *          demodulator, answers in RX1 or, on the same channel, in RX2 and can't receive while it transmits. Its duty
+ *          cycle is kept by src/tx-scheduler.c too, an acknowledgment it can't send is lost. Frames on the same
+ *          channel and spreading factor collide unless one is 6 dB stronger (capture), an interferer that is over
+ *          before the last 5 symbols of the preamble doesn't count, other spreading factors are lost only to a
+ *          frame 16 dB stronger. The same nodes are run with unconfirmed uplinks, and against a gateway with 8
+ *          demodulators on the 3 default channels of EU868 with the spreading factor of each node set by its link
+ *          margin as the ADR would, to compare.
+ *
+ *          The nodes are split among threads: in every window of at most 1 s of virtual time the threads run the
+ *          events of their nodes, then the frames started in the window go through the channel in a single pass. A
+ *          node needs the fate of its frame at RX1, 1 s after the end of it, so nothing crosses a window. Every node
+ *          draws from its own random generator, the results don't depend on the number of threads.
+ *
+ *          Printed for every gateway: packet delivery ratio of the nodes in range, latency from the reading to the
+ *          gateway, airtime a node, the frames lost to collisions and to the gateway transmitting, the
+ *          acknowledgments the gateway couldn't send, and the most nodes that keep a delivery ratio of 90%.
+ *
+ *          build and run from this folder:
+ *          gcc -O2 -Wall -I../../src sim.c ../../src/tx-scheduler.c ../../src/single-channel.c -o sim -pthread -lm
+ *          ./sim [period s] [readings a frame] [single-channel SF] [threads] [max nodes] [nodes csv]
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "tx-scheduler.h"
+#include "single-channel.h"
+
+#define HOUR_US             (60ull * 60 * 1000000)
+// frames made in this time are counted, then the queues have TAIL_US to drain
+#define SIM_US              (24 * HOUR_US)
+#define TAIL_US             (2 * HOUR_US)
+// at most the RX1 delay, see above
+#define WINDOW_US           1000000ull
+#define RX1_DELAY_US        1000000ull
+#define RX2_DELAY_US        2000000ull
+
+// same values of the class-a config.h, bme-config.h and of the batch and payload libraries
+#define SINGLE_FREQ_HZ      868100000
+#define QUEUE_CAPACITY      48
+#define QUEUE_DRAIN         3
+#define BATCH_HEADER_LEN    3
+#define BATCH_RECORD_LEN    (2 + 10)
+// MHDR, FHDR, FPort and MIC
+#define FRAME_OVERHEAD      13
+// the sleep follows the work of the wake-up, readings, bsec and uplinks, which is never the same
+#define AWAKE_JITTER_MS     2000
+
+#define TX_DBM              14
+#define RADIUS_M            2000
+#define SHADOWING_DB        4.0
+// every frame is up to this much stronger or weaker than the mean of the node
+#define FADING_DB           3.0
+// link margin the ADR keeps
+#define ADR_MARGIN_DB       10
+#define CAPTURE_DB          6
+#define SF_REJECTION_DB     16
+#define PREAMBLE            8
+#define GATEWAY_DEMODS      8
+#define TARGET_PDR          0.9
+#define MAX_THREADS         64
+#define NODES_PER_THREAD    500
+
+// same table of src/lorawan.c
+static const struct tx_band eu868_bands[] = {
+    {865000000, 868000000, 100},
+    {868000000, 868600000, 100},
+    {868700000, 869200000, 1000},
+    {869400000, 869650000, 10},
+    {869700000, 870000000, 100},
+};
+static const uint32_t eu868_defaults[] = {868100000, 868300000, 868500000};
+#define RX2_FREQ_HZ         869525000
+#define RX2_SF              12
+// largest application payload of EU868 from SF7 to SF12
+static const uint8_t max_payload[SINGLE_CHANNEL_RATES] = {222, 222, 115, 51, 51, 51};
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do{ \
+        if(!(cond)){ \
+            failures++; \
+            printf("FAIL line %d: ", __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    }while(0)
+
+struct setup {
+    const char* name;
+    bool single;
+    bool confirmed;
+};
+
+/*
+    frame of the uplink queue
+*/
+struct queued {
+    uint64_t made_us;
+    bool counted;                                       // made within SIM_US
+    bool delivered;                                     // the gateway got it, maybe not acknowledged
+};
+
+enum io { IO_NONE, IO_SEND, IO_RX };
+
+struct node {
+    uint64_t rng;
+    double distance_m;
+    double rssi_dbm;                                    // mean at the gateway
+    uint8_t sf;
+    bool in_range;
+    struct tx_scheduler dc;
+    struct queued queue[QUEUE_CAPACITY];
+    uint8_t head;
+    uint8_t count;
+    uint8_t drained;                                    // uplinks since the reading
+    uint64_t clock_us;                                  // time of the last event
+    uint64_t wake_us;                                   // next reading
+    uint64_t io_us;                                     // next step of the uplinks
+    enum io io;
+    uint64_t tx_end_us;
+    // fate of the last frame, written by the channel
+    bool heard;
+    bool acked;
+    uint64_t ack_end_us;
+    // counters of the frames made within SIM_US
+    uint32_t made;
+    uint32_t delivered;
+    uint32_t dropped;                                   // queue full or too long for the datarate
+    uint32_t unheard;                                   // unconfirmed and lost
+    uint32_t sent;                                      // every transmission, retries too
+    uint64_t airtime_us;
+};
+
+struct frame {
+    uint64_t start_us;
+    uint64_t lock_us;                                   // last 5 symbols of the preamble, the receiver locks
+    uint64_t end_us;
+    uint32_t node;
+    uint32_t freq_hz;
+    uint8_t sf;
+    bool demod;                                         // a demodulator of the gateway took it
+    bool resolved;
+    float rssi_dbm;
+};
+
+struct span {
+    uint64_t start_us;
+    uint64_t end_us;
+};
+
+struct sim;
+
+struct worker {
+    struct sim* sim;
+    pthread_t thread;
+    uint32_t* heap;                                     // nodes of the worker by next event
+    uint32_t heap_len;
+    struct frame* out;                                  // frames started in the window
+    size_t n_out;
+    size_t cap_out;
+    uint32_t* latency_ms;
+    size_t n_latency;
+    size_t cap_latency;
+    uint64_t next_us;                                   // first event left after the window
+};
+
+struct sim {
+    const struct setup* setup;
+    uint32_t n_nodes;
+    struct node* nodes;
+    uint32_t period_ms;
+    uint8_t payload_len;
+    int16_t sensitivity_x10[SINGLE_CHANNEL_RATES];
+    // gateway
+    uint32_t freqs[3];
+    uint8_t n_freqs;
+    uint8_t gateway_sf;
+    uint8_t demods;
+    struct tx_scheduler gateway_dc;
+    struct span* gateway_tx;
+    size_t n_gateway_tx;
+    size_t cap_gateway_tx;
+    // channel, frames by start
+    struct frame* air;
+    size_t air_head;
+    size_t air_len;
+    size_t air_cap;
+    size_t unresolved;
+    uint32_t max_airtime_us;
+    size_t* ends;
+    size_t cap_ends;
+    // threads, worker 0 is the main thread
+    struct worker workers[MAX_THREADS];
+    uint8_t n_workers;
+    pthread_barrier_t start;
+    pthread_barrier_t end;
+    bool done;
+    uint64_t window_end_us;
+    // counters
+    uint64_t received;
+    uint64_t collisions;
+    uint64_t gateway_busy;
+    uint64_t acks;
+    uint64_t acks_missed;
+};
+
+struct result {
+    uint32_t nodes;
+    uint32_t in_range;
+    uint64_t made;
+    uint64_t delivered;
+    uint64_t pending;
+    double pdr;
+    double latency_p50_s;
+    double latency_p95_s;
+    double airtime_s_h;                                 // mean of a node
+    double busiest_duty;                                // airtime over the run of the busiest node
+    uint64_t sent;
+    uint64_t received;
+    uint64_t collisions;
+    uint64_t gateway_busy;
+    uint64_t acks;
+    uint64_t acks_missed;
+    bool balanced;                                      // every frame made is delivered, dropped, lost or waiting
+    bool within_duty;
+};
+
+static uint64_t rnd_next(uint64_t* s){
+    uint64_t z = (*s += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static double rnd_uniform(uint64_t* s){
+    return (rnd_next(s) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double rnd_normal(uint64_t* s){
+    double u = rnd_uniform(s);
+    if(u < 1e-12)
+        u = 1e-12;
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * rnd_uniform(s));
+}
+
+static void* grow(void* p, size_t* cap, size_t need, size_t size){
+    if(need <= *cap)
+        return p;
+    *cap = need > 2 * *cap ? need : 2 * *cap;
+    p = realloc(p, *cap * size);
+    if(p == NULL){
+        printf("out of memory\n");
+        exit(2);
+    }
+    return p;
+}
+
+static double sensitivity_dbm(const struct sim* s, uint8_t sf){
+    return s->sensitivity_x10[sf - SINGLE_CHANNEL_MIN_SF] / 10.0;
+}
+
+/*
+    urban macro cell, 3GPP TR 36.942
+*/
+static double path_loss_db(double distance_m){
+    if(distance_m < 50)
+        distance_m = 50;
+    return 128.1 + 37.6 * log10(distance_m / 1000);
+}
+
+static uint64_t symbol_us(uint8_t sf){
+    return (1000000ull << sf) / 125000;
+}
+
+/*
+    --- nodes, run by the workers ---
+*/
+
+/*
+    the firmware does one thing at a time, a reading due during the uplinks waits for them
+*/
+static uint64_t node_next(const struct node* n){
+    return n->io != IO_NONE ? n->io_us : n->wake_us;
+}
+
+static struct queued* queue_head(struct node* n){
+    return &n->queue[n->head];
+}
+
+static void queue_pop(struct node* n){
+    n->head = (n->head + 1) % QUEUE_CAPACITY;
+    n->count--;
+}
+
+/*
+    drain_uplink_queue of class_a.c, sends the frame at the head or stops
+*/
+static void node_send(struct worker* w, struct node* n, uint64_t now){
+    struct sim* s = w->sim;
+
+    while(n->count > 0 && n->drained < QUEUE_DRAIN){
+        struct queued* q = queue_head(n);
+        if(s->payload_len > max_payload[n->sf - SINGLE_CHANNEL_MIN_SF]){
+            if(q->counted && !q->delivered)
+                n->dropped++;
+            queue_pop(n);
+            continue;
+        }
+        const uint32_t* freqs = s->setup->single ? s->freqs : eu868_defaults;
+        uint8_t n_freqs = s->setup->single ? 1 : 3;
+        if(tx_scheduler_wait_ms(&n->dc, now / 1000, freqs, n_freqs) > 0)
+            break;
+
+        uint32_t freq = freqs[rnd_next(&n->rng) % n_freqs];
+        uint32_t airtime = tx_airtime_us(n->sf, 125000, 1, PREAMBLE, true, true, s->payload_len + FRAME_OVERHEAD);
+        tx_scheduler_record(&n->dc, now / 1000, freq, airtime);
+        n->airtime_us += airtime;
+        n->sent++;
+        n->drained++;
+
+        w->out = grow(w->out, &w->cap_out, w->n_out + 1, sizeof(struct frame));
+        struct frame* f = &w->out[w->n_out++];
+        memset(f, 0, sizeof(*f));
+        f->start_us = now;
+        f->lock_us = now + symbol_us(n->sf) * (4 * PREAMBLE + 17 - 20) / 4;
+        f->end_us = now + airtime;
+        f->node = (uint32_t)(n - s->nodes);
+        f->freq_hz = freq;
+        f->sf = n->sf;
+        f->rssi_dbm = (float)(n->rssi_dbm + FADING_DB * (2 * rnd_uniform(&n->rng) - 1));
+
+        n->heard = false;
+        n->acked = false;
+        n->tx_end_us = f->end_us;
+        n->io = IO_RX;
+        n->io_us = f->end_us + RX1_DELAY_US;
+        return;
+    }
+    n->io = IO_NONE;
+    n->io_us = UINT64_MAX;
+}
+
+/*
+    end of the receive windows of the frame at the head
+*/
+static void node_rx(struct worker* w, struct node* n){
+    struct sim* s = w->sim;
+    struct queued* q = queue_head(n);
+
+    if(n->heard && !q->delivered){
+        q->delivered = true;
+        if(q->counted){
+            n->delivered++;
+            w->latency_ms = grow(w->latency_ms, &w->cap_latency, w->n_latency + 1, sizeof(uint32_t));
+            w->latency_ms[w->n_latency++] = (uint32_t)((n->tx_end_us - q->made_us) / 1000);
+        }
+    }
+
+    if(!s->setup->confirmed){
+        if(!q->delivered && q->counted)
+            n->unheard++;
+        queue_pop(n);
+        n->io = IO_SEND;
+        n->io_us = n->tx_end_us + RX2_DELAY_US;
+        return;
+    }
+    if(n->acked){
+        queue_pop(n);
+        n->io = IO_SEND;
+        n->io_us = n->ack_end_us;
+        return;
+    }
+    // not acknowledged, the frame waits for the next reading
+    n->io = IO_NONE;
+    n->io_us = UINT64_MAX;
+}
+
+/*
+    a reading: a frame on the queue and the uplinks unless they are still going on
+*/
+static void node_wake(struct worker* w, struct node* n, uint64_t now){
+    struct sim* s = w->sim;
+
+    if(n->count == QUEUE_CAPACITY){
+        struct queued* oldest = queue_head(n);
+        if(oldest->counted && !oldest->delivered)
+            n->dropped++;
+        queue_pop(n);
+    }
+    struct queued* q = &n->queue[(n->head + n->count) % QUEUE_CAPACITY];
+    q->made_us = now;
+    q->counted = now < SIM_US;
+    q->delivered = false;
+    n->count++;
+    if(q->counted)
+        n->made++;
+
+    n->wake_us = now + s->period_ms * 1000ull + (rnd_next(&n->rng) % AWAKE_JITTER_MS) * 1000;
+    if(n->wake_us >= SIM_US + TAIL_US)
+        n->wake_us = UINT64_MAX;
+
+    n->drained = 0;
+    node_send(w, n, now);
+}
+
+static void node_event(struct worker* w, struct node* n){
+    if(n->io == IO_RX){
+        n->clock_us = n->io_us;
+        node_rx(w, n);
+    }else if(n->io == IO_SEND){
+        n->clock_us = n->io_us;
+        node_send(w, n, n->clock_us);
+    }else{
+        if(n->wake_us > n->clock_us)
+            n->clock_us = n->wake_us;
+        node_wake(w, n, n->clock_us);
+    }
+}
+
+static void heap_down(struct worker* w, uint32_t i){
+    struct node* nodes = w->sim->nodes;
+    for(;;){
+        uint32_t l = 2 * i + 1, r = l + 1, m = i;
+        if(l < w->heap_len && node_next(&nodes[w->heap[l]]) < node_next(&nodes[w->heap[m]]))
+            m = l;
+        if(r < w->heap_len && node_next(&nodes[w->heap[r]]) < node_next(&nodes[w->heap[m]]))
+            m = r;
+        if(m == i)
+            return;
+        uint32_t t = w->heap[i];
+        w->heap[i] = w->heap[m];
+        w->heap[m] = t;
+        i = m;
+    }
+}
+
+/*
+    events of the nodes of a worker up to the end of the window, every event moves its node later
+*/
+static void worker_window(struct worker* w, uint64_t until_us){
+    struct node* nodes = w->sim->nodes;
+
+    w->n_out = 0;
+    while(w->heap_len > 0 && node_next(&nodes[w->heap[0]]) < until_us){
+        node_event(w, &nodes[w->heap[0]]);
+        heap_down(w, 0);
+    }
+    w->next_us = w->heap_len > 0 ? node_next(&nodes[w->heap[0]]) : UINT64_MAX;
+}
+
+static void* worker_main(void* arg){
+    struct worker* w = arg;
+    struct sim* s = w->sim;
+
+    for(;;){
+        pthread_barrier_wait(&s->start);
+        if(s->done)
+            break;
+        worker_window(w, s->window_end_us);
+        pthread_barrier_wait(&s->end);
+    }
+    return NULL;
+}
+
+/*
+    --- gateway and channel, run by the main thread between the windows ---
+*/
+
+static bool gateway_transmitting(const struct sim* s, uint64_t from_us, uint64_t to_us){
+    for(size_t i = 0; i < s->n_gateway_tx; i++)
+        if(s->gateway_tx[i].start_us < to_us && s->gateway_tx[i].end_us > from_us)
+            return true;
+    return false;
+}
+
+static bool gateway_listens(const struct sim* s, const struct frame* f){
+    if(s->setup->single)
+        return f->freq_hz == s->freqs[0] && f->sf == s->gateway_sf;
+    for(uint8_t i = 0; i < s->n_freqs; i++)
+        if(f->freq_hz == s->freqs[i])
+            return true;
+    return false;
+}
+
+/*
+    a demodulator locks on the frame if the gateway hears it and one is free
+*/
+static void channel_lock(struct sim* s, size_t i){
+    struct frame* f = &s->air[i];
+    uint8_t busy = 0;
+
+    if(!gateway_listens(s, f) || f->rssi_dbm < sensitivity_dbm(s, f->sf) ||
+       gateway_transmitting(s, f->start_us, f->start_us + 1))
+        return;
+    for(size_t j = i; j-- > s->air_head && s->air[j].start_us + s->max_airtime_us > f->start_us;)
+        if(s->air[j].demod && s->air[j].end_us > f->start_us)
+            busy++;
+    f->demod = busy < s->demods;
+}
+
+/*
+    true if b takes a
+*/
+static bool interferes(const struct frame* a, const struct frame* b){
+    if(b->freq_hz != a->freq_hz || b->start_us >= a->end_us || b->end_us <= a->start_us)
+        return false;
+    if(b->sf != a->sf)
+        return b->rssi_dbm - a->rssi_dbm > SF_REJECTION_DB;
+    // over before the receiver locks on a
+    if(b->end_us <= a->lock_us)
+        return false;
+    return a->rssi_dbm - b->rssi_dbm < CAPTURE_DB;
+}
+
+static bool gateway_send(struct sim* s, uint64_t at_us, uint32_t freq, uint8_t sf, uint64_t* end_us){
+    // the acknowledgment is an empty downlink, no payload CRC
+    uint32_t airtime = tx_airtime_us(sf, 125000, 1, PREAMBLE, true, false, FRAME_OVERHEAD);
+
+    if(gateway_transmitting(s, at_us, at_us + airtime) || tx_scheduler_wait_ms(&s->gateway_dc, at_us / 1000, &freq, 1) > 0)
+        return false;
+    tx_scheduler_record(&s->gateway_dc, at_us / 1000, freq, airtime);
+    s->gateway_tx = grow(s->gateway_tx, &s->cap_gateway_tx, s->n_gateway_tx + 1, sizeof(struct span));
+    s->gateway_tx[s->n_gateway_tx++] = (struct span){at_us, at_us + airtime};
+    *end_us = at_us + airtime;
+    return true;
+}
+
+static void channel_resolve(struct sim* s, size_t i){
+    struct frame* a = &s->air[i];
+    struct node* n = &s->nodes[a->node];
+    bool ok = a->demod;
+
+    a->resolved = true;
+    if(!ok)
+        return;
+    for(size_t j = i; ok && j-- > s->air_head && s->air[j].start_us + s->max_airtime_us > a->start_us;)
+        ok = !interferes(a, &s->air[j]);
+    for(size_t j = i + 1; ok && j < s->air_len && s->air[j].start_us < a->end_us; j++)
+        ok = !interferes(a, &s->air[j]);
+    if(!ok){
+        s->collisions++;
+        return;
+    }
+    // the packet forwarder sends whenever a downlink is due, what is being received is lost
+    if(gateway_transmitting(s, a->start_us, a->end_us)){
+        s->gateway_busy++;
+        return;
+    }
+
+    s->received++;
+    n->heard = true;
+    if(!s->setup->confirmed)
+        return;
+    uint32_t rx2_freq = s->setup->single ? s->freqs[0] : RX2_FREQ_HZ;
+    uint8_t rx2_sf = s->setup->single ? s->gateway_sf : RX2_SF;
+    if(gateway_send(s, a->end_us + RX1_DELAY_US, a->freq_hz, a->sf, &n->ack_end_us) ||
+       gateway_send(s, a->end_us + RX2_DELAY_US, rx2_freq, rx2_sf, &n->ack_end_us)){
+        n->acked = true;
+        s->acks++;
+    }else{
+        s->acks_missed++;
+    }
+}
+
+static int by_start(const void* x, const void* y){
+    const struct frame* a = x;
+    const struct frame* b = y;
+    if(a->start_us != b->start_us)
+        return a->start_us < b->start_us ? -1 : 1;
+    return a->node < b->node ? -1 : a->node > b->node;
+}
+
+static const struct sim* sort_sim;
+
+static int by_end(const void* x, const void* y){
+    const struct frame* a = &sort_sim->air[*(const size_t*)x];
+    const struct frame* b = &sort_sim->air[*(const size_t*)y];
+    if(a->end_us != b->end_us)
+        return a->end_us < b->end_us ? -1 : 1;
+    return a->node < b->node ? -1 : a->node > b->node;
+}
+
+/*
+    frames started in the window locked in order of start, then the ones over before its end resolved in order of end:
+    an acknowledgment decided here goes on air at least 1 s later, past the window
+*/
+static void channel_window(struct sim* s, uint64_t window_end_us){
+    size_t first = s->air_len;
+
+    for(uint8_t t = 0; t < s->n_workers; t++){
+        struct worker* w = &s->workers[t];
+        s->air = grow(s->air, &s->air_cap, s->air_len + w->n_out, sizeof(struct frame));
+        for(size_t i = 0; i < w->n_out; i++){
+            s->air[s->air_len++] = w->out[i];
+            uint32_t airtime = (uint32_t)(w->out[i].end_us - w->out[i].start_us);
+            if(airtime > s->max_airtime_us)
+                s->max_airtime_us = airtime;
+        }
+    }
+    qsort(&s->air[first], s->air_len - first, sizeof(struct frame), by_start);
+    for(size_t i = first; i < s->air_len; i++)
+        channel_lock(s, i);
+
+    size_t n_ends = 0;
+    for(size_t i = s->unresolved; i < s->air_len; i++){
+        if(!s->air[i].resolved && s->air[i].end_us < window_end_us){
+            s->ends = grow(s->ends, &s->cap_ends, n_ends + 1, sizeof(size_t));
+            s->ends[n_ends++] = i;
+        }
+    }
+    sort_sim = s;
+    qsort(s->ends, n_ends, sizeof(size_t), by_end);
+    for(size_t i = 0; i < n_ends; i++)
+        channel_resolve(s, s->ends[i]);
+
+    while(s->unresolved < s->air_len && s->air[s->unresolved].resolved)
+        s->unresolved++;
+    // a frame still to resolve starts no sooner than the first unresolved one, the new ones after the window
+    uint64_t needed_us = s->unresolved < s->air_len ? s->air[s->unresolved].start_us : window_end_us;
+    while(s->air_head < s->unresolved && s->air[s->air_head].end_us <= needed_us)
+        s->air_head++;
+    if(s->air_head > 4096 && s->air_head > s->air_len / 2){
+        memmove(s->air, &s->air[s->air_head], (s->air_len - s->air_head) * sizeof(struct frame));
+        s->air_len -= s->air_head;
+        s->unresolved -= s->air_head;
+        s->air_head = 0;
+    }
+    size_t kept = 0;
+    for(size_t i = 0; i < s->n_gateway_tx; i++)
+        if(s->gateway_tx[i].end_us > needed_us)
+            s->gateway_tx[kept++] = s->gateway_tx[i];
+    s->n_gateway_tx = kept;
+}
+
+/*
+    --- a run ---
+*/
+
+static void place_nodes(struct sim* s, uint8_t single_sf){
+    for(uint32_t i = 0; i < s->n_nodes; i++){
+        struct node* n = &s->nodes[i];
+        memset(n, 0, sizeof(*n));
+        n->rng = 0x5A15ull * 1000003 + i;
+        n->distance_m = RADIUS_M * sqrt(rnd_uniform(&n->rng));
+        n->rssi_dbm = TX_DBM - path_loss_db(n->distance_m) + SHADOWING_DB * rnd_normal(&n->rng);
+        n->sf = 12;
+        for(uint8_t sf = 7; sf <= 12; sf++){
+            if(n->rssi_dbm >= sensitivity_dbm(s, sf) + ADR_MARGIN_DB){
+                n->sf = sf;
+                break;
+            }
+        }
+        if(s->setup->single)
+            n->sf = single_sf;
+        // no frame is below the sensitivity, whatever its fading
+        n->in_range = n->rssi_dbm - FADING_DB >= sensitivity_dbm(s, n->sf);
+        tx_scheduler_init(&n->dc, eu868_bands, sizeof(eu868_bands) / sizeof(eu868_bands[0]));
+        n->wake_us = (rnd_next(&n->rng) % s->period_ms) * 1000;
+        n->io_us = UINT64_MAX;
+        n->io = IO_NONE;
+    }
+}
+
+static int by_value(const void* x, const void* y){
+    uint32_t a = *(const uint32_t*)x, b = *(const uint32_t*)y;
+    return a < b ? -1 : a > b;
+}
+
+static struct result run(const struct setup* setup, uint32_t n_nodes, uint32_t period_ms, uint8_t readings,
+                         uint8_t single_sf, uint8_t threads, FILE* csv){
+    struct sim* s = calloc(1, sizeof(struct sim));
+    struct single_channel_rate rates[SINGLE_CHANNEL_RATES];
+    struct result r = {0};
+
+    s->setup = setup;
+    s->n_nodes = n_nodes;
+    s->nodes = malloc(n_nodes * sizeof(struct node));
+    s->period_ms = period_ms;
+    s->payload_len = BATCH_HEADER_LEN + readings * BATCH_RECORD_LEN;
+    single_channel_rates(125000, s->payload_len + FRAME_OVERHEAD, 100, 45, rates);
+    for(uint8_t i = 0; i < SINGLE_CHANNEL_RATES; i++)
+        s->sensitivity_x10[i] = rates[i].sensitivity_dbm_x10;
+    if(setup->single){
+        s->freqs[0] = SINGLE_FREQ_HZ;
+        s->n_freqs = 1;
+        s->gateway_sf = single_sf;
+        s->demods = 1;
+    }else{
+        memcpy(s->freqs, eu868_defaults, sizeof(eu868_defaults));
+        s->n_freqs = 3;
+        s->demods = GATEWAY_DEMODS;
+    }
+    tx_scheduler_init(&s->gateway_dc, eu868_bands, sizeof(eu868_bands) / sizeof(eu868_bands[0]));
+    place_nodes(s, single_sf);
+
+    // a thread for a few hundred nodes at least, the windows cost a barrier each
+    s->n_workers = (n_nodes + NODES_PER_THREAD - 1) / NODES_PER_THREAD;
+    if(s->n_workers > threads)
+        s->n_workers = threads;
+    if(s->n_workers == 0)
+        s->n_workers = 1;
+    for(uint8_t t = 0; t < s->n_workers; t++){
+        struct worker* w = &s->workers[t];
+        uint32_t from = (uint64_t)n_nodes * t / s->n_workers, to = (uint64_t)n_nodes * (t + 1) / s->n_workers;
+        w->sim = s;
+        w->heap = malloc((to - from + 1) * sizeof(uint32_t));
+        for(uint32_t i = from; i < to; i++)
+            w->heap[w->heap_len++] = i;
+        for(uint32_t i = w->heap_len / 2 + 1; i-- > 0;)
+            heap_down(w, i);
+    }
+    if(s->n_workers > 1){
+        pthread_barrier_init(&s->start, NULL, s->n_workers);
+        pthread_barrier_init(&s->end, NULL, s->n_workers);
+        for(uint8_t t = 1; t < s->n_workers; t++)
+            pthread_create(&s->workers[t].thread, NULL, worker_main, &s->workers[t]);
+    }
+
+    uint64_t window_start = 0;
+    while(window_start < SIM_US + TAIL_US){
+        s->window_end_us = window_start + WINDOW_US;
+        if(s->n_workers > 1)
+            pthread_barrier_wait(&s->start);
+        worker_window(&s->workers[0], s->window_end_us);
+        if(s->n_workers > 1)
+            pthread_barrier_wait(&s->end);
+        channel_window(s, s->window_end_us);
+
+        uint64_t next = UINT64_MAX;
+        for(uint8_t t = 0; t < s->n_workers; t++)
+            if(s->workers[t].next_us < next)
+                next = s->workers[t].next_us;
+        for(size_t i = s->unresolved; i < s->air_len; i++)
+            if(!s->air[i].resolved && s->air[i].end_us < next)
+                next = s->air[i].end_us;
+        window_start = next;
+    }
+    if(s->n_workers > 1){
+        s->done = true;
+        pthread_barrier_wait(&s->start);
+        for(uint8_t t = 1; t < s->n_workers; t++)
+            pthread_join(s->workers[t].thread, NULL);
+        pthread_barrier_destroy(&s->start);
+        pthread_barrier_destroy(&s->end);
+    }
+
+    // frames made, delivered and latency of the nodes in range
+    r.nodes = n_nodes;
+    r.balanced = true;
+    r.within_duty = true;
+    uint64_t airtime_us = 0;
+    for(uint32_t i = 0; i < n_nodes; i++){
+        struct node* n = &s->nodes[i];
+        uint32_t pending = 0;
+        for(uint8_t k = 0; k < n->count; k++){
+            const struct queued* q = &n->queue[(n->head + k) % QUEUE_CAPACITY];
+            if(q->counted && !q->delivered)
+                pending++;
+        }
+        if(n->made != n->delivered + n->dropped + n->unheard + pending)
+            r.balanced = false;
+        // the time-off follows every frame, one frame may be ahead of it at the end
+        if(n->airtime_us > (SIM_US + TAIL_US) / 100 + s->max_airtime_us)
+            r.within_duty = false;
+        double duty = (double)n->airtime_us / (SIM_US + TAIL_US);
+        if(duty > r.busiest_duty)
+            r.busiest_duty = duty;
+        airtime_us += n->airtime_us;
+        r.sent += n->sent;
+        if(n->in_range){
+            r.in_range++;
+            r.made += n->made;
+            r.delivered += n->delivered;
+            r.pending += pending;
+        }
+        if(csv != NULL)
+            fprintf(csv, "%s,%u,%u,%.0f,%.1f,%u,%d,%u,%u,%u,%u,%u,%.1f\n", setup->name, n_nodes, i, n->distance_m,
+                n->rssi_dbm, n->sf, n->in_range, n->made, n->delivered, n->dropped, n->unheard, n->sent,
+                n->airtime_us / 1000.0);
+    }
+    r.pdr = r.made ? (double)r.delivered / r.made : 1;
+    r.airtime_s_h = (double)airtime_us / n_nodes / 1e6 / ((SIM_US + TAIL_US) / (double)HOUR_US);
+    r.received = s->received;
+    r.collisions = s->collisions;
+    r.gateway_busy = s->gateway_busy;
+    r.acks = s->acks;
+    r.acks_missed = s->acks_missed;
+
+    size_t n_latency = 0;
+    for(uint8_t t = 0; t < s->n_workers; t++)
+        n_latency += s->workers[t].n_latency;
+    uint32_t* latency = malloc((n_latency + 1) * sizeof(uint32_t));
+    n_latency = 0;
+    for(uint8_t t = 0; t < s->n_workers; t++){
+        memcpy(&latency[n_latency], s->workers[t].latency_ms, s->workers[t].n_latency * sizeof(uint32_t));
+        n_latency += s->workers[t].n_latency;
+    }
+    qsort(latency, n_latency, sizeof(uint32_t), by_value);
+    if(n_latency > 0){
+        r.latency_p50_s = latency[n_latency / 2] / 1000.0;
+        r.latency_p95_s = latency[n_latency * 95 / 100] / 1000.0;
+    }
+
+    free(latency);
+    for(uint8_t t = 0; t < s->n_workers; t++){
+        free(s->workers[t].heap);
+        free(s->workers[t].out);
+        free(s->workers[t].latency_ms);
+    }
+    free(s->nodes);
+    free(s->air);
+    free(s->ends);
+    free(s->gateway_tx);
+    free(s);
+    return r;
+}
+
+static void print_row(const struct result* r){
+    printf("| %u | %u | %.1f | %.1f | %.1f | %.1f | %.2f | %.1f | %.1f | %.1f |\n", r->nodes, r->in_range,
+        100 * r->pdr, r->latency_p50_s, r->latency_p95_s, r->airtime_s_h, 100 * r->busiest_duty,
+        r->sent ? 100.0 * r->collisions / r->sent : 0, r->sent ? 100.0 * r->gateway_busy / r->sent : 0,
+        r->received ? 100.0 * r->acks_missed / r->received : 0);
+}
+
+int main(int argc, char** argv){
+    int period_s = argc > 1 ? atoi(argv[1]) : 300;
+    int readings = argc > 2 ? atoi(argv[2]) : 1;
+    int single_sf = argc > 3 ? atoi(argv[3]) : 12;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = argc > 4 ? atoi(argv[4]) : (int)(cpus > 0 ? cpus : 1);
+    int max_nodes = argc > 5 ? atoi(argv[5]) : 5000;
+    FILE* csv = NULL;
+    if(period_s < 10 || readings < 1 || BATCH_HEADER_LEN + readings * BATCH_RECORD_LEN > 222 || single_sf < 7 ||
+       single_sf > 12 || threads < 1 || threads > MAX_THREADS || max_nodes < 10){
+        printf("usage: %s [period s] [readings a frame] [single-channel SF] [threads] [max nodes] [nodes csv]\n", argv[0]);
+        return 1;
+    }
+    if(argc > 6){
+        csv = fopen(argv[6], "w");
+        if(csv == NULL){
+            printf("can't write %s\n", argv[6]);
+            return 1;
+        }
+        fprintf(csv, "gateway,nodes,node,distance_m,rssi_dbm,sf,in_range,made,delivered,dropped,unheard,sent,airtime_ms\n");
+    }
+
+    uint32_t period_ms = period_s * 1000;
+    uint8_t payload_len = BATCH_HEADER_LEN + readings * BATCH_RECORD_LEN;
+    char single_name[64];
+    snprintf(single_name, sizeof(single_name), "single-channel SF%d", single_sf);
+    const struct setup setups[] = {
+        {single_name, true, true},
+        {single_name, true, false},
+        {"8 demodulators, 3 channels, ADR", false, true},
+    };
+    const uint32_t counts[] = {10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000};
+
+    // the results don't depend on the threads
+    const struct setup* check_setup = &setups[2];
+    struct result one = run(check_setup, 1200, period_ms, readings, single_sf, 1, NULL);
+    struct result many = run(check_setup, 1200, period_ms, readings, single_sf, 3, NULL);
+    CHECK(one.delivered == many.delivered && one.sent == many.sent && one.collisions == many.collisions &&
+        one.acks == many.acks && one.latency_p95_s == many.latency_p95_s,
+        "1 and 3 threads differ: %llu/%llu delivered, %llu/%llu sent", (unsigned long long)one.delivered,
+        (unsigned long long)many.delivered, (unsigned long long)one.sent, (unsigned long long)many.sent);
+
+    printf("\n%d bytes (%d readings) every %d s from nodes within %d m, %d dBm, shadowing %.0f dB, a day, %d threads\n",
+        payload_len, readings, period_s, RADIUS_M, TX_DBM, SHADOWING_DB, threads);
+    if(payload_len > max_payload[single_sf - SINGLE_CHANNEL_MIN_SF])
+        printf("the frames don't fit at SF%d, the nodes of the single-channel gateway drop them\n", single_sf);
+
+    for(unsigned k = 0; k < sizeof(setups) / sizeof(setups[0]); k++){
+        const struct setup* setup = &setups[k];
+        uint32_t pass = 0, fail = 0;
+        struct timespec t0, t1;
+
+        printf("\n%s gateway, %s uplinks:\n", setup->name, setup->confirmed ? "confirmed" : "unconfirmed");
+        printf("| nodes | in range | PDR (%%) | latency p50 (s) | latency p95 (s) | airtime a node (s/h) | busiest node (%% of time) "
+            "| collided (%%) | gateway sending (%%) | acks missed (%%) |\n");
+        printf("|-------|----------|---------|-----------------|-----------------|----------------------|--------------------------"
+            "|--------------|---------------------|------------------|\n");
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for(unsigned i = 0; i < sizeof(counts) / sizeof(counts[0]) && counts[i] <= (uint32_t)max_nodes; i++){
+            struct result r = run(setup, counts[i], period_ms, readings, single_sf, threads, csv);
+            print_row(&r);
+            CHECK(r.balanced, "%u nodes: frames made and accounted for differ", counts[i]);
+            CHECK(r.within_duty, "%u nodes: a node past the duty cycle", counts[i]);
+            if(r.pdr >= TARGET_PDR && fail == 0)
+                pass = counts[i];
+            else if(fail == 0)
+                fail = counts[i];
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        printf("(%.1f s)\n", (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+
+        if(fail == 0){
+            printf("delivery ratio of %.0f%% with %u nodes and more\n", 100 * TARGET_PDR, pass);
+            continue;
+        }
+        // bisection between the last count that keeps the target and the first that doesn't
+        uint32_t lo = pass, hi = fail;
+        while(hi - lo > 1 && hi - lo > lo / 50){
+            uint32_t mid = (lo + hi) / 2;
+            if(mid == 0)
+                break;
+            struct result r = run(setup, mid, period_ms, readings, single_sf, threads, NULL);
+            if(r.pdr >= TARGET_PDR)
+                lo = mid;
+            else
+                hi = mid;
+        }
+        printf("delivery ratio of %.0f%% up to %u nodes, %.1f frames a minute\n", 100 * TARGET_PDR, lo,
+            lo * 60.0 / period_s);
+    }
+
+    if(csv != NULL)
+        fclose(csv);
+    printf("%s\n", failures ? "FAILED" : "all checks passed");
+    return failures ? 1 : 0;
+}
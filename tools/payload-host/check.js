@@ -0,0 +1,110 @@
+/*
+    second half of the payload host check, reads the JSON of ./host js on stdin:
+    - the bytes encoded by payload.h must be the fields of executables/lib/payload/payload.json in order, in little
+      endian, built here from the schema without the generator
+    - every message is decoded with the decode function of the codec.js of class-a and class-c and must give the
+      fields divided by their scale, 'nan' for a zero where the schema says so
+    - every message of the schema must be in the output of host.c with all its fields
+    run from this folder with ./host js | node check.js
+*/
+
+var fs = require("fs");
+var path = require("path");
+var vm = require("vm");
+
+var ROOT = path.join(__dirname, "..", "..");
+var SCHEMA = path.join(ROOT, "executables", "lib", "payload", "payload.json");
+var CODECS = [path.join(ROOT, "executables", "class-a", "codec.js"), path.join(ROOT, "executables", "class-c", "codec.js")];
+var SIZES = { "u8": 1, "i8": 1, "u16": 2, "i16": 2, "u32": 4, "i32": 4 };
+
+var failures = 0;
+function check(cond, msg){
+    if(!cond){
+        failures++;
+        console.log("FAIL: " + msg);
+    }
+}
+
+function camel(name){
+    return name.split("_").map(function(p){ return p.charAt(0).toUpperCase() + p.slice(1); }).join("");
+}
+
+/* the messages of the schema with the includes flattened, as payloadgen.py */
+function messages(schema){
+    var done = {};
+    schema.messages.forEach(function(msg){
+        var fields = [];
+        msg.fields.forEach(function(f){
+            fields = fields.concat(f.include ? done[f.include].fields : [f]);
+        });
+        done[msg.name] = { "name": msg.name, "fields": fields };
+    });
+    return done;
+}
+
+/* a codec.js run apart from this file with its console.log calls silenced, returning its decode functions */
+function loadCodec(file, names){
+    var wrap = "(function(console){\n" + fs.readFileSync(file, "utf8") + "\nreturn { " +
+               names.map(function(n){ return "\"" + n + "\": typeof " + n + " === \"function\" ? " + n + " : undefined"; })
+                    .join(", ") + " };\n})";
+    return vm.runInThisContext(wrap, { "filename": file, "lineOffset": -1 })({ "log": function(){} });
+}
+
+function encode(msg, values){
+    var bytes = [];
+    msg.fields.forEach(function(f){
+        var v = values[f.name];
+        for(var b = 0; b < SIZES[f.type]; b++)
+            bytes.push(Math.floor(v / Math.pow(2, 8 * b)) & 0xFF);
+    });
+    return bytes;
+}
+
+function scaled(msg, values){
+    var obj = {};
+    msg.fields.forEach(function(f){
+        var v = values[f.name];
+        obj[f.name] = f.nan_if_zero && v == 0 ? 'nan' : (f.scale || 1) != 1 ? v / f.scale : v;
+    });
+    return obj;
+}
+
+var schema = messages(JSON.parse(fs.readFileSync(SCHEMA, "utf8")));
+var decoders = Object.keys(schema).map(function(n){ return "decode" + camel(n); });
+var codecs = CODECS.map(function(file){ return loadCodec(file, decoders); });
+var input = JSON.parse(fs.readFileSync(0, "utf8"));
+var cases = {};
+
+input.forEach(function(c, i){
+    var msg = schema[c.message];
+    check(msg !== undefined, "case " + i + ": " + c.message + " is not in payload.json");
+    if(msg === undefined)
+        return;
+    var names = msg.fields.map(function(f){ return f.name; }).join(",");
+    check(Object.keys(c.fields).join(",") === names, c.message + ": fields " + Object.keys(c.fields).join(",") +
+          " in host.c, " + names + " in payload.json");
+    var want = encode(msg, c.fields);
+    check(JSON.stringify(c.bytes) === JSON.stringify(want), c.message + " case " + i + ": bytes " +
+          JSON.stringify(c.bytes) + " instead of " + JSON.stringify(want));
+    var expected = JSON.stringify(scaled(msg, c.fields));
+    codecs.forEach(function(codec, k){
+        var decode = codec["decode" + camel(c.message)];
+        check(decode !== undefined, CODECS[k] + " has no decoder of " + c.message);
+        if(decode === undefined)
+            return;
+        var got = JSON.stringify(decode(c.bytes, 0));
+        check(got === expected, c.message + " case " + i + " with " + path.relative(ROOT, CODECS[k]) + ": " + got +
+              " instead of " + expected);
+    });
+    cases[c.message] = (cases[c.message] || 0) + 1;
+});
+
+Object.keys(schema).forEach(function(n){
+    check(cases[n] > 0, n + " of payload.json is not checked by host.c");
+});
+
+console.log("| message | cases | codecs |");
+console.log("|---------|-------|--------|");
+Object.keys(cases).forEach(function(n){ console.log("| " + n + " | " + cases[n] + " | " + CODECS.length + " |"); });
+console.log("\n" + (failures ? "FAILED" : "all checks passed"));
+process.exit(failures ? 1 : 0);
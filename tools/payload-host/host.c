@@ -0,0 +1,115 @@
+/**
+ * @file host.c
+ * @brief host check of the payloads generated by tools/payloadgen from executables/lib/payload/payload.json: every
+ *          message of payload.h is filled with zeros, all ones, the lowest and highest value of each field and then
+ *          random values, encoded and decoded again in C. The decode must give back every field and the encode must
+ *          write exactly the length of the message.
+ *          With the argument js the messages and their bytes are printed as JSON for check.js, which builds the
+ *          bytes again from payload.json on its own, decodes them with the codec.js of class-a and class-c and
+ *          fails on a message of the schema left out of this file.
+ *          The generated files themselves are checked against the schema by payloadgen --check.
+ *
+ *          build and run from this folder:
+ *          gcc -O2 -Wall -I../../executables/lib/payload host.c -o host
+ *          ./host
+ *          ./host js | node check.js
+ *          cd ../.. && python3 tools/payloadgen/payloadgen.py executables/lib/payload/payload.json \
+ *              --header executables/lib/payload/payload.h \
+ *              --js executables/class-a/codec.js --js executables/class-c/codec.js --check
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "payload.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do{ \
+        if(!(cond)){ \
+            failures++; \
+            printf("FAIL line %d: ", __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    }while(0)
+
+#define RANDOM_CASES        1000
+// zeros, all ones, lowest and highest, then random
+#define FIXED_CASES         4
+#define GUARD               0xA5
+
+// fields of every message in the order of payload.json, check.js compares them with the schema
+#define READING_FIELDS(X)       X(temp) X(hum) X(press) X(AQI) X(CO2)
+#define UPLINK_FIELDS(X)        X(id) READING_FIELDS(X)
+#define GAS_UPLINK_FIELDS(X)    X(id) X(p1) X(p2) X(p3) X(p4)
+
+static int print_js;
+
+static uint64_t random_bits(void){
+    return (uint64_t)rand() << 33 ^ (uint64_t)rand() << 11 ^ (uint64_t)rand();
+}
+
+#define IS_SIGNED(f)            ((__typeof__(f))-1 < 0)
+#define TOP_BIT(f)              (1ull << (8 * sizeof(f) - 1))
+
+// the value of a field for a case: the lowest of a signed field has the top bit only, the highest all bits but it
+#define CASE_VALUE(f, c) \
+    ((__typeof__(f))((c) == 0 ? 0 : (c) == 1 ? ~0ull : \
+                     (c) == 2 ? (IS_SIGNED(f) ? TOP_BIT(f) : 0) : \
+                     (c) == 3 ? (IS_SIGNED(f) ? TOP_BIT(f) - 1 : ~0ull) : random_bits()))
+
+#define FILL(f)                 m.f = CASE_VALUE(m.f, c);
+#define COMPARE(f)              CHECK(d.f == m.f, "%s case %d: %s is %lld instead of %lld", name, c, #f, \
+                                    (long long)d.f, (long long)m.f);
+#define PRINT(f)                printf("%s\"%s\": %lld", sep, #f, (long long)m.f), sep = ", ";
+
+#define ROUND_TRIP(msg, LEN, FIELDS) do{ \
+        const char* name = #msg; \
+        for(int c = 0; c < FIXED_CASES + RANDOM_CASES; c++){ \
+            struct payload_##msg m, d; \
+            uint8_t buf[LEN + 1]; \
+            const char* sep = ""; \
+            FIELDS(FILL) \
+            memset(buf, GUARD, sizeof(buf)); \
+            payload_##msg##_encode(&m, buf); \
+            CHECK(buf[LEN] == GUARD, "%s case %d: encode wrote past %d bytes", name, c, LEN); \
+            memset(&d, 0, sizeof(d)); \
+            payload_##msg##_decode(&d, buf); \
+            FIELDS(COMPARE) \
+            if(print_js){ \
+                printf("%s\n{\"message\": \"%s\", \"fields\": {", first ? "" : ",", name); \
+                FIELDS(PRINT) \
+                printf("}, \"bytes\": ["); \
+                for(int i = 0; i < LEN; i++) \
+                    printf("%s%u", i ? "," : "", buf[i]); \
+                printf("]}"); \
+                first = 0; \
+            }else if(c == 0){ \
+                printf("| %s | %d | %d |\n", name, LEN, FIXED_CASES + RANDOM_CASES); \
+            } \
+        } \
+    }while(0)
+
+int main(int argc, char* argv[]){
+    int first = 1;
+    print_js = argc > 1 && strcmp(argv[1], "js") == 0;
+
+    srand(1);
+    if(print_js)
+        printf("[");
+    else
+        printf("| message | bytes | cases |\n|---------|-------|-------|\n");
+    ROUND_TRIP(reading, PAYLOAD_READING_LEN, READING_FIELDS);
+    ROUND_TRIP(uplink, PAYLOAD_UPLINK_LEN, UPLINK_FIELDS);
+    ROUND_TRIP(gas_uplink, PAYLOAD_GAS_UPLINK_LEN, GAS_UPLINK_FIELDS);
+
+    if(print_js)
+        printf("]\n");
+    else
+        printf("\n%s\n", failures == 0 ? "all checks passed" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,254 @@
+#!/usr/bin/env python3
+"""
+payloadgen - generates the encoders and decoders of the uplink payloads from a single schema
+
+    python3 tools/payloadgen/payloadgen.py executables/lib/payload/payload.json \
+        --header executables/lib/payload/payload.h \
+        --js executables/class-a/codec.js --js executables/class-c/codec.js
+
+The C header gets a packed description of every message: a struct with the fields, the length of the
+payload and static inline functions that write/read every field byte by byte in little endian, so the
+layout never depends on the padding or on the endianness of the compiler and every function compiles
+to a straight sequence of loads and stores.
+In the JS files the text between the begin and end markers is replaced with the decoders, the rest of
+the file (Decode, Encode and the framing of batch and delta frames) is left as it is.
+With --check nothing is written: the files that differ from what the schema generates are listed and the
+exit status is 1, to catch a header or codec edited by hand or a schema changed without running the generator.
+
+Schema, JSON:
+    prefix      prefix of the C names
+    messages    list of messages, each one with
+        name    snake_case name
+        doc     description
+        port    optional LoRaWAN port, emitted as <PREFIX>_<NAME>_PORT
+        fields  list of fields, in the order they are sent, each one either
+                { "name", "type": u8|i8|u16|i16|u32|i32, "scale": divisor for the decoder (default 1),
+                  "nan_if_zero": decoder gives 'nan' for 0 (default false), "doc" }
+                or { "include": name of a message defined before, its fields are copied in place }
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+TYPES = {
+    "u8": (1, False),
+    "i8": (1, True),
+    "u16": (2, False),
+    "i16": (2, True),
+    "u32": (4, False),
+    "i32": (4, True),
+}
+
+JS_BEGIN = "/* payloadgen begin"
+JS_END = "/* payloadgen end */"
+
+
+def fail(msg):
+    sys.exit("payloadgen: " + msg)
+
+
+def c_type(t):
+    size, signed = TYPES[t]
+    return "%sint%d_t" % ("" if signed else "u", size * 8)
+
+
+def camel(name):
+    return "".join(p[:1].upper() + p[1:] for p in name.split("_"))
+
+
+def resolve(schema):
+    """flattens the includes and checks the fields, returns the list of messages with offsets"""
+    done = {}
+    messages = []
+    for msg in schema["messages"]:
+        name = msg["name"]
+        if not re.match(r"^[a-z][a-z0-9_]*$", name):
+            fail("invalid message name '%s'" % name)
+        if name in done:
+            fail("message '%s' defined twice" % name)
+        fields = []
+        for f in msg["fields"]:
+            if "include" in f:
+                if f["include"] not in done:
+                    fail("message '%s' includes '%s' that is not defined before" % (name, f["include"]))
+                fields.extend(dict(x) for x in done[f["include"]]["fields"])
+                continue
+            if f.get("type") not in TYPES:
+                fail("field '%s' of '%s' has an unknown type" % (f.get("name"), name))
+            fields.append(dict(f))
+        offset = 0
+        names = set()
+        for f in fields:
+            if f["name"] in names:
+                fail("field '%s' repeated in '%s'" % (f["name"], name))
+            names.add(f["name"])
+            f["offset"] = offset
+            f["size"] = TYPES[f["type"]][0]
+            offset += f["size"]
+        resolved = dict(msg)
+        resolved["fields"] = fields
+        resolved["length"] = offset
+        done[name] = resolved
+        messages.append(resolved)
+    return messages
+
+
+def gen_header(schema, messages, schema_path, header_path):
+    prefix = schema["prefix"]
+    guard = "_%s_H_" % os.path.basename(header_path).split(".")[0].upper()
+    rel_schema = os.path.basename(schema_path)
+    out = []
+    out.append("/**")
+    out.append(" * @file %s" % os.path.basename(header_path))
+    out.append(" * @brief encoders and decoders of the uplink payloads, generated by tools/payloadgen/payloadgen.py from %s," % rel_schema)
+    out.append(" *          do not edit by hand: change the schema and run the generator again.")
+    out.append(" *          Every field is written byte by byte in little endian, so the layout doesn't depend on the padding")
+    out.append(" *          or on the endianness of the compiler; the functions are static inline so that each one becomes a")
+    out.append(" *          straight sequence of stores where it is used")
+    out.append(" */")
+    out.append("")
+    out.append("#ifndef %s" % guard)
+    out.append("#define %s" % guard)
+    out.append("")
+    out.append("#include <stdint.h>")
+    for msg in messages:
+        up = "%s_%s" % (prefix.upper(), msg["name"].upper())
+        out.append("")
+        out.append("/*")
+        out.append("    %s" % msg["doc"])
+        out.append("*/")
+        out.append("#define %s_LEN%s%d" % (up, " " * max(1, 36 - len(up) - 12), msg["length"]))
+        if "port" in msg:
+            out.append("#define %s_PORT%s%d" % (up, " " * max(1, 36 - len(up) - 13), msg["port"]))
+        out.append("")
+        out.append("struct %s_%s {" % (prefix, msg["name"]))
+        for f in msg["fields"]:
+            comment = f.get("doc", "")
+            if f.get("scale", 1) != 1:
+                comment += " {%d}" % f["scale"]
+            decl = "    %s %s;" % (c_type(f["type"]), f["name"])
+            out.append(decl + (" //" + comment.strip() if comment.strip() else ""))
+        out.append("};")
+        out.append("")
+        out.append("static inline void %s_%s_encode(const struct %s_%s* m, uint8_t* buf){" % (prefix, msg["name"], prefix, msg["name"]))
+        for f in msg["fields"]:
+            unsigned = "uint%d_t" % (f["size"] * 8)
+            for b in range(f["size"]):
+                shift = " >> %d" % (8 * b) if b else ""
+                out.append("    buf[%d] = (uint8_t)((%s)m->%s%s);" % (f["offset"] + b, unsigned, f["name"], shift))
+        out.append("}")
+        out.append("")
+        out.append("static inline void %s_%s_decode(struct %s_%s* m, const uint8_t* buf){" % (prefix, msg["name"], prefix, msg["name"]))
+        for f in msg["fields"]:
+            unsigned = "uint%d_t" % (f["size"] * 8)
+            parts = []
+            for b in range(f["size"]):
+                shift = " << %d" % (8 * b) if b else ""
+                parts.append("(%s)buf[%d]%s" % (unsigned, f["offset"] + b, shift))
+            out.append("    m->%s = (%s)(%s);" % (f["name"], c_type(f["type"]), " | ".join(parts)))
+        out.append("}")
+    out.append("")
+    out.append("#endif")
+    return "\n".join(out) + "\n"
+
+
+JS_READERS = {
+    "u8": "function payloadU8(bytes, idx){\n    return bytes[idx] & 0xFF;\n}",
+    "i8": "function payloadI8(bytes, idx){\n    var v = bytes[idx] & 0xFF;\n    return v & 0x80 ? v - 0x100 : v;\n}",
+    "u16": "function payloadU16(bytes, idx){\n    return (bytes[idx] & 0xFF) | ((bytes[idx+1] & 0xFF) << 8);\n}",
+    "i16": "function payloadI16(bytes, idx){\n    var v = payloadU16(bytes, idx);\n    return v & 0x8000 ? v - 0x10000 : v;\n}",
+    "u32": "function payloadU32(bytes, idx){\n    return payloadI32(bytes, idx) >>> 0;\n}",
+    "i32": "function payloadI32(bytes, idx){\n    return (bytes[idx] & 0xFF) | ((bytes[idx+1] & 0xFF) << 8) | ((bytes[idx+2] & 0xFF) << 16) | ((bytes[idx+3] & 0xFF) << 24);\n}",
+}
+
+
+def gen_js(schema, messages, schema_path):
+    out = []
+    out.append("%s, generated by tools/payloadgen/payloadgen.py from %s, do not edit by hand */" % (JS_BEGIN, os.path.basename(schema_path)))
+    # every reader is emitted, they are small and some depend on each other
+    for t in ("u8", "i8", "u16", "i16", "i32", "u32"):
+        out.append(JS_READERS[t])
+        out.append("")
+    for msg in messages:
+        name = camel(msg["name"])
+        up = "%s_%s" % (schema["prefix"].upper(), msg["name"].upper())
+        out.append("/* %s */" % msg["doc"])
+        out.append("var %s_LEN = %d;" % (up, msg["length"]))
+        if "port" in msg:
+            out.append("var %s_PORT = %d;" % (up, msg["port"]))
+        out.append("")
+        out.append("/* converts the integer fields to the physical values */")
+        out.append("function scale%s(raw){" % name)
+        out.append("    return{")
+        for f in msg["fields"]:
+            value = "raw.%s" % f["name"]
+            if f.get("scale", 1) != 1:
+                value += "/%d" % f["scale"]
+            if f.get("nan_if_zero"):
+                value = "raw.%s == 0 ? 'nan' : %s" % (f["name"], value)
+            out.append('        "%s": %s,' % (f["name"], value))
+        out.append("    };")
+        out.append("}")
+        out.append("")
+        out.append("function decode%s(bytes, idx){" % name)
+        out.append("    return scale%s({" % name)
+        for f in msg["fields"]:
+            out.append('        "%s": payload%s(bytes, idx+%d),' % (f["name"], f["type"].upper(), f["offset"]))
+        out.append("    });")
+        out.append("}")
+        out.append("")
+    out.append(JS_END)
+    return "\n".join(out)
+
+
+def write_if_changed(path, text, check):
+    """returns True when the file differs from text, writes it unless check"""
+    old = None
+    if os.path.exists(path):
+        with open(path) as f:
+            old = f.read()
+    if old == text:
+        return False
+    if check:
+        print("payloadgen: %s differs from the schema" % path)
+    else:
+        with open(path, "w") as f:
+            f.write(text)
+        print("payloadgen: wrote %s" % path)
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description="generates the payload encoders and decoders from the schema")
+    parser.add_argument("schema", help="JSON schema of the payloads")
+    parser.add_argument("--header", help="C header to generate")
+    parser.add_argument("--js", action="append", default=[], help="JS file with the markers where the decoders are placed")
+    parser.add_argument("--check", action="store_true", help="write nothing, exit with 1 if a file differs from the schema")
+    args = parser.parse_args()
+
+    with open(args.schema) as f:
+        schema = json.load(f)
+    messages = resolve(schema)
+
+    changed = False
+    if args.header:
+        changed |= write_if_changed(args.header, gen_header(schema, messages, args.schema, args.header), args.check)
+
+    js = gen_js(schema, messages, args.schema)
+    for path in args.js:
+        with open(path) as f:
+            text = f.read()
+        begin = text.find(JS_BEGIN)
+        end = text.find(JS_END)
+        if begin < 0 or end < begin:
+            fail("%s has no '%s ... %s' markers" % (path, JS_BEGIN, JS_END))
+        changed |= write_if_changed(path, text[:begin] + js + text[end + len(JS_END):], args.check)
+    if args.check and changed:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,422 @@
+/**
+ * @file provision.c
+ * @brief images of the provisioning sector of src/lorawan.c (pico/provision.h), one per device: the record sealed
+ *          with its CRC and padded to the sector, as a UF2 that writes that sector alone (drag and drop on the
+ *          BOOTSEL drive or picotool load) and as a raw .bin. The firmware is the same for every device, a board
+ *          without a record keeps the keys of its lora-config.h.
+ *
+ *          devices.csv, a header line naming the columns and a line a device, empty cells are not set:
+ *              name,region,dev_eui,join_eui,app_key,dev_addr,nwk_s_key,app_s_key,channel_mask,frequency,datarate
+ *          OTAA when app_key is set, ABP otherwise (random DevAddr without dev_addr), region by name (EU868, US915..)
+ *          keys and EUIs in hex as in lora-config.h, frequency in Hz for a single-channel gateway
+ *
+ *          The checks come first: CRC, records refused, hex strings refused, PROVISION_HEX_* against the parser and
+ *          the UF2 blocks. Then the time to get the keys of an ABP setup on the host, with the sscanf calls
+ *          lorawan.c used to make, the parser of the settings strings and a record.
+ *
+ *          build and run from this folder:
+ *          gcc -O2 -Wall -I../../src/include provision.c ../../src/provision.c ../../src/crc32.c -o provision
+ *          ./provision [devices.csv] [output folder] [flash offset of the sector, hex]
+ *
+ *          the offset defaults to LORAWAN_PROVISION_OFFSET of the default build (pico/flash-layout.h): 2 MB of flash,
+ *          256 KB of littlefs, the EEPROM journal, two FUOTA slots of 256 fragments of 64 bytes, then this sector
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pico/crc32.h"
+#include "pico/provision.h"
+
+// the default build: 2 MB of flash, FUOTA slots of 256 fragments of 64 bytes
+#define FLASH_SECTOR_SIZE       4096
+#define FLASH_PAGE_SIZE         256
+#define PICO_FLASH_SIZE_BYTES   (2 * 1024 * 1024)
+#define FRAG_MAX_NB             256
+#define FRAG_MAX_SIZE           64
+#include "pico/flash-layout.h"
+
+#define SECTOR_SIZE         FLASH_SECTOR_SIZE
+#define PAGE_SIZE           FLASH_PAGE_SIZE
+#define XIP_BASE            0x10000000u
+#define PROVISION_OFFSET    LORAWAN_PROVISION_OFFSET
+
+#define UF2_MAGIC_START0    0x0A324655u
+#define UF2_MAGIC_START1    0x9E5D5157u
+#define UF2_MAGIC_END       0x0AB16F30u
+#define UF2_FLAG_FAMILY     0x00002000u
+#define UF2_FAMILY_RP2040   0xE48BFF56u
+#define UF2_BLOCKS          (SECTOR_SIZE / PAGE_SIZE)
+
+#define MAX_COLUMNS         16
+#define MAX_LINE            1024
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do{ \
+        if(!(cond)){ \
+            failures++; \
+            printf("FAIL line %d: ", __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    }while(0)
+
+// LoRaMacRegion_t
+static const char* regions[] = {"AS923", "AU915", "CN470", "CN779", "EU433", "EU868", "KR920", "IN865", "US915", "RU864"};
+
+static void put32(uint8_t* p, uint32_t v){
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+static uint32_t get32(const uint8_t* p){
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/*
+    the sector: the record then erased flash
+*/
+static void sector_image(const struct provision_record* r, uint8_t* sector){
+    memset(sector, 0xFF, SECTOR_SIZE);
+    memcpy(sector, r, sizeof(*r));
+}
+
+/*
+    a UF2 block of 512 bytes for every page of the sector
+*/
+static void uf2_image(const uint8_t* sector, uint32_t offset, uint8_t* uf2){
+    for(uint32_t i = 0; i < UF2_BLOCKS; i++){
+        uint8_t* b = uf2 + i * 512;
+        memset(b, 0, 512);
+        put32(b, UF2_MAGIC_START0);
+        put32(b + 4, UF2_MAGIC_START1);
+        put32(b + 8, UF2_FLAG_FAMILY);
+        put32(b + 12, XIP_BASE + offset + i * PAGE_SIZE);
+        put32(b + 16, PAGE_SIZE);
+        put32(b + 20, i);
+        put32(b + 24, UF2_BLOCKS);
+        put32(b + 28, UF2_FAMILY_RP2040);
+        memcpy(b + 32, sector + i * PAGE_SIZE, PAGE_SIZE);
+        put32(b + 508, UF2_MAGIC_END);
+    }
+}
+
+static int region_of(const char* name){
+    for(unsigned i = 0; i < sizeof(regions) / sizeof(regions[0]); i++){
+        if(strcmp(name, regions[i]) == 0)
+            return i;
+    }
+    return -1;
+}
+
+/*
+    a record from the cells of a line, NULL for a missing column, the error in err
+*/
+static int record_of(struct provision_record* r, char** cell, const char** err){
+    enum { NAME, REGION, DEV_EUI, JOIN_EUI, APP_KEY, DEV_ADDR, NWK_S_KEY, APP_S_KEY, CHANNEL_MASK, FREQUENCY, DATARATE };
+    memset(r, 0, sizeof(*r));
+
+    int region = cell[REGION] != NULL ? region_of(cell[REGION]) : region_of("EU868");
+    if(region < 0){
+        *err = "unknown region";
+        return -1;
+    }
+    r->region = region;
+
+    if(cell[APP_KEY] != NULL){
+        r->flags |= PROVISION_OTAA;
+        if(provision_hex(cell[DEV_EUI], r->dev_eui, 8) < 0 || provision_hex(cell[APP_KEY], r->app_key, 16) < 0 ||
+           (cell[JOIN_EUI] != NULL && provision_hex(cell[JOIN_EUI], r->join_eui, 8) < 0)){
+            *err = "OTAA needs dev_eui and app_key in hex, join_eui is optional";
+            return -1;
+        }
+    }else{
+        uint8_t addr[4];
+        if(provision_hex(cell[NWK_S_KEY], r->nwk_s_key, 16) < 0 || provision_hex(cell[APP_S_KEY], r->app_s_key, 16) < 0){
+            *err = "ABP needs nwk_s_key and app_s_key in hex";
+            return -1;
+        }
+        if(cell[DEV_ADDR] != NULL){
+            if(provision_hex(cell[DEV_ADDR], addr, 4) < 0){
+                *err = "dev_addr is 8 hex digits";
+                return -1;
+            }
+            r->flags |= PROVISION_DEV_ADDR;
+            r->dev_addr = ((uint32_t)addr[0] << 24) | ((uint32_t)addr[1] << 16) | (addr[2] << 8) | addr[3];
+        }
+    }
+    if(cell[CHANNEL_MASK] != NULL){
+        if(provision_hex_mask(cell[CHANNEL_MASK], r->channel_mask) < 0){
+            *err = "channel_mask is 24 hex digits";
+            return -1;
+        }
+        r->flags |= PROVISION_CHANNEL_MASK;
+    }
+    if(cell[FREQUENCY] != NULL){
+        r->flags |= PROVISION_SINGLE_CHANNEL;
+        r->frequency = strtoul(cell[FREQUENCY], NULL, 10);
+        r->datarate = cell[DATARATE] != NULL ? atoi(cell[DATARATE]) : 0;
+    }
+    provision_seal(r);
+    return 0;
+}
+
+static int write_file(const char* dir, const char* name, const char* ext, const void* data, size_t len){
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s%s", dir, name, ext);
+    FILE* f = fopen(path, "wb");
+    if(f == NULL || fwrite(data, 1, len, f) != len){
+        printf("can't write %s\n", path);
+        if(f != NULL)
+            fclose(f);
+        return -1;
+    }
+    fclose(f);
+    return 0;
+}
+
+/*
+    an image for every line of the CSV, the columns are found by the names of the header
+*/
+static int generate(const char* csv, const char* dir, uint32_t offset){
+    static const char* names[] = {"name", "region", "dev_eui", "join_eui", "app_key", "dev_addr", "nwk_s_key",
+                                  "app_s_key", "channel_mask", "frequency", "datarate"};
+    const int n_names = sizeof(names) / sizeof(names[0]);
+    int column[MAX_COLUMNS];
+    char line[MAX_LINE];
+    int n_columns = 0;
+    int written = 0;
+    int line_no = 0;
+
+    FILE* f = fopen(csv, "r");
+    if(f == NULL){
+        printf("can't read %s\n", csv);
+        return -1;
+    }
+    printf("\nsector at 0x%08x\n", XIP_BASE + offset);
+    printf("| device | activation | region | DevEUI / DevAddr | CRC |\n");
+    printf("|--------|------------|--------|------------------|-----|\n");
+    while(fgets(line, sizeof(line), f) != NULL){
+        char* cell[MAX_COLUMNS];
+        int n = 0;
+        line_no++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if(line[0] == '\0' || line[0] == '#')
+            continue;
+        for(char* p = line; n < MAX_COLUMNS; n++){
+            cell[n] = p;
+            p = strchr(p, ',');
+            if(p == NULL){
+                n++;
+                break;
+            }
+            *p++ = '\0';
+        }
+
+        if(n_columns == 0){
+            n_columns = n;
+            for(int i = 0; i < n; i++){
+                column[i] = -1;
+                for(int j = 0; j < n_names; j++){
+                    if(strcmp(cell[i], names[j]) == 0)
+                        column[i] = j;
+                }
+                if(column[i] < 0)
+                    printf("column %s ignored\n", cell[i]);
+            }
+            continue;
+        }
+
+        char* field[sizeof(names) / sizeof(names[0])] = {0};
+        for(int i = 0; i < n && i < n_columns; i++){
+            if(column[i] >= 0 && cell[i][0] != '\0')
+                field[column[i]] = cell[i];
+        }
+        struct provision_record r;
+        const char* err = NULL;
+        if(field[0] == NULL || record_of(&r, field, &err) < 0){
+            printf("%s line %d: %s\n", csv, line_no, field[0] == NULL ? "no name" : err);
+            fclose(f);
+            return -1;
+        }
+
+        uint8_t sector[SECTOR_SIZE];
+        uint8_t uf2[UF2_BLOCKS * 512];
+        sector_image(&r, sector);
+        uf2_image(sector, offset, uf2);
+        if(write_file(dir, field[0], ".uf2", uf2, sizeof(uf2)) < 0 || write_file(dir, field[0], ".bin", sector, sizeof(sector)) < 0){
+            fclose(f);
+            return -1;
+        }
+        if(r.flags & PROVISION_OTAA)
+            printf("| %s | OTAA | %s | %s | %08x |\n", field[0], regions[r.region], field[2], r.crc);
+        else
+            printf("| %s | ABP | %s | %s | %08x |\n", field[0], regions[r.region],
+                (r.flags & PROVISION_DEV_ADDR) ? field[5] : "random", r.crc);
+        written++;
+    }
+    fclose(f);
+    printf("%d images in %s\n", written, dir);
+    return written;
+}
+
+#define DEV_EUI         "e660c0d1c74a4530"
+#define APP_KEY         "2B7E151628AED2A6ABF7158809CF4F3C"
+#define DEV_ADDR        "260b1234"
+#define CHANNEL_MASK    "00ff0000000000000000000f"
+
+static void check_record(void){
+    // CRC-32 check value
+    CHECK(lorawan_crc32(0, "123456789", 9) == 0xCBF43926u, "CRC-32 %08x", lorawan_crc32(0, "123456789", 9));
+    CHECK(sizeof(struct provision_record) == 104, "record of %zu bytes", sizeof(struct provision_record));
+
+    // the macros of lora-config.h and the parser give the same bytes
+    static const struct provision_record built = {
+        PROVISION_HEADER,
+        .flags = PROVISION_OTAA | PROVISION_CHANNEL_MASK,
+        .dev_eui = PROVISION_HEX_8(DEV_EUI),
+        .app_key = PROVISION_HEX_16(APP_KEY),
+        .dev_addr = PROVISION_HEX_U32(DEV_ADDR),
+        .channel_mask = PROVISION_HEX_MASK(CHANNEL_MASK),
+    };
+    struct provision_record parsed = {0};
+    uint8_t addr[4];
+    CHECK(provision_hex(DEV_EUI, parsed.dev_eui, 8) == 0 && memcmp(parsed.dev_eui, built.dev_eui, 8) == 0, "DevEUI");
+    CHECK(built.dev_eui[0] == 0xe6 && built.dev_eui[7] == 0x30, "DevEUI not most significant byte first");
+    CHECK(provision_hex(APP_KEY, parsed.app_key, 16) == 0 && memcmp(parsed.app_key, built.app_key, 16) == 0, "AppKey");
+    CHECK(provision_hex(DEV_ADDR, addr, 4) == 0 && built.dev_addr == 0x260b1234u, "DevAddr %08x", built.dev_addr);
+    CHECK(provision_hex_mask(CHANNEL_MASK, parsed.channel_mask) == 0 &&
+          memcmp(parsed.channel_mask, built.channel_mask, sizeof(built.channel_mask)) == 0 &&
+          built.channel_mask[0] == 0x00ff && built.channel_mask[5] == 0x000f, "channel mask");
+    CHECK(provision_valid(&built) == 0, "record built at compile time");
+    CHECK(provision_check(&built) == PROVISION_E_CRC, "a record without its CRC passes provision_check");
+
+    // the strings of the settings: placeholders, short and long ones refused
+    uint8_t key[16];
+    CHECK(provision_hex("xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx", key, 16) < 0, "placeholder accepted");
+    CHECK(provision_hex("2B7E151628AED2A6ABF7158809CF4F3", key, 16) < 0, "31 digits accepted");
+    CHECK(provision_hex("2B7E151628AED2A6ABF7158809CF4F3C0", key, 16) < 0, "33 digits accepted");
+    CHECK(provision_hex("2B7E151628AED2A6ABF7158809CF4F3g", key, 16) < 0, "g accepted");
+    CHECK(provision_hex(NULL, key, 16) < 0, "NULL accepted");
+
+    // sealed, every bit flipped is caught, other versions and an erased sector refused
+    struct provision_record r = built;
+    provision_seal(&r);
+    CHECK(provision_check(&r) == 0, "sealed record refused");
+    for(size_t bit = 0; bit < sizeof(r) * 8; bit++){
+        struct provision_record bad = r;
+        ((uint8_t*)&bad)[bit / 8] ^= 1 << (bit % 8);
+        if(provision_check(&bad) == 0){
+            CHECK(0, "bit %zu flipped not caught", bit);
+            break;
+        }
+    }
+    struct provision_record other = r;
+    other.version = PROVISION_VERSION + 1;
+    other.crc = lorawan_crc32(0, &other, sizeof(other) - sizeof(other.crc));
+    CHECK(provision_check(&other) == PROVISION_E_VERSION, "other version accepted");
+    uint8_t erased[SECTOR_SIZE];
+    memset(erased, 0xFF, sizeof(erased));
+    CHECK(provision_check((const struct provision_record*)erased) == PROVISION_E_EMPTY, "erased sector accepted");
+
+    // the UF2 blocks cover the sector, a page each, and give the record back
+    uint8_t sector[SECTOR_SIZE];
+    uint8_t uf2[UF2_BLOCKS * 512];
+    sector_image(&r, sector);
+    uf2_image(sector, PROVISION_OFFSET, uf2);
+    uint8_t back[SECTOR_SIZE];
+    for(uint32_t i = 0; i < UF2_BLOCKS; i++){
+        const uint8_t* b = uf2 + i * 512;
+        uint32_t addr32 = get32(b + 12);
+        CHECK(get32(b) == UF2_MAGIC_START0 && get32(b + 4) == UF2_MAGIC_START1 && get32(b + 508) == UF2_MAGIC_END &&
+              get32(b + 28) == UF2_FAMILY_RP2040 && get32(b + 24) == UF2_BLOCKS, "UF2 block %u", i);
+        CHECK(addr32 == XIP_BASE + PROVISION_OFFSET + i * PAGE_SIZE && addr32 % PAGE_SIZE == 0, "UF2 address %08x", addr32);
+        memcpy(back + (addr32 - XIP_BASE - PROVISION_OFFSET), b + 32, PAGE_SIZE);
+    }
+    CHECK(memcmp(back, sector, SECTOR_SIZE) == 0 && provision_check((const struct provision_record*)back) == 0,
+          "record out of the UF2");
+}
+
+/*
+    keys of an ABP setup: the loops of sscanf("%2hhx") lorawan.c ran at every boot, the parser of the settings strings,
+    a record copied
+*/
+static void time_parsing(void){
+    const char* addr = "260b1234";
+    const char* nwk = "000102030405060708090a0b0c0d0e0f";
+    const char* app = "0f0e0d0c0b0a09080706050403020100";
+    const char* mask = "00ff00000000000000000000";
+    const int runs = 200000;
+    volatile uint32_t sink = 0;
+    struct provision_record r = {0};
+    double ns[3];
+
+    for(int way = 0; way < 3; way++){
+        clock_t t0 = clock();
+        for(int n = 0; n < runs; n++){
+            struct provision_record out;
+            if(way == 0){
+                uint8_t b;
+                unsigned int w[2];
+                out.dev_addr = 0;
+                for(int i = 0; i < 4; i++){
+                    sscanf(addr + i * 2, "%2hhx", &b);
+                    out.dev_addr = (out.dev_addr << 8) | b;
+                }
+                for(int i = 0; i < 16; i++){
+                    sscanf(nwk + i * 2, "%2hhx", &b);
+                    out.nwk_s_key[i] = b;
+                    sscanf(app + i * 2, "%2hhx", &b);
+                    out.app_s_key[i] = b;
+                }
+                for(int i = 0; i < 6; i++){
+                    sscanf(mask + i * 4 + 0, "%2x", &w[0]);
+                    sscanf(mask + i * 4 + 2, "%2x", &w[1]);
+                    out.channel_mask[i] = (w[0] << 8) | w[1];
+                }
+            }else if(way == 1){
+                uint8_t a[4];
+                provision_hex(addr, a, 4);
+                provision_hex(nwk, out.nwk_s_key, 16);
+                provision_hex(app, out.app_s_key, 16);
+                provision_hex_mask(mask, out.channel_mask);
+                out.dev_addr = ((uint32_t)a[0] << 24) | ((uint32_t)a[1] << 16) | (a[2] << 8) | a[3];
+            }else{
+                memcpy(&out, &r, sizeof(out));
+                r.dev_addr++;
+            }
+            sink += out.dev_addr + out.nwk_s_key[n & 15] + out.channel_mask[n % 6];
+        }
+        ns[way] = (double)(clock() - t0) / CLOCKS_PER_SEC * 1e9 / runs;
+    }
+    printf("\nkeys of an ABP setup with a channel mask, on this host:\n");
+    printf("| way | calls | ns |\n");
+    printf("|-----|-------|----|\n");
+    printf("| sscanf(\"%%2hhx\") | 48 | %.0f |\n", ns[0]);
+    printf("| provision_hex of the settings strings | 4 | %.0f |\n", ns[1]);
+    printf("| provision record | 0 | %.0f |\n", ns[2]);
+    (void)sink;
+}
+
+int main(int argc, char** argv){
+    uint32_t offset = argc > 3 ? strtoul(argv[3], NULL, 16) : PROVISION_OFFSET;
+    if(offset % SECTOR_SIZE != 0 || offset >= 16 * 1024 * 1024){
+        printf("usage: %s [devices.csv] [output folder] [flash offset of the sector, hex, sector aligned]\n", argv[0]);
+        return 1;
+    }
+
+    check_record();
+    time_parsing();
+    if(argc > 1 && generate(argv[1], argc > 2 ? argv[2] : ".", offset) < 0)
+        failures++;
+
+    printf("%s\n", failures ? "FAILED" : "all checks passed");
+    return failures ? 1 : 0;
+}
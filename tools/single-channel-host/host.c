@@ -0,0 +1,234 @@
+/**
+ * @file host.c
+ * @brief host check of the single-channel mode of src/lorawan.c (src/single-channel.c) with a radio emulator: the
+ *          node picks a random channel among the ones enabled in its mask for every uplink, as the LoRaMac regions do,
+ *          and a single-channel gateway hears only the frames on its frequency and spreading factor. Every default
+ *          channel and every channel of the fixed grids must come out as a mask with only that channel, frequencies off
+ *          the grid and joins outside the default channels must be refused, every uplink of the single-channel mask
+ *          must reach the gateway while the mask of the region loses most of them. Then the node sends as soon as the
+ *          duty cycle allows it for a day (src/tx-scheduler.c) and the frames of every hour are compared with the rate
+ *          table, which is printed at the end for the given application payload.
+ *
+ *          build and run from this folder:
+ *          gcc -O2 -Wall -I../../src host.c ../../src/single-channel.c ../../src/tx-scheduler.c -o host
+ *          ./host [application payload bytes] [transmit current mA]
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "single-channel.h"
+#include "tx-scheduler.h"
+
+#define HOUR_MS         (60u * 60 * 1000)
+#define UPLINKS         10000
+
+// same tables of src/lorawan.c
+static const uint32_t eu868_defaults[] = {868100000, 868300000, 868500000};
+static const uint32_t as923_defaults[] = {923200000, 923400000};
+
+static const struct {
+    const char* name;
+    struct single_channel_plan plan;
+} plans[] = {
+    {"EU868", {eu868_defaults, 3}},
+    {"AS923", {as923_defaults, 2}},
+    {"US915", {NULL, 0, 902300000, 200000, 64, 903000000, 1600000, 8}},
+    {"AU915", {NULL, 0, 915200000, 200000, 64, 915900000, 1600000, 8}},
+    {"CN470", {NULL, 0, 470300000, 200000, 96, 0, 0, 0}},
+};
+#define PLANS           (sizeof(plans) / sizeof(plans[0]))
+
+static const struct tx_band eu868_bands[] = {
+    {865000000, 868000000, 100},
+    {868000000, 868600000, 100},
+    {868700000, 869200000, 1000},
+    {869400000, 869650000, 10},
+    {869700000, 870000000, 100},
+    {863000000, 865000000, 1000},
+};
+#define EU868_BANDS     (sizeof(eu868_bands) / sizeof(eu868_bands[0]))
+
+static int failures = 0;
+
+static int mask_bits(const uint16_t* mask){
+    int n = 0;
+    for(int w = 0; w < SINGLE_CHANNEL_MASK_SIZE; w++)
+        for(int b = 0; b < 16; b++)
+            n += (mask[w] >> b) & 1;
+    return n;
+}
+
+static int mask_has(const uint16_t* mask, int index){
+    return (mask[index / 16] >> (index % 16)) & 1;
+}
+
+/*
+    frequency of a channel as the region knows it, added is the frequency of the channel added by the node
+*/
+static uint32_t channel_frequency(const struct single_channel_plan* p, int index, uint32_t added){
+    if(p->n_defaults > 0)
+        return index < p->n_defaults ? p->defaults[index] : added;
+    if(index < p->grid_channels)
+        return p->grid_hz + index * p->grid_step_hz;
+    return p->wide_hz + (index - p->grid_channels) * p->wide_step_hz;
+}
+
+static void check_setup(void){
+    int checked = 0;
+    for(unsigned r = 0; r < PLANS; r++){
+        const struct single_channel_plan* p = &plans[r].plan;
+        int channels = p->n_defaults > 0 ? p->n_defaults : p->grid_channels + p->wide_channels;
+        for(int i = 0; i < channels; i++){
+            uint32_t freq = channel_frequency(p, i, 0);
+            struct single_channel_setup s;
+            for(int join = 0; join <= 1; join++){
+                if(single_channel_setup(p, freq, join, &s) < 0 || s.index != i || s.add || mask_bits(s.mask) != 1 ||
+                   !mask_has(s.mask, i) || s.wide != (p->n_defaults == 0 && i >= p->grid_channels)){
+                    failures++;
+                    printf("FAIL %s %u Hz: channel %u, %d channels in the mask\n", plans[r].name, freq, s.index,
+                        mask_bits(s.mask));
+                }
+                checked++;
+            }
+        }
+        struct single_channel_setup s;
+        if(p->n_defaults > 0){
+            //another frequency is added after the defaults, never for a join
+            uint32_t other = p->defaults[0] + 700000;
+            if(single_channel_setup(p, other, false, &s) < 0 || !s.add || s.index != p->n_defaults ||
+               mask_bits(s.mask) != 1 || !mask_has(s.mask, p->n_defaults)){
+                failures++;
+                printf("FAIL %s %u Hz not added as channel %u\n", plans[r].name, other, p->n_defaults);
+            }
+            if(single_channel_setup(p, other, true, &s) == 0){
+                failures++;
+                printf("FAIL %s join allowed on %u Hz\n", plans[r].name, other);
+            }
+        }else{
+            //off the grid, below and past the last channel
+            uint32_t wrong[] = {p->grid_hz + 100000, p->grid_hz - p->grid_step_hz,
+                                p->grid_hz + p->grid_channels * p->grid_step_hz + (p->wide_channels ? 100000 : 0)};
+            for(int i = 0; i < 3; i++)
+                if(single_channel_setup(p, wrong[i], false, &s) == 0){
+                    failures++;
+                    printf("FAIL %s %u Hz accepted as channel %u\n", plans[r].name, wrong[i], s.index);
+                }
+        }
+        checked += 2;
+    }
+    printf("%d channel setups checked\n", checked);
+}
+
+/*
+    one uplink: a random channel among the enabled ones, heard if the gateway listens there at that spreading factor
+*/
+static int emulate(const struct single_channel_plan* p, const uint16_t* mask, uint32_t added, uint8_t sf,
+                   uint32_t gw_freq, uint8_t gw_sf){
+    int enabled[96];
+    int n = 0;
+    for(int i = 0; i < 96; i++)
+        if(mask_has(mask, i))
+            enabled[n++] = i;
+    uint32_t freq = channel_frequency(p, enabled[rand() % n], added);
+    return freq == gw_freq && sf == gw_sf;
+}
+
+static void check_radio(void){
+    for(unsigned r = 0; r < PLANS; r++){
+        const struct single_channel_plan* p = &plans[r].plan;
+        uint32_t gw_freq = p->n_defaults > 0 ? p->defaults[0] + 700000 : p->grid_hz + 8 * p->grid_step_hz;
+        struct single_channel_setup s;
+        single_channel_setup(p, gw_freq, false, &s);
+
+        //mask of the region, every channel on
+        uint16_t all[SINGLE_CHANNEL_MASK_SIZE] = {0};
+        int channels = p->n_defaults > 0 ? p->n_defaults : p->grid_channels;
+        for(int i = 0; i < channels; i++)
+            all[i / 16] |= 1 << (i % 16);
+        if(p->n_defaults > 0)
+            all[s.index / 16] |= 1 << (s.index % 16);
+
+        int heard_single = 0;
+        int heard_all = 0;
+        int heard_wrong_sf = 0;
+        for(int i = 0; i < UPLINKS; i++){
+            heard_single += emulate(p, s.mask, gw_freq, 12, gw_freq, 12);
+            heard_all += emulate(p, all, gw_freq, 12, gw_freq, 12);
+            heard_wrong_sf += emulate(p, s.mask, gw_freq, 10, gw_freq, 12);
+        }
+        printf("  %s gateway on %u Hz SF12: %d of %d uplinks heard with the single-channel mask, %d with the mask of"
+            " the region, %d at SF10\n", plans[r].name, gw_freq, heard_single, UPLINKS, heard_all, heard_wrong_sf);
+        if(heard_single != UPLINKS || heard_all >= UPLINKS / 2 || heard_wrong_sf != 0){
+            failures++;
+            printf("FAIL %s radio emulation\n", plans[r].name);
+        }
+    }
+}
+
+static void check_duty_cycle(uint8_t phy_len, const struct single_channel_rate* rates){
+    for(int i = 0; i < SINGLE_CHANNEL_RATES; i++){
+        struct tx_scheduler s;
+        tx_scheduler_init(&s, eu868_bands, EU868_BANDS);
+        uint32_t freq = 868100000;
+        uint64_t now = 0;
+        uint32_t frames = 0;
+        uint32_t worst = 0;
+        uint32_t hour_frames = 0;
+        uint64_t hour_end = HOUR_MS;
+        while(now < 24ull * HOUR_MS){
+            now += tx_scheduler_wait_ms(&s, now, &freq, 1);
+            if(now >= hour_end){
+                if(hour_frames > worst)
+                    worst = hour_frames;
+                hour_frames = 0;
+                hour_end += HOUR_MS;
+                continue;
+            }
+            uint32_t us = tx_airtime_us(rates[i].sf, 125000, 1, 8, true, true, phy_len);
+            tx_scheduler_record(&s, now, freq, us);
+            frames++;
+            hour_frames++;
+            now += (us + 999) / 1000;
+        }
+        //the table is the sustained pace, an hour may hold one more frame start than that, never two
+        uint32_t mean = frames / 24;
+        if(worst > rates[i].frames_per_hour + 1 || mean + 1 < rates[i].frames_per_hour || mean > rates[i].frames_per_hour + 1){
+            failures++;
+            printf("FAIL SF%u: %u frames in the busiest hour, %u a day, table %u an hour\n", rates[i].sf, worst, frames,
+                rates[i].frames_per_hour);
+        }
+    }
+}
+
+int main(int argc, char** argv){
+    int app_len = argc > 1 ? atoi(argv[1]) : 24;
+    int tx_ma = argc > 2 ? atoi(argv[2]) : 45;
+    if(app_len < 0 || app_len > 242 || tx_ma <= 0){
+        printf("usage: %s [application payload bytes, 0 to 242] [transmit current mA]\n", argv[0]);
+        return 1;
+    }
+    uint8_t phy_len = (uint8_t)(13 + app_len);
+    srand(1);
+
+    check_setup();
+    check_radio();
+
+    struct single_channel_rate rates[SINGLE_CHANNEL_RATES];
+    single_channel_rates(125000, phy_len, 100, (uint16_t)tx_ma, rates);
+    check_duty_cycle(phy_len, rates);
+
+    printf("\n%d bytes of application payload at BW125 on a 1%% sub-band, %d mA while transmitting\n", app_len, tx_ma);
+    printf("| SF | time on air (ms) | frames/hour | payload (bytes/hour) | sensitivity (dBm) | charge/frame (uAh) |\n");
+    printf("|----|------------------|-------------|----------------------|-------------------|--------------------|\n");
+    for(int i = 0; i < SINGLE_CHANNEL_RATES; i++)
+        printf("| %u | %.1f | %u | %u | %.1f | %.2f |\n", rates[i].sf, rates[i].airtime_us / 1000.0,
+            rates[i].frames_per_hour, rates[i].payload_bytes_per_hour, rates[i].sensitivity_dbm_x10 / 10.0,
+            rates[i].charge_nah / 1000.0);
+
+    printf("%s\n", failures ? "FAILED" : "all checks passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,196 @@
+/**
+ * @file host.c
+ * @brief host test of the BSEC state store (executables/lib/state_store) on littlefs mounted on an image file, or
+ *          on the model of littlefs of ../lfs-host. Random blobs are saved, one in four the same as the last one,
+ *          which must be skipped without touching the flash. Power cuts stop the flash after a random number of
+ *          programs in the middle of a save: after mounting again, the restore must give the blob before the save
+ *          or the new one and nothing else. The newest slot is also corrupted now and then, as a torn or worn out
+ *          file would be, and the restore must fall back to the blob before it. A table gives the outcome.
+ *
+ *          build and run from this folder, on littlefs itself (LFS is the folder with lfs.c of the littlefs-lib
+ *          submodule) or on the model without the submodule:
+ *          LIB=../../executables/lib LFS=../../lib/littlefs-lib SRC=../../src
+ *          gcc -O2 -Wall -I../lfs-host -I$LFS -I$SRC/include -I$LIB/state_store host.c $LIB/state_store/state_store.c \
+ *              $SRC/crc32.c ../lfs-host/lfs-image.c $LFS/lfs.c $LFS/lfs_util.c -o host
+ *          gcc -O2 -Wall -I../lfs-host -I../lfs-host/model -I$SRC/include -I$LIB/state_store host.c \
+ *              $LIB/state_store/state_store.c $SRC/crc32.c ../lfs-host/lfs-model.c -o host
+ *          ./host [image] [saves]
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico_hal.h"
+#include "state_store.h"
+
+#define SLOT_A              "state_a.bin"
+#define SLOT_B              "state_b.bin"
+//BSEC_MAX_STATE_BLOB_SIZE of BSEC 2.4
+#define MAX_BLOB            221
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do{ \
+        if(!(cond)){ \
+            failures++; \
+            printf("FAIL line %d: ", __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    }while(0)
+
+struct blob {
+    uint32_t len;
+    uint8_t data[MAX_BLOB];
+};
+
+static void blob_random(struct blob* b){
+    b->len = 1 + rand() % MAX_BLOB;
+    for(uint32_t i = 0; i < b->len; i++)
+        b->data[i] = (uint8_t)rand();
+}
+
+static int blob_is(const struct blob* b, const uint8_t* data, int len){
+    return len == (int)b->len && memcmp(b->data, data, b->len) == 0;
+}
+
+/**
+ * @brief mounts the filesystem again as after a reset and restores the state on a new handle
+ *
+ * @return int result of state_store_restore
+ */
+static int reboot(struct state_store* store, uint8_t* data){
+    host_fs_power_cut(-1);
+    if(host_fs_reboot() < 0){
+        printf("Mount failed after a power cut\n");
+        exit(1);
+    }
+    state_store_init(store, SLOT_A, SLOT_B);
+    return state_store_restore(store, data, MAX_BLOB);
+}
+
+/**
+ * @brief flips a byte of the blob of the newest slot, the state store must notice it with the CRC
+ */
+static void corrupt(const struct state_store* store){
+    int file = pico_open(store->slot_name[store->current], LFS_O_RDWR);
+    uint8_t byte;
+    CHECK(file >= 0, "open of the slot to corrupt: %d", file);
+    if(file < 0)
+        return;
+    lfs_soff_t at = (lfs_soff_t)(sizeof(struct state_store_header) + (uint32_t)rand() % store->len);
+    pico_lseek(file, at, LFS_SEEK_SET);
+    pico_read(file, &byte, 1);
+    byte ^= (uint8_t)(1u << (rand() % 8));
+    pico_lseek(file, at, LFS_SEEK_SET);
+    pico_write(file, &byte, 1);
+    CHECK(pico_close(file) == 0, "close of the corrupted slot");
+}
+
+static void check_empty(void){
+    struct state_store store;
+    uint8_t data[MAX_BLOB];
+    struct blob b;
+
+    state_store_init(&store, SLOT_A, SLOT_B);
+    CHECK(state_store_restore(&store, data, sizeof(data)) == STATE_STORE_E_NO_STATE, "restore of an empty filesystem");
+
+    blob_random(&b);
+    b.len = MAX_BLOB;
+    CHECK(state_store_save(&store, b.data, b.len) == (int)b.len, "first save");
+    state_store_init(&store, SLOT_A, SLOT_B);
+    CHECK(state_store_restore(&store, data, MAX_BLOB - 1) == STATE_STORE_E_TOO_BIG, "restore in a buffer too small");
+    CHECK(state_store_restore(&store, data, sizeof(data)) == (int)b.len && blob_is(&b, data, (int)b.len),
+        "restore of the first save");
+    CHECK(pico_remove(SLOT_A) == 0, "remove of the slot");
+}
+
+int main(int argc, char* argv[]){
+    const char* path = argc > 1 ? argv[1] : "state.img";
+    long saves = argc > 2 ? atol(argv[2]) : 20000;
+    if(host_fs_format(path) < 0){
+        printf("Cannot format %s\n", path);
+        return 1;
+    }
+    srand(1);
+    check_empty();
+
+    struct state_store store;
+    uint8_t data[MAX_BLOB];
+    //the newest blob saved and the one before it, what the two slots hold
+    struct blob last = {0}, previous = {0};
+    int have_last = 0, have_previous = 0;
+    long written = 0, unchanged = 0, cuts = 0, cut_new = 0, cut_old = 0, corruptions = 0;
+    long progs_before = host_fs_progs();
+
+    state_store_init(&store, SLOT_A, SLOT_B);
+    for(long s = 0; s < saves && failures == 0; s++){
+        struct blob b;
+        int same = have_last && rand() % 4 == 0;
+        if(same)
+            b = last;
+        else
+            blob_random(&b);
+
+        //one save in five is cut, the budget ends somewhere in the commit of the slot
+        int cut = !same && rand() % 5 == 0;
+        host_fs_power_cut(cut ? rand() % 4 : -1);
+        long progs = host_fs_progs();
+        int rslt = state_store_save(&store, b.data, b.len);
+
+        if(same){
+            CHECK(rslt == STATE_STORE_UNCHANGED, "save %ld: unchanged blob written again, %d", s, rslt);
+            CHECK(host_fs_progs() == progs, "save %ld: unchanged blob programmed %ld pages", s, host_fs_progs() - progs);
+            unchanged++;
+            continue;
+        }
+
+        if(cut){
+            cuts++;
+            int len = reboot(&store, data);
+            if(rslt == (int)b.len || blob_is(&b, data, len)){
+                CHECK(blob_is(&b, data, len), "save %ld: saved before the cut but restored %d bytes of something else", s, len);
+                cut_new++;
+            }else if(have_last){
+                CHECK(blob_is(&last, data, len), "save %ld: cut save restored %d bytes, neither the new nor the previous blob", s, len);
+                cut_old++;
+                continue;
+            }else{
+                CHECK(len == STATE_STORE_E_NO_STATE, "save %ld: cut first save restored %d", s, len);
+                cut_old++;
+                continue;
+            }
+        }else{
+            CHECK(rslt == (int)b.len, "save %ld: %d", s, rslt);
+            int len = reboot(&store, data);
+            CHECK(blob_is(&b, data, len), "save %ld: restored %d bytes, not the blob saved", s, len);
+        }
+        written++;
+        previous = last;
+        have_previous = have_last;
+        last = b;
+        have_last = 1;
+
+        //one save in fifty finds its slot damaged at the next boot, the one before it comes back
+        if(have_previous && rand() % 50 == 0){
+            corrupt(&store);
+            int len = reboot(&store, data);
+            CHECK(blob_is(&previous, data, len), "save %ld: corrupted slot restored %d bytes, not the previous blob", s, len);
+            last = previous;
+            have_previous = 0;
+            corruptions++;
+        }
+    }
+
+    printf("| saves | written | skipped unchanged | power cuts | cut, new blob | cut, previous blob | corrupted slots | pages a write |\n");
+    printf("|-------|---------|-------------------|------------|---------------|--------------------|-----------------|---------------|\n");
+    printf("| %ld | %ld | %ld | %ld | %ld | %ld | %ld | %.1f |\n", saves, written, unchanged, cuts, cut_new, cut_old,
+        corruptions, written > 0 ? (double)(host_fs_progs() - progs_before) / written : 0.0);
+    host_fs_close();
+
+    printf("\n%s\n", failures == 0 ? "all checks passed" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
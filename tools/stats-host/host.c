@@ -0,0 +1,231 @@
+/**
+ * @file host.c
+ * @brief host check of the streaming statistics of executables/lib/stats against a double precision reference:
+ *          the outputs of class-a and class-c (temperature, humidity, pressure, IAQ, gas estimates) go through
+ *          random windows with the scales of the uplink, and the mean, min, max, last and EWMA of every window
+ *          must stay within the rounding of the fixed-point conversion of the reference computed on the same
+ *          signals. Then the corners: empty window, reset keeping the EWMA, outputs not followed, a full window,
+ *          rounding of negative values and saturation. A table gives the largest error of each channel.
+ *
+ *          build and run from this folder:
+ *          gcc -O2 -Wall -I../../executables/lib/stats host.c ../../executables/lib/stats/stats.c -o host -lm
+ *          ./host [windows]
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "stats.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do{ \
+        if(!(cond)){ \
+            failures++; \
+            printf("FAIL line %d: ", __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    }while(0)
+
+#define EWMA_SHIFT          3
+#define MAX_WINDOW          400
+
+// an output, its scale in the uplink and the range of its signal
+struct output {
+    const char* name;
+    uint8_t sensor_id;
+    float scale;
+    double low;
+    double high;
+};
+
+static const struct output outputs[] = {
+    {"temperature (degC)", 1, 100.0f, -20.0, 60.0},
+    {"humidity (%)", 2, 100.0f, 0.0, 100.0},
+    {"pressure (Pa)", 3, 0.1f, 90000.0, 110000.0},
+    {"IAQ", 4, 1.0f, 0.0, 500.0},
+    {"gas estimate 1", 5, 10000.0f, 0.0, 1.0},
+    {"gas estimate 2", 6, 10000.0f, 0.0, 1.0},
+    {"CO2 equivalent (ppm)", 7, 1.0f, 400.0, 5000.0},
+};
+
+#define N_OUTPUTS           (sizeof(outputs) / sizeof(outputs[0]))
+
+struct reference {
+    double sum, min, max, last, ewma;
+    int count;
+    int ewma_valid;
+};
+
+struct error {
+    double mean, min, max, last, ewma;
+};
+
+static double uniform(double low, double high){
+    return low + (high - low) * rand() / (double)RAND_MAX;
+}
+
+// a slow random walk with some noise, like a sensor, and now and then a jump
+static float next_signal(const struct output* o, double* state){
+    if(rand() % 50 == 0)
+        *state = uniform(o->low, o->high);
+    *state += (o->high - o->low) * uniform(-0.01, 0.01);
+    if(*state < o->low)
+        *state = o->low;
+    if(*state > o->high)
+        *state = o->high;
+    return (float)(*state + (o->high - o->low) * uniform(-0.002, 0.002));
+}
+
+static void reference_add(struct reference* r, double value){
+    if(r->count == 0 || value < r->min)
+        r->min = value;
+    if(r->count == 0 || value > r->max)
+        r->max = value;
+    r->last = value;
+    r->sum += value;
+    r->count++;
+    if(!r->ewma_valid){
+        r->ewma = value;
+        r->ewma_valid = 1;
+    }else{
+        r->ewma += (value - r->ewma) / (1 << EWMA_SHIFT);
+    }
+}
+
+static void worst(double* e, double fixed, double reference){
+    double d = fabs(fixed - reference);
+    if(d > *e)
+        *e = d;
+}
+
+/*
+    the fixed-point value of a sample is off by at most half a unit, the mean and the EWMA add half a unit of their
+    own rounding and the EWMA the truncation of its fractional bits, 2^shift / 2^frac at most. The signals are
+    floats on the node as well: signal * scale in float adds a relative error of 2^-23
+*/
+static double tolerance(double value, double extra){
+    return 0.5 + extra + fabs(value) * 2.4e-7;
+}
+
+static void check_windows(long windows, struct error* errors){
+    struct stats_window win;
+    struct reference ref[N_OUTPUTS] = {0};
+    double state[N_OUTPUTS];
+
+    stats_init(&win, EWMA_SHIFT);
+    for(unsigned o = 0; o < N_OUTPUTS; o++){
+        CHECK(stats_add_channel(&win, outputs[o].sensor_id, outputs[o].scale) == (int)o, "channel %u", o);
+        state[o] = uniform(outputs[o].low, outputs[o].high);
+    }
+
+    for(long w = 0; w < windows; w++){
+        int samples = 1 + rand() % MAX_WINDOW;
+        for(unsigned o = 0; o < N_OUTPUTS; o++)
+            ref[o].count = 0, ref[o].sum = 0;
+        for(int s = 0; s < samples; s++){
+            for(unsigned o = 0; o < N_OUTPUTS; o++){
+                float signal = next_signal(&outputs[o], &state[o]);
+                CHECK(stats_update(&win, outputs[o].sensor_id, signal), "update of %s", outputs[o].name);
+                reference_add(&ref[o], (double)signal * outputs[o].scale);
+            }
+        }
+
+        for(unsigned o = 0; o < N_OUTPUTS; o++){
+            const struct stats_channel* ch = stats_get(&win, outputs[o].sensor_id);
+            const struct reference* r = &ref[o];
+            double mean = r->sum / r->count;
+            double ewma_trunc = (double)(1 << EWMA_SHIFT) / (1 << STATS_EWMA_FRAC);
+
+            CHECK(ch->count == r->count, "%s: %u samples instead of %d", outputs[o].name, ch->count, r->count);
+            CHECK(fabs(stats_mean(ch) - mean) <= tolerance(mean, 0.5), "%s window %ld: mean %d, reference %.3f",
+                outputs[o].name, w, stats_mean(ch), mean);
+            CHECK(fabs(ch->min - r->min) <= tolerance(r->min, 0), "%s window %ld: min %d, reference %.3f",
+                outputs[o].name, w, ch->min, r->min);
+            CHECK(fabs(ch->max - r->max) <= tolerance(r->max, 0), "%s window %ld: max %d, reference %.3f",
+                outputs[o].name, w, ch->max, r->max);
+            CHECK(fabs(ch->last - r->last) <= tolerance(r->last, 0), "%s window %ld: last %d, reference %.3f",
+                outputs[o].name, w, ch->last, r->last);
+            CHECK(fabs(stats_ewma(ch) - r->ewma) <= tolerance(r->ewma, 0.5 + ewma_trunc),
+                "%s window %ld: EWMA %d, reference %.3f", outputs[o].name, w, stats_ewma(ch), r->ewma);
+
+            worst(&errors[o].mean, stats_mean(ch), mean);
+            worst(&errors[o].min, ch->min, r->min);
+            worst(&errors[o].max, ch->max, r->max);
+            worst(&errors[o].last, ch->last, r->last);
+            worst(&errors[o].ewma, stats_ewma(ch), r->ewma);
+        }
+        stats_reset(&win);
+    }
+}
+
+static void check_corners(void){
+    struct stats_window win;
+    const struct stats_channel* ch;
+
+    stats_init(&win, EWMA_SHIFT);
+    for(int i = 0; i < STATS_MAX_CHANNELS; i++)
+        CHECK(stats_add_channel(&win, (uint8_t)(10 + i), 1.0f) == i, "channel %d", i);
+    CHECK(stats_add_channel(&win, 99, 1.0f) == STATS_E_FULL, "a channel more than STATS_MAX_CHANNELS");
+    CHECK(!stats_update(&win, 99, 1.0f), "an output not followed was taken");
+    CHECK(stats_get(&win, 99) == NULL, "an output not followed has a channel");
+
+    ch = stats_get(&win, 10);
+    CHECK(stats_mean(ch) == 0 && stats_ewma(ch) == 0 && ch->count == 0, "empty window");
+
+    // rounding half away from zero, for the samples and the mean
+    stats_update(&win, 10, -2.5f);
+    CHECK(ch->last == -3 && ch->min == -3, "-2.5 is %d", ch->last);
+    stats_update(&win, 10, 2.5f);
+    CHECK(ch->last == 3 && ch->max == 3 && stats_mean(ch) == 0, "2.5 is %d, mean %d", ch->last, stats_mean(ch));
+    stats_update(&win, 10, -2.0f);
+    CHECK(stats_mean(ch) == -1, "mean of -3, 3, -2 is %d", stats_mean(ch));
+
+    // a new window starts empty and keeps the EWMA
+    int32_t ewma = stats_ewma(ch);
+    stats_reset(&win);
+    CHECK(ch->count == 0 && stats_mean(ch) == 0 && stats_ewma(ch) == ewma, "reset: count %u, EWMA %d instead of %d",
+        ch->count, stats_ewma(ch), ewma);
+    stats_update(&win, 10, 100.0f);
+    CHECK(ch->min == 100 && ch->max == 100 && stats_mean(ch) == 100, "first sample of a new window");
+    CHECK(stats_ewma(ch) != 100, "the EWMA started again on reset");
+
+    // saturation of the conversion
+    ch = stats_get(&win, 11);
+    stats_update(&win, 11, 1e12f);
+    CHECK(ch->last == INT32_MAX, "1e12 is %d", ch->last);
+    stats_update(&win, 11, -1e12f);
+    CHECK(ch->last == INT32_MIN, "-1e12 is %d", ch->last);
+
+    // a window never closed keeps the mean of its first samples, the other statistics go on
+    ch = stats_get(&win, 12);
+    for(long i = 0; i < UINT16_MAX; i++)
+        stats_update(&win, 12, 7.0f);
+    stats_update(&win, 12, 1000.0f);
+    CHECK(ch->count == UINT16_MAX && stats_mean(ch) == 7 && ch->max == 1000 && ch->last == 1000,
+        "full window: count %u, mean %d, max %d", ch->count, stats_mean(ch), ch->max);
+}
+
+int main(int argc, char* argv[]){
+    long windows = argc > 1 ? atol(argv[1]) : 2000;
+    struct error errors[N_OUTPUTS] = {0};
+
+    srand(1);
+    check_windows(windows, errors);
+    check_corners();
+
+    printf("%ld windows of 1 to %d samples, EWMA weight 1/%d, largest error in units of the uplink\n\n", windows,
+        MAX_WINDOW, 1 << EWMA_SHIFT);
+    printf("| output | scale | mean | min | max | last | EWMA |\n");
+    printf("|--------|-------|------|-----|-----|------|------|\n");
+    for(unsigned o = 0; o < N_OUTPUTS; o++)
+        printf("| %s | %g | %.3f | %.3f | %.3f | %.3f | %.3f |\n", outputs[o].name, outputs[o].scale, errors[o].mean,
+            errors[o].min, errors[o].max, errors[o].last, errors[o].ewma);
+
+    printf("\n%s\n", failures == 0 ? "all checks passed" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,189 @@
+/**
+ * @file bench.c
+ * @brief host benchmark of the delta codec (executables/lib/tscodec) against the 12 bytes struct uplink
+ *          and the plain batch frame (executables/lib/batch) on a trace of class-a readings.
+ *          The trace is a CSV file with one reading every 5 minutes and the fields of struct uplink:
+ *
+ *          temp,hum,press,AQI,CO2      e.g. 2470,3874,9967,16,600
+ *
+ *          without a file a week of readings is generated (daily cycle plus noise, fixed seed).
+ *          Every reading decoded is checked against the original with the tolerance of the quantization.
+ *
+ *          build and run from this folder:
+ *          gcc -O2 -I../../executables/lib/tscodec bench.c ../../executables/lib/tscodec/tscodec.c -lm -o bench
+ *          ./bench [trace.csv]
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "tscodec.h"
+
+#define CHANNELS            5
+#define MAX_READINGS        100000
+#define READING_PERIOD_S    300
+//struct uplink, id included
+#define UPLINK_LEN          12
+//batch frame: id and count, then age and reading without the id
+#define BATCH_HEADER_LEN    3
+#define BATCH_READING_LEN   12
+//id in front of the series in the delta frame
+#define DELTA_ID_LEN        2
+#define REPEAT              200
+
+static const uint16_t quantum[CHANNELS] = {5, 10, 1, 10, 1};
+static const char* channel_name[CHANNELS] = {"temp", "hum", "press", "AQI", "CO2"};
+static int32_t trace[MAX_READINGS][CHANNELS];
+
+/**
+ * @brief reads the trace from a CSV file
+ *
+ * @param path file name
+ * @return int readings read, -1 if the file cannot be opened
+ */
+static int load_trace(const char* path){
+    FILE* f = fopen(path, "r");
+    if(f == NULL)
+        return -1;
+    int n = 0;
+    char line[128];
+    while(n < MAX_READINGS && fgets(line, sizeof(line), f) != NULL){
+        int32_t* r = trace[n];
+        if(sscanf(line, "%d,%d,%d,%d,%d", &r[0], &r[1], &r[2], &r[3], &r[4]) == CHANNELS)
+            n++;
+    }
+    fclose(f);
+    return n;
+}
+
+/**
+ * @brief generates a week of readings, slow daily cycle plus sensor noise
+ *
+ * @return int readings generated
+ */
+static int generate_trace(){
+    int n = 7 * 24 * 3600 / READING_PERIOD_S;
+    srand(1);
+    double aqi = 50;
+    for(int i = 0; i < n; i++){
+        double day = 2 * M_PI * i * READING_PERIOD_S / 86400.0;
+        double noise = (rand() / (double)RAND_MAX - 0.5);
+        aqi += (rand() / (double)RAND_MAX - 0.5) * 4;
+        if(aqi < 25) aqi = 25;
+        if(aqi > 300) aqi = 300;
+        trace[i][0] = (int32_t)lround((21 + 3 * sin(day) + noise * 0.1) * 100);
+        trace[i][1] = (int32_t)lround((45 - 8 * sin(day) + noise * 0.5) * 100);
+        trace[i][2] = (int32_t)lround((1013 + 4 * sin(day / 7) + noise * 0.2) * 10);
+        trace[i][3] = (int32_t)lround(aqi * 10);
+        trace[i][4] = (int32_t)lround(400 + aqi * 4);
+    }
+    return n;
+}
+
+/**
+ * @brief encodes the whole trace in frames of max_payload bytes and checks the decoding
+ *
+ * @param n readings of the trace
+ * @param max_payload application payload of the datarate
+ * @param bytes filled with the bytes of all the frames
+ * @param frames filled with the number of frames
+ * @return int 0 if every reading decoded matches, -1 otherwise
+ */
+static int encode_trace(int n, uint8_t max_payload, long* bytes, long* frames){
+    uint8_t frame[256];
+    int32_t values[256 * CHANNELS];
+    uint32_t ages[256];
+    *bytes = 0;
+    *frames = 0;
+    int i = 0;
+    while(i < n){
+        struct ts_encoder enc;
+        ts_encoder_init(&enc, CHANNELS, quantum, &frame[DELTA_ID_LEN], max_payload - DELTA_ID_LEN);
+        int first = i;
+        while(i < n && ts_encoder_add(&enc, trace[i], (uint32_t)i * READING_PERIOD_S) > 0)
+            i++;
+        if(i == first)
+            return -1;
+        int len = ts_encoder_finish(&enc, (uint32_t)(i - 1) * READING_PERIOD_S);
+        *bytes += DELTA_ID_LEN + len;
+        (*frames)++;
+
+        int count = ts_decode(&frame[DELTA_ID_LEN], len, CHANNELS, quantum, values, ages, 255);
+        if(count != i - first)
+            return -1;
+        for(int k = 0; k < count; k++){
+            if(ages[k] != (uint32_t)(i - 1 - (first + k)) * READING_PERIOD_S)
+                return -1;
+            for(int c = 0; c < CHANNELS; c++)
+                if(abs(values[k * CHANNELS + c] - trace[first + k][c]) > quantum[c] / 2)
+                    return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]){
+    int n = argc > 1 ? load_trace(argv[1]) : generate_trace();
+    if(n <= 0){
+        printf("Cannot read the trace\n");
+        return 1;
+    }
+    printf("%d readings, %s\n", n, argc > 1 ? argv[1] : "generated week");
+    printf("quantization:");
+    for(int c = 0; c < CHANNELS; c++)
+        printf(" %s %u", channel_name[c], quantum[c]);
+    printf("\n\n");
+
+    printf("payload  struct uplink[B]  batch[B]  delta[B]  frames batch/delta  bytes/reading  ratio vs struct\n");
+    const uint8_t payloads[] = {51, 115, 222};
+    for(unsigned p = 0; p < sizeof(payloads); p++){
+        long delta_bytes, delta_frames;
+        if(encode_trace(n, payloads[p], &delta_bytes, &delta_frames) < 0){
+            printf("Round trip failed with payload %u\n", payloads[p]);
+            return 1;
+        }
+        int per_batch = (payloads[p] - BATCH_HEADER_LEN) / BATCH_READING_LEN;
+        long batch_frames = (n + per_batch - 1) / per_batch;
+        long batch_bytes = batch_frames * BATCH_HEADER_LEN + (long)n * BATCH_READING_LEN;
+        printf("%7u  %16ld  %8ld  %8ld  %8ld/%-8ld  %13.2f  %14.2fx\n", payloads[p], (long)n * UPLINK_LEN, batch_bytes,
+            delta_bytes, batch_frames, delta_frames, delta_bytes / (double)n, (double)n * UPLINK_LEN / delta_bytes);
+    }
+
+    //encode cost, frames of the largest payload encoded again and again
+    clock_t start = clock();
+    for(int r = 0; r < REPEAT; r++){
+        uint8_t frame[256];
+        int i = 0;
+        while(i < n){
+            struct ts_encoder enc;
+            ts_encoder_init(&enc, CHANNELS, quantum, frame, 220);
+            while(i < n && ts_encoder_add(&enc, trace[i], (uint32_t)i * READING_PERIOD_S) > 0)
+                i++;
+            ts_encoder_finish(&enc, (uint32_t)i * READING_PERIOD_S);
+        }
+    }
+    double delta_ns = (clock() - start) * 1e9 / CLOCKS_PER_SEC / ((double)n * REPEAT);
+
+    start = clock();
+    volatile uint8_t sink = 0;
+    for(int r = 0; r < REPEAT; r++){
+        for(int i = 0; i < n; i++){
+            uint8_t frame[UPLINK_LEN];
+            frame[0] = 4;
+            frame[1] = 0;
+            for(int c = 0; c < CHANNELS; c++){
+                frame[2 + 2 * c] = (uint8_t)(trace[i][c] & 0xFF);
+                frame[3 + 2 * c] = (uint8_t)((trace[i][c] >> 8) & 0xFF);
+            }
+            sink ^= frame[r % UPLINK_LEN];
+        }
+    }
+    double struct_ns = (clock() - start) * 1e9 / CLOCKS_PER_SEC / ((double)n * REPEAT);
+    printf("\nencode cost on this host: struct %.1f ns/reading, delta %.1f ns/reading\n", struct_ns, delta_ns);
+    return 0;
+}
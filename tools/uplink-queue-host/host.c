@@ -0,0 +1,148 @@
+/**
+ * @file host.c
+ * @brief host test of the uplink queue (executables/lib/uplink_queue) on littlefs mounted on an image file with
+ *          the same geometry of the flash of the pico, or on the model of littlefs of ../lfs-host. Random pushes
+ *          and pops are checked against a model of the queue, and power cuts are simulated by letting the flash
+ *          stop programming after a random number of writes, on the image the write it stops in is left torn: the
+ *          filesystem is mounted again, the queue is opened again and it must hold either the frames before or the
+ *          frames after the interrupted operation. The run on the image is the one that counts, the model doesn't
+ *          tear pages.
+ *
+ *          build and run from this folder, on littlefs itself (LFS is the folder with lfs.c of the littlefs-lib
+ *          submodule) or on the model of ../lfs-host/lfs-model.c without the submodule:
+ *          LIB=../../executables/lib LFS=../../lib/littlefs-lib SRC=../../src
+ *          gcc -O2 -Wall -I../lfs-host -I$LFS -I$SRC/include -I$LIB/uplink_queue host.c \
+ *              $LIB/uplink_queue/uplink_queue.c $SRC/crc32.c ../lfs-host/lfs-image.c $LFS/lfs.c $LFS/lfs_util.c -o host
+ *          gcc -O2 -Wall -I../lfs-host -I../lfs-host/model -I$SRC/include -I$LIB/uplink_queue host.c \
+ *              $LIB/uplink_queue/uplink_queue.c $SRC/crc32.c ../lfs-host/lfs-model.c -o host
+ *          ./host [image] [operations]
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico_hal.h"
+#include "uplink_queue.h"
+
+#define CAPACITY            16
+#define MAX_FRAMES          100000
+
+/**
+ * @brief mounts the filesystem again as after a reset
+ */
+static void reboot(){
+    host_fs_power_cut(-1);
+    if(host_fs_reboot() < 0){
+        printf("Mount failed after a power cut\n");
+        exit(1);
+    }
+}
+
+/*
+    model of the queue, frames are identified by their number, the payload is derived from it
+*/
+static uint32_t model[MAX_FRAMES];
+static int model_head;
+static int model_tail;
+
+static uint8_t frame_len(uint32_t id){
+    return 1 + id % 60;
+}
+
+static void frame_fill(uint32_t id, uint8_t* buf){
+    for(uint8_t i = 0; i < frame_len(id); i++)
+        buf[i] = (uint8_t)(id * 31 + i);
+}
+
+/**
+ * @brief checks the queue against the model by reading the oldest frame
+ *
+ * @param q queue
+ * @param head first frame of the model
+ * @param tail end of the model
+ * @return int 1 if the queue matches
+ */
+static int matches(struct uplink_queue* q, int head, int tail){
+    uint8_t buf[UPLINK_QUEUE_MAX_PAYLOAD];
+    uint8_t expected[UPLINK_QUEUE_MAX_PAYLOAD];
+    uint8_t port;
+    if(q->count != tail - head)
+        return 0;
+    if(head == tail)
+        return 1;
+    int len = uplink_queue_peek(q, &port, buf, sizeof(buf));
+    frame_fill(model[head], expected);
+    return len == frame_len(model[head]) && port == 1 + model[head] % 200 && memcmp(buf, expected, len) == 0;
+}
+
+int main(int argc, char* argv[]){
+    const char* path = argc > 1 ? argv[1] : "queue.img";
+    long operations = argc > 2 ? atol(argv[2]) : 20000;
+    if(host_fs_format(path) < 0){
+        printf("Cannot format %s\n", path);
+        return 1;
+    }
+
+    struct uplink_queue q;
+    uplink_queue_open(&q, "uplink_queue.log", "uplink_queue.tmp", CAPACITY, UPLINK_QUEUE_DROP_OLDEST);
+    srand(1);
+    uint32_t next_id = 0;
+    long cuts = 0;
+    long before_cut = 0;
+    long after_cut = 0;
+    for(long op = 0; op < operations && next_id < MAX_FRAMES; op++){
+        int old_head = model_head;
+        int old_tail = model_tail;
+        //one operation in 20 is interrupted by a power cut
+        int cut = rand() % 20 == 0;
+        host_fs_power_cut(cut ? rand() % 6 : -1);
+
+        int rslt;
+        if(rand() % 2){
+            uint8_t buf[UPLINK_QUEUE_MAX_PAYLOAD];
+            uint32_t id = next_id++;
+            frame_fill(id, buf);
+            rslt = uplink_queue_push(&q, 1 + id % 200, buf, frame_len(id));
+            if(model_tail - model_head == CAPACITY)
+                model_head++;
+            model[model_tail++] = id;
+        }else{
+            rslt = uplink_queue_pop(&q);
+            if(model_tail > model_head)
+                model_head++;
+        }
+
+        if(cut){
+            reboot();
+            uplink_queue_open(&q, "uplink_queue.log", "uplink_queue.tmp", CAPACITY, UPLINK_QUEUE_DROP_OLDEST);
+            cuts++;
+            if(matches(&q, model_head, model_tail)){
+                after_cut++;
+            }else if(matches(&q, old_head, old_tail)){
+                //the operation didn't reach the flash, the model goes back
+                model_head = old_head;
+                model_tail = old_tail;
+                before_cut++;
+            }else if(model_head != old_head && model_tail != old_tail && matches(&q, model_head, old_tail)){
+                //push in a full queue: the oldest frame was dropped, the cut came before the new one was written
+                model_tail = old_tail;
+                before_cut++;
+            }else{
+                printf("Operation %ld: queue of %u frames doesn't match the model after a power cut\n", op, q.count);
+                return 1;
+            }
+        }else if(rslt < 0 || !matches(&q, model_head, model_tail)){
+            printf("Operation %ld: result %d, queue of %u frames doesn't match the model of %d\n",
+                op, rslt, q.count, model_tail - model_head);
+            return 1;
+        }
+    }
+
+    printf("%ld operations, %lu frames pushed, %ld power cuts: %ld kept the operation, %ld rolled it back, %u frames waiting\n",
+        operations, (unsigned long)next_id, cuts, after_cut, before_cut, q.count);
+    host_fs_close();
+    return 0;
+}